@@ -0,0 +1,70 @@
+package de.jpaw.jni.bench;
+
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.infra.Blackhole;
+
+import de.jpaw.offHeap.LongToByteArrayOffHeapMap;
+
+// Same operations as getSmallOp and deleteOpNoTx of OffHeapMapBench, but on a map which is much bigger than the L3 cache,
+// with random keys, to compare the hash chains with the open addressing table.
+// Invocation:
+// java -Djava.library.path=$HOME/lib -jar target/offheap-bench.jar LargeMapBench -i 3 -f 1 -wi 3
+
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@State(value = Scope.Thread)
+public class LargeMapBench {
+    private static final byte [] SHORTDATA = { (byte)1, (byte)2, (byte)3 };
+    private static final long MULTIPLIER = 0x9E3779B97F4A7C15L;     // spreads the keys over the whole long range
+
+    @Param({ "4000000" })
+    public int numEntries;
+
+    @Param({ "chained", "openAddressing" })
+    public String engine;
+
+    private LongToByteArrayOffHeapMap map = null;
+    private long seed = 0L;
+
+    @Setup
+    public void setUp() {
+        LongToByteArrayOffHeapMap.Builder builder = new LongToByteArrayOffHeapMap.Builder();
+        builder.setHashSize(numEntries).setAutonomous();
+        if ("openAddressing".equals(engine))
+            builder.setOpenAddressing();
+        map = builder.build();
+        for (int i = 0; i < numEntries; ++i)
+            map.set(i * MULTIPLIER, SHORTDATA);
+    }
+
+    @TearDown
+    public void tearDown() {
+        map.close();
+    }
+
+    private long nextKey() {
+        seed = (seed + 0x7f4a7c15L) % numEntries;
+        return seed * MULTIPLIER;
+    }
+
+    @Benchmark
+    public void getSmallOp(Blackhole bh) {
+        bh.consume(map.get(nextKey()));
+    }
+
+    @Benchmark
+    public void deleteOpNoTx() {
+        // deletes a key which does not exist, as deleteOpNoTx of OffHeapMapBench
+        map.delete(nextKey() + 1L);
+    }
+}
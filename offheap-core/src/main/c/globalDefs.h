@@ -3,6 +3,9 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <jni.h>
 #include <lz4.h>
 // #include "jpawMap.h"
@@ -31,14 +34,33 @@
 #define TRANSACTIONAL       0x01    // allow to rollback / safepoints
 #define REDOLOG_ASYNC       0x02    // allow replaying on a different database - fast
 #define REDOLOG_SYNC        0x04    // allow replaying on a different database - safe
+#define OPEN_ADDRESSING     0x08    // data maps only: use the open addressing table (jpawProbe.c) instead of hash chains
 #define IS_UNIQUE_UNDEX     0x10    // is an index AND it is unique
 #define IS_INDEX            0x20    // is an index
-#define INDEX_HASH_IS_KEY   0x40    // the index type is byte, short, char or int and is stored instead of an index. data size is 0
+#define INDEX_HASH_IS_KEY   0x40    // index values have a fixed width of up to 16 bytes (0 for byte, short, char or int, where the hash is the value),
+                                    // and are stored in a flat table (jpawCompact.c) instead of hash chains. Not combinable with ORDERED_KEYS
 
 #define VIEW_INDEX_MASK     0x70    // bits to keep on the committed view... these are the index settings.
 
 #define AS_PER_TRANSACTION  0x80    // no override in map
 
+// compression settings of data maps, in the upper bits of the modes passed to natOpen (see jpawCodec.h)
+#define CODEC_ID_SHIFT          8       // bits 8..11: codec id
+#define CODEC_LEVEL_SHIFT       12      // bits 12..19: codec level, 0 = default
+#define CODEC_SAVINGS_SHIFT     20      // bits 20..26: minimum savings in percent, entries which compress worse are stored uncompressed
+#define CODEC_ID(mode)          (((mode) >> CODEC_ID_SHIFT) & 0x0f)
+#define CODEC_LEVEL(mode)       (((mode) >> CODEC_LEVEL_SHIFT) & 0xff)
+#define CODEC_SAVINGS(mode)     (((mode) >> CODEC_SAVINGS_SHIFT) & 0x7f)
+
+// width of the values of index maps with INDEX_HASH_IS_KEY, in the bits used for the codec by data maps
+#define INDEX_WIDTH_SHIFT       8
+#define INDEX_WIDTH(mode)       (((mode) >> INDEX_WIDTH_SHIFT) & 0x1f)
+
+#define ORDERED_KEYS            0x08000000  // data maps: use the B+tree (jpawTree.c) instead of hash chains, for range scans and ordered iteration.
+                                            // index maps: keep the entries in order of the index value as well (jpawSorted.c), for range and prefix scans
+#define POSTING_LISTS           0x10000000  // non-unique index maps: one node per distinct value, with the keys as posting list (jpawPosting.c), instead of an entry per key.
+                                            // Takes precedence over INDEX_HASH_IS_KEY, not combinable with ORDERED_KEYS
+
 
 #define IS_TRANSACTIONAL(ctx, mapdata)  ((ctx) && ((mapdata)->modes & TRANSACTIONAL) != 0 && (ctx)->modes != 0)
 #define TX_LOG_ENTRIES_PER_CHUNK_LV1    1024        // first level blocks
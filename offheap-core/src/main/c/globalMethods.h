@@ -8,6 +8,24 @@ void throwOutOfMemory(JNIEnv *env);
 void throwAny(JNIEnv *env, char *msg);
 
 void commitToView(struct tx_log_entry *ep, jlong transactionReference);
+// the committed views changed by a commit. beginViewUpdate / endViewUpdate bracket the application of the commit to them,
+// and wait until none of them is pinned by a parallel scan
+#define VIEW_UPDATE_INLINE      8
+#define VIEW_UPDATE_PINNED      1       // the calling thread pins a view of the commit, which therefore would wait forever
+#define VIEW_UPDATE_NO_MEMORY   2
+struct viewUpdate {
+    struct map **views;
+    int count;
+    int capacity;
+    struct map *inlineViews[VIEW_UPDATE_INLINE];
+};
+void viewUpdateInit(struct viewUpdate *u);
+// adds the committed view of the map of a change. Returns 0 if OK, else VIEW_UPDATE_PINNED or VIEW_UPDATE_NO_MEMORY
+int viewUpdateAdd(struct viewUpdate *u, const struct tx_log_entry *ep);
+void viewUpdateDiscard(struct viewUpdate *u);
+void beginViewUpdate(struct viewUpdate *u);
+// also discards u
+void endViewUpdate(struct viewUpdate *u);
 void rollback(struct tx_log_entry *ep);
 void print(struct tx_log_entry *ep, int i);
 
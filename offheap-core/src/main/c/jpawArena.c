@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+#include "jpawArena.h"
+
+// the first ARENA_GRANULE bytes of a slab hold the link to the next slab, to keep the blocks aligned
+#define SLAB_HEADER_SIZE        ARENA_GRANULE
+
+
+struct arena *arenaCreate(void) {
+    struct arena *a = malloc(sizeof(struct arena));
+    if (a)
+        memset(a, 0, sizeof(struct arena));
+    return a;
+}
+
+void arenaReset(struct arena *a) {
+    void *slab = a->slabs;
+    while (slab) {
+        void *next = *(void **)slab;
+        free(slab);
+        slab = next;
+    }
+    struct arenaLargeBlock *b = a->large;
+    while (b) {
+        struct arenaLargeBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    void *scratch = a->scratch;
+    size_t scratchSize = a->scratchSize;
+    memset(a, 0, sizeof(struct arena));
+    a->scratch = scratch;           // the scratch buffer is not part of the map contents, keep it
+    a->scratchSize = scratchSize;
+}
+
+void arenaDestroy(struct arena *a) {
+    arenaReset(a);
+    if (a->scratch)
+        free(a->scratch);
+    free(a);
+}
+
+static void *allocLarge(struct arena *a, size_t size) {
+    struct arenaLargeBlock *b = malloc(sizeof(struct arenaLargeBlock) + size);
+    if (!b)
+        return NULL;
+    b->size = size;
+    b->prev = NULL;
+    b->next = a->large;
+    if (a->large)
+        a->large->prev = b;
+    a->large = b;
+    ++a->numLargeBlocks;
+    a->largeBytes += size;
+    a->bytesUsed += size;
+    return b + 1;
+}
+
+static void freeLarge(struct arena *a, void *p) {
+    struct arenaLargeBlock *b = (struct arenaLargeBlock *)p - 1;
+    if (b->prev)
+        b->prev->next = b->next;
+    else
+        a->large = b->next;
+    if (b->next)
+        b->next->prev = b->prev;
+    --a->numLargeBlocks;
+    a->largeBytes -= b->size;
+    a->bytesUsed -= b->size;
+    free(b);
+}
+
+static inline void pushFree(struct arena *a, void *p, size_t size) {
+    void **head = &a->freeList[size / ARENA_GRANULE];
+    *(void **)p = *head;
+    *head = p;
+}
+
+void *arenaAlloc(struct arena *a, size_t size) {
+    if (size > ARENA_MAX_CLASS_SIZE)
+        return allocLarge(a, size);
+    void **head = &a->freeList[size / ARENA_GRANULE];
+    void *p = *head;
+    if (p) {
+        *head = *(void **)p;
+    } else {
+        if ((size_t)(a->end - a->current) < size) {
+            // start a new slab. The rest of the current one is kept as a free block of its size
+            char *slab = malloc(ARENA_SLAB_SIZE);
+            if (!slab)
+                return NULL;
+            if (a->end > a->current)
+                pushFree(a, a->current, a->end - a->current);
+            *(void **)slab = a->slabs;
+            a->slabs = slab;
+            a->current = slab + SLAB_HEADER_SIZE;
+            a->end = slab + ARENA_SLAB_SIZE;
+            ++a->numSlabs;
+        }
+        p = a->current;
+        a->current += size;
+    }
+    a->bytesUsed += size;
+    return p;
+}
+
+void arenaFree(struct arena *a, void *p, size_t size) {
+    if (size > ARENA_MAX_CLASS_SIZE) {
+        freeLarge(a, p);
+        return;
+    }
+    pushFree(a, p, size);
+    a->bytesUsed -= size;
+}
+
+void *arenaScratch(struct arena *a, size_t size) {
+    if (size > a->scratchSize) {
+        void *buffer = malloc(size);
+        if (!buffer)
+            return NULL;
+        if (a->scratch)
+            free(a->scratch);
+        a->scratch = buffer;
+        a->scratchSize = size;
+    }
+    return a->scratch;
+}
+
+void arenaGetStats(const struct arena *a, jlong *stats, int n) {
+    jlong values[ARENA_NUM_STATS];
+    jlong slabBytes = a->numSlabs * (jlong)ARENA_SLAB_SIZE;
+    values[ARENA_STAT_BYTES_USED] = a->bytesUsed;
+    values[ARENA_STAT_BYTES_WASTED] = slabBytes - (a->bytesUsed - a->largeBytes);
+    values[ARENA_STAT_SLABS] = a->numSlabs;
+    values[ARENA_STAT_LARGE_BLOCKS] = a->numLargeBlocks;
+    values[ARENA_STAT_BYTES_RESERVED] = slabBytes + a->largeBytes;
+    if (n > 0)
+        memcpy(stats, values, (n < ARENA_NUM_STATS ? n : ARENA_NUM_STATS) * sizeof(jlong));
+}
@@ -0,0 +1,65 @@
+#ifndef _Included_jpawArena
+#define _Included_jpawArena
+
+#include <stddef.h>
+#include <jni.h>
+
+// Size class allocator for dataEntry storage, one per map (shared by the map and its committed view).
+// Block sizes are multiples of ARENA_GRANULE (as produced by ROUND_UP_SIZE), every size has its own free list.
+// New blocks are cut from slabs of ARENA_SLAB_SIZE bytes, blocks bigger than ARENA_MAX_CLASS_SIZE are malloc'd individually.
+// The caller passes the size of a block when freeing it, the blocks themselves have no header.
+// An arena is not thread safe, it must be used from the thread which modifies the map only.
+
+#define ARENA_GRANULE           16
+#define ARENA_SLAB_SIZE         (1024 * 1024)
+#define ARENA_MAX_CLASS_SIZE    8192
+#define ARENA_NUM_CLASSES       (ARENA_MAX_CLASS_SIZE / ARENA_GRANULE + 1)
+
+// indexes into the statistics array
+#define ARENA_STAT_BYTES_USED       0       // bytes in allocated blocks
+#define ARENA_STAT_BYTES_WASTED     1       // bytes of slabs which are not allocated (free lists, unused space of the current slab)
+#define ARENA_STAT_SLABS            2       // number of slabs
+#define ARENA_STAT_LARGE_BLOCKS     3       // number of blocks allocated individually
+#define ARENA_STAT_BYTES_RESERVED   4       // total memory obtained from the system (slabs and large blocks)
+#define ARENA_NUM_STATS             5
+
+struct arenaLargeBlock {
+    struct arenaLargeBlock *prev;
+    struct arenaLargeBlock *next;
+    size_t size;
+    size_t padding;                 // keep the payload 16 byte aligned
+};
+
+struct arena {
+    void *freeList[ARENA_NUM_CLASSES];  // by size / ARENA_GRANULE. The first word of a free block points to the next one
+    void *slabs;                        // linked list of slabs, the first word of each slab points to the next one
+    char *current;                      // unused space of the most recent slab
+    char *end;
+    struct arenaLargeBlock *large;      // blocks bigger than ARENA_MAX_CLASS_SIZE
+    void *scratch;                      // temporary buffer, see arenaScratch()
+    size_t scratchSize;
+    jlong bytesUsed;
+    jlong numSlabs;
+    jlong numLargeBlocks;
+    jlong largeBytes;
+};
+
+// returns NULL if no memory is available
+struct arena *arenaCreate(void);
+// releases all memory, including the arena itself
+void arenaDestroy(struct arena *a);
+// releases all blocks at once. The slabs are returned to the system.
+void arenaReset(struct arena *a);
+
+// size must be a multiple of ARENA_GRANULE. Returns NULL if no memory is available
+void *arenaAlloc(struct arena *a, size_t size);
+// size must be the same as passed to arenaAlloc()
+void arenaFree(struct arena *a, void *p, size_t size);
+
+// returns a buffer of at least size bytes, which is reused by subsequent calls. NULL if no memory is available
+void *arenaScratch(struct arena *a, size_t size);
+
+// fills up to n statistics values, in the order of the ARENA_STAT_ constants
+void arenaGetStats(const struct arena *a, jlong *stats, int n);
+
+#endif
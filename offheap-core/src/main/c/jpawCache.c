@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <string.h>
+#include "jpawCache.h"
+
+#define CACHE_BYTES_PER_SLOT    128         // expected payload size, determines the size of the hash table
+#define CACHE_MIN_SHIFT         8
+#define CACHE_MAX_SHIFT         24
+#define CACHE_MAX_ITEM_SHARE    4           // payloads bigger than capacity / CACHE_MAX_ITEM_SHARE are not cached
+
+
+static inline struct cacheItem **findSlot(struct valueCache *c, const void *key) {
+    // entries are aligned to 16 bytes, the multiplication spreads the remaining bits
+    return &c->table[(((uintptr_t)key >> 4) * 0x9E3779B97F4A7C15ULL) >> c->tableShift];
+}
+
+static inline struct cacheItem *findItem(struct valueCache *c, const void *key) {
+    struct cacheItem *item = *findSlot(c, key);
+    while (item && item->key != key)
+        item = item->hashNext;
+    return item;
+}
+
+static void unlinkItem(struct valueCache *c, struct cacheItem *item) {
+    struct cacheItem **p = findSlot(c, item->key);
+    while (*p != item)
+        p = &(*p)->hashNext;
+    *p = item->hashNext;
+    if (item->clockNext == item) {
+        c->hand = NULL;
+    } else {
+        item->clockPrev->clockNext = item->clockNext;
+        item->clockNext->clockPrev = item->clockPrev;
+        if (c->hand == item)
+            c->hand = item->clockNext;
+    }
+    c->used -= item->length;
+    --c->entries;
+    free(item);
+}
+
+
+struct valueCache *cacheCreate(jlong capacity) {
+    struct valueCache *c = malloc(sizeof(struct valueCache));
+    if (!c)
+        return NULL;
+    memset(c, 0, sizeof(struct valueCache));
+    int bits = CACHE_MIN_SHIFT;
+    while (bits < CACHE_MAX_SHIFT && ((jlong)1 << bits) * CACHE_BYTES_PER_SLOT < capacity)
+        ++bits;
+    c->tableShift = 64 - bits;
+    c->table = calloc((size_t)1 << bits, sizeof(struct cacheItem *));
+    if (!c->table || pthread_mutex_init(&c->lock, NULL)) {
+        free(c->table);
+        free(c);
+        return NULL;
+    }
+    c->capacity = capacity;
+    return c;
+}
+
+void cacheDestroy(struct valueCache *c) {
+    cacheClear(c);
+    pthread_mutex_destroy(&c->lock);
+    free(c->table);
+    free(c);
+}
+
+int cacheGet(struct valueCache *c, const void *key, char *dst, int length) {
+    pthread_mutex_lock(&c->lock);
+    struct cacheItem *item = findItem(c, key);
+    if (!item) {
+        ++c->misses;
+        pthread_mutex_unlock(&c->lock);
+        return -1;
+    }
+    item->referenced = 1;
+    ++c->hits;
+    memcpy(dst, item->data, length);
+    pthread_mutex_unlock(&c->lock);
+    return 0;
+}
+
+struct cacheItem *cacheNewItem(struct valueCache *c, const void *key, int length) {
+    if (length > c->capacity / CACHE_MAX_ITEM_SHARE)
+        return NULL;
+    struct cacheItem *item = malloc(sizeof(struct cacheItem) + length);
+    if (!item)
+        return NULL;
+    item->key = key;
+    item->length = length;
+    item->referenced = 0;       // an item must be hit once to survive a pass of the hand
+    item->generation = __atomic_load_n(&c->generation, __ATOMIC_SEQ_CST);
+    return item;
+}
+
+void cacheInsert(struct valueCache *c, struct cacheItem *item) {
+    pthread_mutex_lock(&c->lock);
+    // a removal since the miss could have been the one of this key
+    if (item->generation != c->generation || findItem(c, item->key)) {
+        pthread_mutex_unlock(&c->lock);
+        free(item);
+        return;
+    }
+    // CLOCK: advance the hand, evicting unreferenced items and clearing the reference bit of the others
+    while (c->hand && c->used + item->length > c->capacity) {
+        struct cacheItem *victim = c->hand;
+        if (victim->referenced) {
+            victim->referenced = 0;
+            c->hand = victim->clockNext;
+        } else {
+            unlinkItem(c, victim);
+        }
+    }
+    struct cacheItem **slot = findSlot(c, item->key);
+    item->hashNext = *slot;
+    *slot = item;
+    // new items go just behind the hand, i.e. they are the last ones to be inspected
+    if (c->hand) {
+        item->clockNext = c->hand;
+        item->clockPrev = c->hand->clockPrev;
+        item->clockPrev->clockNext = item;
+        c->hand->clockPrev = item;
+    } else {
+        item->clockNext = item;
+        item->clockPrev = item;
+        c->hand = item;
+    }
+    c->used += item->length;
+    ++c->entries;
+    pthread_mutex_unlock(&c->lock);
+}
+
+void cacheRemove(struct valueCache *c, const void *key) {
+    pthread_mutex_lock(&c->lock);
+    __atomic_add_fetch(&c->generation, 1, __ATOMIC_SEQ_CST);
+    struct cacheItem *item = findItem(c, key);
+    if (item)
+        unlinkItem(c, item);
+    pthread_mutex_unlock(&c->lock);
+}
+
+void cacheClear(struct valueCache *c) {
+    pthread_mutex_lock(&c->lock);
+    __atomic_add_fetch(&c->generation, 1, __ATOMIC_SEQ_CST);
+    while (c->hand)
+        unlinkItem(c, c->hand);
+    pthread_mutex_unlock(&c->lock);
+}
+
+void cacheGetStats(struct valueCache *c, jlong *values, int n) {
+    jlong stats[CACHE_NUM_STATS];
+    pthread_mutex_lock(&c->lock);
+    stats[CACHE_STAT_HITS] = c->hits;
+    stats[CACHE_STAT_MISSES] = c->misses;
+    stats[CACHE_STAT_ENTRIES] = c->entries;
+    stats[CACHE_STAT_BYTES_USED] = c->used;
+    stats[CACHE_STAT_CAPACITY] = c->capacity;
+    pthread_mutex_unlock(&c->lock);
+    memcpy(values, stats, n * sizeof(jlong));
+}
@@ -0,0 +1,65 @@
+#ifndef _Included_jpawCache
+#define _Included_jpawCache
+
+#include <stdint.h>
+#include <pthread.h>
+#include <jni.h>
+
+// Cache of decompressed payloads of compressed entries, bounded in bytes, with CLOCK replacement.
+// Items are keyed by the address of the entry. Entries are never modified in place, a replacement allocates a new entry,
+// and every entry is removed from the cache when it is freed, before its address can be reused.
+// A reader which misses decompresses without holding the lock, and its item is discarded if any entry has been removed meanwhile.
+// All functions are thread safe, as the cache is shared by a map and its committed view.
+
+// indexes into the statistics array
+#define CACHE_STAT_HITS         0
+#define CACHE_STAT_MISSES       1
+#define CACHE_STAT_ENTRIES      2       // number of cached payloads
+#define CACHE_STAT_BYTES_USED   3       // bytes of cached payloads
+#define CACHE_STAT_CAPACITY     4
+#define CACHE_NUM_STATS         5
+
+struct cacheItem {
+    const void *key;
+    struct cacheItem *hashNext;
+    struct cacheItem *clockPrev;        // ring of all items, in order of insertion
+    struct cacheItem *clockNext;
+    jlong generation;                   // removal count at the time of the miss
+    int length;
+    int referenced;                     // set by a hit, cleared by the passing hand
+    char data[];
+};
+
+struct valueCache {
+    pthread_mutex_t lock;
+    struct cacheItem **table;
+    int tableShift;                     // 64 - log2(table size)
+    int padding;
+    struct cacheItem *hand;             // next candidate for eviction
+    jlong capacity;
+    jlong used;
+    jlong entries;
+    jlong generation;                   // incremented by every removal
+    jlong hits;
+    jlong misses;
+};
+
+// returns NULL if no memory is available
+struct valueCache *cacheCreate(jlong capacity);
+void cacheDestroy(struct valueCache *c);
+
+// copies the first length bytes of the cached payload for key to dst. Returns 0 for a hit, or -1 for a miss
+int cacheGet(struct valueCache *c, const void *key, char *dst, int length);
+// allocates an item for a payload of length bytes, to be filled by the caller and then passed to cacheInsert.
+// Returns NULL if the payload is too big to be cached, or no memory is available
+struct cacheItem *cacheNewItem(struct valueCache *c, const void *key, int length);
+// adds the item, or frees it if it is outdated or the key is cached already
+void cacheInsert(struct valueCache *c, struct cacheItem *item);
+// drops the payload of key, if cached
+void cacheRemove(struct valueCache *c, const void *key);
+void cacheClear(struct valueCache *c);
+
+// fills up to n statistics values, in the order of the CACHE_STAT_ constants
+void cacheGetStats(struct valueCache *c, jlong *values, int n);
+
+#endif
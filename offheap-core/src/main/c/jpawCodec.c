@@ -0,0 +1,350 @@
+#include <stdlib.h>
+#include <string.h>
+#include <lz4.h>
+#include <lz4hc.h>
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+#include "jpawCodec.h"
+
+#ifdef WITH_ZSTD
+// decoding contexts are per thread, because committed views can be read by other threads than the writer
+static __thread ZSTD_DCtx *threadDCtx = NULL;
+#endif
+
+
+int codecSupported(int id) {
+    switch (id) {
+    case CODEC_LZ4:
+    case CODEC_LZ4HC:
+        return 1;
+#ifdef WITH_ZSTD
+    case CODEC_ZSTD:
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+struct codec *codecCreate(int id, int level, int minSavingsPercent) {
+    if (!codecSupported(id) || minSavingsPercent < 0 || minSavingsPercent >= 100)
+        return NULL;
+    struct codec *c = malloc(sizeof(struct codec));
+    if (!c)
+        return NULL;
+    memset(c, 0, sizeof(struct codec));
+    c->id = id;
+    c->level = level;
+    c->minSavingsPercent = minSavingsPercent;
+    return c;
+}
+
+static void freeDictionary(struct codec *c) {
+#ifdef WITH_ZSTD
+    if (c->id == CODEC_ZSTD) {
+        ZSTD_freeCDict(c->dictState);
+        ZSTD_freeDDict(c->ddict);
+    } else
+#endif
+        free(c->dictState);
+    free(c->dictionary);
+    c->dictionary = NULL;
+    c->dictionarySize = 0;
+    c->dictState = NULL;
+    c->ddict = NULL;
+}
+
+void codecDestroy(struct codec *c) {
+    if (c->state) {
+#ifdef WITH_ZSTD
+        if (c->id == CODEC_ZSTD)
+            ZSTD_freeCCtx(c->state);
+        else
+#endif
+            free(c->state);
+    }
+    freeDictionary(c);
+    free(c);
+}
+
+// LZ4 streams are prepared once and copied for every entry, loading the dictionary per entry would cost more than compressing it
+static void *prepareDictionary(const struct codec *c) {
+    switch (c->id) {
+    case CODEC_LZ4: {
+        LZ4_stream_t *stream = malloc(sizeof(LZ4_stream_t));
+        if (stream) {
+            LZ4_initStream(stream, sizeof(LZ4_stream_t));
+            LZ4_loadDict(stream, c->dictionary, c->dictionarySize);
+        }
+        return stream;
+    }
+    case CODEC_LZ4HC: {
+        LZ4_streamHC_t *stream = malloc(sizeof(LZ4_streamHC_t));
+        if (stream) {
+            LZ4_initStreamHC(stream, sizeof(LZ4_streamHC_t));
+            LZ4_resetStreamHC_fast(stream, c->level ? c->level : LZ4HC_CLEVEL_DEFAULT);
+            LZ4_loadDictHC(stream, c->dictionary, c->dictionarySize);
+        }
+        return stream;
+    }
+#ifdef WITH_ZSTD
+    case CODEC_ZSTD:
+        return ZSTD_createCDict(c->dictionary, c->dictionarySize, c->level ? c->level : ZSTD_CLEVEL_DEFAULT);
+#endif
+    default:
+        return NULL;
+    }
+}
+
+int codecSetDictionary(struct codec *c, const char *dictionary, int size) {
+    if (size < 0 || size > CODEC_MAX_DICTIONARY_SIZE)
+        return -1;
+    freeDictionary(c);
+    if (!size)
+        return 0;
+    c->dictionary = malloc(size);
+    if (!c->dictionary)
+        return -1;
+    memcpy(c->dictionary, dictionary, size);
+    c->dictionarySize = size;
+    c->dictState = prepareDictionary(c);
+#ifdef WITH_ZSTD
+    if (c->id == CODEC_ZSTD)
+        c->ddict = ZSTD_createDDict(c->dictionary, size);
+    if (c->id == CODEC_ZSTD && !c->ddict) {
+        freeDictionary(c);
+        return -1;
+    }
+#endif
+    if (!c->dictState) {
+        freeDictionary(c);
+        return -1;
+    }
+    return 0;
+}
+
+int codecBound(const struct codec *c, int length) {
+#ifdef WITH_ZSTD
+    if (c->id == CODEC_ZSTD)
+        return (int)ZSTD_compressBound(length);
+#endif
+    return LZ4_compressBound(length);
+}
+
+static void *allocState(const struct codec *c) {
+    switch (c->id) {
+    case CODEC_LZ4:
+        return malloc(sizeof(LZ4_stream_t));
+    case CODEC_LZ4HC:
+        return malloc(sizeof(LZ4_streamHC_t));
+#ifdef WITH_ZSTD
+    case CODEC_ZSTD:
+        return ZSTD_createCCtx();
+#endif
+    default:
+        return NULL;
+    }
+}
+
+int codecCompress(struct codec *c, const char *src, int length, char *dst, int dstCapacity) {
+    if (length <= 0)
+        return 0;
+    if (!c->state) {
+        c->state = allocState(c);
+        if (!c->state)
+            return 0;
+    }
+    int n;
+    switch (c->id) {
+    case CODEC_LZ4HC:
+        if (c->dictState) {
+            memcpy(c->state, c->dictState, sizeof(LZ4_streamHC_t));
+            n = LZ4_compress_HC_continue(c->state, src, dst, length, dstCapacity);
+            break;
+        }
+        n = LZ4_compress_HC_extStateHC(c->state, src, dst, length, dstCapacity, c->level ? c->level : LZ4HC_CLEVEL_DEFAULT);
+        break;
+#ifdef WITH_ZSTD
+    case CODEC_ZSTD: {
+        size_t r = c->dictState
+          ? ZSTD_compress_usingCDict(c->state, dst, dstCapacity, src, length, c->dictState)
+          : ZSTD_compressCCtx(c->state, dst, dstCapacity, src, length, c->level ? c->level : ZSTD_CLEVEL_DEFAULT);
+        n = ZSTD_isError(r) ? 0 : (int)r;
+        break;
+    }
+#endif
+    default:
+        if (c->dictState) {
+            memcpy(c->state, c->dictState, sizeof(LZ4_stream_t));
+            n = LZ4_compress_fast_continue(c->state, src, dst, length, dstCapacity, c->level ? c->level : 1);
+            break;
+        }
+        n = LZ4_compress_fast_extState(c->state, src, dst, length, dstCapacity, c->level ? c->level : 1);
+        break;
+    }
+    // keep the compressed form only if it saves enough
+    if (n <= 0 || n >= length || (jlong)n * 100 > (jlong)length * (100 - c->minSavingsPercent))
+        return 0;
+    return n;
+}
+
+#ifdef WITH_ZSTD
+static int zstdDecompress(const ZSTD_DDict *ddict, const char *src, int compressedSize, char *dst, int uncompressedSize, int prefixSize) {
+    if (!threadDCtx) {
+        threadDCtx = ZSTD_createDCtx();
+        if (!threadDCtx)
+            return -1;
+    }
+    if (prefixSize == uncompressedSize) {
+        size_t r = ZSTD_decompress_usingDDict(threadDCtx, dst, prefixSize, src, compressedSize, ddict);
+        return !ZSTD_isError(r) && r == (size_t)prefixSize ? 0 : -1;
+    }
+    // streaming decompression stops once the output buffer is full
+    ZSTD_DCtx_reset(threadDCtx, ZSTD_reset_session_only);
+    ZSTD_DCtx_refDDict(threadDCtx, ddict);
+    ZSTD_inBuffer in = { src, compressedSize, 0 };
+    ZSTD_outBuffer out = { dst, prefixSize, 0 };
+    while (out.pos < out.size) {
+        size_t before = out.pos + in.pos;
+        size_t r = ZSTD_decompressStream(threadDCtx, &out, &in);
+        if (ZSTD_isError(r) || (out.pos < out.size && (r == 0 || out.pos + in.pos == before)))
+            return -1;      // error, or the frame ended / no progress before the prefix was complete
+    }
+    return 0;
+}
+#endif
+
+int codecDecompress(const struct codec *c, const char *src, int compressedSize, char *dst, int uncompressedSize, int prefixSize) {
+    if (prefixSize <= 0)
+        return 0;
+    switch (c->id) {
+    case CODEC_LZ4:
+    case CODEC_LZ4HC:
+        // both use the LZ4 block format. Decoding is sequential, so a prefix does not require the rest of the block
+        if (c->dictionary) {
+            if (prefixSize == uncompressedSize)
+                return LZ4_decompress_safe_usingDict(src, dst, compressedSize, prefixSize, c->dictionary, c->dictionarySize) == prefixSize ? 0 : -1;
+            return LZ4_decompress_safe_partial_usingDict(src, dst, compressedSize, prefixSize, prefixSize, c->dictionary, c->dictionarySize) == prefixSize ? 0 : -1;
+        }
+        if (prefixSize == uncompressedSize)
+            return LZ4_decompress_safe(src, dst, compressedSize, prefixSize) == prefixSize ? 0 : -1;
+        return LZ4_decompress_safe_partial(src, dst, compressedSize, prefixSize, prefixSize) == prefixSize ? 0 : -1;
+#ifdef WITH_ZSTD
+    case CODEC_ZSTD:
+        return zstdDecompress(c->ddict, src, compressedSize, dst, uncompressedSize, prefixSize);
+#endif
+    default:
+        return -1;
+    }
+}
+
+
+void codecReleaseThread(void) {
+#ifdef WITH_ZSTD
+    if (threadDCtx) {
+        ZSTD_freeDCtx(threadDCtx);
+        threadDCtx = NULL;
+    }
+#endif
+}
+
+// Dictionary training, a simplified version of the COVER algorithm: the samples are divided into epochs, and from every epoch the segment
+// is taken which contains the most frequent 8 byte sequences. Sequences are counted once only, i.e. their count is cleared once a segment
+// containing them has been selected.
+#define TRAIN_GRAM_SIZE         8
+#define TRAIN_SEGMENT_SIZE      CODEC_MIN_TRAINED_SIZE
+#define TRAIN_HASH_BITS         16
+
+struct trainSegment {
+    int start;
+    unsigned score;
+};
+
+static inline unsigned gramHash(const char *p) {
+    jlong v;
+    memcpy(&v, p, sizeof(v));
+    return (unsigned)((unsigned long long)(v * 0x9E3779B97F4A7C15LL) >> (64 - TRAIN_HASH_BITS));
+}
+
+static int compareSegments(const void *a, const void *b) {
+    unsigned sa = ((const struct trainSegment *)a)->score;
+    unsigned sb = ((const struct trainSegment *)b)->score;
+    return sa < sb ? -1 : sa > sb ? 1 : 0;
+}
+
+int codecTrainDictionary(const char *samples, const int *sampleSizes, int numSamples, char *dictionary, int capacity) {
+    int total = 0;
+    int i;
+    for (i = 0; i < numSamples; ++i)
+        total += sampleSizes[i];
+    if (total <= capacity || capacity < TRAIN_SEGMENT_SIZE) {
+        // not enough data for a selection, or no room for a single segment
+        if (total > capacity)
+            total = capacity;
+        memcpy(dictionary, samples, total);
+        return total;
+    }
+    unsigned *counts = calloc(1 << TRAIN_HASH_BITS, sizeof(unsigned));
+    // sampleEnd[i] is the end of sample i, grams crossing sample boundaries are not counted
+    int *sampleEnd = malloc(sizeof(int) * numSamples);
+    int numSegments = capacity / TRAIN_SEGMENT_SIZE;
+    struct trainSegment *segments = malloc(sizeof(struct trainSegment) * numSegments);
+    if (!counts || !sampleEnd || !segments) {
+        free(counts);
+        free(sampleEnd);
+        free(segments);
+        return 0;
+    }
+    int pos = 0;
+    for (i = 0; i < numSamples; ++i) {
+        pos += sampleSizes[i];
+        sampleEnd[i] = pos;
+    }
+    int s = 0;
+    for (pos = 0; pos + TRAIN_GRAM_SIZE <= total; ++pos) {
+        while (sampleEnd[s] <= pos)
+            ++s;
+        if (pos + TRAIN_GRAM_SIZE <= sampleEnd[s])
+            ++counts[gramHash(samples + pos)];
+    }
+
+    // select the best segment of every epoch
+    int epochSize = total / numSegments;
+    if (epochSize < TRAIN_SEGMENT_SIZE)
+        epochSize = TRAIN_SEGMENT_SIZE;
+    int found = 0;
+    int epochStart;
+    for (epochStart = 0; found < numSegments && epochStart + TRAIN_SEGMENT_SIZE <= total; epochStart += epochSize) {
+        int epochEnd = epochStart + epochSize <= total ? epochStart + epochSize : total;
+        int bestStart = -1;
+        unsigned bestScore = 0;
+        for (pos = epochStart; pos + TRAIN_SEGMENT_SIZE <= epochEnd; ++pos) {
+            unsigned score = 0;
+            int j;
+            for (j = 0; j + TRAIN_GRAM_SIZE <= TRAIN_SEGMENT_SIZE; ++j)
+                score += counts[gramHash(samples + pos + j)];
+            if (score > bestScore) {
+                bestScore = score;
+                bestStart = pos;
+            }
+        }
+        if (bestStart < 0)
+            continue;
+        int j;
+        for (j = 0; j + TRAIN_GRAM_SIZE <= TRAIN_SEGMENT_SIZE; ++j)
+            counts[gramHash(samples + bestStart + j)] = 0;
+        segments[found].start = bestStart;
+        segments[found].score = bestScore;
+        ++found;
+    }
+
+    // the best segments go to the end of the dictionary, where the offsets are the shortest
+    qsort(segments, found, sizeof(struct trainSegment), compareSegments);
+    for (i = 0; i < found; ++i)
+        memcpy(dictionary + i * TRAIN_SEGMENT_SIZE, samples + segments[i].start, TRAIN_SEGMENT_SIZE);
+    free(counts);
+    free(sampleEnd);
+    free(segments);
+    return found * TRAIN_SEGMENT_SIZE;
+}
@@ -0,0 +1,54 @@
+#ifndef _Included_jpawCodec
+#define _Included_jpawCodec
+
+#include <jni.h>
+
+// Compression codecs for data entries. A map uses a single codec for all of its compressed entries, the compressedSize field of an entry
+// tells if it is compressed at all. Entries which do not shrink by at least minSavingsPercent are stored uncompressed.
+// zstd is optional, it is available if compiled with WITH_ZSTD.
+// A codec can use a dictionary, which is shared by all entries. It is useful for small records with many repeated field names or values,
+// which do not compress well individually. The dictionary can only be replaced while no compressed entries exist.
+
+#define CODEC_LZ4               0       // LZ4 block format, level = acceleration (default 1). Also the format of dumps without codec id
+#define CODEC_LZ4HC             1       // LZ4 high compression, same block format (level 1..12, default 9)
+#define CODEC_ZSTD              2       // zstd frames (level 1..22, default 3)
+#define CODEC_MAX_ID            2
+
+#define CODEC_MAX_DICTIONARY_SIZE   65536   // the LZ4 window size. Larger dictionaries would not be used by LZ4 anyway
+#define CODEC_MIN_TRAINED_SIZE      32      // trained dictionaries are composed of segments of this size
+
+struct codec {
+    int id;
+    int level;                  // 0 = default of the codec
+    int minSavingsPercent;
+    int padding;
+    void *state;                // compression state, allocated on first use and then reused. Used by the thread which modifies the map only
+    char *dictionary;           // NULL if no dictionary is used
+    int dictionarySize;
+    int padding2;
+    void *dictState;            // LZ4 / LZ4HC: stream with the dictionary loaded, zstd: the prepared compression dictionary
+    void *ddict;                // zstd only: the prepared decompression dictionary
+    jlong compressedEntries;    // number of entries compressed with this codec, maintained by the map
+};
+
+// returns 1 if the codec is compiled in
+int codecSupported(int id);
+// returns NULL if the codec is not supported or no memory is available
+struct codec *codecCreate(int id, int level, int minSavingsPercent);
+void codecDestroy(struct codec *c);
+// replaces the dictionary (a copy is made). size 0 removes it. Returns 0 if OK, or -1 if out of memory or the size is invalid
+int codecSetDictionary(struct codec *c, const char *dictionary, int size);
+// builds a dictionary of at most capacity bytes from samples, which are stored back to back. Returns the size of the dictionary
+int codecTrainDictionary(const char *samples, const int *sampleSizes, int numSamples, char *dictionary, int capacity);
+
+// returns the size of the buffer required for compressing length bytes
+int codecBound(const struct codec *c, int length);
+// returns the compressed size, or 0 if the data should be stored uncompressed (it does not shrink enough, or no memory for the state)
+int codecCompress(struct codec *c, const char *src, int length, char *dst, int dstCapacity);
+// decodes the first prefixSize bytes (of uncompressedSize) into dst, which must have room for prefixSize bytes.
+// Returns 0 if OK, or -1 for corrupted input. Thread safe, decoding does not use the compression state.
+int codecDecompress(const struct codec *c, const char *src, int compressedSize, char *dst, int uncompressedSize, int prefixSize);
+// frees the decoding state of the calling thread. To be called by short lived threads which have decompressed entries
+void codecReleaseThread(void);
+
+#endif
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "jpawCompact.h"
+
+#define COMPACT_MIN_CAPACITY    32
+#define COMPACT_MAX_CAPACITY    0x40000000
+
+// the load limit is 7/8 of the capacity, counting tombstones. This also guarantees an empty slot, which terminates every probe sequence
+#define LOAD_LIMIT(capacity)    ((capacity) - ((capacity) >> 3))
+
+
+// the hashes of the Java objects are not well distributed in the lower bits (Long.hashCode() for example), use the upper bits of a product
+static inline int homeSlot(const struct compactIndex *t, int hash) {
+    return (int)(((uint32_t)hash * 0x9E3779B9u) >> t->shift);
+}
+
+static inline int sameValue(const struct compactIndex *t, int slot, int hash, const uint64_t *value) {
+    if (t->hashes[slot] != hash)
+        return 0;
+    const uint64_t *v = t->values + (size_t)slot * t->words;
+    switch (t->words) {
+    case 0:
+        return 1;
+    case 1:
+        return v[0] == value[0];
+    default:
+        return v[0] == value[0] && v[1] == value[1];
+    }
+}
+
+static int allocTable(struct compactIndex *t, int capacity) {
+    // keys and values first, they need 8 byte alignment
+    size_t slotSize = sizeof(jlong) + t->words * sizeof(uint64_t) + sizeof(int) + 1;
+    char *mem = malloc((size_t)capacity * slotSize);
+    if (!mem)
+        return -1;
+    t->keys = (jlong *)mem;
+    t->values = (uint64_t *)(mem + (size_t)capacity * sizeof(jlong));
+    t->hashes = (int *)(mem + (size_t)capacity * (sizeof(jlong) + t->words * sizeof(uint64_t)));
+    t->ctrl = (unsigned char *)(mem + (size_t)capacity * (slotSize - 1));
+    memset(t->ctrl, COMPACT_EMPTY, capacity);
+    t->capacity = capacity;
+    t->shift = 32 - __builtin_ctz(capacity);
+    t->count = 0;
+    t->used = 0;
+    return 0;
+}
+
+static int roundUpCapacity(int minCapacity) {
+    int capacity = COMPACT_MIN_CAPACITY;
+    while (capacity < minCapacity && capacity < COMPACT_MAX_CAPACITY)
+        capacity <<= 1;
+    return capacity;
+}
+
+// moves all entries into a new table of the given capacity. Returns 0 if OK, or -1 (with the table unchanged) if no memory is available
+static int rebuild(struct compactIndex *t, int capacity) {
+    struct compactIndex old = *t;
+    if (allocTable(t, capacity)) {
+        *t = old;
+        return -1;
+    }
+    for (int i = 0; i < old.capacity; ++i)
+        if (old.ctrl[i] == COMPACT_USED)
+            compactInsert(t, old.keys[i], old.hashes[i], old.values + (size_t)i * old.words);
+    free(old.keys);
+    return 0;
+}
+
+struct compactIndex *compactCreate(int minCapacity, int width) {
+    if (width < 0 || width > COMPACT_MAX_WIDTH)
+        return NULL;
+    struct compactIndex *t = malloc(sizeof(struct compactIndex));
+    if (!t)
+        return NULL;
+    t->width = width;
+    t->words = (width + 7) >> 3;
+    // the requested size is a number of entries. Allow for the load limit.
+    if (allocTable(t, roundUpCapacity(minCapacity + (minCapacity >> 3)))) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+void compactDestroy(struct compactIndex *t) {
+    free(t->keys);
+    free(t);
+}
+
+void compactClear(struct compactIndex *t) {
+    memset(t->ctrl, COMPACT_EMPTY, t->capacity);
+    t->count = 0;
+    t->used = 0;
+}
+
+void compactPresize(struct compactIndex *t, int numEntries) {
+    int capacity = roundUpCapacity(numEntries + (numEntries >> 3) + 1);
+    if (t->count || capacity <= t->capacity)
+        return;
+    rebuild(t, capacity);       // continue with the current table if no memory is available
+}
+
+int compactReserve(struct compactIndex *t) {
+    if (t->used < LOAD_LIMIT(t->capacity))
+        return 0;
+    // double the size, unless the load is caused mainly by tombstones
+    int newCapacity = t->count >= (t->capacity >> 1) - (t->capacity >> 4) && t->capacity < COMPACT_MAX_CAPACITY ? t->capacity << 1 : t->capacity;
+    if (rebuild(t, newCapacity))
+        return t->used < t->capacity - 1 ? 0 : -1;      // no memory: keep going beyond the load limit, as long as an empty slot remains
+    return 0;
+}
+
+int compactFind(const struct compactIndex *t, int hash, const uint64_t *value) {
+    const int mask = t->capacity - 1;
+    for (int i = homeSlot(t, hash); t->ctrl[i] != COMPACT_EMPTY; i = (i + 1) & mask)
+        if (t->ctrl[i] == COMPACT_USED && sameValue(t, i, hash, value))
+            return i;
+    return -1;
+}
+
+int compactFindNext(const struct compactIndex *t, int slot) {
+    const int mask = t->capacity - 1;
+    const int hash = t->hashes[slot];
+    const uint64_t *value = t->values + (size_t)slot * t->words;
+    for (int i = (slot + 1) & mask; t->ctrl[i] != COMPACT_EMPTY; i = (i + 1) & mask)
+        if (t->ctrl[i] == COMPACT_USED && sameValue(t, i, hash, value))
+            return i;
+    return -1;
+}
+
+int compactFindKey(const struct compactIndex *t, jlong key, int hash) {
+    const int mask = t->capacity - 1;
+    for (int i = homeSlot(t, hash); t->ctrl[i] != COMPACT_EMPTY; i = (i + 1) & mask)
+        if (t->ctrl[i] == COMPACT_USED && t->keys[i] == key && t->hashes[i] == hash)
+            return i;
+    return -1;
+}
+
+int compactInsert(struct compactIndex *t, jlong key, int hash, const uint64_t *value) {
+    const int mask = t->capacity - 1;
+    int i = homeSlot(t, hash);
+    while (t->ctrl[i] == COMPACT_USED)
+        i = (i + 1) & mask;
+    if (t->ctrl[i] == COMPACT_EMPTY)
+        ++t->used;
+    t->ctrl[i] = COMPACT_USED;
+    t->keys[i] = key;
+    t->hashes[i] = hash;
+    memcpy(t->values + (size_t)i * t->words, value, t->words * sizeof(uint64_t));
+    ++t->count;
+    return i;
+}
+
+void compactErase(struct compactIndex *t, int slot) {
+    const int mask = t->capacity - 1;
+    --t->count;
+    if (t->ctrl[(slot + 1) & mask] != COMPACT_EMPTY) {
+        t->ctrl[slot] = COMPACT_DELETED;
+        return;
+    }
+    // no probe sequence continues past this slot: it becomes empty, and so do the tombstones directly before it
+    do {
+        t->ctrl[slot] = COMPACT_EMPTY;
+        --t->used;
+        slot = (slot - 1) & mask;
+    } while (t->ctrl[slot] == COMPACT_DELETED);
+}
@@ -0,0 +1,70 @@
+#ifndef _Included_jpawCompact
+#define _Included_jpawCompact
+
+#include <stdint.h>
+#include <string.h>
+#include <jni.h>
+
+// Flat index table for index maps with values of a fixed width of up to 16 bytes (INDEX_HASH_IS_KEY), used instead of
+// hash chains of dataEntry. Every slot holds the primary key, the hash of the index value and the value itself, in separate
+// arrays, so an index entry needs no allocation and no entry header, and values are compared as one or two 64 bit words.
+// Width 0 is used by int sized index types, where the hash is the value.
+// Linear probing, starting at a slot derived from the hash. Equal values of non-unique indexes are stored in the same probe sequence.
+// Removed entries leave a tombstone (unless the probe sequence ends after them), such that an iterator position stays valid
+// while entries are removed. The table is rebuilt once the used slots reach the load limit, at twice the size unless most
+// of the used slots are tombstones.
+
+#define COMPACT_MAX_WIDTH       16
+#define COMPACT_MAX_WORDS       (COMPACT_MAX_WIDTH / 8)
+
+struct compactIndex {
+    int capacity;                   // number of slots, a power of 2
+    int count;                      // entries
+    int used;                       // entries plus tombstones
+    int width;                      // bytes per value, 0 .. COMPACT_MAX_WIDTH
+    int words;                      // 64 bit words per value, 0 .. COMPACT_MAX_WORDS
+    int shift;                      // 32 - log2(capacity), to obtain the start slot from the upper bits of the mixed hash
+    jlong *keys;                    // all arrays are part of a single allocation, starting at keys
+    uint64_t *values;               // words per slot, the value zero padded to full words
+    int *hashes;
+    unsigned char *ctrl;            // COMPACT_EMPTY, COMPACT_USED or COMPACT_DELETED
+};
+
+#define COMPACT_EMPTY           0
+#define COMPACT_USED            1
+#define COMPACT_DELETED         2
+
+// returns NULL if no memory is available or the width is not supported
+struct compactIndex *compactCreate(int minCapacity, int width);
+void compactDestroy(struct compactIndex *t);
+// removes all entries (but keeps the size)
+void compactClear(struct compactIndex *t);
+// resizes an empty table to hold numEntries without rebuilds
+void compactPresize(struct compactIndex *t, int numEntries);
+// returns 0 if there is space for at least one more entry (possibly after rebuilding the table), else -1.
+// A rebuild moves the entries, therefore slot numbers obtained before are invalid afterwards.
+int compactReserve(struct compactIndex *t);
+
+// converts a serialized value of width bytes into the representation used for comparisons
+static inline void compactLoadValue(const struct compactIndex *t, const void *src, uint64_t *value) {
+    value[0] = 0;
+    value[1] = 0;
+    memcpy(value, src, t->width);
+}
+
+static inline const void *compactValue(const struct compactIndex *t, int slot) {
+    return t->values + (size_t)slot * t->words;
+}
+
+// returns the slot of the first entry of the value, or -1
+int compactFind(const struct compactIndex *t, int hash, const uint64_t *value);
+// returns the next slot following slot which holds the same value as slot (which may have been removed meanwhile), or -1
+int compactFindNext(const struct compactIndex *t, int slot);
+// returns the slot of the entry of key with hash, or -1
+int compactFindKey(const struct compactIndex *t, jlong key, int hash);
+// adds an entry and returns its slot. Requires a prior successful compactReserve()
+int compactInsert(struct compactIndex *t, jlong key, int hash, const uint64_t *value);
+// removes the entry in slot
+void compactErase(struct compactIndex *t, int slot);
+
+#endif
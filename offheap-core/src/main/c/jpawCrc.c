@@ -0,0 +1,96 @@
+#include <string.h>
+#include <pthread.h>
+#include "jpawCrc.h"
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#define CRC32C_POLY     0x82F63B78      // reflected
+
+static uint32_t crcTable[8][256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+static void crcInitTable(void) {
+    for (int i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+            c = c & 1 ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+        crcTable[0][i] = c;
+    }
+    for (int i = 0; i < 256; ++i)
+        for (int t = 1; t < 8; ++t)
+            crcTable[t][i] = (crcTable[t - 1][i] >> 8) ^ crcTable[0][crcTable[t - 1][i] & 0xff];
+}
+
+// slicing by 8, on the inverted crc. Assumes a little endian host, as the rest of the dump format does
+static uint32_t crcSoftware(uint32_t crc, const unsigned char *p, size_t len) {
+    pthread_once(&crcTableOnce, crcInitTable);
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        w ^= crc;
+        crc = crcTable[7][w & 0xff] ^ crcTable[6][(w >> 8) & 0xff] ^ crcTable[5][(w >> 16) & 0xff] ^ crcTable[4][(w >> 24) & 0xff]
+            ^ crcTable[3][(w >> 32) & 0xff] ^ crcTable[2][(w >> 40) & 0xff] ^ crcTable[1][(w >> 48) & 0xff] ^ crcTable[0][w >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = (crc >> 8) ^ crcTable[0][(crc ^ *p++) & 0xff];
+    return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CRC_HARDWARE
+__attribute__((target("sse4.2")))
+static uint32_t crcHardware(uint32_t crc, const unsigned char *p, size_t len) {
+    uint64_t c = crc;
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        c = __builtin_ia32_crc32di(c, w);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)c;
+    while (len--)
+        crc = __builtin_ia32_crc32qi(crc, *p++);
+    return crc;
+}
+
+static int crcHardwareAvailable(void) {
+    static int available = -1;          // benign race: every thread computes the same value
+    if (available < 0) {
+        __builtin_cpu_init();
+        available = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+    }
+    return available;
+}
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC_HARDWARE
+static uint32_t crcHardware(uint32_t crc, const unsigned char *p, size_t len) {
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        crc = __crc32cd(crc, w);
+        p += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = __crc32cb(crc, *p++);
+    return crc;
+}
+
+static inline int crcHardwareAvailable(void) {
+    return 1;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
+    crc = ~crc;
+#ifdef CRC_HARDWARE
+    if (crcHardwareAvailable())
+        return ~crcHardware(crc, data, len);
+#endif
+    return ~crcSoftware(crc, data, len);
+}
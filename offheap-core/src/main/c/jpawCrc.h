@@ -0,0 +1,15 @@
+#ifndef _Included_jpawCrc
+#define _Included_jpawCrc
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC32C (Castagnoli polynomial, as used by iSCSI and ext4), for the checksums of the segmented dumps.
+// Uses the crc32 instruction of SSE 4.2 (x86_64, detected at runtime) or of the ARMv8 CRC extension (if compiled for it),
+// else a table driven implementation (slicing by 8). All variants compute the same values.
+// All functions are thread safe.
+
+// continues the checksum crc (0 for the start) over len bytes of data, and returns the new checksum
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+#endif
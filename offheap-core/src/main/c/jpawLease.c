@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jpawMap.h"
+#include "jpawLease.h"
+
+#define LEASE_POOL_SIZE         16              // released leases kept per thread
+#define LEASE_POOL_MAX_BUFFER   (64 * 1024)     // bigger decompression buffers are not kept in the pool
+#define LEASE_MIN_DEFERRED      256             // initial capacity of the queue of deferred blocks
+
+// released leases, with their buffers, for reuse by the same thread
+static __thread struct lease *leasePool[LEASE_POOL_SIZE];
+static __thread int leasePoolSize = 0;
+
+
+struct leaseRegistry *leaseCreateRegistry(struct arena *a) {
+    struct leaseRegistry *r = malloc(sizeof(struct leaseRegistry));
+    if (!r)
+        return NULL;
+    memset(r, 0, sizeof(struct leaseRegistry));
+    if (pthread_mutex_init(&r->lock, NULL)) {
+        free(r);
+        return NULL;
+    }
+    r->arena = a;
+    return r;
+}
+
+void leaseDestroyRegistry(struct leaseRegistry *r) {
+    if (r->activeLeases)
+        fprintf(stderr, "WARNING: map closed with %d active leases\n", r->activeLeases);
+    for (int i = r->deferredStart; i < r->deferredEnd; ++i)
+        arenaFree(r->arena, r->deferred[i].block, r->deferred[i].size);
+    if (r->deferred)
+        free(r->deferred);
+    pthread_mutex_destroy(&r->lock);
+    free(r);
+}
+
+struct lease *leaseAcquire(struct leaseRegistry *r) {
+    struct lease *l;
+    if (leasePoolSize) {
+        l = leasePool[--leasePoolSize];
+    } else {
+        l = malloc(sizeof(struct lease));
+        if (!l)
+            return NULL;
+        l->buffer = NULL;
+        l->bufferSize = 0;
+    }
+    l->data = NULL;
+    l->length = 0;
+    l->registry = r;
+    l->next = NULL;
+    pthread_mutex_lock(&r->lock);
+    // count the lease before reading the epoch: a writer which does not see the lease has removed its block before
+    __atomic_add_fetch(&r->activeLeases, 1, __ATOMIC_SEQ_CST);
+    l->epoch = __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+    l->prev = r->newest;
+    if (r->newest)
+        r->newest->next = l;
+    else
+        r->oldest = l;
+    r->newest = l;
+    pthread_mutex_unlock(&r->lock);
+    return l;
+}
+
+char *leaseBuffer(struct lease *l, int size) {
+    if (size > l->bufferSize) {
+        char *buffer = malloc(size);
+        if (!buffer)
+            return NULL;
+        if (l->buffer)
+            free(l->buffer);
+        l->buffer = buffer;
+        l->bufferSize = size;
+    }
+    return l->buffer;
+}
+
+void leaseUnpin(struct lease *l) {
+    struct leaseRegistry *r = l->registry;
+    if (!r)
+        return;
+    pthread_mutex_lock(&r->lock);
+    if (l->prev)
+        l->prev->next = l->next;
+    else
+        r->oldest = l->next;
+    if (l->next)
+        l->next->prev = l->prev;
+    else
+        r->newest = l->prev;
+    __atomic_sub_fetch(&r->activeLeases, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&r->lock);
+    l->registry = NULL;
+    l->prev = NULL;
+    l->next = NULL;
+}
+
+void leaseRelease(struct lease *l) {
+    leaseUnpin(l);
+    if (l->bufferSize > LEASE_POOL_MAX_BUFFER) {
+        free(l->buffer);
+        l->buffer = NULL;
+        l->bufferSize = 0;
+    }
+    if (leasePoolSize < LEASE_POOL_SIZE) {
+        leasePool[leasePoolSize++] = l;
+        return;
+    }
+    if (l->buffer)
+        free(l->buffer);
+    free(l);
+}
+
+int leaseDefer(struct leaseRegistry *r, void *block, size_t size) {
+    if (r->deferredEnd >= r->deferredCapacity) {
+        // compact the queue, or grow it if more than half is in use
+        int n = r->deferredEnd - r->deferredStart;
+        if (r->deferredStart && n <= r->deferredCapacity / 2) {
+            memmove(r->deferred, r->deferred + r->deferredStart, n * sizeof(struct leaseDeferred));
+        } else {
+            int newCapacity = r->deferredCapacity ? 2 * r->deferredCapacity : LEASE_MIN_DEFERRED;
+            struct leaseDeferred *q = realloc(r->deferred, newCapacity * sizeof(struct leaseDeferred));
+            if (!q) {
+                // cannot track the block: keep it allocated, freeing it could invalidate a lease
+                fprintf(stderr, "WARNING: out of memory, leaking a block of %d bytes\n", (int)size);
+                return 1;
+            }
+            r->deferred = q;
+            r->deferredCapacity = newCapacity;
+            if (r->deferredStart)
+                memmove(r->deferred, r->deferred + r->deferredStart, n * sizeof(struct leaseDeferred));
+        }
+        r->deferredStart = 0;
+        r->deferredEnd = n;
+    }
+    struct leaseDeferred *d = &r->deferred[r->deferredEnd++];
+    d->block = block;
+    d->size = size;
+    // leases acquired from now on have a higher epoch and cannot reach the block any more
+    d->epoch = __atomic_fetch_add(&r->epoch, 1, __ATOMIC_SEQ_CST);
+    leaseReclaim(r);
+    return 1;
+}
+
+void leaseReclaim(struct leaseRegistry *r) {
+    if (r->deferredStart == r->deferredEnd)
+        return;
+    pthread_mutex_lock(&r->lock);
+    jlong minEpoch = r->oldest ? r->oldest->epoch : __atomic_load_n(&r->epoch, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&r->lock);
+    // a block removed at epoch E may be referenced by leases of epochs up to E
+    while (r->deferredStart < r->deferredEnd && r->deferred[r->deferredStart].epoch < minEpoch) {
+        arenaFree(r->arena, r->deferred[r->deferredStart].block, r->deferred[r->deferredStart].size);
+        ++r->deferredStart;
+    }
+    if (r->deferredStart == r->deferredEnd) {
+        r->deferredStart = 0;
+        r->deferredEnd = 0;
+    }
+}
+
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapLease
+ * Method:    natGetBuffer
+ * Signature: (J)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_de_jpaw_offHeap_OffHeapLease_natGetBuffer
+  (JNIEnv *env, jclass me, jlong cLease) {
+    struct lease *l = (struct lease *) cLease;
+    return (*env)->NewDirectByteBuffer(env, l->data, (jlong)l->length);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapLease
+ * Method:    natRelease
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapLease_natRelease
+  (JNIEnv *env, jclass me, jlong cLease) {
+    leaseRelease((struct lease *) cLease);
+}
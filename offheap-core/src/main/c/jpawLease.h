@@ -0,0 +1,83 @@
+#ifndef _Included_jpawLease
+#define _Included_jpawLease
+
+#include <stddef.h>
+#include <pthread.h>
+#include <jni.h>
+#include "jpawArena.h"
+
+// Read leases: a lease gives a reader direct access to the payload of an entry, for example wrapped into a DirectByteBuffer.
+// Every lease is stamped with the current epoch when it is acquired. Entries which are freed by the writer while leases
+// exist are not returned to the arena immediately, but queued with the epoch of their removal, and only freed once all leases
+// of that epoch or before have been released (epoch based reclamation).
+// Acquiring and releasing leases is thread safe. Retiring and reclaiming blocks must be done by the thread which modifies the map,
+// as the arena is not thread safe.
+// One registry exists per map, shared by the map and its committed view (as the arena).
+
+struct lease {
+    struct lease *prev;                 // list of active leases, NULL once unpinned
+    struct lease *next;
+    struct leaseRegistry *registry;     // NULL if the lease does not pin an epoch (any more)
+    jlong epoch;
+    char *data;                         // the leased bytes: either the payload of an entry, or buffer
+    int length;
+    int bufferSize;
+    char *buffer;                       // decompressed copy, kept while the lease is in the thread local pool
+};
+
+struct leaseDeferred {
+    void *block;
+    size_t size;
+    jlong epoch;                        // epoch at which the block was removed from the map
+};
+
+struct leaseRegistry {
+    pthread_mutex_t lock;               // protects the list of active leases
+    struct lease *oldest;               // active leases in order of acquisition, i.e. ascending epochs
+    struct lease *newest;
+    int activeLeases;                   // read by the writer without taking the lock
+    int padding;
+    jlong epoch;                        // incremented for every deferred block
+    struct arena *arena;                // where deferred blocks are returned to
+    struct leaseDeferred *deferred;     // queue of blocks waiting for the release of older leases, ascending epochs
+    int deferredStart;
+    int deferredEnd;
+    int deferredCapacity;
+    int padding2;
+};
+
+// returns NULL if no memory is available
+struct leaseRegistry *leaseCreateRegistry(struct arena *a);
+// returns the deferred blocks to the arena and frees the registry. All leases must have been released before.
+void leaseDestroyRegistry(struct leaseRegistry *r);
+
+// returns a new lease which pins the current epoch, or NULL if no memory is available. Acquire the lease before looking up the entry.
+struct lease *leaseAcquire(struct leaseRegistry *r);
+// returns a buffer of at least size bytes owned by the lease, or NULL if no memory is available
+char *leaseBuffer(struct lease *l, int size);
+// stops pinning the epoch, for leases which refer to their own buffer only
+void leaseUnpin(struct lease *l);
+// unpins the lease and returns it to the pool of the calling thread
+void leaseRelease(struct lease *l);
+
+// writer side: queues a block which has been removed from the map, if it can still be referenced by a lease. Returns 1 if the block has been queued.
+int leaseDefer(struct leaseRegistry *r, void *block, size_t size);
+// writer side: frees the queued blocks which are not referenced by any lease any more
+void leaseReclaim(struct leaseRegistry *r);
+
+// returns 1 if the block must not be freed by the caller (because it is queued)
+static inline int leaseRetire(struct leaseRegistry *r, void *block, size_t size) {
+    // the block has been unlinked by plain stores, which must not be reordered after the load of activeLeases.
+    // Pairs with the seq_cst increment in leaseAcquire: either the writer sees the lease, or the reader does not find the block
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&r->activeLeases, __ATOMIC_SEQ_CST) && r->deferredStart == r->deferredEnd)
+        return 0;       // fast path: nobody can see the block
+    return leaseDefer(r, block, size);
+}
+
+static inline int leaseActive(struct leaseRegistry *r) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);     // as in leaseRetire
+    return __atomic_load_n(&r->activeLeases, __ATOMIC_SEQ_CST) || r->deferredStart != r->deferredEnd;
+}
+
+#endif
@@ -1,6 +1,18 @@
+#define _DEFAULT_SOURCE         // MAP_POPULATE and madvise for mapped files, with -std=c99
 #include "jpawMap.h"
 #include "globalDefs.h"
 #include "globalMethods.h"
+#include "jpawProbe.h"
+#include "jpawTree.h"
+#include "jpawSorted.h"
+#include "jpawCompact.h"
+#include "jpawPosting.h"
+#include "jpawArena.h"
+#include "jpawLease.h"
+#include "jpawCodec.h"
+#include "jpawCache.h"
+#include "jpawCrc.h"
+#include "jpawWriter.h"
 
 #define USE_CRITICAL_FOR_STORE
 // #define USE_CRITICAL_FOR_RETRIEVAL       // this seems to be much slower!
@@ -10,6 +22,15 @@
 #define ROUND_UP_SIZE(size)     ((((size) - 1) & ~0x0f) + 16)
 #define ROUND_UP_FILESIZE(size) ((((size) - 1) & ~0x07) + 8)  // as stored in the disk dump file
 
+// batch buffers use big endian byte order, which is the default of java.nio.ByteBuffer
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define TO_BIG_ENDIAN_32(x)     __builtin_bswap32(x)
+#define TO_BIG_ENDIAN_64(x)     __builtin_bswap64(x)
+#else
+#define TO_BIG_ENDIAN_32(x)     (x)
+#define TO_BIG_ENDIAN_64(x)     (x)
+#endif
+
 struct dataEntry {
     // start with the internal ptr, to allow writing a continuous area when dumping the file.
     struct dataEntry *nextSameHash;
@@ -34,6 +55,14 @@ struct dataEntry {
 
 // the hashCode (index of primary array) is for data maps the hash of the key, for index maps the hash of the index (modulus something)
 
+// order of ordered index maps: the serialized index value, then the primary key
+static void indexSortKey(const void *entry, struct sortKey *k) {
+    const struct dataEntry *e = entry;
+    k->data = e->data;
+    k->length = e->uncompressedSize;
+    k->key = e->key;
+}
+
 // in both cases, a key occurs once only, for every map.
 
 
@@ -45,6 +74,20 @@ struct fctnPtrs {
 };
 
 
+// index rules of data maps: every row change of the map updates the attached index map with the value extracted from the row
+#define RULE_FIELD      0               // field number position, as for natGetField
+#define RULE_REGION     1               // up to length bytes from offset position
+
+struct indexRule {
+    struct indexRule *next;
+    struct map *index;
+    int kind;
+    int position;
+    int length;                     // RULE_REGION only
+    char delimiter;                 // RULE_FIELD only
+    char nullIndicator;             // RULE_FIELD only
+};
+
 // a map, as used for key to value lookups, but alos reverse lookups (index => key).
 // the difference between data maps and index maps is the use of the hash to select the appropriate slot.
 // for data lookup, it is based on the key, for index lookups, it is based on the hash (as stored in dataEntry->compressedSize field)
@@ -54,27 +97,77 @@ struct map {
     int hashTableSize;
     int modes;                      // 00 = not transactional, 0x80 = take mode of transaction, 1 = TRANSACTIONAL.. see globalDefs.h
     struct dataEntry **keyHash;
+    struct dataEntry **oldKeyHash;  // while a resize is in progress: the previous (smaller) bucket array, else NULL
+    int oldHashTableSize;           // size of oldKeyHash
+    int rehashPosition;             // slots of oldKeyHash below this index have been migrated to keyHash already
     struct map *committedView;      // same data, but synched after commit (to provide secondary view for read/only queries, i.e. dirty read as well as committed read views...)
+    jboolean isView;                // this is a committed view: its hash chains are linked by nextInCommittedView
+    pthread_mutex_t pinLock;        // committed views: protects the pin state below (see natPinView)
+    pthread_cond_t pinCond;
+    int pins;                       // committed views: number of pins, commits are not applied to the view meanwhile
+    jboolean updating;              // committed views: a commit is being applied, new pins wait
+    struct viewPin *pinOwners;      // committed views: the pins taken by natPinView, with their threads
     jlong lastCommittedRef;
+    jlong changeSequence;           // number of changes made without a transaction, which do not advance lastCommittedRef. Stored in the dumps,
+                                    // for the order of delta checkpoints. Maintained on the map, not on its committed view
     void *sharedIndexLookupBuffer;  // for the singlethreaded dirty view: allows reusing temporary storage for index lookups
     int sharedIndexLookupBufferSize;
+    struct probeMap *probe;         // open addressing table (OPEN_ADDRESSING), used instead of keyHash. NULL for hash chains
+    struct orderedTree *tree;       // B+tree (ORDERED_KEYS), used instead of keyHash. NULL for hash chains
+    struct sortedTree *sorted;      // index maps with ORDERED_KEYS: the entries in order of the index value, in addition to keyHash. Else NULL
+    struct compactIndex *compact;   // index maps with INDEX_HASH_IS_KEY: flat table of the fixed width values, used instead of keyHash. Else NULL
+    struct postingIndex *postings;  // non-unique index maps with POSTING_LISTS: the keys per distinct value, used instead of keyHash. Else NULL
+    struct arena *arena;            // storage of the entries. Shared by the map and its committed view
+    struct leaseRegistry *leases;   // read leases on entries, which delay freeing them. Shared by the map and its committed view
+    struct codec *codec;            // compression of the entries. Shared by the map and its committed view
+    struct valueCache *cache;       // decompressed payloads of compressed entries, NULL if disabled. Shared by the map and its committed view
+    struct indexRule *indexRules;   // data maps: the index maps maintained by the row changes (natAttachIndex). NULL if none, always for views
+    struct versionStore *versions;  // committed views of data maps: replaced entries kept for snapshots (natOpenSnapshot), NULL before the first one
+    struct mappedFile *mapped;      // file mapped by natMapFile, whose entries are used in place. NULL if none. Shared by the map and its committed view
+    struct changeSet *changes;      // data maps: the keys changed since the last delta checkpoint (natEnableChangeTracking). NULL if not tracked, always for views
 };
 
+// a dump file in the mapped format (natMapFile). Its entries are not allocated from the arena, and therefore never returned to it
+struct mappedFile {
+    char *base;
+    size_t size;
+};
+
+// keys of the committed changes since fromRef, for the delta checkpoints (natWriteDeltaFile). The changes of transactional maps are
+// recorded when they are committed, the others immediately. Rolled back changes therefore never appear, and a key which changed
+// several times is contained once only. Updated by the thread which modifies the map (the commits apply the views in that thread).
+struct changeSet {
+    struct probeMap *keys;          // the values are not used (the set itself, as probeGet() distinguishes NULL)
+    jlong fromRef;                  // the changes after this reference are recorded
+    jlong fromSequence;             // ...and after this changeSequence of the map
+    jboolean incomplete;            // changes were lost (no memory, or a non-transactional clear): a full checkpoint is required
+};
+
+static inline void trackChange(struct map * const mapdata, jlong key) {
+    struct changeSet * const c = mapdata->changes;
+    if (c->incomplete)
+        return;
+    if (probeReserve(c->keys))
+        c->incomplete = JNI_TRUE;
+    else
+        probeSet(c->keys, key, c);
+}
+
 
 static jfieldID javaIteratorCurrentHashIndexFID;
 static jfieldID javaIteratorCurrentKeyFID;
 static jfieldID javaIndexIteratorCurrentKeyFID;
 static jfieldID javaIndexIteratorCurrentSizeFID;
+static jfieldID javaIndexRangeIteratorCurrentSizeFID;
 
 
 
 // other protos...
 // static methods commented out..
 //
-//int computeKeyHash(jlong arg, int size);
-//void clear(struct dataEntry **keyHash, int numEntries);
+//struct dataEntry **findKeyBucket(struct map *mapdata, jlong key);
+//void clear(struct map *mapdata);
 //int record_change(JNIEnv *env, struct tx_log_hdr *ctx, struct map *mapdata, struct dataEntry *oldData, struct dataEntry *newData);
-//int transferWrite(const int fd, char *buffer, int oldOffset, void const *src, int len);
 //char *allocateBuffers(JNIEnv *env, char **buffer, jbyteArray filename);
 //struct dataEntry *find_entry(struct map *mapdata, jlong key);
 //struct dataEntry *create_new_entry(JNIEnv *env, jlong key, jbyteArray data, jint offset, jint length, jboolean doCompress);
@@ -102,6 +195,321 @@ void throwAny(JNIEnv *env, char *msg) {
 
 
 
+// entries are allocated from the arena of their map, in blocks of this size
+static inline int entryAllocSize(const struct map * const mapdata, const struct dataEntry * const e) {
+    // for index maps, compressedSize holds the hash
+    int payloadSize = (mapdata->modes & IS_INDEX) || !e->compressedSize ? e->uncompressedSize : e->compressedSize;
+    return sizeof(struct dataEntry) + ROUND_UP_SIZE(payloadSize);
+}
+
+static inline struct dataEntry *allocEntry(struct map * const mapdata, int payloadSize) {
+    return arenaAlloc(mapdata->arena, sizeof(struct dataEntry) + ROUND_UP_SIZE(payloadSize));
+}
+
+// entries which may be referenced by a lease are queued, and freed after the lease has been released
+static inline void freeEntry(struct map * const mapdata, struct dataEntry * const e) {
+    int size = entryAllocSize(mapdata, e);
+    if (!(mapdata->modes & IS_INDEX) && e->compressedSize) {
+        --mapdata->codec->compressedEntries;
+        if (mapdata->cache)
+            cacheRemove(mapdata->cache, e);     // before the address can be reused
+    }
+    if (mapdata->mapped && (char *)e >= mapdata->mapped->base && (char *)e < mapdata->mapped->base + mapdata->mapped->size)
+        return;                                 // part of a mapped file: just dropped
+    if (!leaseRetire(mapdata->leases, e, size))
+        arenaFree(mapdata->arena, e, size);
+}
+
+
+// misses of the cache decompress the whole entry, also for partial reads, as the item is the complete payload
+static int decompressCachedEntry(const struct map * const mapdata, const struct dataEntry * const e, char *dst, int prefixSize) {
+    if (!cacheGet(mapdata->cache, e, dst, prefixSize))
+        return 0;
+    struct cacheItem *item = cacheNewItem(mapdata->cache, e, e->uncompressedSize);
+    if (!item)
+        return codecDecompress(mapdata->codec, e->data, e->compressedSize, dst, e->uncompressedSize, prefixSize);
+    if (codecDecompress(mapdata->codec, e->data, e->compressedSize, item->data, e->uncompressedSize, e->uncompressedSize)) {
+        free(item);
+        return -1;
+    }
+    memcpy(dst, item->data, prefixSize);
+    cacheInsert(mapdata->cache, item);
+    return 0;
+}
+
+// decodes the first prefixSize bytes of a compressed entry into dst. Returns 0 if OK, -1 if the entry is corrupted
+static inline int decompressEntry(const struct map * const mapdata, const struct dataEntry * const e, char *dst, int prefixSize) {
+    if (mapdata->cache)
+        return decompressCachedEntry(mapdata, e, dst, prefixSize);
+    return codecDecompress(mapdata->codec, e->data, e->compressedSize, dst, e->uncompressedSize, prefixSize);
+}
+
+static inline int computeHash(jlong arg) {
+    arg *= 33;
+    return (int) (arg ^ (arg >> 32));
+}
+
+// returns the start of the chain for a hash value (not yet reduced to a slot number).
+// While a resize is in progress, a slot of the old bucket array which has not been migrated yet is still authoritative.
+// All entries of the same hash therefore are in the same chain at any time.
+static inline struct dataEntry **findBucket(const struct map * const mapdata, int hash) {
+    hash &= 0x7fffffff;
+    if (mapdata->oldKeyHash) {
+        int oldSlot = hash % mapdata->oldHashTableSize;
+        if (oldSlot >= mapdata->rehashPosition)
+            return &mapdata->oldKeyHash[oldSlot];
+    }
+    return &mapdata->keyHash[hash % mapdata->hashTableSize];
+}
+
+static inline struct dataEntry **findKeyBucket(const struct map * const mapdata, jlong key) {
+    return findBucket(mapdata, computeHash(key));
+}
+
+static inline int computeEntryHash(const struct map * const mapdata, const struct dataEntry * const e) {
+    return mapdata->modes & IS_INDEX ? e->compressedSize : computeHash(e->key);
+}
+
+static inline struct dataEntry **computeSlot(const struct map * const mapdata, const struct dataEntry * const e) {
+    return findBucket(mapdata, computeEntryHash(mapdata, e));
+}
+
+// full scans: during a resize, the slots of the old bucket array which have not yet been migrated follow the new ones.
+// Migrated slots of the old array are NULL.
+// For open addressing and trees, every slot holds at most one entry, and nextSameHash / nextInCommittedView are always NULL.
+// Compact and posting list index maps have no entries to scan, their functions use the table directly.
+static inline int numberOfScanSlots(const struct map * const mapdata) {
+    if (mapdata->compact || mapdata->postings)
+        return 0;
+    if (mapdata->probe)
+        return probeScanSlots(mapdata->probe);
+    if (mapdata->tree)
+        return treeScanSlots(mapdata->tree);
+    return mapdata->hashTableSize + (mapdata->oldKeyHash ? mapdata->oldHashTableSize : 0);
+}
+
+static inline struct dataEntry *scanSlot(const struct map * const mapdata, int i) {
+    if (mapdata->probe)
+        return probeScanSlot(mapdata->probe, i);
+    if (mapdata->tree)
+        return treeScanSlot(mapdata->tree, i);
+    return i < mapdata->hashTableSize ? mapdata->keyHash[i] : mapdata->oldKeyHash[i - mapdata->hashTableSize];
+}
+
+
+// Incremental resize.
+// Once the number of entries exceeds the load factor, a bucket array of twice the size is allocated, and with every
+// subsequent inserting operation, REHASH_SLOTS_PER_STEP slots of the old array are migrated. This avoids a stall of a single call
+// for big maps. The committed view has its own bucket array and is resized independently, within commitToView,
+// therefore the chain to use (nextSameHash or nextInCommittedView) is passed as parameter.
+#define MAX_LOAD_FACTOR_PERCENT     100
+#define REHASH_SLOTS_PER_STEP       64
+#define MAX_HASH_TABLE_SIZE         0x40000000
+
+static void rehashStep(struct map * const mapdata, int slotsToMigrate, jboolean isShadow) {
+    int end = mapdata->rehashPosition + slotsToMigrate;
+    if (end > mapdata->oldHashTableSize)
+        end = mapdata->oldHashTableSize;
+    while (mapdata->rehashPosition < end) {
+        struct dataEntry *e = mapdata->oldKeyHash[mapdata->rehashPosition];
+        mapdata->oldKeyHash[mapdata->rehashPosition] = NULL;
+        ++mapdata->rehashPosition;          // from now on, findBucket uses the new array for this slot
+        while (e) {
+            struct dataEntry *next = isShadow ? e->nextInCommittedView : e->nextSameHash;
+            struct dataEntry **bucket = &mapdata->keyHash[(computeEntryHash(mapdata, e) & 0x7fffffff) % mapdata->hashTableSize];
+            if (isShadow)
+                e->nextInCommittedView = *bucket;
+            else
+                e->nextSameHash = *bucket;
+            *bucket = e;
+            e = next;
+        }
+    }
+    if (mapdata->rehashPosition >= mapdata->oldHashTableSize) {
+        // resize complete
+        free(mapdata->oldKeyHash);
+        mapdata->oldKeyHash = NULL;
+        mapdata->oldHashTableSize = 0;
+        mapdata->rehashPosition = 0;
+    }
+}
+
+// the open addressing table and the tree grow by themselves, within probeReserve() / treeReserve(), and are not affected by the functions below
+static inline void finishResize(struct map * const mapdata, jboolean isShadow) {
+    if (mapdata->oldKeyHash)
+        rehashStep(mapdata, mapdata->oldHashTableSize, isShadow);
+}
+
+// called at the start of every inserting operation. Never fails: if no memory is available for a bigger bucket array,
+// the map just continues with longer chains.
+static void maintainHashTable(struct map * const mapdata, jboolean isShadow) {
+    if (mapdata->oldKeyHash) {
+        rehashStep(mapdata, REHASH_SLOTS_PER_STEP, isShadow);
+        return;
+    }
+    if (mapdata->count <= (long)mapdata->hashTableSize * MAX_LOAD_FACTOR_PERCENT / 100 || mapdata->hashTableSize >= MAX_HASH_TABLE_SIZE)
+        return;
+    int newSize = mapdata->hashTableSize * 2;
+    struct dataEntry **newKeyHash = calloc(newSize, sizeof(struct dataEntry *));
+    if (!newKeyHash)
+        return;
+#ifdef DEBUG
+    fprintf(stderr, "Resizing map %16p from %d to %d slots (%d entries)\n", mapdata, mapdata->hashTableSize, newSize, mapdata->count);
+#endif
+    mapdata->oldKeyHash = mapdata->keyHash;
+    mapdata->oldHashTableSize = mapdata->hashTableSize;
+    mapdata->rehashPosition = 0;
+    mapdata->keyHash = newKeyHash;
+    mapdata->hashTableSize = newSize;
+    rehashStep(mapdata, REHASH_SLOTS_PER_STEP, isShadow);
+}
+
+// grows an empty map such that numEntries can be stored without exceeding the load factor (used before a bulk load)
+static void presize(struct map * const mapdata, int numEntries) {
+    if (mapdata->probe) {
+        probePresize(mapdata->probe, numEntries);
+        return;
+    }
+    if (mapdata->compact) {
+        compactPresize(mapdata->compact, numEntries);
+        return;
+    }
+    if (mapdata->tree || mapdata->postings)
+        return;     // posting lists grow with the number of distinct values, which is not known
+    int newSize = mapdata->hashTableSize;
+    while ((long)newSize * MAX_LOAD_FACTOR_PERCENT / 100 < numEntries && newSize < MAX_HASH_TABLE_SIZE)
+        newSize *= 2;
+    if (mapdata->count || mapdata->oldKeyHash || newSize == mapdata->hashTableSize)
+        return;
+    struct dataEntry **newKeyHash = calloc(newSize, sizeof(struct dataEntry *));
+    if (!newKeyHash)
+        return;  // continue with the current size
+    free(mapdata->keyHash);
+    mapdata->keyHash = newKeyHash;
+    mapdata->hashTableSize = newSize;
+}
+
+// clear all entries
+static void clear(struct map * const mapdata) {
+    if (!mapdata->committedView && !leaseActive(mapdata->leases)) {
+        // no other structure refers to the entries: release the slabs at once
+        arenaReset(mapdata->arena);
+        mapdata->codec->compressedEntries = 0;
+        if (mapdata->cache)
+            cacheClear(mapdata->cache);
+        return;
+    }
+    int i;
+    for (i = numberOfScanSlots(mapdata) - 1; i >= 0; --i) {
+        struct dataEntry *p = scanSlot(mapdata, i);
+        while (p) {
+            register struct dataEntry *next = mapdata->isView ? p->nextInCommittedView : p->nextSameHash;
+            freeEntry(mapdata, p);
+            p = next;
+        }
+    }
+}
+
+// allocates the initial bucket array, the open addressing table, the tree or the compact index table, as selected by the mode passed to natOpen.
+// Returns 0 if OK.
+// Index maps hash by the index value: unless ordered, non-unique ones use posting lists if requested, and fixed width values the compact table.
+// Else they use hash chains. Ordered index maps keep the bucket array for lookups by value, and the sorted tree for range scans.
+static int allocateSlots(struct map * const mapdata, int size, int mode) {
+    mapdata->keyHash = NULL;
+    mapdata->probe = NULL;
+    mapdata->tree = NULL;
+    mapdata->sorted = NULL;
+    mapdata->compact = NULL;
+    mapdata->postings = NULL;
+    if (mode & IS_INDEX) {
+        if ((mode & POSTING_LISTS) && !(mode & (IS_UNIQUE_UNDEX | ORDERED_KEYS))) {
+            mapdata->postings = postingCreate(size);
+        } else if ((mode & INDEX_HASH_IS_KEY) && !(mode & ORDERED_KEYS)) {
+            mapdata->compact = compactCreate(size, INDEX_WIDTH(mode));
+        } else {
+            mapdata->keyHash = calloc(size, sizeof(struct dataEntry *));
+            if (mapdata->keyHash && (mode & ORDERED_KEYS)) {
+                mapdata->sorted = sortedCreate(indexSortKey);
+                if (!mapdata->sorted) {
+                    free(mapdata->keyHash);
+                    mapdata->keyHash = NULL;
+                }
+            }
+        }
+    } else if (mode & ORDERED_KEYS) {
+        mapdata->tree = treeCreate();
+    } else if (mode & OPEN_ADDRESSING) {
+        mapdata->probe = probeCreate(size);
+    } else {
+        mapdata->keyHash = calloc(size, sizeof(struct dataEntry *));
+    }
+    return mapdata->keyHash || mapdata->probe || mapdata->tree || mapdata->compact || mapdata->postings ? 0 : -1;
+}
+
+static void freeSlots(struct map * const mapdata) {
+    if (mapdata->probe)
+        probeDestroy(mapdata->probe);
+    if (mapdata->tree)
+        treeDestroy(mapdata->tree);
+    if (mapdata->sorted)
+        sortedDestroy(mapdata->sorted);
+    if (mapdata->compact)
+        compactDestroy(mapdata->compact);
+    if (mapdata->postings)
+        postingDestroy(mapdata->postings);
+    if (mapdata->oldKeyHash)
+        free(mapdata->oldKeyHash);
+    if (mapdata->keyHash)
+        free(mapdata->keyHash);
+}
+
+// makes sure that a subsequent setPutSub / setPutSubShadow can insert a new entry. Returns 0 if OK.
+// Hash chains never run out of space, the open addressing table may have to grow, the trees may need new nodes.
+static inline int reserveEntry(struct map * const mapdata) {
+    if (mapdata->tree)
+        return treeReserve(mapdata->tree);
+    if (mapdata->sorted)
+        return sortedReserve(mapdata->sorted);
+    if (mapdata->compact)
+        return compactReserve(mapdata->compact);
+    return mapdata->probe ? probeReserve(mapdata->probe) : 0;
+}
+
+// resets the map to an empty bucket array, after the entries have been discarded or logged
+static void resetBuckets(struct map * const mapdata) {
+    if (mapdata->probe) {
+        probeClear(mapdata->probe);
+        mapdata->count = 0;
+        return;
+    }
+    if (mapdata->tree) {
+        treeClear(mapdata->tree);
+        mapdata->count = 0;
+        return;
+    }
+    if (mapdata->compact) {
+        compactClear(mapdata->compact);
+        mapdata->count = 0;
+        return;
+    }
+    if (mapdata->postings) {
+        postingClear(mapdata->postings);
+        mapdata->count = 0;
+        return;
+    }
+    if (mapdata->oldKeyHash) {
+        free(mapdata->oldKeyHash);
+        mapdata->oldKeyHash = NULL;
+        mapdata->oldHashTableSize = 0;
+        mapdata->rehashPosition = 0;
+    }
+    if (mapdata->sorted)
+        sortedClear(mapdata->sorted);
+    memset(mapdata->keyHash, 0, mapdata->hashTableSize * sizeof(struct dataEntry *));     // set the initial pointers to NULL
+    mapdata->count = 0;
+}
+
+
 // Iterator
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
@@ -139,8 +547,15 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_0002
 #ifdef DEBUG
     fprintf(stderr, "iterate on map %16p (has %d entries in %d slots)\n", mapdata, mapdata->count, mapdata->hashTableSize);
 #endif
+    if (mapdata->tree) {
+        // ordered maps iterate in key order. The successor is looked up by key, as entries move within the leaves on inserts and removals
+        e = e ? treeHigher(mapdata->tree, e->key) : mapdata->tree->first->count ? mapdata->tree->first->entries[0] : NULL;
+        if (e)
+            (*env)->SetLongField(env, myClass, javaIteratorCurrentKeyFID, e->key);
+        return (jlong)e;
+    }
     if (e) {
-        e = e->nextSameHash;
+        e = mapdata->isView ? e->nextInCommittedView : e->nextSameHash;
         if (e) {
             // update Key, but not slot
 #ifdef DEBUG
@@ -153,8 +568,8 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_0002
 
     // need a new slot for the next entry
     // must search for an entry in the next slot...
-    while (++hashIndex < mapdata->hashTableSize) {
-        e = mapdata->keyHash[hashIndex];
+    while (++hashIndex < numberOfScanSlots(mapdata)) {
+        e = scanSlot(mapdata, hashIndex);
         if (e) {
             // found an entry. Store this new hashIndex and return the entry
 #ifdef DEBUG
@@ -176,8 +591,11 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_0002
 static int record_change(JNIEnv *env, struct tx_log_hdr *ctx, struct map *mapdata, struct dataEntry *oldData, struct dataEntry *newData) {
     if (!IS_TRANSACTIONAL(ctx, mapdata)) {
         // no transaction log. Maybe free old data
+        ++mapdata->changeSequence;
+        if (mapdata->changes)
+            trackChange(mapdata, newData ? newData->key : oldData->key);
         if (oldData)
-            free(oldData);
+            freeEntry(mapdata, oldData);
         return 0;
     }
 
@@ -197,6 +615,104 @@ static int record_change(JNIEnv *env, struct tx_log_hdr *ctx, struct map *mapdat
     return 0;
 }
 
+// Compact and posting list index maps do not have an entry per key. For the transaction log, a change is recorded as transient entries
+// in the format of hash index maps (the value in data, uncompressedSize is its length and compressedSize the hash), which are discarded
+// by commit or rollback.
+static inline jboolean logsCopies(const struct map * const mapdata) {
+    return mapdata->compact || mapdata->postings;
+}
+
+// Returns NULL if no memory is available.
+static struct dataEntry *indexLogEntry(struct map * const mapdata, jlong key, int hash, const void *value, int length) {
+    struct dataEntry *e = allocEntry(mapdata, length);
+    if (e) {
+        e->nextSameHash = NULL;
+        e->nextInCommittedView = NULL;
+        e->uncompressedSize = length;
+        e->compressedSize = hash;
+        e->key = key;
+        memcpy(e->data, value, length);
+    }
+    return e;
+}
+
+#define POSTING_BATCH_SIZE      256
+
+// records the removal of all entries of a compact or posting list index map. Returns 0 if OK, -1 if not all could be logged
+static int logIndexEntries(JNIEnv *env, struct tx_log_hdr *ctx, struct map *mapdata) {
+    int result = 0;
+    if (mapdata->compact) {
+        const struct compactIndex *t = mapdata->compact;
+        for (int i = 0; i < t->capacity; ++i) {
+            if (t->ctrl[i] == COMPACT_USED) {
+                struct dataEntry *e = indexLogEntry(mapdata, t->keys[i], t->hashes[i], compactValue(t, i), t->width);
+                if (e)
+                    record_change(env, ctx, mapdata, e, NULL);  // may throw an error....
+                else
+                    result = -1;
+            }
+        }
+        return result;
+    }
+    jlong keys[POSTING_BATCH_SIZE];
+    for (int i = 0; i < postingScanSlots(mapdata->postings); ++i) {
+        for (const struct postingNode *n = postingScanSlot(mapdata->postings, i); n; n = n->next) {
+            int found = postingCollect(&n->keys, NULL, 0, keys, POSTING_BATCH_SIZE);
+            while (found > 0) {
+                for (int j = 0; j < found; ++j) {
+                    struct dataEntry *e = indexLogEntry(mapdata, keys[j], n->hash, n->value, n->length);
+                    if (e)
+                        record_change(env, ctx, mapdata, e, NULL);  // may throw an error....
+                    else
+                        result = -1;
+                }
+                found = found == POSTING_BATCH_SIZE ? postingCollect(&n->keys, &keys[POSTING_BATCH_SIZE - 1], 0, keys, POSTING_BATCH_SIZE) : 0;
+            }
+        }
+    }
+    return result;
+}
+
+// replays a logged change on a compact or posting list index map: removes the entry of oldEntry, and adds the one of newEntry (either can be NULL)
+static void applyIndexChange(struct map * const mapdata, const struct dataEntry *oldEntry, const struct dataEntry *newEntry, const char *what) {
+    if (mapdata->postings) {
+        if (oldEntry) {
+            struct postingNode *n = postingFindKey(mapdata->postings, oldEntry->key, oldEntry->compressedSize);
+            if (!n || postingRemove(mapdata->postings, n, oldEntry->key))
+                fprintf(stderr, "%s PROBLEM: no index entry for key %ld\n", what, (long)oldEntry->key);
+            else
+                --mapdata->count;
+        }
+        if (newEntry) {
+            if (postingInsert(mapdata->postings, newEntry->key, newEntry->compressedSize, newEntry->data, newEntry->uncompressedSize))
+                fprintf(stderr, "%s PROBLEM: cannot add index entry for key %ld\n", what, (long)newEntry->key);
+            else
+                ++mapdata->count;
+        }
+        return;
+    }
+    struct compactIndex *t = mapdata->compact;
+    if (oldEntry) {
+        int slot = compactFindKey(t, oldEntry->key, oldEntry->compressedSize);
+        if (slot < 0) {
+            fprintf(stderr, "%s PROBLEM: no index entry for key %ld\n", what, (long)oldEntry->key);
+        } else {
+            compactErase(t, slot);
+            --mapdata->count;
+        }
+    }
+    if (newEntry) {
+        if (compactReserve(t)) {
+            fprintf(stderr, "%s PROBLEM: no space in index for key %ld\n", what, (long)newEntry->key);
+            return;
+        }
+        uint64_t value[COMPACT_MAX_WORDS];
+        compactLoadValue(t, newEntry->data, value);
+        compactInsert(t, newEntry->key, newEntry->compressedSize, value);
+        ++mapdata->count;
+    }
+}
+
 //
 //
 //
@@ -225,11 +741,55 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natOpen
     mapdata->hashTableSize = size;
     mapdata->modes = mode;
     mapdata->lastCommittedRef = -1L;
+    mapdata->changeSequence = 0;
     mapdata->committedView = NULL;
-    mapdata->keyHash = calloc(size, sizeof(struct dataEntry *));
+    mapdata->isView = JNI_FALSE;
+    mapdata->oldKeyHash = NULL;
+    mapdata->oldHashTableSize = 0;
+    mapdata->rehashPosition = 0;
     mapdata->sharedIndexLookupBufferSize = 0;
     mapdata->sharedIndexLookupBuffer = NULL;
-    if (!mapdata->keyHash) {
+    mapdata->cache = NULL;
+    mapdata->indexRules = NULL;
+    mapdata->versions = NULL;
+    mapdata->mapped = NULL;
+    mapdata->changes = NULL;
+    if ((mode & IS_INDEX) && (mode & INDEX_HASH_IS_KEY) && INDEX_WIDTH(mode) > COMPACT_MAX_WIDTH) {
+        free(mapdata);
+        throwAny(env, "Index values wider than 16 bytes cannot be stored in a compact index");
+        return 0L;
+    }
+    int codecMode = mode & IS_INDEX ? 0 : mode;    // index maps do not compress, and use these bits for the index width
+    if (!codecSupported(CODEC_ID(codecMode))) {
+        free(mapdata);
+        throwAny(env, "Compression codec not supported");
+        return 0L;
+    }
+    mapdata->codec = codecCreate(CODEC_ID(codecMode), CODEC_LEVEL(codecMode), CODEC_SAVINGS(codecMode));
+    if (!mapdata->codec) {
+        free(mapdata);
+        throwOutOfMemory(env);
+        return 0L;
+    }
+    mapdata->arena = arenaCreate();
+    if (!mapdata->arena) {
+        codecDestroy(mapdata->codec);
+        free(mapdata);
+        throwOutOfMemory(env);
+        return 0L;
+    }
+    mapdata->leases = leaseCreateRegistry(mapdata->arena);
+    if (!mapdata->leases) {
+        arenaDestroy(mapdata->arena);
+        codecDestroy(mapdata->codec);
+        free(mapdata);
+        throwOutOfMemory(env);
+        return 0L;
+    }
+    if (allocateSlots(mapdata, size, mode)) {
+        codecDestroy(mapdata->codec);
+        leaseDestroyRegistry(mapdata->leases);
+        arenaDestroy(mapdata->arena);
         free(mapdata);
         throwOutOfMemory(env);
         return 0L;
@@ -237,7 +797,10 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natOpen
     if (withCommittedView) {
         struct map *view = malloc(sizeof(struct map));
         if (!view) {
-            free(mapdata->keyHash);
+            freeSlots(mapdata);
+            codecDestroy(mapdata->codec);
+            leaseDestroyRegistry(mapdata->leases);
+            arenaDestroy(mapdata->arena);
             free(mapdata);
             throwOutOfMemory(env);
             return 0L;
@@ -246,14 +809,23 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natOpen
         mapdata->committedView = view;
 
         view->modes = mode & VIEW_INDEX_MASK;        // the committed view does not have any TX management
-        view->keyHash = calloc(size, sizeof(struct dataEntry *));
-        if (!view->keyHash) {
+        view->isView = JNI_TRUE;
+        view->indexRules = NULL;
+        if (allocateSlots(view, size, mode)) {
             free(view);
-            free(mapdata->keyHash);
+            freeSlots(mapdata);
+            codecDestroy(mapdata->codec);
+            leaseDestroyRegistry(mapdata->leases);
+            arenaDestroy(mapdata->arena);
             free(mapdata);
             throwOutOfMemory(env);
             return 0L;
         }
+        pthread_mutex_init(&view->pinLock, NULL);
+        pthread_cond_init(&view->pinCond, NULL);
+        view->pins = 0;
+        view->updating = JNI_FALSE;
+        view->pinOwners = NULL;
     }
 
     // printf("jpawMap: created new map at %p\n", mapdata);
@@ -271,32 +843,8 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natGetView
     return (jlong)mapdata->committedView;
 }
 
-static inline int computeHash(jlong arg) {
-    arg *= 33;
-    return (int) (arg ^ (arg >> 32));
-}
-
-static inline int computeKeyHash(jlong arg, int size) {
-    arg *= 33;
-    return ((int) (arg ^ (arg >> 32)) & 0x7fffffff) % size;
-}
-
-static inline int computeSlot(const struct map * const mapdata, const struct dataEntry * const e) {
-    return ((mapdata->modes & IS_INDEX ? e->compressedSize : computeHash(e->key)) & 0x7fffffff) % mapdata->hashTableSize;
-}
 
-// clear all entries
-static void clear(struct dataEntry **keyHash, int numEntries) {
-    int i;
-    for (i = 0; i < numEntries; ++i) {
-        struct dataEntry *p = keyHash[i];
-        while (p) {
-            register struct dataEntry *next = p->nextSameHash;
-            free(p);
-            p = next;
-        }
-    }
-}
+static void destroyVersionStore(struct versionStore *vs);
 
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
@@ -307,10 +855,38 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natClose
     (JNIEnv *env, jobject me, jlong cMap) {
     // Get the int given the Field ID
     struct map *mapdata = (struct map *) cMap;
-    clear(mapdata->keyHash, mapdata->hashTableSize);
+    struct map *view = mapdata->committedView;
+    if (view) {
+        if (view->versions)
+            destroyVersionStore(view->versions);    // the entries are released with the arena
+        if (view->sharedIndexLookupBuffer)
+            free(view->sharedIndexLookupBuffer);
+        pthread_cond_destroy(&view->pinCond);
+        pthread_mutex_destroy(&view->pinLock);
+        freeSlots(view);
+        free(view);
+    }
+    if (mapdata->cache)
+        cacheDestroy(mapdata->cache);
+    while (mapdata->indexRules) {
+        struct indexRule *r = mapdata->indexRules;
+        mapdata->indexRules = r->next;
+        free(r);
+    }
+    codecDestroy(mapdata->codec);
+    leaseDestroyRegistry(mapdata->leases);
+    arenaDestroy(mapdata->arena);   // releases all entries at once
+    if (mapdata->mapped) {
+        munmap(mapdata->mapped->base, mapdata->mapped->size);
+        free(mapdata->mapped);
+    }
+    if (mapdata->changes) {
+        probeDestroy(mapdata->changes->keys);
+        free(mapdata->changes);
+    }
     if (mapdata->sharedIndexLookupBuffer)
         free(mapdata->sharedIndexLookupBuffer);
-    free(mapdata->keyHash);
+    freeSlots(mapdata);
     free(mapdata);
 }
 
@@ -336,14 +912,22 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natClear
     // Get the int given the Field ID
     struct map *mapdata = (struct map *) cMap;
     struct tx_log_hdr *ctx = (struct tx_log_hdr *)ctxAsLong;
+    for (struct indexRule *r = mapdata->indexRules; r; r = r->next)
+        Java_de_jpaw_offHeap_AbstractOffHeapMap_natClear(env, me, (jlong)r->index, ctxAsLong);
     if (!IS_TRANSACTIONAL(ctx, mapdata)) {
         // this is faster
-        clear(mapdata->keyHash, mapdata->hashTableSize);
+        clear(mapdata);
+        ++mapdata->changeSequence;
+        if (mapdata->changes)
+            mapdata->changes->incomplete = JNI_TRUE;    // the removed keys are not known
+    } else if (mapdata->compact || mapdata->postings) {
+        if (logIndexEntries(env, ctx, mapdata))
+            throwOutOfMemory(env);
     } else {
         int hash;
-        for (hash = 0; hash < mapdata->hashTableSize; ++hash) {
+        for (hash = 0; hash < numberOfScanSlots(mapdata); ++hash) {
             struct dataEntry *e;
-            for (e = mapdata->keyHash[hash]; e; e = e->nextSameHash) {
+            for (e = scanSlot(mapdata, hash); e; e = e->nextSameHash) {
 #ifdef DEBUG
                 fprintf(stderr, "Transactional clear of entry %16p in hash slot %d\n", e, hash);
 #endif
@@ -351,11 +935,10 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natClear
             }
         }
     }
-    memset(mapdata->keyHash, 0, mapdata->hashTableSize * sizeof(struct dataEntry *));     // set the initial pointers to NULL
-    mapdata->count = 0;
+    resetBuckets(mapdata);
 }
 
-static jbyteArray toJavaByteArray(JNIEnv *env, struct dataEntry *e) {
+static jbyteArray toJavaByteArray(JNIEnv *env, const struct map *mapdata, struct dataEntry *e) {
     if (!e)
         return (jbyteArray) 0;
     jbyteArray result = (*env)->NewByteArray(env, e->uncompressedSize);
@@ -371,8 +954,10 @@ static jbyteArray toJavaByteArray(JNIEnv *env, struct dataEntry *e) {
             // TODO: release result?
             return result;
         }
-        LZ4_decompress_fast(e->data, tmp, e->uncompressedSize);
+        int rc = decompressEntry(mapdata, e, tmp, e->uncompressedSize);
         (*env)->ReleasePrimitiveArrayCritical(env, result, tmp, 0);  // transfer back data and release tmp buffer
+        if (rc)
+            throwAny(env, "Corrupted compressed entry");
 #else
         // TODO: can the temporary buffer be avoided, i.e. we write directly into the jbyteArray buffer? It would skip 1 malloc / free plus an array copy
         char *tmp = malloc(e->uncompressedSize);
@@ -381,8 +966,10 @@ static jbyteArray toJavaByteArray(JNIEnv *env, struct dataEntry *e) {
             // TODO: release result?
             return result;
         }
-        LZ4_decompress_fast(e->data, tmp, e->uncompressedSize);
-        (*env)->SetByteArrayRegion(env, result, 0, e->uncompressedSize, (jbyte *)tmp);
+        if (decompressEntry(mapdata, e, tmp, e->uncompressedSize))
+            throwAny(env, "Corrupted compressed entry");
+        else
+            (*env)->SetByteArrayRegion(env, result, 0, e->uncompressedSize, (jbyte *)tmp);
         free(tmp);
 #endif
     }
@@ -390,9 +977,27 @@ static jbyteArray toJavaByteArray(JNIEnv *env, struct dataEntry *e) {
 }
 
 
+// looks up a key in a committed view, along the chains of the view. They differ from the chains of the map,
+// as the view resizes independently
+static struct dataEntry *findCommittedEntry(const struct map *view, jlong key) {
+    if (view->probe)
+        return probeGet(view->probe, key);
+    if (view->tree)
+        return treeGet(view->tree, key);
+    struct dataEntry *e = *findKeyBucket(view, key);
+    while (e && e->key != key)
+        e = e->nextInCommittedView;
+    return e;
+}
+
 static struct dataEntry *find_entry(struct map *mapdata, jlong key) {
-    int hash = computeKeyHash(key, mapdata->hashTableSize);
-    struct dataEntry *e = mapdata->keyHash[hash];
+    if (mapdata->isView)
+        return findCommittedEntry(mapdata, key);
+    if (mapdata->probe)
+        return probeGet(mapdata->probe, key);
+    if (mapdata->tree)
+        return treeGet(mapdata->tree, key);
+    struct dataEntry *e = *findKeyBucket(mapdata, key);
     while (e) {
         // check if this is a match
         if (e->key == key)
@@ -411,7 +1016,7 @@ JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
     (JNIEnv *env, jclass me, jlong cMap, jlong key) {
     struct map *mapdata = (struct map *) cMap;
     struct dataEntry *e = find_entry(mapdata, key);
-    return toJavaByteArray(env, e);
+    return toJavaByteArray(env, mapdata, e);
 }
 
 /*
@@ -434,11 +1039,54 @@ JNIEXPORT jobject JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_na
         throwOutOfMemory(env);
         return NULL;
     }
-    LZ4_decompress_fast(e->data, tmp, e->uncompressedSize);
+    if (decompressEntry(mapdata, e, tmp, e->uncompressedSize)) {
+        free(tmp);
+        throwAny(env, "Corrupted compressed entry");
+        return NULL;
+    }
     return (*env)->NewDirectByteBuffer(env, tmp, (jlong)e->uncompressedSize);
 //    free(tmp);
 }
 
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natLease
+ * Signature: (JJ)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natLease
+  (JNIEnv *env, jclass me, jlong cMap, jlong key) {
+    struct map *mapdata = (struct map *) cMap;
+    // acquire the lease first: an entry found afterwards is not freed before the lease has been released
+    struct lease *l = leaseAcquire(mapdata->leases);
+    if (!l) {
+        throwOutOfMemory(env);
+        return 0L;
+    }
+    struct dataEntry *e = find_entry(mapdata, key);
+    if (!e) {
+        leaseRelease(l);
+        return 0L;
+    }
+    l->length = e->uncompressedSize;
+    if (!e->compressedSize) {
+        l->data = e->data;
+        return (jlong) l;
+    }
+    l->data = leaseBuffer(l, e->uncompressedSize);
+    if (!l->data) {
+        leaseRelease(l);
+        throwOutOfMemory(env);
+        return 0L;
+    }
+    if (decompressEntry(mapdata, e, l->data, e->uncompressedSize)) {
+        leaseRelease(l);
+        throwAny(env, "Corrupted compressed entry");
+        return 0L;
+    }
+    leaseUnpin(l);      // the lease refers to its own copy now, the entry may go away
+    return (jlong) l;
+}
+
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
  * Method:    natLength
@@ -466,57 +1114,255 @@ JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natCo
 
 
 
-// remove an entry for a key. If transactions are active, redo log / rollback info will be stored. Else the entry no longer required will be freed.
-// JNIEnv may be NULL if ctx is NULL
-static jboolean execRemove4Rollback(struct map * const mapdata, struct dataEntry * const oldEntry) {
-    int slot = computeSlot(mapdata, oldEntry);
-    struct dataEntry *prev = NULL;
-    jlong key = oldEntry->key;
-    for (struct dataEntry *e = mapdata->keyHash[slot]; e; e = e->nextSameHash) {
-        // check if this is a match
-        if (e->key == key) {
-            if (!prev) {
-                // initial entry, update mapdata
-                mapdata->keyHash[slot] = e->nextSameHash;
-            } else {
-                prev->nextSameHash = e->nextSameHash;
-            }
-#ifdef DEBUG
-            fprintf(stderr, "Removing an entry of key %ld in slot %d\n", (long)key, hash);
-#endif
-            free(e);
-            --mapdata->count;
-            return JNI_TRUE;
-        }
-        prev = e;
+// seek modes of ordered maps
+#define SEEK_FLOOR      0
+#define SEEK_CEILING    1
+#define SEEK_HIGHER     2
+#define SEEK_LOWER      3
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natSeek
+ * Signature: (JJI[J)Z
+ */
+JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natSeek
+    (JNIEnv *env, jclass me, jlong cMap, jlong key, jint mode, jlongArray result) {
+    struct map *mapdata = (struct map *) cMap;
+    if (!mapdata->tree) {
+        throwAny(env, "Map is not ordered");
+        return JNI_FALSE;
     }
-    // not found. No change of size  ERROR!
-    fprintf(stderr, "ERROR: Cannot remove an entry of key %ld in slot %d (does not exist)\n", (long)key, slot);
-    return JNI_FALSE;
+    struct dataEntry *e;
+    switch (mode) {
+    case SEEK_FLOOR:
+        e = treeFloor(mapdata->tree, key);
+        break;
+    case SEEK_CEILING:
+        e = treeCeiling(mapdata->tree, key);
+        break;
+    case SEEK_HIGHER:
+        e = treeHigher(mapdata->tree, key);
+        break;
+    default:
+        e = key == (jlong)0x8000000000000000LL ? NULL : treeFloor(mapdata->tree, key - 1);
+        break;
+    }
+    if (!e)
+        return JNI_FALSE;
+    (*env)->SetLongArrayRegion(env, result, 0, 1, &e->key);
+    return JNI_TRUE;
 }
 
-// COMMIT subroutine: remove an entry for a key
-// only called from commitToView. Used for data map as well as index
-static jboolean execRemoveShadow(struct map * const mapdata, const struct dataEntry * const ref) {
-    int slot = computeSlot(mapdata, ref);
-    struct dataEntry *prev = NULL;
-    struct dataEntry *e = mapdata->keyHash[slot];
-    jlong key = ref->key;
-    while (e) {
-        // check if this is a match
-        if (e->key == key) {
-            if (!prev) {
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetKeyRange
+ * Signature: (JJJ[JI)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetKeyRange
+    (JNIEnv *env, jclass me, jlong cMap, jlong fromKey, jlong toKey, jlongArray keys, jint maxCount) {
+    struct map *mapdata = (struct map *) cMap;
+    if (!mapdata->tree) {
+        throwAny(env, "Map is not ordered");
+        return 0;
+    }
+    if (maxCount > (*env)->GetArrayLength(env, keys))
+        maxCount = (*env)->GetArrayLength(env, keys);
+    if (maxCount <= 0)
+        return 0;
+    jlong *keyArray = (*env)->GetPrimitiveArrayCritical(env, keys, NULL);
+    if (!keyArray) {
+        throwOutOfMemory(env);
+        return 0;
+    }
+    int n = treeRange(mapdata->tree, fromKey, toKey, keyArray, NULL, maxCount);
+    (*env)->ReleasePrimitiveArrayCritical(env, keys, keyArray, 0);
+    return n;
+}
+
+
+#define TRAIN_MAX_SAMPLES           16384
+#define TRAIN_SAMPLES_PER_DICT_BYTE 100     // sample size relative to the dictionary size
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natTrainDictionary
+ * Signature: (JI)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natTrainDictionary
+    (JNIEnv *env, jobject me, jlong cMap, jint maxSize) {
+    struct map *mapdata = (struct map *) cMap;
+    if (maxSize > CODEC_MAX_DICTIONARY_SIZE)
+        maxSize = CODEC_MAX_DICTIONARY_SIZE;
+    else if (maxSize > 0 && maxSize < CODEC_MIN_TRAINED_SIZE)
+        maxSize = CODEC_MIN_TRAINED_SIZE;
+    if (maxSize <= 0 || !mapdata->count)
+        return (*env)->NewByteArray(env, 0);
+    // take every stride-th entry, spread across the whole map
+    int stride = mapdata->count / TRAIN_MAX_SAMPLES + 1;
+    int budget = maxSize * TRAIN_SAMPLES_PER_DICT_BYTE;
+    char *samples = malloc(budget);
+    int *sampleSizes = malloc(sizeof(int) * TRAIN_MAX_SAMPLES);
+    char *dictionary = malloc(maxSize);
+    if (!samples || !sampleSizes || !dictionary) {
+        free(samples);
+        free(sampleSizes);
+        free(dictionary);
+        throwOutOfMemory(env);
+        return (jbyteArray)0;
+    }
+    int numSamples = 0;
+    int used = 0;
+    int n = 0;
+    int i;
+    for (i = 0; i < numberOfScanSlots(mapdata) && numSamples < TRAIN_MAX_SAMPLES && used < budget; ++i) {
+        struct dataEntry *e;
+        for (e = scanSlot(mapdata, i); e && numSamples < TRAIN_MAX_SAMPLES && used < budget;
+          e = mapdata->isView ? e->nextInCommittedView : e->nextSameHash) {
+            if (n++ % stride || !e->uncompressedSize)
+                continue;
+            int len = e->uncompressedSize <= budget - used ? e->uncompressedSize : budget - used;
+            if (!e->compressedSize)
+                memcpy(samples + used, e->data, len);
+            else if (decompressEntry(mapdata, e, samples + used, len))
+                continue;       // skip corrupted entries
+            sampleSizes[numSamples++] = len;
+            used += len;
+        }
+    }
+    int size = codecTrainDictionary(samples, sampleSizes, numSamples, dictionary, maxSize);
+    jbyteArray result = (*env)->NewByteArray(env, size);
+    if (result)
+        (*env)->SetByteArrayRegion(env, result, 0, size, (const jbyte *)dictionary);
+    free(samples);
+    free(sampleSizes);
+    free(dictionary);
+    return result;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natSetDictionary
+ * Signature: (J[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSetDictionary
+    (JNIEnv *env, jobject me, jlong cMap, jbyteArray dictionary) {
+    struct map *mapdata = (struct map *) cMap;
+    int size = dictionary ? (*env)->GetArrayLength(env, dictionary) : 0;
+    if (size > CODEC_MAX_DICTIONARY_SIZE) {
+        throwAny(env, "Compression dictionary too big");
+        return;
+    }
+    // existing entries could not be decoded any more
+    if (mapdata->codec->compressedEntries) {
+        throwAny(env, "Compression dictionary cannot be replaced while compressed entries exist");
+        return;
+    }
+    char *tmp = NULL;
+    if (size) {
+        tmp = malloc(size);
+        if (!tmp) {
+            throwOutOfMemory(env);
+            return;
+        }
+        (*env)->GetByteArrayRegion(env, dictionary, 0, size, (jbyte *)tmp);
+    }
+    if (codecSetDictionary(mapdata->codec, tmp, size))
+        throwOutOfMemory(env);
+    free(tmp);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natGetDictionary
+ * Signature: (J)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natGetDictionary
+    (JNIEnv *env, jobject me, jlong cMap) {
+    struct map *mapdata = (struct map *) cMap;
+    const struct codec *c = mapdata->codec;
+    if (!c->dictionarySize)
+        return (jbyteArray)0;
+    jbyteArray result = (*env)->NewByteArray(env, c->dictionarySize);
+    if (result)
+        (*env)->SetByteArrayRegion(env, result, 0, c->dictionarySize, (const jbyte *)c->dictionary);
+    return result;
+}
+
+
+// unlinks the entry for a key from the (dirty) map and returns it, or NULL if no entry exists. The entry is not freed.
+// hash is the hash of the key for data maps, and the hash of the index value for index maps (see computeEntryHash)
+static struct dataEntry *unlinkEntry(struct map * const mapdata, jlong key, int hash) {
+    if (mapdata->probe || mapdata->tree) {
+        struct dataEntry *e = mapdata->probe ? probeRemove(mapdata->probe, key) : treeRemove(mapdata->tree, key);
+        if (e)
+            --mapdata->count;
+        return e;
+    }
+    struct dataEntry **slot = findBucket(mapdata, hash);
+    struct dataEntry *prev = NULL;
+    for (struct dataEntry *e = *slot; e; e = e->nextSameHash) {
+        // check if this is a match
+        if (e->key == key) {
+            if (!prev) {
+                // initial entry, update mapdata
+                *slot = e->nextSameHash;
+            } else {
+                prev->nextSameHash = e->nextSameHash;
+            }
+#ifdef DEBUG
+            fprintf(stderr, "Removing an entry of key %ld\n", (long)key);
+#endif
+            if (mapdata->sorted)
+                sortedRemove(mapdata->sorted, e);
+            --mapdata->count;
+            return e;
+        }
+        prev = e;
+    }
+    return NULL;
+}
+
+// remove an entry for a key, during rollback. The entry no longer required will be freed.
+static jboolean execRemove4Rollback(struct map * const mapdata, struct dataEntry * const oldEntry) {
+    struct dataEntry *e = unlinkEntry(mapdata, oldEntry->key, computeEntryHash(mapdata, oldEntry));
+    if (e) {
+        freeEntry(mapdata, e);
+        return JNI_TRUE;
+    }
+    // not found. No change of size  ERROR!
+    fprintf(stderr, "ERROR: Cannot remove an entry of key %ld (does not exist)\n", (long)oldEntry->key);
+    return JNI_FALSE;
+}
+
+// COMMIT subroutine: unlinks the entry for the key of ref from the committed view and returns it, or NULL if no entry exists. The entry is not freed.
+// only called from commitToView. Used for data map as well as index
+static struct dataEntry *unlinkShadowEntry(struct map * const mapdata, const struct dataEntry * const ref) {
+    if (mapdata->probe || mapdata->tree) {
+        struct dataEntry *e = mapdata->probe ? probeRemove(mapdata->probe, ref->key) : treeRemove(mapdata->tree, ref->key);
+        if (e)
+            --mapdata->count;
+        return e;
+    }
+    struct dataEntry **slot = computeSlot(mapdata, ref);
+    struct dataEntry *prev = NULL;
+    struct dataEntry *e = *slot;
+    jlong key = ref->key;
+    while (e) {
+        // check if this is a match
+        if (e->key == key) {
+            if (!prev) {
                 // initial entry, update mapdata
-                mapdata->keyHash[slot] = e->nextInCommittedView;
+                *slot = e->nextInCommittedView;
             } else {
-                prev->nextSameHash = e->nextInCommittedView;
+                prev->nextInCommittedView = e->nextInCommittedView;
             }
 #ifdef DEBUG
             fprintf(stderr, "Removing a shadow entry of key %ld in slot %d\n", (long)key, hash);
 #endif
-            free(e);
+            if (mapdata->sorted)
+                sortedRemove(mapdata->sorted, e);
             --mapdata->count;
-            return JNI_TRUE;
+            return e;
         }
         prev = e;
         e = e->nextInCommittedView;
@@ -525,7 +1371,28 @@ static jboolean execRemoveShadow(struct map * const mapdata, const struct dataEn
 #ifdef DEBUG
     fprintf(stderr, "Not removing a shadow entry of key %ld in slot %d (does not exist)\n", (long)key, hash);
 #endif
-    return JNI_FALSE;
+    return NULL;
+}
+
+// COMMIT subroutine: remove an entry for a key
+static jboolean execRemoveShadow(struct map * const mapdata, const struct dataEntry * const ref) {
+    struct dataEntry *e = unlinkShadowEntry(mapdata, ref);
+    if (!e)
+        return JNI_FALSE;
+    freeEntry(mapdata, e);
+    return JNI_TRUE;
+}
+
+// updates the attached indexes for a row change, see the index rules below
+static int maintainIndexes(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key,
+  const struct dataEntry *oldEntry, const struct dataEntry *newEntry);
+
+// maintains the attached indexes for the removal of the row of key. Returns 0 if OK, else -1 (and the row must not be removed)
+static inline int maintainIndexesForRemove(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key) {
+    if (!mapdata->indexRules)
+        return 0;
+    const struct dataEntry *e = find_entry(mapdata, key);
+    return e ? maintainIndexes(env, mapdata, ctx, key, e, NULL) : 0;
 }
 
 /*
@@ -540,33 +1407,18 @@ JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natDe
 // remove an entry for a key. If transactions are active, redo log / rollback info will be stored. Else the entry no longer required will be freed.
 // JNIEnv may be NULL if ctx is NULL
     struct map *mapdata = (struct map *)cMap;
-    int hash = computeKeyHash(key, mapdata->hashTableSize);
-    struct dataEntry *prev = NULL;
-    struct dataEntry *e = mapdata->keyHash[hash];
-    while (e) {
-        // check if this is a match
-        if (e->key == key) {
-            if (!prev) {
-                // initial entry, update mapdata
-                mapdata->keyHash[hash] = e->nextSameHash;
-            } else {
-                prev->nextSameHash = e->nextSameHash;
-            }
+    if (maintainIndexesForRemove(env, mapdata, (struct tx_log_hdr *)ctx, key))
+        return JNI_FALSE;
+    struct dataEntry *e = unlinkEntry(mapdata, key, computeHash(key));
+    if (!e) {
+        // not found. No change of size
 #ifdef DEBUG
-            fprintf(stderr, "Removing an entry of key %ld in slot %d\n", (long)key, hash);
+        fprintf(stderr, "Not removing an entry of key %ld (does not exist)\n", (long)key);
 #endif
-            record_change(env, (struct tx_log_hdr *)ctx, mapdata, e, NULL); // may throw an error
-            --mapdata->count;
-            return JNI_TRUE;
-        }
-        prev = e;
-        e = e->nextSameHash;
+        return JNI_FALSE;
     }
-    // not found. No change of size
-#ifdef DEBUG
-    fprintf(stderr, "Not removing an entry of key %ld in slot %d (does not exist)\n", (long)key, hash);
-#endif
-    return JNI_FALSE;
+    record_change(env, (struct tx_log_hdr *)ctx, mapdata, e, NULL); // may throw an error
+    return JNI_TRUE;
 }
 
 
@@ -578,88 +1430,87 @@ JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natDe
 JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natRemove
     (JNIEnv *env, jobject me, jlong cMap, jlong ctx, jlong key) {
     struct map *mapdata = (struct map *) cMap;
-    int hash = computeKeyHash(key, mapdata->hashTableSize);
-    struct dataEntry *prev = NULL;
-    struct dataEntry *e = mapdata->keyHash[hash];
-    while (e) {
-        // check if this is a match
-        if (e->key == key) {
-            if (!prev) {
-                // initial entry, update mapdata
-                mapdata->keyHash[hash] = e->nextSameHash;
-            } else {
-                prev->nextSameHash = e->nextSameHash;
-            }
-            jbyteArray result = toJavaByteArray(env, e);
-            record_change(env, (struct tx_log_hdr *)ctx, mapdata, e, NULL); // may throw an error
-            --mapdata->count;
-            return result;
-        }
-        prev = e;
-        e = e->nextSameHash;
-    }
-    return (jbyteArray)0;
+    if (maintainIndexesForRemove(env, mapdata, (struct tx_log_hdr *)ctx, key))
+        return (jbyteArray)0;
+    struct dataEntry *e = unlinkEntry(mapdata, key, computeHash(key));
+    if (!e)
+        return (jbyteArray)0;
+    jbyteArray result = toJavaByteArray(env, mapdata, e);
+    record_change(env, (struct tx_log_hdr *)ctx, mapdata, e, NULL); // may throw an error
+    return result;
 }
 
 
-static struct dataEntry *create_new_entry(JNIEnv *env, jlong key, jbyteArray data, jint offset, jint length, jboolean doCompress) {
-    // int uncompressed_length = (*env)->GetArrayLength(env, data);
+// creates an entry from data in native memory
+static struct dataEntry *create_new_entry_from_memory(struct map * const mapdata, jlong key, const char *src, int length, jboolean doCompress) {
     struct dataEntry *e;
     if (doCompress) {
-        // compress the data. Allocate a target buffer
-        int max_compressed_length = ROUND_UP_SIZE(LZ4_compressBound(length));
-        struct dataEntry *tmp_dst = malloc(sizeof(struct dataEntry) + max_compressed_length);
-        if (!tmp_dst) {
+        // compress the data into a temporary buffer first, then allocate the entry of the exact size
+        char *tmp_dst = arenaScratch(mapdata->arena, codecBound(mapdata->codec, length));
+        if (!tmp_dst)
             return NULL;  // will throw OOM
-        }
+        int actual_compressed_length = codecCompress(mapdata->codec, src, length, tmp_dst, codecBound(mapdata->codec, length));
+        // if the compressed form does not need less space (the allocation is in multiples of 16), store the uncompressed one
+        if (!actual_compressed_length || ROUND_UP_SIZE(actual_compressed_length) >= ROUND_UP_SIZE(length))
+            return create_new_entry_from_memory(mapdata, key, src, length, JNI_FALSE);
+        e = allocEntry(mapdata, actual_compressed_length);
+        if (!e)
+            return NULL;  // will throw OOM
+        memcpy(e->data, tmp_dst, actual_compressed_length);
+        e->compressedSize = actual_compressed_length;
+        ++mapdata->codec->compressedEntries;
+    } else {
+        e = allocEntry(mapdata, length);
+        if (!e)
+            return NULL;  // will throw OOM
+        memcpy(e->data, src, length);
+        e->compressedSize = 0;
+    }
+    e->uncompressedSize = length;
+    e->nextInCommittedView = NULL;
+    e->key = key;
+    return e;
+}
+
+static struct dataEntry *create_new_entry(JNIEnv *env, struct map * const mapdata, jlong key, jbyteArray data, jint offset, jint length, jboolean doCompress) {
+    // int uncompressed_length = (*env)->GetArrayLength(env, data);
+    struct dataEntry *e;
+    if (doCompress) {
 #ifndef USE_CRITICAL_FOR_STORE
         void *tmp_src = malloc(length);
         if (!tmp_src) {
-            free(tmp_dst);
             return NULL;  // will throw OOM
         }
         (*env)->GetByteArrayRegion(env, data, offset, length, tmp_src);
-        int actual_compressed_length = LZ4_compress(tmp_src, tmp_dst->data, uncompressed_length);
+        e = create_new_entry_from_memory(mapdata, key, tmp_src, length, JNI_TRUE);
         free(tmp_src);
 #else
         // get the original array location, to avoid an extra copy
         jboolean isCopy = 0;
-        void *src = (*env)->GetPrimitiveArrayCritical(env, data, &isCopy);
+        char *src = (*env)->GetPrimitiveArrayCritical(env, data, &isCopy);
         if (!src) {
-            free(tmp_dst);
             throwOutOfMemory(env);
             return NULL;
         }
-        int actual_compressed_length = LZ4_compress(src+offset, tmp_dst->data, length);
+        e = create_new_entry_from_memory(mapdata, key, src + offset, length, JNI_TRUE);
         (*env)->ReleasePrimitiveArrayCritical(env, data, src, JNI_ABORT);  // abort, as we did not change anything
 #endif
-        // TODO: if the uncompressed size needs the same space (or less) than the compressed, use the uncompressed form instead!
-        int actual_rounded_length = ROUND_UP_SIZE(actual_compressed_length);
-        // if we need less than initially allocated, realloc to free the space.
-        if (actual_rounded_length < max_compressed_length) {
-            e = realloc(tmp_dst, sizeof(struct dataEntry) + actual_rounded_length);
-            if (!e)
-                e = tmp_dst;
-        } else {
-            e = tmp_dst;
-        }
-        e->compressedSize = actual_compressed_length;
-    } else {
-        e = (struct dataEntry *)malloc(sizeof(struct dataEntry) + ROUND_UP_SIZE(length));
-        if (!e)
-            return NULL;  // will throw OOM
-        e->compressedSize = 0;
-        (*env)->GetByteArrayRegion(env, data, offset, length, (jbyte *)e->data);
+        return e;
     }
+    e = allocEntry(mapdata, length);
+    if (!e)
+        return NULL;  // will throw OOM
+    e->compressedSize = 0;
+    (*env)->GetByteArrayRegion(env, data, offset, length, (jbyte *)e->data);
     e->uncompressedSize = length;
     e->nextInCommittedView = NULL;
     e->key = key;
     return e;
 }
 
-static struct dataEntry *create_new_index_entry(JNIEnv *env, jlong key, jint hash, jbyteArray data, jint offset, jint length) {
+static struct dataEntry *create_new_index_entry(JNIEnv *env, struct map * const mapdata, jlong key, jint hash, jbyteArray data, jint offset, jint length) {
     // int uncompressed_length = (*env)->GetArrayLength(env, data);
-    struct dataEntry *e = (struct dataEntry *)malloc(sizeof(struct dataEntry) + ROUND_UP_SIZE(length));
+    struct dataEntry *e = allocEntry(mapdata, length);
     if (!e)
         return NULL;  // will throw OOM
 
@@ -675,11 +1526,20 @@ static struct dataEntry *create_new_index_entry(JNIEnv *env, jlong key, jint has
 }
 
 // can work on data and index structures! (index only for rollback where the key is known)
+// For open addressing, the caller must have reserved space by reserveEntry().
 static struct dataEntry * setPutSub(struct map * const mapdata, struct dataEntry * const newEntry) {
-    int slot = computeSlot(mapdata, newEntry);
-    struct dataEntry *e = mapdata->keyHash[slot];
+    if (mapdata->probe || mapdata->tree) {
+        newEntry->nextSameHash = NULL;
+        struct dataEntry *e = mapdata->probe ? probeSet(mapdata->probe, newEntry->key, newEntry) : treeSet(mapdata->tree, newEntry->key, newEntry);
+        if (!e)
+            ++mapdata->count;
+        return e;
+    }
+    maintainHashTable(mapdata, JNI_FALSE);
+    struct dataEntry **slot = computeSlot(mapdata, newEntry);
+    struct dataEntry *e = *slot;
     newEntry->nextSameHash = e;  // insert it at the start
-    mapdata->keyHash[slot] = newEntry;
+    *slot = newEntry;
     struct dataEntry *prev = newEntry;
 
     jlong key = newEntry->key;
@@ -691,6 +1551,10 @@ static struct dataEntry * setPutSub(struct map * const mapdata, struct dataEntry
 #ifdef DEBUG
             fprintf(stderr, "Replacing an entry of key %ld in slot %d\n", (long)key, hash);
 #endif
+            if (mapdata->sorted) {
+                sortedRemove(mapdata->sorted, e);
+                sortedInsert(mapdata->sorted, newEntry);
+            }
             return e;
         }
         prev = e;
@@ -700,16 +1564,26 @@ static struct dataEntry * setPutSub(struct map * const mapdata, struct dataEntry
 #ifdef DEBUG
     fprintf(stderr, "Inserting an entry of key %ld in slot %d\n", (long)key, hash);
 #endif
+    if (mapdata->sorted)
+        sortedInsert(mapdata->sorted, newEntry);
     ++mapdata->count;
     return NULL;
 }
 
 // COMMIT subroutine, only called from commitToView
 static struct dataEntry * setPutSubShadow(struct map * const mapdata, struct dataEntry * const newEntry) {
-    int slot = computeSlot(mapdata, newEntry);
-    struct dataEntry *e = mapdata->keyHash[slot];
+    if (mapdata->probe || mapdata->tree) {
+        newEntry->nextInCommittedView = NULL;
+        struct dataEntry *e = mapdata->probe ? probeSet(mapdata->probe, newEntry->key, newEntry) : treeSet(mapdata->tree, newEntry->key, newEntry);
+        if (!e)
+            ++mapdata->count;
+        return e;
+    }
+    maintainHashTable(mapdata, JNI_TRUE);
+    struct dataEntry **slot = computeSlot(mapdata, newEntry);
+    struct dataEntry *e = *slot;
     newEntry->nextInCommittedView = e;  // insert it at the start
-    mapdata->keyHash[slot] = newEntry;
+    *slot = newEntry;
     struct dataEntry *prev = newEntry;
     jlong key = newEntry->key;
 
@@ -721,6 +1595,10 @@ static struct dataEntry * setPutSubShadow(struct map * const mapdata, struct dat
 #ifdef DEBUG
             fprintf(stderr, "Replacing a shadow entry of key %ld in slot %d\n", (long)key, hash);
 #endif
+            if (mapdata->sorted) {
+                sortedRemove(mapdata->sorted, e);
+                sortedInsert(mapdata->sorted, newEntry);
+            }
             return e;
         }
         prev = e;
@@ -730,6 +1608,8 @@ static struct dataEntry * setPutSubShadow(struct map * const mapdata, struct dat
 #ifdef DEBUG
     fprintf(stderr, "Inserting a shadow entry of key %ld in slot %d\n", (long)key, hash);
 #endif
+    if (mapdata->sorted)
+        sortedInsert(mapdata->sorted, newEntry);
     ++mapdata->count;
     return NULL;
 }
@@ -743,11 +1623,19 @@ static struct dataEntry * setPutSubShadow(struct map * const mapdata, struct dat
 JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSet
     (JNIEnv *env, jobject me, jlong cMap, jlong ctx, jlong key, jbyteArray data, jint offset, jint length, jboolean doCompress) {
     struct map *mapdata = (struct map *) cMap;
-    struct dataEntry *newEntry = create_new_entry(env, key, data, offset, length, doCompress);
+    if (reserveEntry(mapdata)) {
+        throwOutOfMemory(env);
+        return JNI_FALSE;
+    }
+    struct dataEntry *newEntry = create_new_entry(env, mapdata, key, data, offset, length, doCompress);
     if (!newEntry) {
         throwOutOfMemory(env);
         return JNI_FALSE;
     }
+    if (mapdata->indexRules && maintainIndexes(env, mapdata, (struct tx_log_hdr *)ctx, key, find_entry(mapdata, key), newEntry)) {
+        freeEntry(mapdata, newEntry);
+        return JNI_FALSE;
+    }
 
     struct dataEntry *previousEntry = setPutSub(mapdata, newEntry);
     record_change(env, (struct tx_log_hdr *)ctx, mapdata, previousEntry, newEntry);  // may throw an error
@@ -762,24 +1650,133 @@ JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSe
 JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natPut
     (JNIEnv *env, jobject me, jlong cMap, jlong ctx, jlong key, jbyteArray data, jint offset, jint length, jboolean doCompress) {
     struct map *mapdata = (struct map *) cMap;
-    struct dataEntry *newEntry = create_new_entry(env, key, data, offset, length, doCompress);
+    if (reserveEntry(mapdata)) {
+        throwOutOfMemory(env);
+        return NULL;
+    }
+    struct dataEntry *newEntry = create_new_entry(env, mapdata, key, data, offset, length, doCompress);
     if (!newEntry) {
         throwOutOfMemory(env);
         return NULL;
     }
+    if (mapdata->indexRules && maintainIndexes(env, mapdata, (struct tx_log_hdr *)ctx, key, find_entry(mapdata, key), newEntry)) {
+        freeEntry(mapdata, newEntry);
+        return NULL;
+    }
 
     struct dataEntry *previousEntry = setPutSub(mapdata, newEntry);
-    jbyteArray result = toJavaByteArray(env, previousEntry);
+    jbyteArray result = toJavaByteArray(env, mapdata, previousEntry);
     record_change(env, (struct tx_log_hdr *)ctx, mapdata, previousEntry, newEntry);  // may throw an error
     return result;
 }
 
 
-static int computeChainLength(struct dataEntry *e) {
+// record layout of batch updates: key (8 bytes), length (4 bytes), flags (4 bytes), followed by length bytes of data (without padding)
+#define BATCH_RECORD_HEADER_SIZE    16
+#define BATCH_FLAG_COMPRESS         0x01    // compress the data, independent of its size
+#define BATCH_FLAG_DELETE           0x02    // remove the entry for key. length must be 0
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natSetBatch
+ * Signature: (JJLjava/nio/ByteBuffer;III)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSetBatch
+    (JNIEnv *env, jclass me, jlong cMap, jlong ctx, jobject src, jint position, jint limit, jint maxUncompressedSize) {
+    struct map *mapdata = (struct map *) cMap;
+    const char *buffer = (*env)->GetDirectBufferAddress(env, src);
+    if (!buffer) {
+        throwAny(env, "source must be a direct ByteBuffer");
+        return 0;
+    }
+    int replaced = 0;
+    while (position < limit) {
+        if (limit - position < BATCH_RECORD_HEADER_SIZE) {
+            throwAny(env, "Truncated batch record header");
+            break;
+        }
+        jlong key;
+        jint length, flags;
+        memcpy(&key, buffer + position, sizeof(jlong));
+        memcpy(&length, buffer + position + 8, sizeof(jint));
+        memcpy(&flags, buffer + position + 12, sizeof(jint));
+        key = TO_BIG_ENDIAN_64(key);
+        length = TO_BIG_ENDIAN_32(length);
+        flags = TO_BIG_ENDIAN_32(flags);
+        position += BATCH_RECORD_HEADER_SIZE;
+        if (length < 0 || length > limit - position) {
+            throwAny(env, "Bad batch record length");
+            break;
+        }
+        struct dataEntry *previousEntry;
+        if (flags & BATCH_FLAG_DELETE) {
+            if (maintainIndexesForRemove(env, mapdata, (struct tx_log_hdr *)ctx, key))
+                break;      // error has been thrown
+            previousEntry = unlinkEntry(mapdata, key, computeHash(key));
+            if (previousEntry && record_change(env, (struct tx_log_hdr *)ctx, mapdata, previousEntry, NULL))
+                break;      // error has been thrown
+        } else {
+            if (reserveEntry(mapdata)) {
+                throwOutOfMemory(env);
+                break;
+            }
+            struct dataEntry *newEntry = create_new_entry_from_memory(mapdata, key, buffer + position, length,
+              length > 0 && ((flags & BATCH_FLAG_COMPRESS) || length > maxUncompressedSize));
+            if (!newEntry) {
+                throwOutOfMemory(env);
+                break;
+            }
+            if (mapdata->indexRules && maintainIndexes(env, mapdata, (struct tx_log_hdr *)ctx, key, find_entry(mapdata, key), newEntry)) {
+                freeEntry(mapdata, newEntry);
+                break;      // error has been thrown
+            }
+            previousEntry = setPutSub(mapdata, newEntry);
+            if (record_change(env, (struct tx_log_hdr *)ctx, mapdata, previousEntry, newEntry))
+                break;      // error has been thrown
+        }
+        if (previousEntry)
+            ++replaced;
+        position += length;
+    }
+    return replaced;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natDeleteBatch
+ * Signature: (JJLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natDeleteBatch
+    (JNIEnv *env, jclass me, jlong cMap, jlong ctx, jobject src, jint position, jint limit) {
+    struct map *mapdata = (struct map *) cMap;
+    const char *buffer = (*env)->GetDirectBufferAddress(env, src);
+    if (!buffer) {
+        throwAny(env, "source must be a direct ByteBuffer");
+        return 0;
+    }
+    int deleted = 0;
+    for (; position + (int)sizeof(jlong) <= limit; position += sizeof(jlong)) {
+        jlong key;
+        memcpy(&key, buffer + position, sizeof(jlong));
+        key = TO_BIG_ENDIAN_64(key);
+        if (maintainIndexesForRemove(env, mapdata, (struct tx_log_hdr *)ctx, key))
+            break;      // error has been thrown
+        struct dataEntry *e = unlinkEntry(mapdata, key, computeHash(key));
+        if (e) {
+            ++deleted;
+            if (record_change(env, (struct tx_log_hdr *)ctx, mapdata, e, NULL))
+                break;      // error has been thrown
+        }
+    }
+    return deleted;
+}
+
+
+static int computeChainLength(const struct map *mapdata, struct dataEntry *e) {
     register int len = 0;
     while (e) {
         ++len;
-        e = e->nextSameHash;
+        e = mapdata->isView ? e->nextInCommittedView : e->nextSameHash;
     }
     return len;
 }
@@ -799,9 +1796,31 @@ JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natGetHistogram
         throwOutOfMemory(env);
         return -1;
     }
+    if (mapdata->compact) {
+        // every slot holds at most one entry
+        if (numHistogramEntries > 0)
+            ctr[0] = mapdata->compact->capacity - mapdata->compact->count;
+        if (numHistogramEntries > 1)
+            ctr[1] = mapdata->compact->count;
+        maxLen = mapdata->compact->count ? 1 : 0;
+    }
+    if (mapdata->postings) {
+        // chain lengths in nodes (distinct values) per bucket
+        for (int i = 0; i < postingScanSlots(mapdata->postings); ++i) {
+            int len = 0;
+            for (const struct postingNode *n = postingScanSlot(mapdata->postings, i); n; n = n->next)
+                ++len;
+            if (len > maxLen)
+                maxLen = len;
+            if (len < numHistogramEntries)
+                ++ctr[len];
+        }
+    }
     int i;
-    for (i = 0; i < mapdata->hashTableSize; ++i) {
-        int len = computeChainLength(mapdata->keyHash[i]);
+    for (i = 0; i < numberOfScanSlots(mapdata); ++i) {
+        if (mapdata->keyHash && i >= mapdata->hashTableSize && i - mapdata->hashTableSize < mapdata->rehashPosition)
+            continue;   // slot of the old bucket array which has been migrated already
+        int len = computeChainLength(mapdata, scanSlot(mapdata, i));
         if (len > maxLen)
             maxLen = len;
         if (len < numHistogramEntries)
@@ -814,69 +1833,92 @@ JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natGetHistogram
 
 
 /*
- * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
- * Method:    natGetIntoPreallocated
- * Signature: (JJ[BI)I
+ * Class:     de_jpaw_offHeap_AbstractOffHeapMap
+ * Method:    natGetMemoryStats
+ * Signature: (J[J)V
  */
-JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetIntoPreallocated
-  (JNIEnv *env, jobject me, jlong cMap, jlong key, jbyteArray target, jint offset) {
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natGetMemoryStats
+    (JNIEnv *env, jclass me, jlong cMap, jlongArray stats) {
     struct map *mapdata = (struct map *) cMap;
-    struct dataEntry *e = find_entry(mapdata, key);
-    if (!e)
-        return -1;  // key does not exist
-    int targetSize = (*env)->GetArrayLength(env, target);
-
-    if (offset >= targetSize)
-        return 0;   // offset too big, no data will be copied
-    if (e->compressedSize) {
-        throwAny(env, "Copying from compressed entries not yet implemented");
-        return -2;  // not yet implemented
-    }
-    int length = (offset + e->uncompressedSize > targetSize) ? targetSize - offset : e->uncompressedSize;
-    (*env)->SetByteArrayRegion(env, target, offset, length, (jbyte *)e->data);
-    return length;
+    jlong values[ARENA_NUM_STATS];
+    int n = (*env)->GetArrayLength(env, stats);
+    if (n > ARENA_NUM_STATS)
+        n = ARENA_NUM_STATS;
+    arenaGetStats(mapdata->arena, values, n);
+    (*env)->SetLongArrayRegion(env, stats, 0, n, values);
 }
 
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
- * Method:    natGetRegion
- * Signature: (JJII)[B
+ * Method:    natGetCacheStats
+ * Signature: (J[J)V
  */
-JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetRegion
-  (JNIEnv *env, jobject me, jlong cMap, jlong key, jint offset, jint length) {
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetCacheStats
+    (JNIEnv *env, jclass me, jlong cMap, jlongArray stats) {
     struct map *mapdata = (struct map *) cMap;
-    struct dataEntry *e = find_entry(mapdata, key);
-    if (!e)
-        return (jbyteArray)0;
-    if (e->compressedSize) {
-        throwAny(env, "Copying from compressed entries not yet implemented");
-        return (jbyteArray)0;  // not yet implemented
-    }
-    int len = offset >= e->uncompressedSize ? 0 : offset + length <= e->uncompressedSize ? length : e->uncompressedSize - offset;
-    jbyteArray result = (*env)->NewByteArray(env, len);
-    if (len)
-        (*env)->SetByteArrayRegion(env, result, 0, len, (jbyte *)e->data + offset);
-    return result;
+    jlong values[CACHE_NUM_STATS];
+    int n = (*env)->GetArrayLength(env, stats);
+    if (n > CACHE_NUM_STATS)
+        n = CACHE_NUM_STATS;
+    if (mapdata->cache)
+        cacheGetStats(mapdata->cache, values, n);
+    else
+        memset(values, 0, sizeof(values));
+    (*env)->SetLongArrayRegion(env, stats, 0, n, values);
 }
 
 /*
- * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
- * Method:    natGetField
- * Signature: (JJIBB)[B
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natSetCacheSize
+ * Signature: (JJ)V
  */
-JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetField
-  (JNIEnv *env, jobject me, jlong cMap, jlong key, jint fieldNo, jbyte delimiter, jbyte nullIndicator) {
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSetCacheSize
+    (JNIEnv *env, jclass me, jlong cMap, jlong capacity) {
     struct map *mapdata = (struct map *) cMap;
-    struct dataEntry *e = find_entry(mapdata, key);
-    if (!e)
-        return (jbyteArray)0;
-    if (e->compressedSize) {
-        throwAny(env, "Copying from compressed entries not yet implemented");
-        return (jbyteArray)0;  // not yet implemented
+    struct valueCache *cache = NULL;
+    if (capacity > 0) {
+        cache = cacheCreate(capacity);
+        if (!cache) {
+            throwOutOfMemory(env);
+            return;
+        }
+    }
+    if (mapdata->cache)
+        cacheDestroy(mapdata->cache);
+    mapdata->cache = cache;
+    if (mapdata->committedView)
+        mapdata->committedView->cache = cache;
+}
+
+
+// partial reads of compressed entries. LZ4 decodes sequentially, so a prefix can be decompressed without touching the rest of the entry.
+// The output goes into a buffer per thread, because views may be read by other threads than the one owning the arena.
+// There are two buffers, such that the old and the new value of a row can be held at the same time (see maintainIndexes).
+#define FIELD_SCAN_INITIAL_SIZE     256         // first prefix decompressed when searching a field. Doubled until the field has been found
+#define NUM_THREAD_SCRATCH          2
+
+static __thread char *threadScratch[NUM_THREAD_SCRATCH];
+static __thread int threadScratchSize[NUM_THREAD_SCRATCH];
+
+static char *getThreadScratch(int which, int size) {
+    if (size > threadScratchSize[which]) {
+        char *buffer = malloc(size);
+        if (!buffer)
+            return NULL;
+        if (threadScratch[which])
+            free(threadScratch[which]);
+        threadScratch[which] = buffer;
+        threadScratchSize[which] = size;
     }
-    char *ptr = e->data;
-    char *startOfField = e->data;
-    int bytesLeft = e->uncompressedSize;
+    return threadScratch[which];
+}
+
+// locates field fieldNo (see natGetField) within the first size bytes of the data. complete tells if these are all bytes of the entry.
+// Returns the length of the field and sets *start to its offset, or -1 for a null field, or -2 if more data is required.
+static int locateField(const char *data, int size, jboolean complete, int fieldNo, char delimiter, char nullIndicator, int *start) {
+    const char *ptr = data;
+    const char *startOfField = data;
+    int bytesLeft = size;
     // search for start of field, until either bytesLeft are exhausted, or
     while (bytesLeft && fieldNo) {
         if (*ptr == delimiter) {
@@ -884,7 +1926,7 @@ JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
             startOfField = ++ptr;
         } else if (*ptr == nullIndicator) {
 //            if (fieldNo == 1)
-//                return (jbyteArray)0;       // found it, it was 0!
+//                return -1;       // found it, it was 0!
             --fieldNo;
             startOfField = ++ptr;
         } else {
@@ -894,285 +1936,3234 @@ JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
         --bytesLeft;
     }
     if (!bytesLeft) {
+        if (!complete)
+            return -2;
         if (fieldNo) {
             // no more bytes, we field is out of bounds. Return null
-            return (jbyteArray)0;
+            return -1;
         }
         // here: fall through! We are the the field we are looking for, and at the same time at end of message
     } else {
         // found the field, and there are bytes left!
         // scan up to the next delimiter, or next null token, or end of record
         if (*ptr != delimiter && *ptr == nullIndicator) {
-            return (jbyteArray)0;       // explicit NULL field
+            return -1;       // explicit NULL field
         }
         while (bytesLeft && *ptr != delimiter && *ptr != nullIndicator) {
             ++ptr;
             --bytesLeft;
         }
+        if (!bytesLeft && !complete)
+            return -2;      // the field may continue
     }
-    int len = ptr - startOfField;
-    // the requested field was the last one in the object. We return a new byte array
-    jbyteArray result = (*env)->NewByteArray(env, len);
-    if (len)
-        (*env)->SetByteArrayRegion(env, result, 0, len, (jbyte *) startOfField);
-    return result;
+    *start = startOfField - data;
+    return ptr - startOfField;
 }
 
+#define FIELD_INCOMPLETE    -2          // as returned by locateField: the data ends within the field, but more data exists
+#define FIELD_NO_MEMORY     -3
+#define FIELD_CORRUPTED     -4
 
-
-struct filedumpHeader {
-    int magicNumber;
-    int numberOfRecords;
-    long totalSize;
-    jlong lastCommittedRef;
-};
-
-
-// buffer size calculation:
-// we want to achieve the magnitide of the advertised 500 MB / s write speed.
-// SSD write latency is about 3 ms (333 ops / second), or a buffer size of 1.5 MB.
-// let's allocate about 2 megs then.  This just happens to be a hugepage on x86_64.
-// all entries in the file will be 8-byte aligned, padded by 0xee
-#define FILEDUMP_BUFFER_SIZE    (2 * 1024 * 1024)
-
-// upon input, [0, FILEDUMP_BUFFER_SIZE] bytes are occupied, i.e. the first iteration possibly only writes 0 bytes
-static int transferWrite(const int fd, char *buffer, int oldOffset, void const *src, int len) {
-    while (len > 0) {
-        if (oldOffset + len < FILEDUMP_BUFFER_SIZE) {
-            // copy all and, still space left
-            memcpy(buffer + oldOffset, src, len);
-            // possibly align by multipes of 8
-            if (len & 7) {
-                char *p = buffer+oldOffset+len;
-                do {
-                    *p++ = (char)0xee;
-                } while (++len & 7);
-            }
-            return oldOffset + len;
-        }
-        // copy data and we reach end of buffer with that. Flush the buffer and loop
-        int portion = FILEDUMP_BUFFER_SIZE - oldOffset;
-        memcpy(buffer + oldOffset, src, portion);
-        write(fd, buffer, FILEDUMP_BUFFER_SIZE);  // TODO error check later
-        src += portion;
-        oldOffset = 0;
-        len -= portion;
+// locates field fieldNo of an entry, decompressing a growing prefix of compressed entries (into scratch buffer which) until it contains
+// the end of the field. Returns the length of the field and sets *field, or -1 for a null field, or FIELD_NO_MEMORY / FIELD_CORRUPTED.
+static int extractField(const struct map *mapdata, const struct dataEntry *e, int fieldNo, char delimiter, char nullIndicator,
+  int which, const char **field) {
+    int start = 0;
+    int len;
+    if (!e->compressedSize) {
+        len = locateField(e->data, e->uncompressedSize, JNI_TRUE, fieldNo, delimiter, nullIndicator, &start);
+        *field = e->data + start;
+        return len;
     }
-    return oldOffset;
+    int prefixSize = FIELD_SCAN_INITIAL_SIZE;
+    do {
+        if (prefixSize > e->uncompressedSize)
+            prefixSize = e->uncompressedSize;
+        char *buffer = getThreadScratch(which, prefixSize);
+        if (!buffer)
+            return FIELD_NO_MEMORY;
+        if (decompressEntry(mapdata, e, buffer, prefixSize))
+            return FIELD_CORRUPTED;
+        len = locateField(buffer, prefixSize, prefixSize >= e->uncompressedSize, fieldNo, delimiter, nullIndicator, &start);
+        *field = buffer + start;
+        prefixSize *= 2;
+    } while (len == -2);
+    return len;
 }
 
-static char *allocateBuffers(JNIEnv *env, char **buffer, jbyteArray filename) {
-
-#ifdef _ISOC11_SOURCE
-    *buffer = aligned_alloc(4 * 1024, FILEDUMP_BUFFER_SIZE);  // needs _ISOC11_SOURCE
-#else
-    *buffer = malloc(FILEDUMP_BUFFER_SIZE);
-#endif
-    if (!*buffer) {
-        throwOutOfMemory(env);
-        return NULL;
-    }
-    int filenameLen = (*env)->GetArrayLength(env, filename);
-    char *filenameBuffer = malloc(filenameLen+1);
-    if (!filenameBuffer) {
-        free(*buffer);
+static void throwFieldError(JNIEnv *env, int rc) {
+    if (rc == FIELD_NO_MEMORY)
         throwOutOfMemory(env);
-        return NULL;
-    }
-    (*env)->GetByteArrayRegion(env, filename, 0, filenameLen, (jbyte *)filenameBuffer);
-    filenameBuffer[filenameLen] = 0;
-    return filenameBuffer;
+    else
+        throwAny(env, "Corrupted compressed entry");
 }
 
-#define MAGIC_DB_CONSTANT   0x283462FE
-#define ENTRY_HDR_SIZE      (2 * sizeof(int) + sizeof(jlong))
-
-
 /*
- * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
- * Method:    natWriteToFile
- * Signature: (J[BZ)V
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetIntoPreallocated
+ * Signature: (JJ[BI)I
  */
-JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natWriteToFile
-  (JNIEnv *env, jobject me, jlong cMap, jbyteArray filename, jboolean fromCommittedView) {
-    struct filedumpHeader hdr;
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetIntoPreallocated
+  (JNIEnv *env, jobject me, jlong cMap, jlong key, jbyteArray target, jint offset) {
     struct map *mapdata = (struct map *) cMap;
-    char *buffer;
-
-    char *filenameBuffer = allocateBuffers(env, &buffer, filename);
-    if (!filenameBuffer)
-        return;  // error
-    int fd = open(filenameBuffer, O_CREAT | O_WRONLY | O_TRUNC, 0644);
-    free(filenameBuffer);
-    if (fd < 0) {
-        free(buffer);
-        throwAny(env, "Cannot open file");
-        return;
-    }
-
-    if (!mapdata->committedView)
-        fromCommittedView = JNI_FALSE;
-    if (fromCommittedView)
-        mapdata = mapdata->committedView;
-
-    // transfer header
-    hdr.magicNumber = MAGIC_DB_CONSTANT;
-    hdr.numberOfRecords = mapdata->count;
-    hdr.lastCommittedRef = mapdata->lastCommittedRef;
-    hdr.totalSize = 0L;  // findSize(mapdata)
+    struct dataEntry *e = find_entry(mapdata, key);
+    if (!e)
+        return -1;  // key does not exist
+    int targetSize = (*env)->GetArrayLength(env, target);
 
-    int bufferOffset = transferWrite(fd, buffer, 0, &hdr, sizeof(hdr));
-    // write the entries
-    int i;
-    for (i = 0; i < mapdata->hashTableSize; ++i) {
-        struct dataEntry *e;
-        for (e = mapdata->keyHash[i]; e; e = (fromCommittedView ? e->nextInCommittedView : e->nextSameHash)) {
-            int rawSize = e->compressedSize ? e->compressedSize : e->uncompressedSize;
-            int finalSize = 2 * sizeof(int) + sizeof(jlong) + rawSize;
-            bufferOffset = transferWrite(fd, buffer, bufferOffset, &(e->uncompressedSize), finalSize);
+    if (offset >= targetSize)
+        return 0;   // offset too big, no data will be copied
+    int length = (offset + e->uncompressedSize > targetSize) ? targetSize - offset : e->uncompressedSize;
+    if (e->compressedSize) {
+        // decompress straight into the target array, up to the space available
+        jboolean isCopy = 0;
+        char *dst = (*env)->GetPrimitiveArrayCritical(env, target, &isCopy);
+        if (!dst) {
+            throwOutOfMemory(env);
+            return -1;
+        }
+        int rc = decompressEntry(mapdata, e, dst + offset, length);
+        (*env)->ReleasePrimitiveArrayCritical(env, target, dst, 0);
+        if (rc) {
+            throwAny(env, "Corrupted compressed entry");
+            return -1;
         }
+        return length;
     }
+    (*env)->SetByteArrayRegion(env, target, offset, length, (jbyte *)e->data);
+    return length;
+}
 
-    if (bufferOffset) {
-        write(fd, buffer, bufferOffset);
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetRegion
+ * Signature: (JJII)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetRegion
+  (JNIEnv *env, jobject me, jlong cMap, jlong key, jint offset, jint length) {
+    struct map *mapdata = (struct map *) cMap;
+    struct dataEntry *e = find_entry(mapdata, key);
+    if (!e)
+        return (jbyteArray)0;
+    int len = offset >= e->uncompressedSize ? 0 : offset + length <= e->uncompressedSize ? length : e->uncompressedSize - offset;
+    const char *src = e->data;
+    if (len && e->compressedSize) {
+        // decompress up to the end of the region only
+        char *buffer = getThreadScratch(0, offset + len);
+        if (!buffer) {
+            throwOutOfMemory(env);
+            return (jbyteArray)0;
+        }
+        if (decompressEntry(mapdata, e, buffer, offset + len)) {
+            throwAny(env, "Corrupted compressed entry");
+            return (jbyteArray)0;
+        }
+        src = buffer;
     }
-    close(fd);
-    free(buffer);
+    jbyteArray result = (*env)->NewByteArray(env, len);
+    if (len)
+        (*env)->SetByteArrayRegion(env, result, 0, len, (const jbyte *)src + offset);
+    return result;
 }
 
 /*
- * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
- * Method:    natReadFromFile
- * Signature: (J[B)V
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetField
+ * Signature: (JJIBB)[B
  */
-JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natReadFromFile
-  (JNIEnv *env, jobject me, jlong cMap, jbyteArray filename) {
-    struct filedumpHeader hdr;
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetField
+  (JNIEnv *env, jobject me, jlong cMap, jlong key, jint fieldNo, jbyte delimiter, jbyte nullIndicator) {
     struct map *mapdata = (struct map *) cMap;
-
-    if (mapdata->count) {
-        throwAny(env, "DB is not empty");
-        return;
+    struct dataEntry *e = find_entry(mapdata, key);
+    if (!e)
+        return (jbyteArray)0;
+    const char *field;
+    int len = extractField(mapdata, e, fieldNo, delimiter, nullIndicator, 0, &field);
+    if (len < -1) {
+        throwFieldError(env, len);
+        return (jbyteArray)0;
     }
+    if (len < 0)
+        return (jbyteArray)0;       // null field, or out of bounds
+    jbyteArray result = (*env)->NewByteArray(env, len);
+    if (len)
+        (*env)->SetByteArrayRegion(env, result, 0, len, (const jbyte *)field);
+    return result;
+}
 
-    char *buffer;
-
-    char *filenameBuffer = allocateBuffers(env, &buffer, filename);
-    if (!filenameBuffer)
-        return;  // error
-
-    // use buffered I/O for reading.
-    FILE *fp = fopen(filenameBuffer, "rb");
-    free(filenameBuffer);
-    if (!fp) {
-        throwAny(env, "Cannot open file");
-        free(buffer);
-        return;
-    }
 
-    setvbuf(fp, buffer, _IOFBF, FILEDUMP_BUFFER_SIZE);
+// batch lookups. The keys are processed in groups, with a separate pass for every dependent memory access,
+// such that the cache misses within a group overlap: first the hash slot, then the entry.
+// The keys are copied per group rather than accessed in a critical region, as decompressEntry may wait for the lock of the cache.
+#define BATCH_GROUP_SIZE        16
 
-    if (fread(&hdr, sizeof(hdr), 1, fp) != 1) {
-        throwAny(env, "Cannot read file header");
-        free(buffer);
-        fclose(fp);
-        return;
-    }
-    if (hdr.magicNumber != MAGIC_DB_CONSTANT) {
-        throwAny(env, "File is not a DB file (bad magic number)");
-        free(buffer);
-        fclose(fp);
-        return;
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetBatch
+ * Signature: (J[JIILjava/nio/ByteBuffer;II)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetBatch
+  (JNIEnv *env, jclass me, jlong cMap, jlongArray keys, jint fromIndex, jint count, jobject target, jint position, jint limit) {
+    struct map *mapdata = (struct map *) cMap;
+    char *buffer = (*env)->GetDirectBufferAddress(env, target);
+    if (!buffer) {
+        throwAny(env, "target must be a direct ByteBuffer");
+        return 0L;
     }
-
-    int i;
-    for (i = 0; i < hdr.numberOfRecords; ++i) {
-        // read the entry header: key, uncompressed & compressed size
-        struct dataEntry entryHdr;
-        if (fread(&(entryHdr.uncompressedSize), ENTRY_HDR_SIZE, 1, fp) != 1) {
-            free(buffer);
-            fclose(fp);
-            throwAny(env, "Cannot read entry header");
-            return;
+    jlong k[BATCH_GROUP_SIZE];
+    struct dataEntry *found[BATCH_GROUP_SIZE];
+    int done = 0;
+
+    while (done < count) {
+        int n = count - done < BATCH_GROUP_SIZE ? count - done : BATCH_GROUP_SIZE;
+        int j;
+        (*env)->GetLongArrayRegion(env, keys, fromIndex + done, n, k);
+        // pass 1: locate the hash slots
+        for (j = 0; j < n; ++j) {
+            if (mapdata->probe)
+                probePrefetch(mapdata->probe, k[j]);
+            else if (!mapdata->tree)
+                __builtin_prefetch(findKeyBucket(mapdata, k[j]));
         }
-        int actualSize = entryHdr.compressedSize ? entryHdr.compressedSize : entryHdr.uncompressedSize;
-        struct dataEntry *e = malloc(sizeof(struct dataEntry) + ROUND_UP_SIZE(actualSize));
-        if (!e) {
-            free(buffer);
-            fclose(fp);
-            throwOutOfMemory(env);
-            return;
+        // pass 2: load the first entry of each chain (or the matching entry for open addressing)
+        for (j = 0; j < n; ++j) {
+            found[j] = mapdata->keyHash ? *findKeyBucket(mapdata, k[j]) : find_entry(mapdata, k[j]);
+            if (found[j])
+                __builtin_prefetch(found[j]);
         }
-        e->key = entryHdr.key;
-        e->uncompressedSize = entryHdr.uncompressedSize;
-        e->compressedSize = entryHdr.compressedSize;
-
-        int hash = computeKeyHash(entryHdr.key, mapdata->hashTableSize);
-        e->nextInCommittedView = e->nextSameHash = mapdata->keyHash[hash];
-        mapdata->keyHash[hash] = e;
-        if (fread(e->data, ROUND_UP_FILESIZE(actualSize), 1, fp) != 1) {
-            free(buffer);
-            fclose(fp);
-            throwAny(env, "Cannot read entry data");
-            return;
+        // pass 3: resolve the chains and transfer the data
+        for (j = 0; j < n; ++j) {
+            struct dataEntry *e = found[j];
+            while (e && e->key != k[j])
+                e = mapdata->isView ? e->nextInCommittedView : e->nextSameHash;
+            int len = e ? e->uncompressedSize : -1;
+            int needed = sizeof(jint) + (len > 0 ? len : 0);
+            if (limit - position < needed)
+                goto bufferFull;
+            jint lenBigEndian = TO_BIG_ENDIAN_32(len);
+            memcpy(buffer + position, &lenBigEndian, sizeof(jint));
+            position += sizeof(jint);
+            if (len > 0) {
+                if (e->compressedSize) {
+                    if (decompressEntry(mapdata, e, buffer + position, len)) {
+                        throwAny(env, "Corrupted compressed entry");
+                        return 0L;
+                    }
+                } else
+                    memcpy(buffer + position, e->data, len);
+                position += len;
+            }
+            ++done;
         }
-        ++mapdata->count;
     }
-    free(buffer);
-    fclose(fp);
+bufferFull:
+    return ((jlong)done << 32) | (jlong)(unsigned)position;
+}
 
-    // mapdata->count = hdr.numberOfRecords;
-    mapdata->lastCommittedRef = hdr.lastCommittedRef;
-    struct map *viewdata = mapdata->committedView;
-    if (viewdata) {
-        // transfer everything from main view to committed view as well
-        // assumes same hashtablesize
-        memcpy(viewdata->keyHash, mapdata->keyHash, sizeof(struct dataEntry *) * mapdata->hashTableSize);
-        viewdata->count = mapdata->count;
-        viewdata->lastCommittedRef = mapdata->lastCommittedRef;
-    }
+
+
+// hash of a byte value, as java.util.Arrays.hashCode(byte []) computes it
+static int valueHash(const char *value, int length) {
+    uint32_t h = 1;
+    for (int i = 0; i < length; ++i)
+        h = 31 * h + (uint32_t)(int)(signed char)value[i];
+    return (int)h;
 }
 
+// Native scans (natScan). The specification is serialized by the Java class ScanSpec, all ints in big endian byte order:
+// delimiter, null indicator, the number of predicates, per predicate its kind, position (field number or offset), and the length and
+// bytes of both operands (a length of -1 for the second one is no upper bound), then the number of projections and the projected field numbers.
+#define SCAN_FIELD_EQUALS       0
+#define SCAN_FIELD_PREFIX       1
+#define SCAN_FIELD_RANGE        2       // field >= first operand and <= second, comparing unsigned bytes
+#define SCAN_REGION_RANGE       3       // as SCAN_FIELD_RANGE, for the bytes at offset position, as many as the first operand has
+#define SCAN_PROJECT_ROW        -1      // projection of the whole row
+#define SCAN_MAX_TERMS          64
+#define SCAN_BUFFER_FULL        -2
+#define SCAN_ALL_SLOTS          0x7fffffffffffffffLL    // end slot of an unpartitioned cursor
+
+struct scanPredicate {
+    int kind;
+    int position;
+    int lengthA;
+    int lengthB;
+    const char *a;
+    const char *b;
+};
 
+struct scanSpec {
+    char delimiter;
+    char nullIndicator;
+    int numPredicates;
+    int numProjections;
+    struct scanPredicate predicates[SCAN_MAX_TERMS];
+    int projections[SCAN_MAX_TERMS];
+};
 
-// class member functions....
+static int specInt(const char *spec, int size, int *pos, int *value) {
+    if (size - *pos < (int)sizeof(jint))
+        return 1;
+    jint v;
+    memcpy(&v, spec + *pos, sizeof(jint));
+    *value = TO_BIG_ENDIAN_32(v);
+    *pos += sizeof(jint);
+    return 0;
+}
 
-void commitToView(struct tx_log_entry *ep, jlong transactionReference) {
-    ep->affected_table->lastCommittedRef = transactionReference;
-    struct map *view = ep->affected_table->committedView;
-    if (!view) {
-        // no shadow: simple rule: discard old entry.
-        struct dataEntry *e = ep->old_entry;
-        if (e)
-            free(e);
-    } else {
-        // have secondary view. Do not discard old entry, because we either still need it, or we discard it within a recursive call
-        // we have a view, and are asked to replay the tx on it
-        if (!ep->new_entry) {
-            // was a remove => remove it on the view (which frees the old data)
-            execRemoveShadow(view, ep->old_entry);
+static int specBytes(const char *spec, int size, int *pos, int *length, const char **bytes) {
+    if (specInt(spec, size, pos, length) || *length > size - *pos)
+        return 1;
+    *bytes = spec + *pos;
+    if (*length > 0)
+        *pos += *length;
+    return 0;
+}
+
+// parses a serialized scan specification. Returns 0 if OK
+static int parseScanSpec(const char *spec, int size, struct scanSpec *s) {
+    int pos = 0;
+    int delimiter, nullIndicator;
+    if (specInt(spec, size, &pos, &delimiter) || specInt(spec, size, &pos, &nullIndicator) || specInt(spec, size, &pos, &s->numPredicates))
+        return 1;
+    if (s->numPredicates < 0 || s->numPredicates > SCAN_MAX_TERMS)
+        return 1;
+    s->delimiter = (char)delimiter;
+    s->nullIndicator = (char)nullIndicator;
+    for (int i = 0; i < s->numPredicates; ++i) {
+        struct scanPredicate *p = &s->predicates[i];
+        if (specInt(spec, size, &pos, &p->kind) || specInt(spec, size, &pos, &p->position)
+          || specBytes(spec, size, &pos, &p->lengthA, &p->a) || specBytes(spec, size, &pos, &p->lengthB, &p->b))
+            return 1;
+        if (p->kind < SCAN_FIELD_EQUALS || p->kind > SCAN_REGION_RANGE || p->position < 0 || p->lengthA < 0 || p->lengthB < -1)
+            return 1;
+        if (p->kind == SCAN_REGION_RANGE && (p->lengthA == 0 || (p->lengthB >= 0 && p->lengthB != p->lengthA)))
+            return 1;
+    }
+    if (specInt(spec, size, &pos, &s->numProjections) || s->numProjections < 0 || s->numProjections > SCAN_MAX_TERMS)
+        return 1;
+    for (int i = 0; i < s->numProjections; ++i)
+        if (specInt(spec, size, &pos, &s->projections[i]) || s->projections[i] < SCAN_PROJECT_ROW)
+            return 1;
+    return pos != size;
+}
+
+// lexicographic comparison of unsigned bytes, a value sorts before its extensions
+static inline int compareBytes(const char *a, int lenA, const char *b, int lenB) {
+    int rc = memcmp(a, b, lenA < lenB ? lenA : lenB);
+    return rc ? rc : lenA - lenB;
+}
+
+// evaluates all predicates on the first size bytes of a (decompressed) row, complete tells if these are all bytes.
+// Returns 1 if the row matches, 0 if not, or FIELD_INCOMPLETE if more bytes are required. Null fields never match
+static int scanMatches(const struct scanSpec *s, const char *row, int size, jboolean complete) {
+    for (int i = 0; i < s->numPredicates; ++i) {
+        const struct scanPredicate *p = &s->predicates[i];
+        int start = 0;
+        int len;
+        if (p->kind == SCAN_REGION_RANGE) {
+            if (p->position > size - p->lengthA)
+                return complete ? 0 : FIELD_INCOMPLETE;
+            start = p->position;
+            len = p->lengthA;
         } else {
-            // insert or replace
-            struct dataEntry * const shouldBeOld = setPutSubShadow(view, ep->new_entry);
-            if (shouldBeOld != ep->old_entry)
-                fprintf(stderr, "REDO PROBLEM: expected to get %16p, but got %16p for key %ld\n", ep->old_entry, shouldBeOld, ep->new_entry->key);
-            // if new_entry was not null, then free it (it is no longer required)
-            if (ep->old_entry)
-                free(ep->old_entry);
+            len = locateField(row, size, complete, p->position, s->delimiter, s->nullIndicator, &start);
+            if (len < 0)
+                return len == FIELD_INCOMPLETE ? FIELD_INCOMPLETE : 0;
+        }
+        const char *value = row + start;
+        switch (p->kind) {
+        case SCAN_FIELD_EQUALS:
+            if (len != p->lengthA || memcmp(value, p->a, len))
+                return 0;
+            break;
+        case SCAN_FIELD_PREFIX:
+            if (len < p->lengthA || memcmp(value, p->a, p->lengthA))
+                return 0;
+            break;
+        default:
+            if (compareBytes(value, len, p->a, p->lengthA) < 0 || (p->lengthB >= 0 && compareBytes(value, len, p->b, p->lengthB) > 0))
+                return 0;
         }
-        view->lastCommittedRef = transactionReference;
     }
+    return 1;
 }
 
-void print(struct tx_log_entry *ep, int i) {
-    jlong key = ep->new_entry ? ep->new_entry->key : ep->old_entry->key;
-    fprintf(stderr, "redo log entry %5d is for key %16ld: old=%16p, new=%16p\n", i, key, ep->old_entry, ep->new_entry);
+// appends the key and the projected fields of a matching row. Returns the new position, or SCAN_BUFFER_FULL if the record does not fit
+static int scanProject(const struct scanSpec *s, jlong key, const char *row, int size, char *buffer, int position, int limit) {
+    if (limit - position < (int)sizeof(jlong))
+        return SCAN_BUFFER_FULL;
+    jlong keyBigEndian = TO_BIG_ENDIAN_64(key);
+    memcpy(buffer + position, &keyBigEndian, sizeof(jlong));
+    position += sizeof(jlong);
+    for (int i = 0; i < s->numProjections; ++i) {
+        int start = 0;
+        int len = s->projections[i] == SCAN_PROJECT_ROW ? size
+          : locateField(row, size, JNI_TRUE, s->projections[i], s->delimiter, s->nullIndicator, &start);
+        if (limit - position < (int)sizeof(jint) + (len > 0 ? len : 0))
+            return SCAN_BUFFER_FULL;
+        jint lenBigEndian = TO_BIG_ENDIAN_32(len);
+        memcpy(buffer + position, &lenBigEndian, sizeof(jint));
+        position += sizeof(jint);
+        if (len > 0) {
+            memcpy(buffer + position, row + start, len);
+            position += len;
+        }
+    }
+    return position;
+}
+
+// scans a single entry: appends it to the buffer if it matches. Returns the new position, or SCAN_BUFFER_FULL, FIELD_NO_MEMORY or FIELD_CORRUPTED
+static int scanEntry(const struct map *mapdata, const struct scanSpec *s, const struct dataEntry *e, char *buffer, int position, int limit) {
+    const char *row = e->data;
+    // full iterations (without predicates) of keys only do not need the row, and compressed rows are decompressed straight into the target
+    if (!s->numPredicates && !s->numProjections)
+        return scanProject(s, e->key, row, e->uncompressedSize, buffer, position, limit);
+    if (!s->numPredicates && s->numProjections == 1 && s->projections[0] == SCAN_PROJECT_ROW && e->compressedSize) {
+        int len = e->uncompressedSize;
+        if (limit - position < (int)(sizeof(jlong) + sizeof(jint)) + len)
+            return SCAN_BUFFER_FULL;
+        if (decompressEntry(mapdata, e, buffer + position + sizeof(jlong) + sizeof(jint), len))
+            return FIELD_CORRUPTED;
+        jlong keyBigEndian = TO_BIG_ENDIAN_64(e->key);
+        jint lenBigEndian = TO_BIG_ENDIAN_32(len);
+        memcpy(buffer + position, &keyBigEndian, sizeof(jlong));
+        memcpy(buffer + position + sizeof(jlong), &lenBigEndian, sizeof(jint));
+        return position + sizeof(jlong) + sizeof(jint) + len;
+    }
+    if (e->compressedSize) {
+        char *scratch = getThreadScratch(0, e->uncompressedSize);
+        if (!scratch)
+            return FIELD_NO_MEMORY;
+        if (decompressEntry(mapdata, e, scratch, e->uncompressedSize))
+            return FIELD_CORRUPTED;
+        row = scratch;
+    }
+    if (!scanMatches(s, row, e->uncompressedSize, JNI_TRUE))
+        return position;
+    return scanProject(s, e->key, row, e->uncompressedSize, buffer, position, limit);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natScan
+ * Signature: (JZ[B[JLjava/nio/ByteBuffer;III)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natScan
+  (JNIEnv *env, jclass me, jlong cMap, jboolean isView, jbyteArray specArray, jlongArray cursorArray, jobject target, jint position, jint limit,
+  jint maxRows) {
+    struct map *mapdata = (struct map *) cMap;
+    char *buffer = (*env)->GetDirectBufferAddress(env, target);
+    if (!buffer) {
+        throwAny(env, "target must be a direct ByteBuffer");
+        return 0L;
+    }
+    if (mapdata->modes & IS_INDEX) {
+        throwAny(env, "Scans are supported on data maps only");
+        return 0L;
+    }
+    int specSize = (*env)->GetArrayLength(env, specArray);
+    char *specData = malloc(specSize ? specSize : 1);
+    if (!specData) {
+        throwOutOfMemory(env);
+        return 0L;
+    }
+    (*env)->GetByteArrayRegion(env, specArray, 0, specSize, (jbyte *)specData);
+    struct scanSpec spec;
+    if (parseScanSpec(specData, specSize, &spec)) {
+        free(specData);
+        throwAny(env, "Bad scan specification");
+        return 0L;
+    }
+    // the cursor is (slot, entries of the slot done, end slot) for hash chains and open addressing, and (started, next key) for ordered maps.
+    // Partitions of a parallel scan are slot ranges, also for ordered maps
+    jlong cursor[3];
+    (*env)->GetLongArrayRegion(env, cursorArray, 0, 3, cursor);
+    const int startPosition = position;
+    int rows = 0;
+    int rc = 0;
+
+    if (mapdata->tree && cursor[2] == SCAN_ALL_SLOTS) {
+        // ordered maps are scanned in key order, resuming at the first key not done yet
+        struct dataEntry *e = cursor[0] < 0 ? NULL : treeCeiling(mapdata->tree, cursor[0] ? cursor[1] : (jlong)0x8000000000000000LL);
+        for (; e; e = treeHigher(mapdata->tree, e->key)) {
+            rc = rows < maxRows ? scanEntry(mapdata, &spec, e, buffer, position, limit) : SCAN_BUFFER_FULL;
+            if (rc < 0) {
+                cursor[0] = 1;
+                cursor[1] = e->key;
+                break;
+            }
+            if (rc != position)
+                ++rows;
+            position = rc;
+        }
+        if (!e)
+            cursor[0] = -1;
+    } else if (cursor[0] >= 0) {
+        int numSlots = numberOfScanSlots(mapdata);
+        if (cursor[2] < numSlots)
+            numSlots = (int)cursor[2];
+        int i;
+        for (i = (int)cursor[0]; i < numSlots && rc >= 0; ++i) {
+            if (i + 1 < numSlots)
+                __builtin_prefetch(scanSlot(mapdata, i + 1));
+            jlong n = 0;
+            for (struct dataEntry *e = scanSlot(mapdata, i); e; e = (isView ? e->nextInCommittedView : e->nextSameHash), ++n) {
+                if (i == cursor[0] && n < cursor[1])
+                    continue;       // done in the previous call
+                rc = rows < maxRows ? scanEntry(mapdata, &spec, e, buffer, position, limit) : SCAN_BUFFER_FULL;
+                if (rc < 0) {
+                    cursor[0] = i;
+                    cursor[1] = n;
+                    break;
+                }
+                if (rc != position)
+                    ++rows;
+                position = rc;
+            }
+        }
+        if (rc >= 0)
+            cursor[0] = -1;
+    }
+    free(specData);
+    if (rc == SCAN_BUFFER_FULL && position == startPosition && maxRows > 0) {
+        throwAny(env, "target buffer too small for a single row");
+        return 0L;
+    }
+    if (rc < SCAN_BUFFER_FULL) {
+        throwFieldError(env, rc);
+        return 0L;
+    }
+    (*env)->SetLongArrayRegion(env, cursorArray, 0, 3, cursor);
+    return ((jlong)rows << 32) | (jlong)(unsigned)position;
+}
+
+
+static void pinView(struct map *view);
+static void unpinView(struct map *view);
+
+// Native aggregation (natAggregate): the number of rows matching a scan specification (its projections are ignored), and the number,
+// sum, minimum and maximum of the numeric values of a field, optionally grouped by the value of another field.
+// Big maps are aggregated by several threads, each over a range of slots, and the groups of the threads are merged at the end.
+// Compressed rows are decompressed only up to the last field required. The cache of decompressed values is bypassed, a full scan would
+// only flush it.
+#define AGG_NO_FIELD                -1
+#define AGG_INITIAL_SLOTS           64          // of the group hash, a power of 2
+#define AGG_MIN_SLOTS_PER_THREAD    4096
+#define AGG_MAX_THREADS             64
+
+struct aggGroup {
+    int keyOffset;                  // in keyBytes of the table
+    int keyLength;                  // -1 for the group of the rows without the group field (and if not grouped)
+    int hash;
+    jlong count;                    // matching rows
+    jlong valueCount;               // matching rows with a numeric value field
+    jlong sum;                      // of the numeric values, modulo 2^64
+    jlong min;
+    jlong max;
+};
+
+struct aggTable {
+    struct aggGroup *groups;
+    int numGroups;
+    int capacity;
+    int *slots;                     // index of the group + 1, 0 for a free slot (linear probing)
+    int numSlots;
+    char *keyBytes;
+    int keyBytesUsed;
+    int keyBytesSize;
+};
+
+struct aggWorker {
+    const struct map *mapdata;
+    const struct scanSpec *spec;
+    int groupField;
+    int valueField;
+    jboolean isView;
+    int fromSlot;
+    int toSlot;
+    struct aggTable table;
+    char *row;                      // decompressed prefix of the current row
+    int rowSize;
+    int rc;                         // 0 if OK, else FIELD_NO_MEMORY or FIELD_CORRUPTED
+};
+
+static void aggFree(struct aggTable *t) {
+    free(t->groups);
+    free(t->slots);
+    free(t->keyBytes);
+}
+
+// rebuilds the slots for twice the number, or AGG_INITIAL_SLOTS initially. Returns 0 if OK
+static int aggGrow(struct aggTable *t) {
+    int numSlots = t->numSlots ? 2 * t->numSlots : AGG_INITIAL_SLOTS;
+    int *slots = calloc(numSlots, sizeof(int));
+    struct aggGroup *groups = realloc(t->groups, (numSlots / 2) * sizeof(struct aggGroup));
+    if (!slots || !groups) {
+        free(slots);
+        if (groups)
+            t->groups = groups;
+        return -1;
+    }
+    for (int i = 0; i < t->numGroups; ++i) {
+        int j = groups[i].hash & (numSlots - 1);
+        while (slots[j])
+            j = (j + 1) & (numSlots - 1);
+        slots[j] = i + 1;
+    }
+    free(t->slots);
+    t->slots = slots;
+    t->numSlots = numSlots;
+    t->groups = groups;
+    t->capacity = numSlots / 2;
+    return 0;
+}
+
+// returns the group of a key (length -1 for the null group), creating it if required. Returns NULL if out of memory
+static struct aggGroup *aggFindGroup(struct aggTable *t, const char *key, int length) {
+    int hash = length < 0 ? -1 : valueHash(key, length);
+    if (t->numGroups >= t->capacity && aggGrow(t))
+        return NULL;
+    int j = hash & (t->numSlots - 1);
+    while (t->slots[j]) {
+        struct aggGroup *g = &t->groups[t->slots[j] - 1];
+        if (g->hash == hash && g->keyLength == length && (length <= 0 || !memcmp(t->keyBytes + g->keyOffset, key, length)))
+            return g;
+        j = (j + 1) & (t->numSlots - 1);
+    }
+    if (length > t->keyBytesSize - t->keyBytesUsed) {
+        int newSize = 2 * t->keyBytesSize + length + 256;
+        char *keyBytes = realloc(t->keyBytes, newSize);
+        if (!keyBytes)
+            return NULL;
+        t->keyBytes = keyBytes;
+        t->keyBytesSize = newSize;
+    }
+    struct aggGroup *g = &t->groups[t->numGroups];
+    t->slots[j] = ++t->numGroups;
+    g->keyOffset = t->keyBytesUsed;
+    g->keyLength = length;
+    g->hash = hash;
+    g->count = 0;
+    g->valueCount = 0;
+    g->sum = 0;
+    g->min = 0;
+    g->max = 0;
+    if (length > 0) {
+        memcpy(t->keyBytes + t->keyBytesUsed, key, length);
+        t->keyBytesUsed += length;
+    }
+    return g;
+}
+
+static inline void aggAddValues(struct aggGroup *g, jlong valueCount, jlong sum, jlong min, jlong max) {
+    if (!valueCount)
+        return;
+    if (!g->valueCount || min < g->min)
+        g->min = min;
+    if (!g->valueCount || max > g->max)
+        g->max = max;
+    g->valueCount += valueCount;
+    g->sum = (jlong)((unsigned long long)g->sum + (unsigned long long)sum);
+}
+
+// parses a decimal number with an optional sign. Returns 0 if the field is not numeric (or out of the range of a long)
+static int parseLong(const char *p, int len, jlong *value) {
+    int i = len && (*p == '-' || *p == '+') ? 1 : 0;
+    if (i >= len || len - i > 18)
+        return 0;
+    jlong v = 0;
+    for (; i < len; ++i) {
+        if (p[i] < '0' || p[i] > '9')
+            return 0;
+        v = 10 * v + (p[i] - '0');
+    }
+    *value = *p == '-' ? -v : v;
+    return 1;
+}
+
+// aggregates the first size bytes of a row. Returns 0 if OK, or FIELD_INCOMPLETE or FIELD_NO_MEMORY
+static int aggregateRow(struct aggWorker *w, const char *row, int size, jboolean complete) {
+    const struct scanSpec *s = w->spec;
+    int rc = scanMatches(s, row, size, complete);
+    if (rc <= 0)
+        return rc;
+    int start = 0;
+    int groupLength = -1;
+    const char *groupKey = NULL;
+    if (w->groupField != AGG_NO_FIELD) {
+        groupLength = locateField(row, size, complete, w->groupField, s->delimiter, s->nullIndicator, &start);
+        if (groupLength == FIELD_INCOMPLETE)
+            return FIELD_INCOMPLETE;
+        groupKey = row + start;
+    }
+    jlong value = 0;
+    int hasValue = 0;
+    if (w->valueField != AGG_NO_FIELD) {
+        int len = locateField(row, size, complete, w->valueField, s->delimiter, s->nullIndicator, &start);
+        if (len == FIELD_INCOMPLETE)
+            return FIELD_INCOMPLETE;
+        hasValue = len > 0 && parseLong(row + start, len, &value);
+    }
+    struct aggGroup *g = aggFindGroup(&w->table, groupKey, groupLength);
+    if (!g)
+        return FIELD_NO_MEMORY;
+    ++g->count;
+    if (hasValue)
+        aggAddValues(g, 1, value, value, value);
+    return 0;
+}
+
+// aggregates an entry, decompressing a doubling prefix of compressed rows until it contains all fields required
+static int aggregateEntry(struct aggWorker *w, const struct dataEntry *e) {
+    if (!e->compressedSize)
+        return aggregateRow(w, e->data, e->uncompressedSize, JNI_TRUE);
+    int prefixSize = FIELD_SCAN_INITIAL_SIZE;
+    int rc;
+    do {
+        if (prefixSize > e->uncompressedSize)
+            prefixSize = e->uncompressedSize;
+        if (prefixSize > w->rowSize) {
+            char *row = realloc(w->row, prefixSize);
+            if (!row)
+                return FIELD_NO_MEMORY;
+            w->row = row;
+            w->rowSize = prefixSize;
+        }
+        if (codecDecompress(w->mapdata->codec, e->data, e->compressedSize, w->row, e->uncompressedSize, prefixSize))
+            return FIELD_CORRUPTED;
+        rc = aggregateRow(w, w->row, prefixSize, prefixSize >= e->uncompressedSize);
+        prefixSize *= 2;
+    } while (rc == FIELD_INCOMPLETE);
+    return rc;
+}
+
+static void aggregateRange(struct aggWorker *w) {
+    for (int i = w->fromSlot; i < w->toSlot && !w->rc; ++i)
+        for (struct dataEntry *e = scanSlot(w->mapdata, i); e && !w->rc; e = w->isView ? e->nextInCommittedView : e->nextSameHash)
+            w->rc = aggregateEntry(w, e);
+}
+
+static void *aggregateThread(void *arg) {
+    aggregateRange((struct aggWorker *)arg);
+    codecReleaseThread();
+    return NULL;
+}
+
+// serializes the groups, all numbers in big endian byte order: the number of groups, then per group the length of the key
+// (-1 for the null group) and its bytes, the count, the number of values, their sum, minimum and maximum
+static jbyteArray aggToJava(JNIEnv *env, const struct aggTable *t) {
+    int size = sizeof(jint) + t->keyBytesUsed + t->numGroups * (sizeof(jint) + 5 * sizeof(jlong));
+    char *buffer = malloc(size);
+    if (!buffer) {
+        throwOutOfMemory(env);
+        return (jbyteArray)0;
+    }
+    jint n = TO_BIG_ENDIAN_32(t->numGroups);
+    memcpy(buffer, &n, sizeof(jint));
+    int pos = sizeof(jint);
+    for (int i = 0; i < t->numGroups; ++i) {
+        const struct aggGroup *g = &t->groups[i];
+        n = TO_BIG_ENDIAN_32(g->keyLength);
+        memcpy(buffer + pos, &n, sizeof(jint));
+        pos += sizeof(jint);
+        if (g->keyLength > 0) {
+            memcpy(buffer + pos, t->keyBytes + g->keyOffset, g->keyLength);
+            pos += g->keyLength;
+        }
+        jlong numbers[5] = { g->count, g->valueCount, g->sum, g->min, g->max };
+        for (int j = 0; j < 5; ++j) {
+            jlong v = TO_BIG_ENDIAN_64(numbers[j]);
+            memcpy(buffer + pos, &v, sizeof(jlong));
+            pos += sizeof(jlong);
+        }
+    }
+    jbyteArray result = (*env)->NewByteArray(env, size);
+    if (result)
+        (*env)->SetByteArrayRegion(env, result, 0, size, (jbyte *)buffer);
+    free(buffer);
+    return result;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natAggregate
+ * Signature: (JZ[BIII)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natAggregate
+  (JNIEnv *env, jclass me, jlong cMap, jboolean isView, jbyteArray specArray, jint groupField, jint valueField, jint numThreads) {
+    struct map *mapdata = (struct map *) cMap;
+    if (mapdata->modes & IS_INDEX) {
+        throwAny(env, "Aggregation is supported on data maps only");
+        return (jbyteArray)0;
+    }
+    if (groupField < AGG_NO_FIELD || valueField < AGG_NO_FIELD) {
+        throwAny(env, "Bad field number");
+        return (jbyteArray)0;
+    }
+    int specSize = (*env)->GetArrayLength(env, specArray);
+    char *specData = malloc(specSize ? specSize : 1);
+    if (!specData) {
+        throwOutOfMemory(env);
+        return (jbyteArray)0;
+    }
+    (*env)->GetByteArrayRegion(env, specArray, 0, specSize, (jbyte *)specData);
+    struct scanSpec spec;
+    if (parseScanSpec(specData, specSize, &spec)) {
+        free(specData);
+        throwAny(env, "Bad scan specification");
+        return (jbyteArray)0;
+    }
+
+    if (isView)
+        pinView(mapdata);   // the threads read the view at a consistent point
+    int numSlots = numberOfScanSlots(mapdata);
+    if (numThreads > numSlots / AGG_MIN_SLOTS_PER_THREAD)
+        numThreads = numSlots / AGG_MIN_SLOTS_PER_THREAD;
+    if (numThreads > AGG_MAX_THREADS)
+        numThreads = AGG_MAX_THREADS;
+    if (numThreads < 1)
+        numThreads = 1;
+    struct aggWorker workers[AGG_MAX_THREADS];
+    pthread_t threads[AGG_MAX_THREADS];
+    int started[AGG_MAX_THREADS];
+    memset(workers, 0, numThreads * sizeof(struct aggWorker));
+    for (int i = 0; i < numThreads; ++i) {
+        struct aggWorker *w = &workers[i];
+        w->mapdata = mapdata;
+        w->spec = &spec;
+        w->groupField = groupField;
+        w->valueField = valueField;
+        w->isView = isView;
+        w->fromSlot = (int)((jlong)numSlots * i / numThreads);
+        w->toSlot = (int)((jlong)numSlots * (i + 1) / numThreads);
+        // the first range is done by the calling thread. If a thread cannot be started, its range is done by the calling thread as well
+        started[i] = i && !pthread_create(&threads[i], NULL, aggregateThread, w);
+    }
+    for (int i = 0; i < numThreads; ++i)
+        if (!started[i])
+            aggregateRange(&workers[i]);
+    int rc = 0;
+    for (int i = 0; i < numThreads; ++i) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        if (workers[i].rc)
+            rc = workers[i].rc;
+    }
+    if (isView)
+        unpinView(mapdata);
+
+    // merge the groups into the table of the first worker
+    struct aggTable *t = &workers[0].table;
+    for (int i = 1; i < numThreads && !rc; ++i) {
+        const struct aggTable *other = &workers[i].table;
+        for (int j = 0; j < other->numGroups && !rc; ++j) {
+            const struct aggGroup *src = &other->groups[j];
+            struct aggGroup *g = aggFindGroup(t, other->keyBytes + src->keyOffset, src->keyLength);
+            if (!g) {
+                rc = FIELD_NO_MEMORY;
+                break;
+            }
+            g->count += src->count;
+            aggAddValues(g, src->valueCount, src->sum, src->min, src->max);
+        }
+    }
+    jbyteArray result = (jbyteArray)0;
+    if (rc)
+        throwFieldError(env, rc);
+    else
+        result = aggToJava(env, t);
+    for (int i = 0; i < numThreads; ++i) {
+        aggFree(&workers[i].table);
+        free(workers[i].row);
+    }
+    free(specData);
+    return result;
+}
+
+
+struct filedumpHeader {
+    int magicNumber;
+    int numberOfRecords;
+    int codecId;                // codec of the compressed entries. Older dumps have 0 (CODEC_LZ4) here, as part of a totalSize field which was never set
+    int dictionarySize;         // size of the codec dictionary, which follows the header (padded to a multiple of 8). Always 0 in older dumps
+    jlong lastCommittedRef;
+    jlong changeSequence;       // of the map. Only present in dumps with MAGIC_DB_SEQUENCE_CONSTANT, 0 for older dumps
+};
+#define FILEDUMP_HEADER_V1_SIZE (4 * sizeof(int) + sizeof(jlong))      // the header of dumps with MAGIC_DB_CONSTANT
+
+
+// buffer size calculation (reading):
+// we want to achieve the magnitide of the advertised 500 MB / s write speed.
+// SSD write latency is about 3 ms (333 ops / second), or a buffer size of 1.5 MB.
+// let's allocate about 2 megs then.  This just happens to be a hugepage on x86_64.
+// all entries in the file will be 8-byte aligned, padded by 0xee. Dumps are written by a dumpWriter (jpawWriter.c)
+#define FILEDUMP_BUFFER_SIZE    (2 * 1024 * 1024)
+
+// returns the file name as a C string (malloc'd), NULL if no memory is available (and throws)
+static char *filenameFromJava(JNIEnv *env, jbyteArray filename) {
+    int filenameLen = (*env)->GetArrayLength(env, filename);
+    char *filenameBuffer = malloc(filenameLen+1);
+    if (!filenameBuffer) {
+        throwOutOfMemory(env);
+        return NULL;
+    }
+    (*env)->GetByteArrayRegion(env, filename, 0, filenameLen, (jbyte *)filenameBuffer);
+    filenameBuffer[filenameLen] = 0;
+    return filenameBuffer;
+}
+
+// throws the exception for a failed writerOpen / writerClose
+static void throwWriteError(JNIEnv *env, int rc, const char *what) {
+    char msg[256];
+    if (rc == ENOMEM) {
+        throwOutOfMemory(env);
+        return;
+    }
+    snprintf(msg, sizeof(msg), "%s: %s", what, rc > 0 ? strerror(rc) : "short write");
+    throwAny(env, msg);
+}
+
+// opens a dump writer for the file. Returns 0 if OK, else -1 (and throws)
+static int openDumpWriter(JNIEnv *env, struct dumpWriter *w, jbyteArray filename, int numBuffers) {
+    char *filenameBuffer = filenameFromJava(env, filename);
+    if (!filenameBuffer)
+        return -1;
+    int rc = writerOpen(w, filenameBuffer, numBuffers);
+    free(filenameBuffer);
+    if (rc) {
+        throwWriteError(env, rc, "Cannot open file");
+        return -1;
+    }
+    return 0;
+}
+
+static char *allocateBuffers(JNIEnv *env, char **buffer, jbyteArray filename) {
+
+#ifdef _ISOC11_SOURCE
+    *buffer = aligned_alloc(4 * 1024, FILEDUMP_BUFFER_SIZE);  // needs _ISOC11_SOURCE
+#else
+    *buffer = malloc(FILEDUMP_BUFFER_SIZE);
+#endif
+    if (!*buffer) {
+        throwOutOfMemory(env);
+        return NULL;
+    }
+    char *filenameBuffer = filenameFromJava(env, filename);
+    if (!filenameBuffer)
+        free(*buffer);
+    return filenameBuffer;
+}
+
+#define MAGIC_DB_CONSTANT           0x283462FE      // older dumps, without changeSequence. Still read
+#define MAGIC_DB_SEQUENCE_CONSTANT  0x283462FD
+#define ENTRY_HDR_SIZE      (2 * sizeof(int) + sizeof(jlong))
+
+// reads the header of a dump in either format. Returns NULL if OK, else the error message
+static char *readFiledumpHeader(FILE *fp, struct filedumpHeader *hdr) {
+    if (fread(hdr, FILEDUMP_HEADER_V1_SIZE, 1, fp) != 1)
+        return "Cannot read file header";
+    hdr->changeSequence = 0;
+    if (hdr->magicNumber == MAGIC_DB_SEQUENCE_CONSTANT)
+        return fread(&hdr->changeSequence, sizeof(jlong), 1, fp) == 1 ? NULL : "Cannot read file header";
+    return hdr->magicNumber == MAGIC_DB_CONSTANT ? NULL : "File is not a DB file (bad magic number)";
+}
+
+// compact index maps are dumped in the format of hash index maps: uncompressedSize is the width, compressedSize the hash
+static void writeCompactEntries(struct dumpWriter *w, const struct compactIndex *t) {
+    char record[ENTRY_HDR_SIZE + COMPACT_MAX_WIDTH];
+    for (int i = 0; i < t->capacity; ++i) {
+        if (t->ctrl[i] == COMPACT_USED) {
+            memcpy(record, &t->width, sizeof(int));
+            memcpy(record + sizeof(int), &t->hashes[i], sizeof(int));
+            memcpy(record + 2 * sizeof(int), &t->keys[i], sizeof(jlong));
+            memcpy(record + ENTRY_HDR_SIZE, compactValue(t, i), t->width);
+            writerPut(w, record, ENTRY_HDR_SIZE + t->width);
+        }
+    }
+}
+
+// posting list index maps are dumped in the same format, one record per key
+static void writePostingEntries(struct dumpWriter *w, const struct postingIndex *pi) {
+    jlong keys[POSTING_BATCH_SIZE];
+    char record[ENTRY_HDR_SIZE];
+    for (int i = 0; i < postingScanSlots(pi); ++i) {
+        for (const struct postingNode *n = postingScanSlot(pi, i); n; n = n->next) {
+            memcpy(record, &n->length, sizeof(int));
+            memcpy(record + sizeof(int), &n->hash, sizeof(int));
+            int found = postingCollect(&n->keys, NULL, 0, keys, POSTING_BATCH_SIZE);
+            while (found > 0) {
+                for (int j = 0; j < found; ++j) {
+                    memcpy(record + 2 * sizeof(int), &keys[j], sizeof(jlong));
+                    writerPut(w, record, ENTRY_HDR_SIZE);
+                    if (n->length)
+                        writerPut(w, n->value, n->length);
+                }
+                found = found == POSTING_BATCH_SIZE ? postingCollect(&n->keys, &keys[POSTING_BATCH_SIZE - 1], 0, keys, POSTING_BATCH_SIZE) : 0;
+            }
+        }
+    }
+}
+
+// adds one entry read from a dump to a compact or posting list index map. Returns 0 if OK, -1 if no memory is available
+static int loadIndexEntry(struct map *mapdata, const struct dataEntry *entryHdr, const char *data) {
+    if (mapdata->postings) {
+        if (postingInsert(mapdata->postings, entryHdr->key, entryHdr->compressedSize, data, entryHdr->uncompressedSize) < 0)
+            return -1;
+    } else {
+        uint64_t value[COMPACT_MAX_WORDS];
+        if (compactReserve(mapdata->compact))
+            return -1;
+        compactLoadValue(mapdata->compact, data, value);
+        compactInsert(mapdata->compact, entryHdr->key, entryHdr->compressedSize, value);
+    }
+    ++mapdata->count;
+    return 0;
+}
+
+// loads the entries into the compact table or the posting lists of the map and of its committed view. Returns 0 if OK, else -1 (and throws)
+static int readIndexEntries(JNIEnv *env, FILE *fp, struct map *mapdata, int numberOfRecords) {
+    struct map *viewdata = mapdata->committedView;
+    char *data = NULL;
+    int dataSize = 0;
+    int result = 0;
+    if (viewdata)
+        resetBuckets(viewdata);
+    for (int i = 0; i < numberOfRecords && !result; ++i) {
+        struct dataEntry entryHdr;
+        if (fread(&(entryHdr.uncompressedSize), ENTRY_HDR_SIZE, 1, fp) != 1) {
+            throwAny(env, "Cannot read entry header");
+            result = -1;
+            break;
+        }
+        const int length = entryHdr.uncompressedSize;
+        if (mapdata->compact ? length != mapdata->compact->width : length < 0) {
+            throwAny(env, "Entry does not match the width of the index");
+            result = -1;
+            break;
+        }
+        if (ROUND_UP_FILESIZE(length) > dataSize) {
+            free(data);
+            dataSize = ROUND_UP_FILESIZE(length);
+            if (!(data = malloc(dataSize))) {
+                throwOutOfMemory(env);
+                result = -1;
+                break;
+            }
+        }
+        if (length && fread(data, ROUND_UP_FILESIZE(length), 1, fp) != 1) {
+            throwAny(env, "Cannot read entry data");
+            result = -1;
+            break;
+        }
+        if (loadIndexEntry(mapdata, &entryHdr, data) || (viewdata && loadIndexEntry(viewdata, &entryHdr, data))) {
+            throwOutOfMemory(env);
+            result = -1;
+        }
+    }
+    free(data);
+    return result;
+}
+
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natWriteToFile
+ * Signature: (J[BZ)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natWriteToFile
+  (JNIEnv *env, jobject me, jlong cMap, jbyteArray filename, jboolean fromCommittedView) {
+    struct filedumpHeader hdr;
+    struct map *mapdata = (struct map *) cMap;
+    struct dumpWriter w;
+
+    if (openDumpWriter(env, &w, filename, WRITER_MAX_BUFFERS))
+        return;  // error
+
+    hdr.changeSequence = mapdata->changeSequence;
+    if (!mapdata->committedView)
+        fromCommittedView = JNI_FALSE;
+    if (fromCommittedView)
+        mapdata = mapdata->committedView;
+
+    // transfer header
+    hdr.magicNumber = MAGIC_DB_SEQUENCE_CONSTANT;
+    hdr.numberOfRecords = mapdata->count;
+    hdr.lastCommittedRef = mapdata->lastCommittedRef;
+    hdr.codecId = mapdata->codec->id;
+    hdr.dictionarySize = mapdata->codec->dictionarySize;
+
+    writerPut(&w, &hdr, sizeof(hdr));
+    if (hdr.dictionarySize)
+        writerPut(&w, mapdata->codec->dictionary, hdr.dictionarySize);
+    // write the entries
+    if (mapdata->compact)
+        writeCompactEntries(&w, mapdata->compact);
+    if (mapdata->postings)
+        writePostingEntries(&w, mapdata->postings);
+    int i;
+    for (i = 0; i < numberOfScanSlots(mapdata); ++i) {
+        struct dataEntry *e;
+        for (e = scanSlot(mapdata, i); e; e = (fromCommittedView ? e->nextInCommittedView : e->nextSameHash)) {
+            // index maps use compressedSize for the hash
+            int rawSize = e->compressedSize && !(mapdata->modes & IS_INDEX) ? e->compressedSize : e->uncompressedSize;
+            int finalSize = 2 * sizeof(int) + sizeof(jlong) + rawSize;
+            writerPut(&w, &(e->uncompressedSize), finalSize);
+        }
+    }
+
+    int rc = writerClose(&w, NULL, 0);
+    if (rc)
+        throwWriteError(env, rc, "Cannot write the file");
+}
+
+static void linkViewAfterLoad(struct map *mapdata);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natReadFromFile
+ * Signature: (J[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natReadFromFile
+  (JNIEnv *env, jobject me, jlong cMap, jbyteArray filename) {
+    struct filedumpHeader hdr;
+    struct map *mapdata = (struct map *) cMap;
+
+    if (mapdata->count) {
+        throwAny(env, "DB is not empty");
+        return;
+    }
+
+    char *buffer;
+
+    char *filenameBuffer = allocateBuffers(env, &buffer, filename);
+    if (!filenameBuffer)
+        return;  // error
+
+    // use buffered I/O for reading.
+    FILE *fp = fopen(filenameBuffer, "rb");
+    free(filenameBuffer);
+    if (!fp) {
+        throwAny(env, "Cannot open file");
+        free(buffer);
+        return;
+    }
+
+    setvbuf(fp, buffer, _IOFBF, FILEDUMP_BUFFER_SIZE);
+
+    char *headerError = readFiledumpHeader(fp, &hdr);
+    if (headerError) {
+        throwAny(env, headerError);
+        free(buffer);
+        fclose(fp);
+        return;
+    }
+    char *fileDictionary = NULL;
+    if (hdr.dictionarySize < 0 || hdr.dictionarySize > CODEC_MAX_DICTIONARY_SIZE
+      || (hdr.dictionarySize && (!(fileDictionary = malloc(ROUND_UP_FILESIZE(hdr.dictionarySize)))
+        || fread(fileDictionary, ROUND_UP_FILESIZE(hdr.dictionarySize), 1, fp) != 1))) {
+        free(fileDictionary);
+        throwAny(env, "Cannot read the compression dictionary");
+        free(buffer);
+        fclose(fp);
+        return;
+    }
+    // entries compressed with a different codec or dictionary than the one of the map are recompressed while loading.
+    // A map without dictionary adopts the one of the file, if it does not hold compressed entries yet.
+    struct codec *fileCodec = NULL;
+    jboolean transcode = JNI_FALSE;
+    if (!(mapdata->modes & IS_INDEX)) {        // index maps use compressedSize for the hash
+        struct codec *c = mapdata->codec;
+        if (hdr.codecId == c->id && hdr.dictionarySize && !c->dictionarySize && !c->compressedEntries
+          && codecSetDictionary(c, fileDictionary, hdr.dictionarySize)) {
+            free(fileDictionary);
+            throwOutOfMemory(env);
+            free(buffer);
+            fclose(fp);
+            return;
+        }
+        transcode = hdr.codecId != c->id || hdr.dictionarySize != c->dictionarySize
+          || (hdr.dictionarySize && memcmp(fileDictionary, c->dictionary, hdr.dictionarySize));
+        if (transcode) {
+            if (!codecSupported(hdr.codecId)) {
+                free(fileDictionary);
+                throwAny(env, "Compression codec of the file not supported");
+                free(buffer);
+                fclose(fp);
+                return;
+            }
+            fileCodec = codecCreate(hdr.codecId, 0, 0);
+            if (!fileCodec || codecSetDictionary(fileCodec, fileDictionary, hdr.dictionarySize)) {
+                if (fileCodec)
+                    codecDestroy(fileCodec);
+                free(fileDictionary);
+                throwOutOfMemory(env);
+                free(buffer);
+                fclose(fp);
+                return;
+            }
+        }
+    }
+    free(fileDictionary);
+    char *transcodeBuffer = NULL;
+    int transcodeBufferSize = 0;
+
+    // size the bucket arrays for the final number of entries, to avoid any resize during the load
+    struct map *viewdata = mapdata->committedView;
+    resetBuckets(mapdata);
+    presize(mapdata, hdr.numberOfRecords);
+    if (viewdata) {
+        finishResize(viewdata, JNI_TRUE);
+        presize(viewdata, hdr.numberOfRecords);
+    }
+    if (mapdata->compact || mapdata->postings) {
+        if (!readIndexEntries(env, fp, mapdata, hdr.numberOfRecords)) {
+            mapdata->lastCommittedRef = hdr.lastCommittedRef;
+            mapdata->changeSequence = hdr.changeSequence;
+            if (viewdata)
+                viewdata->lastCommittedRef = hdr.lastCommittedRef;
+        }
+        free(buffer);
+        fclose(fp);
+        return;
+    }
+
+    int i;
+    for (i = 0; i < hdr.numberOfRecords; ++i) {
+        // read the entry header: key, uncompressed & compressed size
+        struct dataEntry entryHdr;
+        if (fread(&(entryHdr.uncompressedSize), ENTRY_HDR_SIZE, 1, fp) != 1) {
+            free(buffer);
+            fclose(fp);
+            throwAny(env, "Cannot read entry header");
+            return;
+        }
+        int actualSize = entryHdr.compressedSize && !(mapdata->modes & IS_INDEX) ? entryHdr.compressedSize : entryHdr.uncompressedSize;
+        struct dataEntry *e;
+        if (transcode && entryHdr.compressedSize) {
+            // buffer for the file contents, followed by the uncompressed data
+            int needed = ROUND_UP_FILESIZE(actualSize) + entryHdr.uncompressedSize;
+            if (needed > transcodeBufferSize) {
+                free(transcodeBuffer);
+                transcodeBufferSize = needed;
+                transcodeBuffer = malloc(needed);
+            }
+            char *uncompressed = transcodeBuffer + ROUND_UP_FILESIZE(actualSize);
+            if (!transcodeBuffer || fread(transcodeBuffer, ROUND_UP_FILESIZE(actualSize), 1, fp) != 1
+              || codecDecompress(fileCodec, transcodeBuffer, actualSize, uncompressed, entryHdr.uncompressedSize, entryHdr.uncompressedSize)) {
+                codecDestroy(fileCodec);
+                free(transcodeBuffer);
+                free(buffer);
+                fclose(fp);
+                throwAny(env, "Cannot read entry data");
+                return;
+            }
+            e = create_new_entry_from_memory(mapdata, entryHdr.key, uncompressed, entryHdr.uncompressedSize, JNI_TRUE);
+        } else {
+            e = allocEntry(mapdata, actualSize);
+        }
+        if (!e) {
+            if (fileCodec)
+                codecDestroy(fileCodec);
+            free(transcodeBuffer);
+            free(buffer);
+            fclose(fp);
+            throwOutOfMemory(env);
+            return;
+        }
+        if (!transcode || !entryHdr.compressedSize) {
+            e->key = entryHdr.key;
+            e->uncompressedSize = entryHdr.uncompressedSize;
+            e->compressedSize = entryHdr.compressedSize;
+            if (entryHdr.compressedSize && !(mapdata->modes & IS_INDEX))
+                ++mapdata->codec->compressedEntries;
+        }
+        if (reserveEntry(mapdata)) {
+            freeEntry(mapdata, e);
+            if (fileCodec)
+                codecDestroy(fileCodec);
+            free(transcodeBuffer);
+            free(buffer);
+            fclose(fp);
+            throwOutOfMemory(env);
+            return;
+        }
+
+        if (mapdata->probe) {
+            e->nextSameHash = NULL;
+            probeSet(mapdata->probe, e->key, e);
+        } else if (mapdata->tree) {
+            e->nextSameHash = NULL;
+            treeSet(mapdata->tree, e->key, e);
+        } else {
+            struct dataEntry **slot = computeSlot(mapdata, e);
+            e->nextSameHash = *slot;
+            *slot = e;
+        }
+        e->nextInCommittedView = NULL;
+        if ((!transcode || !entryHdr.compressedSize) && fread(e->data, ROUND_UP_FILESIZE(actualSize), 1, fp) != 1) {
+            if (fileCodec)
+                codecDestroy(fileCodec);
+            free(transcodeBuffer);
+            free(buffer);
+            fclose(fp);
+            throwAny(env, "Cannot read entry data");
+            return;
+        }
+        if (mapdata->sorted)
+            sortedInsert(mapdata->sorted, e);      // after the value has been read, space has been reserved above
+        ++mapdata->count;
+    }
+    if (fileCodec)
+        codecDestroy(fileCodec);
+    free(transcodeBuffer);
+    free(buffer);
+    fclose(fp);
+
+    // mapdata->count = hdr.numberOfRecords;
+    mapdata->lastCommittedRef = hdr.lastCommittedRef;
+    mapdata->changeSequence = hdr.changeSequence;
+    linkViewAfterLoad(mapdata);
+}
+
+// links the entries loaded into a map into its committed view as well, if it has one
+static void linkViewAfterLoad(struct map *mapdata) {
+    struct map *viewdata = mapdata->committedView;
+    int i;
+    if (viewdata) {
+        // transfer everything from main view to committed view as well
+        // the bucket arrays of both could differ in size, therefore link the committed view chains separately
+        if (viewdata->probe || viewdata->tree) {
+            for (i = 0; i < numberOfScanSlots(mapdata); ++i) {
+                struct dataEntry *e = scanSlot(mapdata, i);
+                if (e && !reserveEntry(viewdata))
+                    setPutSubShadow(viewdata, e);
+            }
+        } else if (viewdata->hashTableSize == mapdata->hashTableSize) {
+            for (i = 0; i < mapdata->hashTableSize; ++i) {
+                viewdata->keyHash[i] = mapdata->keyHash[i];
+                for (struct dataEntry *e = mapdata->keyHash[i]; e; e = e->nextSameHash)
+                    e->nextInCommittedView = e->nextSameHash;
+            }
+        } else {
+            memset(viewdata->keyHash, 0, sizeof(struct dataEntry *) * viewdata->hashTableSize);
+            for (i = 0; i < mapdata->hashTableSize; ++i) {
+                for (struct dataEntry *e = mapdata->keyHash[i]; e; e = e->nextSameHash) {
+                    struct dataEntry **slot = computeSlot(viewdata, e);
+                    e->nextInCommittedView = *slot;
+                    *slot = e;
+                }
+            }
+        }
+        if (viewdata->sorted) {
+            sortedClear(viewdata->sorted);
+            for (i = 0; i < mapdata->hashTableSize; ++i)
+                for (struct dataEntry *e = mapdata->keyHash[i]; e; e = e->nextSameHash)
+                    if (!reserveEntry(viewdata))
+                        sortedInsert(viewdata->sorted, e);
+        }
+        viewdata->count = mapdata->count;
+        viewdata->lastCommittedRef = mapdata->lastCommittedRef;
+    }
+}
+
+
+
+// Mapped dump files (natWriteMappedFile / natMapFile) of data maps: the entries are stored in their in-memory layout (struct dataEntry,
+// with NULL links, 16 byte aligned), followed by a table of (key, file offset) pairs. Loading maps the file (MAP_PRIVATE) and builds the
+// slots of the map from the table, pointing into the mapping, without reading or copying the entries: pages are faulted in on first access.
+// The table carries the payload size of every entry as well, therefore the bounds of the entries are validated without touching them.
+// Replaced or removed entries are never written to, the new values are allocated from the arena as usual (copy on write).
+// Open addressing and ordered maps keep their entries in separate tables, therefore their entry pages stay shared with the page cache.
+// Hash chains link the entries through nextSameHash, which writes to (and privately copies) every entry page at load time.
+
+#define MAGIC_MAPPED_CONSTANT   0x283462FF
+#define MAPPED_PREWARM_POPULATE 0x01        // natMapFile: read the whole file at once (MAP_POPULATE)
+#define MAPPED_PREWARM_WILLNEED 0x02        // natMapFile: start reading the file asynchronously (MADV_WILLNEED)
+
+struct mappedDumpHeader {
+    int magicNumber;
+    int numberOfRecords;
+    int codecId;
+    int dictionarySize;         // size of the codec dictionary, which follows the header (padded to a multiple of 8)
+    jlong lastCommittedRef;
+    int entryHeaderSize;        // sizeof(struct dataEntry) of the writer, which must match
+    int numberOfCompressed;     // entries stored compressed, counted at write time (the entries are not read at load time)
+    jlong entriesOffset;        // file offset of the first entry, a multiple of 16
+    jlong keysOffset;           // file offset of the (key, entry offset) table, after the entries
+    jlong changeSequence;
+};
+
+struct mappedKey {
+    jlong key;
+    jlong offset;
+    int payloadSize;            // as stored in the entry (compressedSize if compressed, else uncompressedSize)
+    int padding;
+};
+
+// writes data and pads it by 0xee to a multiple of 16 bytes
+static void writerPut16(struct dumpWriter *w, void const *src, int len) {
+    static const char padding[8] = { (char)0xee, (char)0xee, (char)0xee, (char)0xee, (char)0xee, (char)0xee, (char)0xee, (char)0xee };
+    writerPut(w, src, len);
+    if (ROUND_UP_FILESIZE(len) & 15)
+        writerPut(w, padding, 8);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natWriteMappedFile
+ * Signature: (J[BZ)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natWriteMappedFile
+  (JNIEnv *env, jclass me, jlong cMap, jbyteArray filename, jboolean fromCommittedView) {
+    struct map *mapdata = (struct map *) cMap;
+    if (mapdata->modes & IS_INDEX) {
+        throwAny(env, "Mapped dumps are supported for data maps only");
+        return;
+    }
+    if (!mapdata->committedView)
+        fromCommittedView = JNI_FALSE;
+    if (fromCommittedView)
+        mapdata = mapdata->committedView;
+    struct mappedKey *keys = malloc(sizeof(struct mappedKey) * (mapdata->count ? mapdata->count : 1));
+    if (!keys) {
+        throwOutOfMemory(env);
+        return;
+    }
+    struct dumpWriter w;
+    if (openDumpWriter(env, &w, filename, WRITER_MAX_BUFFERS)) {
+        free(keys);
+        return;  // error
+    }
+
+    struct mappedDumpHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.changeSequence = ((struct map *) cMap)->changeSequence;
+    hdr.magicNumber = MAGIC_MAPPED_CONSTANT;
+    hdr.codecId = mapdata->codec->id;
+    hdr.dictionarySize = mapdata->codec->dictionarySize;
+    hdr.lastCommittedRef = mapdata->lastCommittedRef;
+    hdr.entryHeaderSize = sizeof(struct dataEntry);
+    hdr.entriesOffset = ROUND_UP_SIZE(sizeof(hdr)) + (hdr.dictionarySize ? ROUND_UP_SIZE(hdr.dictionarySize) : 0);
+    writerPut16(&w, &hdr, sizeof(hdr));      // rewritten at the end
+    if (hdr.dictionarySize)
+        writerPut16(&w, mapdata->codec->dictionary, hdr.dictionarySize);
+
+    // the entries, with the links cleared
+    jlong offset = hdr.entriesOffset;
+    int n = 0;
+    for (int i = 0; i < numberOfScanSlots(mapdata); ++i) {
+        for (struct dataEntry *e = scanSlot(mapdata, i); e && n < mapdata->count; e = fromCommittedView ? e->nextInCommittedView : e->nextSameHash) {
+            struct dataEntry entryHdr;
+            memset(&entryHdr, 0, sizeof(entryHdr));
+            entryHdr.uncompressedSize = e->uncompressedSize;
+            entryHdr.compressedSize = e->compressedSize;
+            entryHdr.key = e->key;
+            const int payloadSize = e->compressedSize ? e->compressedSize : e->uncompressedSize;
+            writerPut(&w, &entryHdr, sizeof(struct dataEntry));
+            writerPut16(&w, e->data, payloadSize);
+            keys[n].key = e->key;
+            keys[n].offset = offset;
+            keys[n].payloadSize = payloadSize;
+            keys[n].padding = 0;
+            if (e->compressedSize)
+                ++hdr.numberOfCompressed;
+            ++n;
+            offset += sizeof(struct dataEntry) + ROUND_UP_SIZE(payloadSize);
+        }
+    }
+    hdr.numberOfRecords = n;
+    hdr.keysOffset = offset;
+    writerPut(&w, keys, sizeof(struct mappedKey) * n);
+    int rc = writerClose(&w, &hdr, sizeof(hdr));
+    free(keys);
+    if (rc)
+        throwWriteError(env, rc, "Cannot write the file");
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natMapFile
+ * Signature: (J[BI)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natMapFile
+  (JNIEnv *env, jclass me, jlong cMap, jbyteArray filename, jint prewarm) {
+    struct map *mapdata = (struct map *) cMap;
+    if (mapdata->count || (mapdata->committedView && mapdata->committedView->count)) {
+        throwAny(env, "DB is not empty");
+        return;
+    }
+    if (mapdata->mapped) {
+        throwAny(env, "A file has been mapped already");
+        return;
+    }
+    if (mapdata->modes & IS_INDEX) {
+        throwAny(env, "Mapped dumps are supported for data maps only");
+        return;
+    }
+    int filenameLen = (*env)->GetArrayLength(env, filename);
+    char *filenameBuffer = malloc(filenameLen + 1);
+    struct mappedFile *mf = malloc(sizeof(struct mappedFile));
+    if (!filenameBuffer || !mf) {
+        free(filenameBuffer);
+        free(mf);
+        throwOutOfMemory(env);
+        return;
+    }
+    (*env)->GetByteArrayRegion(env, filename, 0, filenameLen, (jbyte *)filenameBuffer);
+    filenameBuffer[filenameLen] = 0;
+    int fd = open(filenameBuffer, O_RDONLY);
+    free(filenameBuffer);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) || st.st_size < (off_t)sizeof(struct mappedDumpHeader)) {
+        if (fd >= 0)
+            close(fd);
+        free(mf);
+        throwAny(env, "Cannot open file");
+        return;
+    }
+    mf->size = st.st_size;
+    mf->base = mmap(NULL, mf->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | (prewarm & MAPPED_PREWARM_POPULATE ? MAP_POPULATE : 0), fd, 0);
+    close(fd);          // the mapping stays valid
+    if (mf->base == MAP_FAILED) {
+        free(mf);
+        throwAny(env, "Cannot map file");
+        return;
+    }
+    if (prewarm & MAPPED_PREWARM_WILLNEED)
+        madvise(mf->base, mf->size, MADV_WILLNEED);
+
+    const struct mappedDumpHeader *hdr = (const struct mappedDumpHeader *) mf->base;
+    char *error = NULL;
+    struct codec *c = mapdata->codec;
+    jboolean adoptedDictionary = JNI_FALSE;     // dropped again if the file is rejected
+    if (hdr->magicNumber != MAGIC_MAPPED_CONSTANT)
+        error = "File is not a mapped DB file (bad magic number)";
+    else if (hdr->entryHeaderSize != sizeof(struct dataEntry))
+        error = "File has been written by an incompatible build";
+    else if (hdr->numberOfRecords < 0 || hdr->dictionarySize < 0 || hdr->dictionarySize > CODEC_MAX_DICTIONARY_SIZE
+      || hdr->entriesOffset < (jlong)sizeof(*hdr) + hdr->dictionarySize || (hdr->entriesOffset & 15)
+      || hdr->keysOffset < hdr->entriesOffset || hdr->keysOffset + (jlong)sizeof(struct mappedKey) * hdr->numberOfRecords > (jlong)mf->size
+      || hdr->numberOfCompressed < 0 || hdr->numberOfCompressed > hdr->numberOfRecords)
+        error = "Corrupted file header";
+    else if (hdr->codecId != c->id)
+        error = "Compression codec of the file does not match the map";
+    else if (hdr->dictionarySize && !c->dictionarySize && !c->compressedEntries) {
+        // adopt the dictionary of the file
+        if (codecSetDictionary(c, mf->base + ROUND_UP_SIZE(sizeof(*hdr)), hdr->dictionarySize))
+            error = "Out of off-heap memory in JNI call";
+        else
+            adoptedDictionary = JNI_TRUE;
+    }
+    if (!error && (hdr->dictionarySize != c->dictionarySize
+      || (hdr->dictionarySize && memcmp(mf->base + ROUND_UP_SIZE(sizeof(*hdr)), c->dictionary, hdr->dictionarySize))))
+        error = "Compression dictionary of the file does not match the map";
+    // every entry, including its payload, must be located between the entries offset and the key table
+    const struct mappedKey *keys = (const struct mappedKey *)(mf->base + hdr->keysOffset);
+    for (int i = 0; !error && i < hdr->numberOfRecords; ++i) {
+        if (keys[i].offset < hdr->entriesOffset || (keys[i].offset & 15) || keys[i].payloadSize < 0
+          || keys[i].offset + (jlong)sizeof(struct dataEntry) + ROUND_UP_SIZE((jlong)keys[i].payloadSize) > hdr->keysOffset)
+            error = "Corrupted key table";
+    }
+    if (error) {
+        if (adoptedDictionary)
+            codecSetDictionary(c, NULL, 0);
+        munmap(mf->base, mf->size);
+        free(mf);
+        throwAny(env, error);
+        return;
+    }
+
+    // the slots refer to the entries in the mapping. Only the key table is read here
+    mapdata->mapped = mf;
+    if (mapdata->committedView)
+        mapdata->committedView->mapped = mf;
+    resetBuckets(mapdata);
+    presize(mapdata, hdr->numberOfRecords);
+    if (mapdata->committedView) {
+        finishResize(mapdata->committedView, JNI_TRUE);
+        presize(mapdata->committedView, hdr->numberOfRecords);
+    }
+    for (int i = 0; i < hdr->numberOfRecords; ++i) {
+        struct dataEntry *e = (struct dataEntry *)(mf->base + keys[i].offset);
+        if (mapdata->probe || mapdata->tree) {
+            // the key table is trusted for the key and the size, the entry is only read on access
+            if (reserveEntry(mapdata)) {
+                error = "Out of off-heap memory in JNI call";
+                break;
+            }
+            if (mapdata->probe)
+                probeSet(mapdata->probe, keys[i].key, e);      // cannot fail after the presize
+            else
+                treeSet(mapdata->tree, keys[i].key, e);
+        } else {
+            // the entry page is written to anyway: check the entry against the key table
+            if (e->key != keys[i].key || (e->compressedSize ? e->compressedSize : e->uncompressedSize) != keys[i].payloadSize) {
+                error = "Corrupted key table";
+                break;
+            }
+            struct dataEntry **slot = computeSlot(mapdata, e);
+            e->nextSameHash = *slot;
+            *slot = e;
+        }
+        ++mapdata->count;
+    }
+    if (error) {
+        // no entry of the mapping must remain referenced once it is unmapped
+        resetBuckets(mapdata);
+        mapdata->mapped = NULL;
+        if (mapdata->committedView)
+            mapdata->committedView->mapped = NULL;
+        if (adoptedDictionary)
+            codecSetDictionary(c, NULL, 0);
+        munmap(mf->base, mf->size);
+        free(mf);
+        throwAny(env, error);
+        return;
+    }
+    c->compressedEntries += hdr->numberOfCompressed;
+    mapdata->lastCommittedRef = hdr->lastCommittedRef;
+    mapdata->changeSequence = hdr->changeSequence;
+    linkViewAfterLoad(mapdata);
+}
+
+
+// Segmented dumps (natWriteSegmentedFile / natReadSegmentedFile) of data maps: the slots are split into ranges, and the entries of
+// every range are written to a separate segment file (<pathname>.<segment number>) by a thread of its own, in the record format of
+// natWriteToFile. Each segment file starts with a small header, and has a CRC32C checksum and a record count, which are stored in the
+// manifest (<pathname>), together with the dictionary and lastCommittedRef. The manifest is written last, after all segments.
+// Restore reads and verifies all segments in parallel, before the map is touched, then allocates the entries (the arena is not thread
+// safe), and lets the threads copy the entries and link the hash chains, each thread into a range of slots of its own.
+// The segments are held in memory completely while they are loaded.
+
+#define MAGIC_SEGMENTED_CONSTANT    0x28346300
+#define MAGIC_SEGMENT_CONSTANT      0x28346301
+#define SEGMENTS_MAX                64
+
+struct segmentedDumpHeader {
+    int magicNumber;
+    int numberOfSegments;
+    int codecId;
+    int dictionarySize;         // size of the codec dictionary, which follows the segment table (padded to a multiple of 8)
+    jlong lastCommittedRef;
+    int numberOfRecords;        // in all segments
+    uint32_t crc;               // CRC32C of the segment table and the dictionary
+    jlong changeSequence;
+};
+
+struct segmentInfo {
+    jlong size;                 // of the segment file, including its header
+    int numberOfRecords;
+    uint32_t crc;               // CRC32C of the segment file
+};
+
+struct segmentHeader {
+    int magicNumber;
+    int segmentNumber;
+    jlong lastCommittedRef;
+};
+
+struct segmentWriter {
+    const struct map *mapdata;
+    char *filename;
+    int fromSlot;               // range of slots written to the segment
+    int toSlot;
+    jboolean fromCommittedView;
+    struct segmentHeader hdr;
+    struct segmentInfo info;
+    struct dumpWriter writer;   // double buffered
+    int rc;                     // of writerOpen / writerClose
+};
+
+// runs worker for the n items, n - 1 of them in threads of their own, and the first one by the calling thread.
+// Items for which no thread can be started are done by the calling thread as well
+static void runSegmentThreads(void *(*worker)(void *), char *items, size_t itemSize, int n) {
+    pthread_t threads[SEGMENTS_MAX];
+    int started[SEGMENTS_MAX];
+    for (int i = 0; i < n; ++i)
+        started[i] = i && !pthread_create(&threads[i], NULL, worker, items + i * itemSize);
+    for (int i = 0; i < n; ++i)
+        if (!started[i])
+            worker(items + i * itemSize);
+    for (int i = 0; i < n; ++i)
+        if (started[i])
+            pthread_join(threads[i], NULL);
+}
+
+// writes data to a segment, padded by 0xee to a multiple of 8 bytes, and adds it to the checksum
+static void segmentWrite(struct segmentWriter *w, const void *src, int len) {
+    static const char padding[8] = { (char)0xee, (char)0xee, (char)0xee, (char)0xee, (char)0xee, (char)0xee, (char)0xee, (char)0xee };
+    w->info.crc = crc32c(w->info.crc, src, len);
+    if (len & 7)
+        w->info.crc = crc32c(w->info.crc, padding, 8 - (len & 7));
+    writerPut(&w->writer, src, len);
+}
+
+static void *segmentWriterThread(void *arg) {
+    struct segmentWriter *w = arg;
+    if ((w->rc = writerOpen(&w->writer, w->filename, 2)))
+        return NULL;
+    segmentWrite(w, &w->hdr, sizeof(w->hdr));
+    for (int i = w->fromSlot; i < w->toSlot; ++i) {
+        for (const struct dataEntry *e = scanSlot(w->mapdata, i); e; e = w->fromCommittedView ? e->nextInCommittedView : e->nextSameHash) {
+            int finalSize = ENTRY_HDR_SIZE + (e->compressedSize ? e->compressedSize : e->uncompressedSize);
+            segmentWrite(w, &(e->uncompressedSize), finalSize);
+            ++w->info.numberOfRecords;
+        }
+    }
+    w->info.size = writerPosition(&w->writer);
+    w->rc = writerClose(&w->writer, NULL, 0);
+    return NULL;
+}
+
+// returns the name of a segment file (malloc'd), NULL if no memory is available
+static char *segmentFilename(const char *pathname, int segment) {
+    size_t len = strlen(pathname);
+    char *name = malloc(len + 16);
+    if (name) {
+        memcpy(name, pathname, len);
+        sprintf(name + len, ".%d", segment);
+    }
+    return name;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natWriteSegmentedFile
+ * Signature: (J[BZI)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natWriteSegmentedFile
+  (JNIEnv *env, jclass me, jlong cMap, jbyteArray filename, jboolean fromCommittedView, jint numberOfSegments) {
+    struct map *mapdata = (struct map *) cMap;
+    if (mapdata->modes & IS_INDEX) {
+        throwAny(env, "Segmented dumps are supported for data maps only");
+        return;
+    }
+    if (numberOfSegments < 1 || numberOfSegments > SEGMENTS_MAX) {
+        throwAny(env, "Bad number of segments");
+        return;
+    }
+    if (!mapdata->committedView)
+        fromCommittedView = JNI_FALSE;
+    if (fromCommittedView)
+        mapdata = mapdata->committedView;
+    char *pathname = filenameFromJava(env, filename);
+    if (!pathname)
+        return;  // error
+    struct segmentWriter writers[SEGMENTS_MAX];
+    memset(writers, 0, sizeof(struct segmentWriter) * numberOfSegments);
+    jboolean noMemory = JNI_FALSE;
+    for (int i = 0; i < numberOfSegments; ++i) {
+        writers[i].filename = segmentFilename(pathname, i);
+        noMemory |= !writers[i].filename;
+    }
+    int rc = 0;
+    struct segmentedDumpHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.changeSequence = ((struct map *) cMap)->changeSequence;
+    if (!noMemory) {
+        if (fromCommittedView)
+            pinView(mapdata);   // the threads read the view at a consistent point
+        int numSlots = numberOfScanSlots(mapdata);
+        hdr.lastCommittedRef = mapdata->lastCommittedRef;
+        for (int i = 0; i < numberOfSegments; ++i) {
+            struct segmentWriter *w = &writers[i];
+            w->mapdata = mapdata;
+            w->fromCommittedView = fromCommittedView;
+            w->fromSlot = (int)((jlong)numSlots * i / numberOfSegments);
+            w->toSlot = (int)((jlong)numSlots * (i + 1) / numberOfSegments);
+            w->hdr.magicNumber = MAGIC_SEGMENT_CONSTANT;
+            w->hdr.segmentNumber = i;
+            w->hdr.lastCommittedRef = hdr.lastCommittedRef;
+        }
+        runSegmentThreads(segmentWriterThread, (char *)writers, sizeof(struct segmentWriter), numberOfSegments);
+        if (fromCommittedView)
+            unpinView(mapdata);
+
+        // the manifest: header, segment table, dictionary
+        hdr.magicNumber = MAGIC_SEGMENTED_CONSTANT;
+        hdr.numberOfSegments = numberOfSegments;
+        hdr.codecId = mapdata->codec->id;
+        hdr.dictionarySize = mapdata->codec->dictionarySize;
+        struct segmentInfo infos[SEGMENTS_MAX];
+        for (int i = 0; i < numberOfSegments; ++i) {
+            if (!rc)
+                rc = writers[i].rc;
+            infos[i] = writers[i].info;
+            hdr.numberOfRecords += infos[i].numberOfRecords;
+        }
+        hdr.crc = crc32c(0, infos, sizeof(struct segmentInfo) * numberOfSegments);
+        if (hdr.dictionarySize)
+            hdr.crc = crc32c(hdr.crc, mapdata->codec->dictionary, hdr.dictionarySize);
+        struct dumpWriter w;
+        if (!rc && !(rc = writerOpen(&w, pathname, 2))) {
+            writerPut(&w, &hdr, sizeof(hdr));
+            writerPut(&w, infos, sizeof(struct segmentInfo) * numberOfSegments);
+            if (hdr.dictionarySize)
+                writerPut(&w, mapdata->codec->dictionary, hdr.dictionarySize);
+            rc = writerClose(&w, NULL, 0);
+        }
+    }
+    for (int i = 0; i < numberOfSegments; ++i)
+        free(writers[i].filename);
+    free(pathname);
+    if (noMemory)
+        throwOutOfMemory(env);
+    else if (rc)
+        throwWriteError(env, rc, "Cannot write the file");
+}
+
+
+#define SEGMENT_OK              0
+#define SEGMENT_CANNOT_READ     1
+#define SEGMENT_CORRUPTED       2
+#define SEGMENT_NO_MEMORY       3
+
+struct segmentLoader {
+    struct map *mapdata;
+    char *filename;
+    int segmentNumber;
+    int numberOfSegments;       // also the number of slot ranges
+    jlong lastCommittedRef;
+    struct segmentInfo info;
+    char *data;                 // contents of the segment file
+    struct dataEntry **entries; // allocated for the records, in the order of the file
+    struct dataEntry *toRange[SEGMENTS_MAX];    // the entries, by slot range, linked through nextSameHash
+    int compressedEntries;
+    int rc;                     // SEGMENT_*
+};
+
+static inline const char *segmentRecordAt(const struct segmentLoader *l, jlong offset, struct dataEntry *entryHdr) {
+    memcpy(&(entryHdr->uncompressedSize), l->data + offset, ENTRY_HDR_SIZE);
+    return l->data + offset + ENTRY_HDR_SIZE;
+}
+
+static inline int segmentPayloadSize(const struct dataEntry *entryHdr) {
+    return entryHdr->compressedSize ? entryHdr->compressedSize : entryHdr->uncompressedSize;
+}
+
+// phase 1: reads the segment and verifies its size, checksum, header and records
+static void *segmentReaderThread(void *arg) {
+    struct segmentLoader *l = arg;
+    l->rc = SEGMENT_CANNOT_READ;
+    int fd = open(l->filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) || st.st_size != l->info.size) {
+        l->rc = SEGMENT_CORRUPTED;
+        close(fd);
+        return NULL;
+    }
+    l->data = malloc(l->info.size);
+    if (!l->data) {
+        l->rc = SEGMENT_NO_MEMORY;
+        close(fd);
+        return NULL;
+    }
+    jlong done = 0;
+    while (done < l->info.size) {
+        ssize_t n = read(fd, l->data + done, l->info.size - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+    if (done < l->info.size)
+        return NULL;
+    l->rc = SEGMENT_CORRUPTED;
+    if (crc32c(0, l->data, l->info.size) != l->info.crc)
+        return NULL;
+    const struct segmentHeader *hdr = (const struct segmentHeader *) l->data;
+    if (hdr->magicNumber != MAGIC_SEGMENT_CONSTANT || hdr->segmentNumber != l->segmentNumber || hdr->lastCommittedRef != l->lastCommittedRef)
+        return NULL;
+    jlong offset = sizeof(struct segmentHeader);
+    for (int i = 0; i < l->info.numberOfRecords; ++i) {
+        struct dataEntry entryHdr;
+        if (offset + (jlong)ENTRY_HDR_SIZE > l->info.size)
+            return NULL;
+        segmentRecordAt(l, offset, &entryHdr);
+        if (entryHdr.uncompressedSize < 0 || entryHdr.compressedSize < 0)
+            return NULL;
+        offset += ENTRY_HDR_SIZE + ROUND_UP_FILESIZE((jlong)segmentPayloadSize(&entryHdr));
+    }
+    if (offset != l->info.size)
+        return NULL;
+    l->rc = SEGMENT_OK;
+    return NULL;
+}
+
+// phase 2: copies the records into the allocated entries, and sorts them by the slot range of the final bucket array
+static void *segmentCopyThread(void *arg) {
+    struct segmentLoader *l = arg;
+    const struct map *mapdata = l->mapdata;
+    jlong offset = sizeof(struct segmentHeader);
+    for (int i = 0; i < l->info.numberOfRecords; ++i) {
+        struct dataEntry *e = l->entries[i];
+        const char *payload = segmentRecordAt(l, offset, e);
+        const int payloadSize = segmentPayloadSize(e);
+        memcpy(e->data, payload, payloadSize);
+        offset += ENTRY_HDR_SIZE + ROUND_UP_FILESIZE(payloadSize);
+        e->nextInCommittedView = NULL;
+        if (e->compressedSize)
+            ++l->compressedEntries;
+        if (mapdata->keyHash) {
+            int range = (int)((jlong)((computeHash(e->key) & 0x7fffffff) % mapdata->hashTableSize) * l->numberOfSegments / mapdata->hashTableSize);
+            e->nextSameHash = l->toRange[range];
+            l->toRange[range] = e;
+        } else {
+            e->nextSameHash = NULL;
+        }
+    }
+    return NULL;
+}
+
+// phase 3: links the entries of one slot range of the bucket array, collected from all segments. The loaders form an array
+static void *segmentLinkThread(void *arg) {
+    struct segmentLoader *l = arg;
+    struct segmentLoader *all = l - l->segmentNumber;
+    struct map *mapdata = l->mapdata;
+    for (int i = 0; i < l->numberOfSegments; ++i) {
+        struct dataEntry *e = all[i].toRange[l->segmentNumber];
+        while (e) {
+            struct dataEntry *next = e->nextSameHash;
+            struct dataEntry **slot = &mapdata->keyHash[(computeHash(e->key) & 0x7fffffff) % mapdata->hashTableSize];
+            e->nextSameHash = *slot;
+            *slot = e;
+            e = next;
+        }
+    }
+    return NULL;
+}
+
+// returns the entries allocated so far to the arena, after a failed load
+static void freeSegmentEntries(struct map *mapdata, struct segmentLoader *loaders, int numberOfSegments) {
+    for (int i = 0; i < numberOfSegments; ++i) {
+        struct segmentLoader *l = &loaders[i];
+        jlong offset = sizeof(struct segmentHeader);
+        for (int j = 0; l->entries && j < l->info.numberOfRecords && l->entries[j]; ++j) {
+            struct dataEntry entryHdr;
+            segmentRecordAt(l, offset, &entryHdr);
+            arenaFree(mapdata->arena, l->entries[j], sizeof(struct dataEntry) + ROUND_UP_SIZE(segmentPayloadSize(&entryHdr)));
+            offset += ENTRY_HDR_SIZE + ROUND_UP_FILESIZE(segmentPayloadSize(&entryHdr));
+        }
+    }
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natReadSegmentedFile
+ * Signature: (J[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natReadSegmentedFile
+  (JNIEnv *env, jclass me, jlong cMap, jbyteArray filename) {
+    struct map *mapdata = (struct map *) cMap;
+    if (mapdata->count || (mapdata->committedView && mapdata->committedView->count)) {
+        throwAny(env, "DB is not empty");
+        return;
+    }
+    if (mapdata->modes & IS_INDEX) {
+        throwAny(env, "Segmented dumps are supported for data maps only");
+        return;
+    }
+    char *buffer;
+    char *pathname = allocateBuffers(env, &buffer, filename);
+    if (!pathname)
+        return;  // error
+    FILE *fp = fopen(pathname, "rb");
+    if (!fp) {
+        free(pathname);
+        free(buffer);
+        throwAny(env, "Cannot open file");
+        return;
+    }
+    setvbuf(fp, buffer, _IOFBF, FILEDUMP_BUFFER_SIZE);
+
+    // the manifest
+    struct segmentedDumpHeader hdr;
+    struct segmentInfo infos[SEGMENTS_MAX];
+    char *dictionary = NULL;
+    char *error = NULL;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1)
+        error = "Cannot read file header";
+    else if (hdr.magicNumber != MAGIC_SEGMENTED_CONSTANT)
+        error = "File is not a segmented DB file (bad magic number)";
+    else if (hdr.numberOfSegments < 1 || hdr.numberOfSegments > SEGMENTS_MAX || hdr.numberOfRecords < 0
+      || hdr.dictionarySize < 0 || hdr.dictionarySize > CODEC_MAX_DICTIONARY_SIZE)
+        error = "Corrupted file header";
+    else if (fread(infos, sizeof(struct segmentInfo), hdr.numberOfSegments, fp) != (size_t)hdr.numberOfSegments
+      || (hdr.dictionarySize && (!(dictionary = malloc(ROUND_UP_FILESIZE(hdr.dictionarySize)))
+        || fread(dictionary, ROUND_UP_FILESIZE(hdr.dictionarySize), 1, fp) != 1)))
+        error = "Cannot read the segment table";
+    else if (crc32c(crc32c(0, infos, sizeof(struct segmentInfo) * hdr.numberOfSegments), dictionary, hdr.dictionarySize) != hdr.crc)
+        error = "Corrupted segment table (checksum mismatch)";
+    fclose(fp);
+    free(buffer);
+    jlong total = 0;
+    for (int i = 0; !error && i < hdr.numberOfSegments; ++i) {
+        if (infos[i].numberOfRecords < 0 || infos[i].size < (jlong)sizeof(struct segmentHeader))
+            error = "Corrupted segment table";
+        total += infos[i].numberOfRecords;
+    }
+    if (!error && total != hdr.numberOfRecords)
+        error = "Corrupted segment table";
+    // a map without dictionary adopts the one of the file, if it does not hold compressed entries yet. There is no transcoding
+    struct codec *c = mapdata->codec;
+    jboolean adoptDictionary = hdr.dictionarySize && !c->dictionarySize && !c->compressedEntries;
+    if (!error && hdr.codecId != c->id)
+        error = "Compression codec of the file does not match the map";
+    else if (!error && !adoptDictionary && (hdr.dictionarySize != c->dictionarySize
+      || (hdr.dictionarySize && memcmp(dictionary, c->dictionary, hdr.dictionarySize))))
+        error = "Compression dictionary of the file does not match the map";
+    if (error) {
+        free(dictionary);
+        free(pathname);
+        throwAny(env, error);
+        return;
+    }
+
+    // phase 1: read and verify all segments, in parallel
+    struct segmentLoader loaders[SEGMENTS_MAX];
+    memset(loaders, 0, sizeof(struct segmentLoader) * hdr.numberOfSegments);
+    jboolean noMemory = JNI_FALSE;
+    for (int i = 0; i < hdr.numberOfSegments; ++i) {
+        struct segmentLoader *l = &loaders[i];
+        l->mapdata = mapdata;
+        l->segmentNumber = i;
+        l->numberOfSegments = hdr.numberOfSegments;
+        l->lastCommittedRef = hdr.lastCommittedRef;
+        l->info = infos[i];
+        l->filename = segmentFilename(pathname, i);
+        l->entries = malloc(sizeof(struct dataEntry *) * (infos[i].numberOfRecords ? infos[i].numberOfRecords : 1));
+        noMemory |= !l->filename || !l->entries;
+    }
+    free(pathname);
+    int badSegment = -1;
+    if (!noMemory) {
+        runSegmentThreads(segmentReaderThread, (char *)loaders, sizeof(struct segmentLoader), hdr.numberOfSegments);
+        for (int i = 0; i < hdr.numberOfSegments; ++i) {
+            if (loaders[i].rc == SEGMENT_NO_MEMORY)
+                noMemory = JNI_TRUE;
+            else if (loaders[i].rc != SEGMENT_OK && badSegment < 0)
+                badSegment = i;
+        }
+    }
+
+    // the map is only changed after all segments have been verified
+    if (!noMemory && badSegment < 0 && adoptDictionary && codecSetDictionary(c, dictionary, hdr.dictionarySize))
+        noMemory = JNI_TRUE;
+    free(dictionary);
+    if (!noMemory && badSegment < 0) {
+        // phase 2: allocate the entries (single threaded, as the arena is not thread safe), let the threads copy them
+        struct map *viewdata = mapdata->committedView;
+        resetBuckets(mapdata);
+        presize(mapdata, hdr.numberOfRecords);
+        if (viewdata) {
+            finishResize(viewdata, JNI_TRUE);
+            presize(viewdata, hdr.numberOfRecords);
+        }
+        for (int i = 0; i < hdr.numberOfSegments && !noMemory; ++i) {
+            struct segmentLoader *l = &loaders[i];
+            jlong offset = sizeof(struct segmentHeader);
+            memset(l->entries, 0, sizeof(struct dataEntry *) * l->info.numberOfRecords);
+            for (int j = 0; j < l->info.numberOfRecords; ++j) {
+                struct dataEntry entryHdr;
+                segmentRecordAt(l, offset, &entryHdr);
+                if (!(l->entries[j] = allocEntry(mapdata, segmentPayloadSize(&entryHdr)))) {
+                    noMemory = JNI_TRUE;
+                    break;
+                }
+                offset += ENTRY_HDR_SIZE + ROUND_UP_FILESIZE(segmentPayloadSize(&entryHdr));
+            }
+        }
+        if (noMemory) {
+            freeSegmentEntries(mapdata, loaders, hdr.numberOfSegments);
+        } else {
+            runSegmentThreads(segmentCopyThread, (char *)loaders, sizeof(struct segmentLoader), hdr.numberOfSegments);
+            // phase 3: hash chains are linked by the threads, each into its own range of slots. The other structures are not partitioned
+            if (mapdata->keyHash) {
+                runSegmentThreads(segmentLinkThread, (char *)loaders, sizeof(struct segmentLoader), hdr.numberOfSegments);
+            } else {
+                for (int i = 0; i < hdr.numberOfSegments && !noMemory; ++i) {
+                    for (int j = 0; j < loaders[i].info.numberOfRecords; ++j) {
+                        struct dataEntry *e = loaders[i].entries[j];
+                        if (reserveEntry(mapdata)) {
+                            noMemory = JNI_TRUE;
+                            break;
+                        }
+                        if (mapdata->probe)
+                            probeSet(mapdata->probe, e->key, e);      // cannot fail after the presize
+                        else
+                            treeSet(mapdata->tree, e->key, e);
+                    }
+                }
+            }
+            if (noMemory) {
+                // no entry is kept: the slots must not refer to the freed entries
+                resetBuckets(mapdata);
+                freeSegmentEntries(mapdata, loaders, hdr.numberOfSegments);
+            } else {
+                for (int i = 0; i < hdr.numberOfSegments; ++i)
+                    c->compressedEntries += loaders[i].compressedEntries;
+                mapdata->count = hdr.numberOfRecords;
+                mapdata->lastCommittedRef = hdr.lastCommittedRef;
+                mapdata->changeSequence = hdr.changeSequence;
+                linkViewAfterLoad(mapdata);
+            }
+        }
+    }
+    for (int i = 0; i < hdr.numberOfSegments; ++i) {
+        free(loaders[i].filename);
+        free(loaders[i].data);
+        free(loaders[i].entries);
+    }
+    if (noMemory) {
+        throwOutOfMemory(env);
+    } else if (badSegment >= 0) {
+        char msg[80];
+        snprintf(msg, sizeof(msg), loaders[badSegment].rc == SEGMENT_CANNOT_READ ? "Cannot read segment %d" : "Segment %d is corrupted", badSegment);
+        throwAny(env, msg);
+    }
+}
+
+
+// Pins of the committed views (natPinView): while a view is pinned, commits are not applied to it, such that it can be read
+// by several threads, and at a consistent point. Commits wait until all pins of the views they change have been released, new pins
+// wait while a commit is applied. Pins do not wait for waiting commits, therefore nested pins are allowed.
+// The state is kept per view, pins of one map do not delay commits to others. The pins taken from Java record their thread,
+// and a commit of that thread which changes the view is rejected, as it would wait forever.
+struct viewPin {
+    pthread_t owner;
+    struct viewPin *next;
+};
+
+static void pinView(struct map *view) {
+    pthread_mutex_lock(&view->pinLock);
+    while (view->updating)
+        pthread_cond_wait(&view->pinCond, &view->pinLock);
+    ++view->pins;
+    pthread_mutex_unlock(&view->pinLock);
+}
+
+static void unpinView(struct map *view) {
+    pthread_mutex_lock(&view->pinLock);
+    if (!--view->pins)
+        pthread_cond_broadcast(&view->pinCond);
+    pthread_mutex_unlock(&view->pinLock);
+}
+
+// returns JNI_TRUE if the calling thread holds a pin of the view, taken by natPinView
+static jboolean pinnedByThisThread(struct map *view) {
+    jboolean found = JNI_FALSE;
+    pthread_mutex_lock(&view->pinLock);
+    for (const struct viewPin *p = view->pinOwners; p && !found; p = p->next)
+        found = pthread_equal(p->owner, pthread_self()) != 0;
+    pthread_mutex_unlock(&view->pinLock);
+    return found;
+}
+
+// waits until the view is not pinned, and blocks new pins until endUpdateOfView
+static void beginUpdateOfView(struct map *view) {
+    pthread_mutex_lock(&view->pinLock);
+    while (view->pins || view->updating)
+        pthread_cond_wait(&view->pinCond, &view->pinLock);
+    view->updating = JNI_TRUE;
+    pthread_mutex_unlock(&view->pinLock);
+}
+
+static void endUpdateOfView(struct map *view) {
+    pthread_mutex_lock(&view->pinLock);
+    view->updating = JNI_FALSE;
+    pthread_cond_broadcast(&view->pinCond);
+    pthread_mutex_unlock(&view->pinLock);
+}
+
+void viewUpdateInit(struct viewUpdate *u) {
+    u->views = u->inlineViews;
+    u->count = 0;
+    u->capacity = VIEW_UPDATE_INLINE;
+}
+
+int viewUpdateAdd(struct viewUpdate *u, const struct tx_log_entry *ep) {
+    struct map *view = ep->affected_table->committedView;
+    if (!view || (u->count && u->views[u->count - 1] == view))
+        return 0;       // no view, or the same as for the previous change (the usual case)
+    for (int i = 0; i < u->count; ++i)
+        if (u->views[i] == view)
+            return 0;
+    if (pinnedByThisThread(view))
+        return VIEW_UPDATE_PINNED;
+    if (u->count == u->capacity) {
+        struct map **views = malloc(2 * u->capacity * sizeof(struct map *));
+        if (!views)
+            return VIEW_UPDATE_NO_MEMORY;
+        memcpy(views, u->views, u->count * sizeof(struct map *));
+        if (u->views != u->inlineViews)
+            free(u->views);
+        u->views = views;
+        u->capacity *= 2;
+    }
+    u->views[u->count++] = view;
+    return 0;
+}
+
+void viewUpdateDiscard(struct viewUpdate *u) {
+    if (u->views != u->inlineViews)
+        free(u->views);
+    viewUpdateInit(u);
+}
+
+void beginViewUpdate(struct viewUpdate *u) {
+    for (int i = 0; i < u->count; ++i)
+        beginUpdateOfView(u->views[i]);
+}
+
+void endViewUpdate(struct viewUpdate *u) {
+    for (int i = 0; i < u->count; ++i)
+        endUpdateOfView(u->views[i]);
+    viewUpdateDiscard(u);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natPinView
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natPinView
+  (JNIEnv *env, jclass me, jlong cMap) {
+    struct map *view = (struct map *) cMap;
+    if (!view->isView)
+        return 0L;      // nothing to pin, the map is changed by its own thread only
+    struct viewPin *p = malloc(sizeof(struct viewPin));
+    if (!p) {
+        throwOutOfMemory(env);
+        return 0L;
+    }
+    p->owner = pthread_self();
+    pinView(view);
+    pthread_mutex_lock(&view->pinLock);
+    p->next = view->pinOwners;
+    view->pinOwners = p;
+    pthread_mutex_unlock(&view->pinLock);
+    return (jlong) p;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natUnpinView
+ * Signature: (JJ)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natUnpinView
+  (JNIEnv *env, jclass me, jlong cMap, jlong cPin) {
+    struct map *view = (struct map *) cMap;
+    struct viewPin *p = (struct viewPin *) cPin;
+    if (!p)
+        return;
+    pthread_mutex_lock(&view->pinLock);
+    for (struct viewPin **prev = &view->pinOwners; *prev; prev = &(*prev)->next) {
+        if (*prev == p) {
+            *prev = p->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&view->pinLock);
+    free(p);
+    unpinView(view);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetScanSlots
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetScanSlots
+  (JNIEnv *env, jclass me, jlong cMap) {
+    return numberOfScanSlots((struct map *) cMap);
+}
+
+
+// Multi-version snapshots (natOpenSnapshot) of the committed view of a data map: a snapshot pins the lastCommittedRef of the view.
+// While snapshots are open, commits keep the entries they replace or remove (or a NULL version for inserted keys) in per-key
+// version chains, tagged with the reference of the commit which superseded them. A read at reference ref takes the oldest version
+// superseded after ref, or the current entry of the view if the key has not been changed since.
+// Versions superseded at or before the oldest open snapshot are freed by the writing thread (next commit or natReclaimVersions),
+// as the arena is not thread safe. The lock of the store is held by the commits while they change the view, and by snapshot reads.
+
+struct version {
+    struct version *next;           // next version in the same bucket
+    struct dataEntry *entry;        // the value before the commit, NULL if the key did not exist
+    jlong key;
+    jlong supersededBy;             // reference of the commit which replaced or removed the value
+};
+
+struct snapshot {
+    struct snapshot *next;
+    struct versionStore *store;
+    jlong ref;                      // lastCommittedRef of the view when the snapshot was opened
+    jboolean incomplete;            // a version could not be kept due to lack of memory
+};
+
+struct versionStore {
+    pthread_mutex_t lock;
+    struct map *view;
+    struct snapshot *snapshots;     // open snapshots
+    struct version **buckets;
+    int hashSize;                   // power of 2
+    int numVersions;
+    jboolean reclaim;               // a snapshot has been closed, versions may have become obsolete
+};
+
+#define VERSION_INITIAL_HASH_SIZE   1024
+
+static inline int versionSlot(const struct versionStore *vs, jlong key) {
+    return (int)(((unsigned long long)key * 0x9E3779B97F4A7C15ULL) >> 32) & (vs->hashSize - 1);
+}
+
+static struct versionStore *createVersionStore(struct map *view) {
+    struct versionStore *vs = calloc(1, sizeof(struct versionStore));
+    if (!vs)
+        return NULL;
+    vs->buckets = calloc(VERSION_INITIAL_HASH_SIZE, sizeof(struct version *));
+    if (!vs->buckets) {
+        free(vs);
+        return NULL;
+    }
+    pthread_mutex_init(&vs->lock, NULL);
+    vs->view = view;
+    vs->hashSize = VERSION_INITIAL_HASH_SIZE;
+    return vs;
+}
+
+// frees the bookkeeping only, the entries belong to the arena
+static void destroyVersionStore(struct versionStore *vs) {
+    for (int i = 0; i < vs->hashSize; ++i) {
+        while (vs->buckets[i]) {
+            struct version *v = vs->buckets[i];
+            vs->buckets[i] = v->next;
+            free(v);
+        }
+    }
+    while (vs->snapshots) {
+        struct snapshot *sn = vs->snapshots;
+        vs->snapshots = sn->next;
+        free(sn);
+    }
+    pthread_mutex_destroy(&vs->lock);
+    free(vs->buckets);
+    free(vs);
+}
+
+// doubles the bucket array. Failures are ignored, they just result in longer chains
+static void growVersionStore(struct versionStore *vs) {
+    struct version **oldBuckets = vs->buckets;
+    int oldSize = vs->hashSize;
+    struct version **buckets = calloc(2 * oldSize, sizeof(struct version *));
+    if (!buckets)
+        return;
+    vs->buckets = buckets;
+    vs->hashSize = 2 * oldSize;
+    for (int i = 0; i < oldSize; ++i) {
+        while (oldBuckets[i]) {
+            struct version *v = oldBuckets[i];
+            oldBuckets[i] = v->next;
+            int slot = versionSlot(vs, v->key);
+            v->next = buckets[slot];
+            buckets[slot] = v;
+        }
+    }
+    free(oldBuckets);
+}
+
+// keeps the value of key before the commit ref. Called with the lock held. If no memory is available, the entry is freed,
+// and the open snapshots are marked as incomplete
+static void keepVersion(struct versionStore *vs, jlong key, struct dataEntry *e, jlong ref) {
+    struct version *v = malloc(sizeof(struct version));
+    if (!v) {
+        for (struct snapshot *sn = vs->snapshots; sn; sn = sn->next)
+            sn->incomplete = JNI_TRUE;
+        if (e)
+            freeEntry(vs->view, e);
+        return;
+    }
+    if (vs->numVersions >= 2 * vs->hashSize)
+        growVersionStore(vs);
+    int slot = versionSlot(vs, key);
+    v->entry = e;
+    v->key = key;
+    v->supersededBy = ref;
+    v->next = vs->buckets[slot];
+    vs->buckets[slot] = v;
+    ++vs->numVersions;
+}
+
+// returns the version of key valid at ref, or NULL if the current entry of the view applies. Called with the lock held
+static const struct version *findVersion(const struct versionStore *vs, jlong key, jlong ref) {
+    const struct version *found = NULL;
+    for (const struct version *v = vs->buckets[versionSlot(vs, key)]; v; v = v->next)
+        if (v->key == key && v->supersededBy > ref && (!found || v->supersededBy < found->supersededBy))
+            found = v;
+    return found;
+}
+
+// frees the versions which no open snapshot reads any more. Called by the writing thread, with the lock held.
+// Returns the number of versions freed
+static int reclaimVersions(struct versionStore *vs) {
+    jlong oldest = 0x7fffffffffffffffLL;
+    for (const struct snapshot *sn = vs->snapshots; sn; sn = sn->next)
+        if (sn->ref < oldest)
+            oldest = sn->ref;
+    int freed = 0;
+    for (int i = 0; i < vs->hashSize; ++i) {
+        struct version **prev = &vs->buckets[i];
+        while (*prev) {
+            struct version *v = *prev;
+            if (v->supersededBy <= oldest) {
+                *prev = v->next;
+                if (v->entry)
+                    freeEntry(vs->view, v->entry);
+                free(v);
+                ++freed;
+            } else {
+                prev = &v->next;
+            }
+        }
+    }
+    vs->numVersions -= freed;
+    vs->reclaim = JNI_FALSE;
+    return freed;
+}
+
+// opens a snapshot of view, or returns NULL if no memory is available. If entries is not NULL, the entries of the view are
+// collected into a new array at the same point, and their number is stored in *count
+static struct snapshot *openSnapshot(struct map *view, struct dataEntry ***entries, int *count) {
+    struct snapshot *sn = malloc(sizeof(struct snapshot));
+    struct dataEntry **collected = entries ? malloc(sizeof(struct dataEntry *) * (view->count ? view->count : 1)) : NULL;
+    if (!sn || (entries && !collected)) {
+        free(sn);
+        free(collected);
+        return NULL;
+    }
+    // not while a commit is applied, in order to see all or nothing of it
+    pthread_mutex_lock(&view->pinLock);
+    while (view->updating)
+        pthread_cond_wait(&view->pinCond, &view->pinLock);
+    if (!view->versions)
+        view->versions = createVersionStore(view);
+    struct versionStore *vs = view->versions;
+    if (vs) {
+        pthread_mutex_lock(&vs->lock);
+        sn->store = vs;
+        sn->ref = view->lastCommittedRef;
+        sn->incomplete = JNI_FALSE;
+        sn->next = vs->snapshots;
+        vs->snapshots = sn;
+        pthread_mutex_unlock(&vs->lock);
+        if (entries) {
+            int n = 0;
+            for (int i = 0; i < numberOfScanSlots(view); ++i)
+                for (struct dataEntry *e = scanSlot(view, i); e && n < view->count; e = e->nextInCommittedView)
+                    collected[n++] = e;
+            *entries = collected;
+            *count = n;
+        }
+    }
+    pthread_mutex_unlock(&view->pinLock);
+    if (!vs) {
+        free(sn);
+        free(collected);
+        return NULL;
+    }
+    return sn;
+}
+
+// closes a snapshot, from any thread. The versions it needed are freed by the writing thread later
+static void closeSnapshot(struct snapshot *sn) {
+    struct versionStore *vs = sn->store;
+    pthread_mutex_lock(&vs->lock);
+    struct snapshot **prev = &vs->snapshots;
+    while (*prev != sn)
+        prev = &(*prev)->next;
+    *prev = sn->next;
+    vs->reclaim = JNI_TRUE;
+    pthread_mutex_unlock(&vs->lock);
+    free(sn);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natOpenSnapshot
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natOpenSnapshot
+  (JNIEnv *env, jclass me, jlong cMap) {
+    struct map *mapdata = (struct map *) cMap;
+    struct map *view = mapdata->committedView;
+    if (!view || (mapdata->modes & IS_INDEX)) {
+        throwAny(env, "Snapshots require a data map with a committed view");
+        return (jlong)0;
+    }
+    struct snapshot *sn = openSnapshot(view, NULL, NULL);
+    if (!sn)
+        throwOutOfMemory(env);
+    return (jlong)sn;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natReclaimVersions
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natReclaimVersions
+  (JNIEnv *env, jclass me, jlong cMap) {
+    struct map *view = ((struct map *) cMap)->committedView;
+    if (!view || !view->versions)
+        return 0;
+    pthread_mutex_lock(&view->versions->lock);
+    int freed = reclaimVersions(view->versions);
+    pthread_mutex_unlock(&view->versions->lock);
+    return freed;
+}
+
+// returns the entry of key as seen by the snapshot, or NULL. Called with the lock held
+static struct dataEntry *snapshotEntry(JNIEnv *env, const struct snapshot *sn, jlong key) {
+    if (sn->incomplete) {
+        throwAny(env, "Snapshot is incomplete due to lack of memory");
+        return NULL;
+    }
+    const struct version *v = findVersion(sn->store, key, sn->ref);
+    return v ? v->entry : findCommittedEntry(sn->store->view, key);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapSnapshot
+ * Method:    natGet
+ * Signature: (JJ)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_OffHeapSnapshot_natGet
+  (JNIEnv *env, jclass me, jlong cSnapshot, jlong key) {
+    struct snapshot *sn = (struct snapshot *) cSnapshot;
+    pthread_mutex_lock(&sn->store->lock);
+    jbyteArray result = toJavaByteArray(env, sn->store->view, snapshotEntry(env, sn, key));
+    pthread_mutex_unlock(&sn->store->lock);
+    return result;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapSnapshot
+ * Method:    natLength
+ * Signature: (JJ)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_OffHeapSnapshot_natLength
+  (JNIEnv *env, jclass me, jlong cSnapshot, jlong key) {
+    struct snapshot *sn = (struct snapshot *) cSnapshot;
+    pthread_mutex_lock(&sn->store->lock);
+    const struct dataEntry *e = snapshotEntry(env, sn, key);
+    jint length = e ? e->uncompressedSize : -1;
+    pthread_mutex_unlock(&sn->store->lock);
+    return length;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapSnapshot
+ * Method:    natGetRef
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_OffHeapSnapshot_natGetRef
+  (JNIEnv *env, jclass me, jlong cSnapshot) {
+    return ((struct snapshot *) cSnapshot)->ref;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapSnapshot
+ * Method:    natClose
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapSnapshot_natClose
+  (JNIEnv *env, jclass me, jlong cSnapshot) {
+    closeSnapshot((struct snapshot *) cSnapshot);
+}
+
+
+// Background dumps (natStartBackgroundDump) of the committed view of a data map: the entries of the view are collected at a
+// consistent point, between two commits, and a snapshot keeps the entries which are replaced or removed by later commits alive
+// until the dump has been written. The file is written by a native thread, in the format of natWriteToFile, while commits continue.
+// The entries are immutable, and compressed ones are written as they are, therefore the thread does not need the map otherwise.
+
+#define DUMP_RUNNING            0
+#define DUMP_DONE               1
+#define DUMP_FAILED             -1
+#define DUMP_PROGRESS_INTERVAL  1024    // records between updates of the progress
+
+struct backgroundDump {
+    pthread_t thread;
+    struct snapshot *snapshot;          // keeps the collected entries alive, closed by the thread once done
+    struct dataEntry **entries;
+    struct filedumpHeader hdr;
+    char *dictionary;                   // copy of the codec dictionary, as it may be replaced meanwhile
+    struct dumpWriter writer;
+    int recordsWritten;                 // updated atomically, read by other threads
+    int status;                         // DUMP_*, updated atomically
+    int error;                          // errno of the failure, or WRITER_SHORT_WRITE
+    jboolean joined;
+};
+
+static void *backgroundDumpWorker(void *arg) {
+    struct backgroundDump *d = arg;
+    writerPut(&d->writer, &d->hdr, sizeof(d->hdr));
+    if (d->hdr.dictionarySize)
+        writerPut(&d->writer, d->dictionary, d->hdr.dictionarySize);
+    for (int i = 0; i < d->hdr.numberOfRecords; ++i) {
+        const struct dataEntry *e = d->entries[i];
+        int finalSize = ENTRY_HDR_SIZE + (e->compressedSize ? e->compressedSize : e->uncompressedSize);
+        writerPut(&d->writer, &(e->uncompressedSize), finalSize);
+        if (!((i + 1) % DUMP_PROGRESS_INTERVAL))
+            __atomic_store_n(&d->recordsWritten, i + 1, __ATOMIC_RELEASE);
+    }
+    closeSnapshot(d->snapshot);         // the entries are not needed any more
+    d->snapshot = NULL;
+    d->error = writerClose(&d->writer, NULL, 0);
+    int status = d->error ? DUMP_FAILED : DUMP_DONE;
+    __atomic_store_n(&d->recordsWritten, d->hdr.numberOfRecords, __ATOMIC_RELEASE);
+    __atomic_store_n(&d->status, status, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void freeBackgroundDump(struct backgroundDump *d) {
+    if (d->snapshot)
+        closeSnapshot(d->snapshot);
+    free(d->entries);
+    free(d->dictionary);
+    free(d);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natStartBackgroundDump
+ * Signature: (J[B)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natStartBackgroundDump
+  (JNIEnv *env, jclass me, jlong cMap, jbyteArray filename) {
+    struct map *mapdata = (struct map *) cMap;
+    struct map *view = mapdata->committedView;
+    if (!view || (mapdata->modes & IS_INDEX)) {
+        throwAny(env, "Background dumps require a data map with a committed view");
+        return (jlong)0;
+    }
+    struct backgroundDump *d = calloc(1, sizeof(struct backgroundDump));
+    if (!d) {
+        throwOutOfMemory(env);
+        return (jlong)0;
+    }
+    if (openDumpWriter(env, &d->writer, filename, WRITER_MAX_BUFFERS)) {
+        free(d);
+        return (jlong)0;  // error
+    }
+    // the dictionary only changes by calls of the writing thread, i.e. this one
+    d->hdr.magicNumber = MAGIC_DB_SEQUENCE_CONSTANT;
+    d->hdr.changeSequence = mapdata->changeSequence;
+    d->hdr.codecId = view->codec->id;
+    d->hdr.dictionarySize = view->codec->dictionarySize;
+    if (d->hdr.dictionarySize && (d->dictionary = malloc(d->hdr.dictionarySize)))
+        memcpy(d->dictionary, view->codec->dictionary, d->hdr.dictionarySize);
+    int count = 0;
+    if ((d->hdr.dictionarySize && !d->dictionary) || !(d->snapshot = openSnapshot(view, &d->entries, &count))) {
+        writerClose(&d->writer, NULL, 0);
+        freeBackgroundDump(d);
+        throwOutOfMemory(env);
+        return (jlong)0;
+    }
+    d->hdr.numberOfRecords = count;
+    d->hdr.lastCommittedRef = d->snapshot->ref;
+    if (pthread_create(&d->thread, NULL, backgroundDumpWorker, d)) {
+        writerClose(&d->writer, NULL, 0);
+        freeBackgroundDump(d);
+        throwAny(env, "Cannot start the dump thread");
+        return (jlong)0;
+    }
+    return (jlong)d;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapDump
+ * Method:    natGetProgress
+ * Signature: (J[J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapDump_natGetProgress
+  (JNIEnv *env, jclass me, jlong cDump, jlongArray progress) {
+    const struct backgroundDump *d = (const struct backgroundDump *) cDump;
+    jlong values[3];
+    values[0] = __atomic_load_n(&d->recordsWritten, __ATOMIC_ACQUIRE);
+    values[1] = d->hdr.numberOfRecords;
+    values[2] = __atomic_load_n(&d->status, __ATOMIC_ACQUIRE);
+    (*env)->SetLongArrayRegion(env, progress, 0, 3, values);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapDump
+ * Method:    natAwait
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapDump_natAwait
+  (JNIEnv *env, jclass me, jlong cDump) {
+    struct backgroundDump *d = (struct backgroundDump *) cDump;
+    if (!d->joined) {
+        pthread_join(d->thread, NULL);
+        d->joined = JNI_TRUE;
+    }
+    if (d->status == DUMP_FAILED) {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "Background dump failed: %s", d->error > 0 ? strerror(d->error) : "short write");
+        throwAny(env, msg);
+    }
+}
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapDump
+ * Method:    natClose
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapDump_natClose
+  (JNIEnv *env, jclass me, jlong cDump) {
+    struct backgroundDump *d = (struct backgroundDump *) cDump;
+    if (!d->joined)
+        pthread_join(d->thread, NULL);
+    freeBackgroundDump(d);
+}
+
+
+// Delta checkpoints (natWriteDeltaFile) of data maps: the entries of the keys changed since the previous checkpoint (see struct changeSet),
+// or tombstones for the removed keys, written in the record format of natWriteToFile. The header holds the range of commit references
+// covered. A full dump (base) followed by a chain of deltas is restored by natReadFromFile and natApplyDeltaFile. A delta follows a state
+// if its fromRef is not newer than the lastCommittedRef of the state, as applying a change again does not alter the result.
+// Changes without a transaction do not advance lastCommittedRef, they are ordered by the changeSequence of the map, in the same way.
+// natMergeCheckpoint folds a base and a chain of deltas into a new base, streaming the base, with only the deltas held in memory.
+// The data map of transactional maps holds the uncommitted changes as well, therefore their deltas are written from the committed view.
+
+#define MAGIC_DELTA_CONSTANT    0x28346302
+#define DELTA_TOMBSTONE         -1          // uncompressedSize of the records of removed keys, which have no data
+
+struct deltaDumpHeader {
+    int magicNumber;
+    int numberOfRecords;        // upserts and tombstones
+    int codecId;
+    int dictionarySize;         // size of the codec dictionary, which follows the header (padded to a multiple of 8)
+    jlong fromRef;              // the changes of the commits after this reference...
+    jlong lastCommittedRef;     // ...up to this one
+    jlong fromSequence;         // the changes without a transaction after this changeSequence...
+    jlong changeSequence;       // ...up to this one
+};
+
+// a delta file read into memory
+struct deltaFile {
+    struct deltaDumpHeader hdr;
+    char *data;                 // the whole file
+    jlong size;
+    const char *dictionary;
+    jlong recordsOffset;
+};
+
+static inline int deltaPayloadSize(const struct dataEntry *entryHdr) {
+    if (entryHdr->uncompressedSize == DELTA_TOMBSTONE)
+        return 0;
+    return entryHdr->compressedSize ? entryHdr->compressedSize : entryHdr->uncompressedSize;
+}
+
+// reads a delta file and verifies its records. Returns NULL if OK, else the error message
+static char *readDeltaFile(const char *filename, struct deltaFile *d) {
+    memset(d, 0, sizeof(struct deltaFile));
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0)
+        return "Cannot open file";
+    if (fstat(fd, &st) || st.st_size < (off_t)sizeof(struct deltaDumpHeader) || !(d->data = malloc(st.st_size))) {
+        close(fd);
+        return st.st_size < (off_t)sizeof(struct deltaDumpHeader) ? "File is not a delta file" : "Out of off-heap memory in JNI call";
+    }
+    d->size = st.st_size;
+    jlong done = 0;
+    while (done < d->size) {
+        ssize_t n = read(fd, d->data + done, d->size - done);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    close(fd);
+    if (done < d->size)
+        return "Cannot read the file";
+    memcpy(&d->hdr, d->data, sizeof(struct deltaDumpHeader));
+    if (d->hdr.magicNumber != MAGIC_DELTA_CONSTANT)
+        return "File is not a delta file (bad magic number)";
+    if (d->hdr.numberOfRecords < 0 || d->hdr.dictionarySize < 0 || d->hdr.dictionarySize > CODEC_MAX_DICTIONARY_SIZE
+      || d->hdr.fromRef > d->hdr.lastCommittedRef || d->hdr.fromSequence > d->hdr.changeSequence)
+        return "Corrupted file header";
+    d->dictionary = d->data + ROUND_UP_FILESIZE(sizeof(struct deltaDumpHeader));
+    d->recordsOffset = ROUND_UP_FILESIZE(sizeof(struct deltaDumpHeader)) + ROUND_UP_FILESIZE(d->hdr.dictionarySize);
+    jlong offset = d->recordsOffset;
+    for (int i = 0; i < d->hdr.numberOfRecords; ++i) {
+        struct dataEntry entryHdr;
+        if (offset + (jlong)ENTRY_HDR_SIZE > d->size)
+            return "Corrupted delta file";
+        memcpy(&(entryHdr.uncompressedSize), d->data + offset, ENTRY_HDR_SIZE);
+        if ((entryHdr.uncompressedSize < 0 && entryHdr.uncompressedSize != DELTA_TOMBSTONE) || entryHdr.compressedSize < 0)
+            return "Corrupted delta file";
+        offset += ENTRY_HDR_SIZE + ROUND_UP_FILESIZE(deltaPayloadSize(&entryHdr));
+    }
+    return offset == d->size ? NULL : "Corrupted delta file";
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natEnableChangeTracking
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natEnableChangeTracking
+  (JNIEnv *env, jclass me, jlong cMap) {
+    struct map *mapdata = (struct map *) cMap;
+    if (mapdata->modes & IS_INDEX) {
+        throwAny(env, "Delta checkpoints are supported for data maps only");
+        return;
+    }
+    if ((mapdata->modes & TRANSACTIONAL) && !mapdata->committedView) {
+        throwAny(env, "Delta checkpoints of transactional maps require a committed view");
+        return;
+    }
+    if (!mapdata->changes) {
+        struct changeSet *c = malloc(sizeof(struct changeSet));
+        if (!c || !(c->keys = probeCreate(1024))) {
+            free(c);
+            throwOutOfMemory(env);
+            return;
+        }
+        mapdata->changes = c;
+    }
+    probeClear(mapdata->changes->keys);
+    mapdata->changes->fromRef = mapdata->lastCommittedRef;
+    mapdata->changes->fromSequence = mapdata->changeSequence;
+    mapdata->changes->incomplete = JNI_FALSE;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natWriteDeltaFile
+ * Signature: (J[BZ)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natWriteDeltaFile
+  (JNIEnv *env, jclass me, jlong cMap, jbyteArray filename, jboolean fromCommittedView) {
+    struct map *mapdata = (struct map *) cMap;
+    struct changeSet *c = mapdata->changes;
+    if (!c) {
+        throwAny(env, "Change tracking is not enabled");
+        return 0;
+    }
+    if (c->incomplete) {
+        throwAny(env, "Changes have not been tracked completely, a full checkpoint is required");
+        return 0;
+    }
+    if ((mapdata->modes & TRANSACTIONAL) && !(fromCommittedView && mapdata->committedView)) {
+        throwAny(env, "Delta checkpoints of transactional maps are written from the committed view");
+        return 0;
+    }
+    struct dumpWriter w;
+    if (openDumpWriter(env, &w, filename, WRITER_MAX_BUFFERS))
+        return 0;  // error
+    struct map *source = fromCommittedView && mapdata->committedView ? mapdata->committedView : mapdata;
+    if (source != mapdata)
+        pinView(source);    // no commit changes the view or the tracked keys meanwhile
+
+    struct deltaDumpHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magicNumber = MAGIC_DELTA_CONSTANT;
+    hdr.codecId = source->codec->id;
+    hdr.dictionarySize = source->codec->dictionarySize;
+    hdr.fromRef = c->fromRef;
+    hdr.lastCommittedRef = source->lastCommittedRef;
+    hdr.fromSequence = c->fromSequence;
+    hdr.changeSequence = mapdata->changeSequence;
+    writerPut(&w, &hdr, sizeof(hdr));        // rewritten at the end
+    if (hdr.dictionarySize)
+        writerPut(&w, source->codec->dictionary, hdr.dictionarySize);
+    for (int i = 0; i < probeScanSlots(c->keys); ++i) {
+        if (!probeScanSlot(c->keys, i))
+            continue;
+        jlong key = probeScanKey(c->keys, i);
+        const struct dataEntry *e = source == mapdata ? find_entry(mapdata, key) : findCommittedEntry(source, key);
+        if (e) {
+            writerPut(&w, &(e->uncompressedSize), ENTRY_HDR_SIZE + (e->compressedSize ? e->compressedSize : e->uncompressedSize));
+        } else {
+            struct dataEntry tombstone;
+            tombstone.uncompressedSize = DELTA_TOMBSTONE;
+            tombstone.compressedSize = 0;
+            tombstone.key = key;
+            writerPut(&w, &(tombstone.uncompressedSize), ENTRY_HDR_SIZE);
+        }
+        ++hdr.numberOfRecords;
+    }
+    int rc = writerClose(&w, &hdr, sizeof(hdr));
+    if (!rc) {
+        // the next delta continues here. After a failure, the changes are kept for the next attempt
+        probeClear(c->keys);
+        c->fromRef = hdr.lastCommittedRef;
+        c->fromSequence = hdr.changeSequence;
+    }
+    if (source != mapdata)
+        unpinView(source);
+    if (rc) {
+        throwWriteError(env, rc, "Cannot write the file");
+        return 0;
+    }
+    return hdr.numberOfRecords;
+}
+
+// checks that the codec and dictionary of a file match the map, or adopts the dictionary. Returns NULL if OK, else the error message
+static char *checkFileCodec(struct codec *c, int codecId, const char *dictionary, int dictionarySize) {
+    if (codecId != c->id)
+        return "Compression codec of the file does not match the map";
+    if (dictionarySize && !c->dictionarySize && !c->compressedEntries)
+        return codecSetDictionary(c, dictionary, dictionarySize) ? "Out of off-heap memory in JNI call" : NULL;
+    if (dictionarySize != c->dictionarySize || (dictionarySize && memcmp(dictionary, c->dictionary, dictionarySize)))
+        return "Compression dictionary of the file does not match the map";
+    return NULL;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natApplyDeltaFile
+ * Signature: (J[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natApplyDeltaFile
+  (JNIEnv *env, jclass me, jlong cMap, jbyteArray filename) {
+    struct map *mapdata = (struct map *) cMap;
+    struct map *view = mapdata->committedView;
+    if (mapdata->modes & IS_INDEX) {
+        throwAny(env, "Delta checkpoints are supported for data maps only");
+        return;
+    }
+    if (mapdata->indexRules) {
+        throwAny(env, "Deltas cannot be applied to a map with attached indexes");
+        return;
+    }
+    if (view && pinnedByThisThread(view)) {
+        throwAny(env, "The committed view is pinned by this thread");
+        return;
+    }
+    char *filenameBuffer = filenameFromJava(env, filename);
+    if (!filenameBuffer)
+        return;  // error
+    struct deltaFile d;
+    char *error = readDeltaFile(filenameBuffer, &d);
+    free(filenameBuffer);
+    if (!error && (d.hdr.fromRef > mapdata->lastCommittedRef || d.hdr.fromSequence > mapdata->changeSequence))
+        error = "Delta does not follow the state of the map (changes are missing)";
+    if (!error && (d.hdr.lastCommittedRef < mapdata->lastCommittedRef || d.hdr.changeSequence < mapdata->changeSequence))
+        error = "Delta is older than the state of the map";
+    if (!error)
+        error = checkFileCodec(mapdata->codec, d.hdr.codecId, d.dictionary, d.hdr.dictionarySize);
+    if (error) {
+        free(d.data);
+        throwAny(env, error);
+        return;
+    }
+
+    // the file has been verified completely, apply it to the map and to its committed view
+    struct versionStore * const vs = view ? view->versions : NULL;
+    if (view)
+        beginUpdateOfView(view);
+    if (vs)
+        pthread_mutex_lock(&vs->lock);
+    if (vs && vs->snapshots)
+        error = "Deltas cannot be applied while snapshots are open";
+    jboolean noMemory = JNI_FALSE;
+    jlong offset = d.recordsOffset;
+    for (int i = 0; i < d.hdr.numberOfRecords && !error && !noMemory; ++i) {
+        struct dataEntry entryHdr;
+        memcpy(&(entryHdr.uncompressedSize), d.data + offset, ENTRY_HDR_SIZE);
+        struct dataEntry *old, *oldInView = NULL;
+        if (entryHdr.uncompressedSize == DELTA_TOMBSTONE) {
+            old = unlinkEntry(mapdata, entryHdr.key, computeHash(entryHdr.key));
+            if (view)
+                oldInView = unlinkShadowEntry(view, &entryHdr);
+        } else {
+            const int payloadSize = deltaPayloadSize(&entryHdr);
+            struct dataEntry *e = allocEntry(mapdata, payloadSize);
+            if (!e || reserveEntry(mapdata) || (view && reserveEntry(view))) {
+                if (e)
+                    arenaFree(mapdata->arena, e, sizeof(struct dataEntry) + ROUND_UP_SIZE(payloadSize));
+                noMemory = JNI_TRUE;        // the records applied so far stay, lastCommittedRef is not changed
+                break;
+            }
+            e->uncompressedSize = entryHdr.uncompressedSize;
+            e->compressedSize = entryHdr.compressedSize;
+            e->key = entryHdr.key;
+            memcpy(e->data, d.data + offset + ENTRY_HDR_SIZE, payloadSize);
+            if (e->compressedSize)
+                ++mapdata->codec->compressedEntries;
+            old = setPutSub(mapdata, e);
+            if (view)
+                oldInView = setPutSubShadow(view, e);
+        }
+        if (old)
+            freeEntry(mapdata, old);
+        if (oldInView && oldInView != old)
+            freeEntry(mapdata, oldInView);
+        if (mapdata->changes)
+            trackChange(mapdata, entryHdr.key);
+        offset += ENTRY_HDR_SIZE + ROUND_UP_FILESIZE(deltaPayloadSize(&entryHdr));
+    }
+    if (!error && !noMemory) {
+        mapdata->lastCommittedRef = d.hdr.lastCommittedRef;
+        mapdata->changeSequence = d.hdr.changeSequence;
+        if (view)
+            view->lastCommittedRef = d.hdr.lastCommittedRef;
+    }
+    if (vs)
+        pthread_mutex_unlock(&vs->lock);
+    if (view)
+        endUpdateOfView(view);
+    free(d.data);
+    if (error)
+        throwAny(env, error);
+    else if (noMemory)
+        throwOutOfMemory(env);
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natMergeCheckpoint
+ * Signature: ([B[[B[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natMergeCheckpoint
+  (JNIEnv *env, jclass me, jbyteArray baseFilename, jobjectArray deltaFilenames, jbyteArray targetFilename) {
+    int numDeltas = (*env)->GetArrayLength(env, deltaFilenames);
+    struct deltaFile *deltas = calloc(numDeltas ? numDeltas : 1, sizeof(struct deltaFile));
+    struct probeMap *latest = probeCreate(1024);       // key => the record of the last delta which contains it
+    char *buffer;
+    char *baseName = deltas && latest ? allocateBuffers(env, &buffer, baseFilename) : NULL;
+    if (!baseName) {
+        if (!deltas || !latest)
+            throwOutOfMemory(env);
+        free(deltas);
+        if (latest)
+            probeDestroy(latest);
+        return;
+    }
+    FILE *fp = fopen(baseName, "rb");
+    free(baseName);
+    struct filedumpHeader hdr;
+    char *dictionary = NULL;
+    char *error = NULL;
+    if (!fp)
+        error = "Cannot open file";
+    else {
+        setvbuf(fp, buffer, _IOFBF, FILEDUMP_BUFFER_SIZE);
+        if (readFiledumpHeader(fp, &hdr))
+            error = "Base file is not a DB file";
+        else if (hdr.numberOfRecords < 0 || hdr.dictionarySize < 0 || hdr.dictionarySize > CODEC_MAX_DICTIONARY_SIZE
+          || (hdr.dictionarySize && (!(dictionary = malloc(ROUND_UP_FILESIZE(hdr.dictionarySize)))
+            || fread(dictionary, ROUND_UP_FILESIZE(hdr.dictionarySize), 1, fp) != 1)))
+            error = "Cannot read the compression dictionary";
+    }
+    // the deltas, in the order of the chain. The records are copied as they are, therefore the codec and dictionary must match
+    jlong lastRef = error ? 0 : hdr.lastCommittedRef;
+    jlong lastSequence = error ? 0 : hdr.changeSequence;
+    for (int i = 0; i < numDeltas && !error; ++i) {
+        jbyteArray name = (*env)->GetObjectArrayElement(env, deltaFilenames, i);
+        char *deltaName = filenameFromJava(env, name);
+        (*env)->DeleteLocalRef(env, name);
+        if (!deltaName) {
+            error = "";         // thrown already
+            break;
+        }
+        struct deltaFile *d = &deltas[i];
+        error = readDeltaFile(deltaName, d);
+        free(deltaName);
+        if (!error && (d->hdr.fromRef > lastRef || d->hdr.lastCommittedRef < lastRef
+          || d->hdr.fromSequence > lastSequence || d->hdr.changeSequence < lastSequence))
+            error = "Delta does not follow the base or the previous delta";
+        if (!error && (d->hdr.codecId != hdr.codecId || d->hdr.dictionarySize != hdr.dictionarySize
+          || (hdr.dictionarySize && memcmp(d->dictionary, dictionary, hdr.dictionarySize))))
+            error = "Compression codec or dictionary of a delta does not match the base";
+        if (error)
+            break;
+        lastRef = d->hdr.lastCommittedRef;
+        lastSequence = d->hdr.changeSequence;
+        jlong offset = d->recordsOffset;
+        for (int j = 0; j < d->hdr.numberOfRecords; ++j) {
+            struct dataEntry entryHdr;
+            memcpy(&(entryHdr.uncompressedSize), d->data + offset, ENTRY_HDR_SIZE);
+            if (probeReserve(latest)) {
+                error = "Out of off-heap memory in JNI call";
+                break;
+            }
+            probeSet(latest, entryHdr.key, d->data + offset);
+            offset += ENTRY_HDR_SIZE + ROUND_UP_FILESIZE(deltaPayloadSize(&entryHdr));
+        }
+    }
+
+    // stream the base, replacing or dropping the changed keys, then append the new keys
+    struct dumpWriter w;
+    int rc = 0;
+    if (!error && openDumpWriter(env, &w, targetFilename, WRITER_MAX_BUFFERS))
+        error = "";             // thrown already
+    if (!error) {
+        struct filedumpHeader newHdr = hdr;
+        newHdr.numberOfRecords = 0;
+        newHdr.magicNumber = MAGIC_DB_SEQUENCE_CONSTANT;
+        newHdr.lastCommittedRef = lastRef;
+        newHdr.changeSequence = lastSequence;
+        writerPut(&w, &newHdr, sizeof(newHdr));        // rewritten at the end
+        if (hdr.dictionarySize)
+            writerPut(&w, dictionary, hdr.dictionarySize);
+        char *data = NULL;
+        int dataSize = 0;
+        for (int i = 0; i < hdr.numberOfRecords && !error; ++i) {
+            struct dataEntry entryHdr;
+            if (fread(&(entryHdr.uncompressedSize), ENTRY_HDR_SIZE, 1, fp) != 1) {
+                error = "Cannot read entry header";
+                break;
+            }
+            const int payloadSize = entryHdr.compressedSize ? entryHdr.compressedSize : entryHdr.uncompressedSize;
+            if (entryHdr.uncompressedSize < 0 || payloadSize < 0) {
+                error = "Corrupted base file";
+                break;
+            }
+            if (ROUND_UP_FILESIZE(payloadSize) > dataSize) {
+                free(data);
+                dataSize = ROUND_UP_FILESIZE(payloadSize);
+                if (!(data = malloc(dataSize))) {
+                    error = "Out of off-heap memory in JNI call";
+                    break;
+                }
+            }
+            if (payloadSize && fread(data, ROUND_UP_FILESIZE(payloadSize), 1, fp) != 1) {
+                error = "Cannot read entry data";
+                break;
+            }
+            const char *record = probeRemove(latest, entryHdr.key);
+            if (record) {
+                // changed by a delta: replaced by its record, or dropped for a tombstone
+                memcpy(&(entryHdr.uncompressedSize), record, ENTRY_HDR_SIZE);
+                if (entryHdr.uncompressedSize != DELTA_TOMBSTONE) {
+                    writerPut(&w, record, ENTRY_HDR_SIZE + deltaPayloadSize(&entryHdr));
+                    ++newHdr.numberOfRecords;
+                }
+            } else {
+                writerPut(&w, &(entryHdr.uncompressedSize), ENTRY_HDR_SIZE);
+                if (payloadSize)
+                    writerPut(&w, data, payloadSize);
+                ++newHdr.numberOfRecords;
+            }
+        }
+        free(data);
+        for (int i = 0; i < probeScanSlots(latest) && !error; ++i) {
+            const char *record = probeScanSlot(latest, i);
+            struct dataEntry entryHdr;
+            if (!record)
+                continue;
+            memcpy(&(entryHdr.uncompressedSize), record, ENTRY_HDR_SIZE);
+            if (entryHdr.uncompressedSize != DELTA_TOMBSTONE) {
+                writerPut(&w, record, ENTRY_HDR_SIZE + deltaPayloadSize(&entryHdr));
+                ++newHdr.numberOfRecords;
+            }
+        }
+        rc = writerClose(&w, error ? NULL : &newHdr, sizeof(newHdr));
+    }
+    if (fp)
+        fclose(fp);
+    free(buffer);
+    free(dictionary);
+    for (int i = 0; i < numDeltas; ++i)
+        free(deltas[i].data);
+    free(deltas);
+    probeDestroy(latest);
+    if (error && *error)
+        throwAny(env, error);
+    else if (!error && rc)
+        throwWriteError(env, rc, "Cannot write the file");
+}
+
+
+// class member functions....
+
+void commitToView(struct tx_log_entry *ep, jlong transactionReference) {
+    ep->affected_table->lastCommittedRef = transactionReference;
+    if (ep->affected_table->changes)
+        trackChange(ep->affected_table, ep->new_entry ? ep->new_entry->key : ep->old_entry->key);
+    struct map *view = ep->affected_table->committedView;
+    if (logsCopies(ep->affected_table)) {
+        // the log entries of compact and posting list index maps are copies, which are not needed after the replay
+        if (view) {
+            applyIndexChange(view, ep->old_entry, ep->new_entry, "REDO");
+            view->lastCommittedRef = transactionReference;
+        }
+        if (ep->old_entry)
+            freeEntry(ep->affected_table, ep->old_entry);
+        if (ep->new_entry)
+            freeEntry(ep->affected_table, ep->new_entry);
+        return;
+    }
+    if (!view) {
+        // no shadow: simple rule: discard old entry.
+        struct dataEntry *e = ep->old_entry;
+        if (e)
+            freeEntry(ep->affected_table, e);
+    } else {
+        // have secondary view. Do not discard old entry, because we either still need it, or we discard it within a recursive call
+        // we have a view, and are asked to replay the tx on it
+        struct versionStore * const vs = view->versions;
+        if (vs) {
+            pthread_mutex_lock(&vs->lock);      // snapshot reads must not see the view while it is relinked
+            if (vs->reclaim)
+                reclaimVersions(vs);
+        }
+        const jboolean keep = vs && vs->snapshots;  // keep the old values for the open snapshots
+        if (!ep->new_entry) {
+            // was a remove => remove it on the view (which frees the old data)
+            if (!keep)
+                execRemoveShadow(view, ep->old_entry);
+            else {
+                struct dataEntry * const e = unlinkShadowEntry(view, ep->old_entry);
+                if (e)
+                    keepVersion(vs, e->key, e, transactionReference);
+            }
+        } else if (reserveEntry(view)) {
+            fprintf(stderr, "REDO PROBLEM: no space in view for key %ld\n", ep->new_entry->key);
+        } else {
+            // insert or replace
+            // the old and the new value of an index entry can hash to different slots: unlink the old one first
+            struct dataEntry *shouldBeOld = ep->old_entry && (view->modes & IS_INDEX) ? unlinkShadowEntry(view, ep->old_entry) : NULL;
+            struct dataEntry * const replaced = setPutSubShadow(view, ep->new_entry);
+            if (replaced)
+                shouldBeOld = replaced;
+            if (shouldBeOld != ep->old_entry)
+                fprintf(stderr, "REDO PROBLEM: expected to get %16p, but got %16p for key %ld\n", ep->old_entry, shouldBeOld, ep->new_entry->key);
+            // if new_entry was not null, then free it (it is no longer required)
+            if (keep)
+                keepVersion(vs, ep->new_entry->key, ep->old_entry, transactionReference);
+            else if (ep->old_entry)
+                freeEntry(ep->affected_table, ep->old_entry);
+        }
+        view->lastCommittedRef = transactionReference;
+        if (vs)
+            pthread_mutex_unlock(&vs->lock);
+    }
+}
+
+void print(struct tx_log_entry *ep, int i) {
+    jlong key = ep->new_entry ? ep->new_entry->key : ep->old_entry->key;
+    fprintf(stderr, "redo log entry %5d is for key %16ld: old=%16p, new=%16p\n", i, key, ep->old_entry, ep->new_entry);
 }
 
 void rollback(struct tx_log_entry *e) {
 #ifdef DEBUG
     fprintf(stderr, "Rolling back entry for %16p %16p %16p\n", e->affected_table, e->old_entry, e->new_entry);
 #endif
+    if (logsCopies(e->affected_table)) {
+        applyIndexChange(e->affected_table, e->new_entry, e->old_entry, "ROLLBACK");
+        if (e->old_entry)
+            freeEntry(e->affected_table, e->old_entry);
+        if (e->new_entry)
+            freeEntry(e->affected_table, e->new_entry);
+        return;
+    }
     if (!e->old_entry) {
         // was an insert
 #ifdef DEBUG
@@ -1187,93 +5178,583 @@ void rollback(struct tx_log_entry *e) {
 #ifdef DEBUG
         fprintf(stderr, "    => insert / update %16p with key %ld\n", e->old_entry, e->old_entry->key);
 #endif
-        struct dataEntry *shouldBeNew = setPutSub(e->affected_table, e->old_entry);
+        if (reserveEntry(e->affected_table)) {
+            fprintf(stderr, "ROLLBACK PROBLEM: no space to restore key %ld\n", e->old_entry->key);
+            return;
+        }
+        struct dataEntry *shouldBeNew;
+        if (e->new_entry && (e->affected_table->modes & IS_INDEX)) {
+            // the old and the new value of an index entry can hash to different slots: unlink the new one first
+            shouldBeNew = unlinkEntry(e->affected_table, e->new_entry->key, e->new_entry->compressedSize);
+            setPutSub(e->affected_table, e->old_entry);
+        } else {
+            shouldBeNew = setPutSub(e->affected_table, e->old_entry);
+        }
         if (shouldBeNew != e->new_entry)
             fprintf(stderr, "ROLLBACK PROBLEM: expected to get %16p, but got %16p for key %ld\n", e->new_entry, shouldBeNew, e->old_entry->key);
         // if new_entry was not null, then free it (it is no longer required)
         if (e->new_entry)
-            free(e->new_entry);
+            freeEntry(e->affected_table, e->new_entry);
+    }
+}
+
+
+// find some existing entry or return null
+static struct dataEntry *findIndexEntry(struct dataEntry *e, int len, int newHash, const void *data) {
+    while (e) {
+        // check if this is a match (isSameIndex(e, newEntry)
+        if (e->compressedSize == newHash && len == e->uncompressedSize) {
+            if (len == 0 || !memcmp(e->data, data, len)) {
+                // match found with same index, problem!
+                return e;
+            }
+        }
+        e = e->nextSameHash;
+    }
+    return NULL;
+}
+
+// returns an existing entry of the same value for unique indexes (and does not insert newEntry then), else NULL
+// For ordered indexes, the caller must have reserved space by reserveEntry().
+static struct dataEntry * setPutSubIndex(struct map * const mapdata, struct dataEntry * const newEntry) {
+    maintainHashTable(mapdata, JNI_FALSE);
+    struct dataEntry **slot = findBucket(mapdata, newEntry->compressedSize);
+    struct dataEntry *existing = *slot;
+
+    if (mapdata->modes & IS_UNIQUE_UNDEX) {
+//        fprintf(stderr, "try find existing: modes = %02x, hash size = %d, using slot %d\n", mapdata->modes, mapdata->hashTableSize, slot);
+        // check for existing index of same value
+        existing = findIndexEntry(existing, newEntry->uncompressedSize, newEntry->compressedSize, newEntry->data);
+        if (existing)
+            return existing;
+    }
+    newEntry->nextSameHash = *slot;  // insert it at the start
+    *slot = newEntry;
+    if (mapdata->sorted)
+        sortedInsert(mapdata->sorted, newEntry);
+    // this is a new entry
+#ifdef DEBUG
+    fprintf(stderr, "Inserting an index entry of key %ld in slot %d\n", (long)key, slot);
+#endif
+    ++mapdata->count;
+    return NULL;
+}
+
+// return previous entry or NULL for error
+// old slot and new slot could be different or the same!
+static struct dataEntry * setPutSubIndexReplace(struct map *mapdata, int oldHash, struct dataEntry *newEntry) {
+    jlong key = newEntry->key;
+    maintainHashTable(mapdata, JNI_FALSE);
+    struct dataEntry **newSlot = findBucket(mapdata, newEntry->compressedSize);
+    struct dataEntry **oldSlot = findBucket(mapdata, oldHash);
+
+    if (mapdata->modes & IS_UNIQUE_UNDEX) {
+        // check for existing index of same value. By definition (shortcut in Java), this cannot be identical with the same key entry, we would have skipped this update!
+        // check for existing index of same value
+        struct dataEntry *existing = findIndexEntry(*newSlot, newEntry->uncompressedSize, newEntry->compressedSize, newEntry->data);
+        if (existing)
+            return NULL;
+    }
+
+    // now find the old entry to remove! Nothing is modified before it has been found
+    struct dataEntry *prev = NULL;
+    struct dataEntry *f = *oldSlot;  // the old start of chain..., to find the previous entry for key
+    while (f && f->key != key) {
+        prev = f;
+        f = f->nextSameHash;
+    }
+    // last plausi...
+    if (!f || f->compressedSize != oldHash)
+        return NULL;        // problem! no old entry found, or inconsistency
+    // f is to be removed. set the ptr on prev
+    if (prev)
+        prev->nextSameHash = f->nextSameHash;
+    else
+        *oldSlot = f->nextSameHash;
+    newEntry->nextSameHash = *newSlot;  // insert it at the start
+    *newSlot = newEntry;
+    if (mapdata->sorted) {
+        sortedRemove(mapdata->sorted, f);
+        sortedInsert(mapdata->sorted, newEntry);
+    }
+    return f;
+}
+
+// temporary storage for index values passed from Java
+static void *getTempBuffer(struct map *mapdata, int requiredSize) {
+    if (mapdata->sharedIndexLookupBufferSize >= requiredSize)
+        // current buffer is sufficient
+        return mapdata->sharedIndexLookupBuffer;
+    int newLen = ROUND_UP_SIZE(requiredSize);
+    // no buffer exists so far, must malloc!
+    void *buffer = malloc(newLen);
+    if (!buffer)
+        return buffer;      // out of memory!
+    if (mapdata->sharedIndexLookupBuffer) {
+        // there is a buffer already but we got a bigger one now. Free the old one and store the new.
+        free(mapdata->sharedIndexLookupBuffer);
+    } else  if (!(mapdata->modes & TRANSACTIONAL)) {
+        // no buffer exists, but we are running possibly in multithreading mode. No buffer sharing allowed!
+        return buffer;
+    }
+    // transactional mode, this is single threaded, no interrupt will mess up this one. Store the new buffer for reuse!
+    mapdata->sharedIndexLookupBuffer = buffer;
+    mapdata->sharedIndexLookupBufferSize = newLen;
+    return buffer;
+}
+
+static void inline freeTempBuffer(struct map *mapdata, void *buffer) {
+    if (!(mapdata->modes & TRANSACTIONAL))
+        free(buffer);
+}
+
+// Index operations on compact index maps (INDEX_HASH_IS_KEY). The value is copied into local words, no entry is allocated.
+
+// copies the value passed from Java into buffer (of COMPACT_MAX_WIDTH bytes), unless its length differs from the width of the index
+static void compactBytesFromJava(JNIEnv *env, const struct compactIndex *t, jbyteArray data, jint offset, jint length, char *buffer) {
+    if (length == t->width && length)
+        (*env)->GetByteArrayRegion(env, data, offset, length, (jbyte *)buffer);
+}
+
+// converts the value passed from Java. Returns 0 if OK, -1 if its length differs from the width of the index
+static int compactValueFromJava(JNIEnv *env, const struct compactIndex *t, jbyteArray data, jint offset, jint length, uint64_t *value) {
+    char buffer[COMPACT_MAX_WIDTH];
+    if (length != t->width)
+        return -1;
+    compactBytesFromJava(env, t, data, offset, length, buffer);
+    compactLoadValue(t, buffer, value);
+    return 0;
+}
+
+static void compactIndexCreate(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key, jint hash, const char *data, jint length) {
+    struct compactIndex *t = mapdata->compact;
+    uint64_t value[COMPACT_MAX_WORDS];
+    if (length != t->width) {
+        throwAny(env, "Index value does not match the width of the index");
+        return;
+    }
+    compactLoadValue(t, data, value);
+    if (compactReserve(t)) {
+        throwOutOfMemory(env);
+        return;
+    }
+    if ((mapdata->modes & IS_UNIQUE_UNDEX) && compactFind(t, hash, value) >= 0) {
+        throwDuplicateKey(env);
+        return;
+    }
+    struct dataEntry *newEntry = NULL;
+    if (IS_TRANSACTIONAL(ctx, mapdata) && !(newEntry = indexLogEntry(mapdata, key, hash, value, t->width))) {
+        throwOutOfMemory(env);
+        return;
+    }
+    compactInsert(t, key, hash, value);
+    ++mapdata->count;
+    if (newEntry)
+        record_change(env, ctx, mapdata, NULL, newEntry);  // may throw an error
+}
+
+static void compactIndexDelete(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key, jint hash) {
+    struct compactIndex *t = mapdata->compact;
+    int slot = compactFindKey(t, key, hash);
+    if (slot < 0) {
+        throwInconsistent(env, "no index entry found");
+        return;
+    }
+    struct dataEntry *oldEntry = NULL;
+    if (IS_TRANSACTIONAL(ctx, mapdata) && !(oldEntry = indexLogEntry(mapdata, key, hash, compactValue(t, slot), t->width))) {
+        throwOutOfMemory(env);
+        return;
+    }
+    compactErase(t, slot);
+    --mapdata->count;
+    if (oldEntry)
+        record_change(env, ctx, mapdata, oldEntry, NULL);  // may throw an error
+}
+
+static void compactIndexUpdate(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key, jint oldHash, jint newHash,
+  const char *newData, jint length) {
+    struct compactIndex *t = mapdata->compact;
+    uint64_t value[COMPACT_MAX_WORDS];
+    if (length != t->width) {
+        throwAny(env, "Index value does not match the width of the index");
+        return;
+    }
+    compactLoadValue(t, newData, value);
+    if (compactReserve(t)) {        // before looking up any slot, as it can rebuild the table
+        throwOutOfMemory(env);
+        return;
+    }
+    int oldSlot = compactFindKey(t, key, oldHash);
+    if (oldSlot < 0) {
+        throwInconsistent(env, "old index entry not found");
+        return;
+    }
+    if (mapdata->modes & IS_UNIQUE_UNDEX) {
+        int existing = compactFind(t, newHash, value);
+        if (existing >= 0 && existing != oldSlot) {
+            throwDuplicateKey(env);
+            return;
+        }
+    }
+    struct dataEntry *oldEntry = NULL;
+    struct dataEntry *newEntry = NULL;
+    if (IS_TRANSACTIONAL(ctx, mapdata)) {
+        oldEntry = indexLogEntry(mapdata, key, oldHash, compactValue(t, oldSlot), t->width);
+        newEntry = indexLogEntry(mapdata, key, newHash, value, t->width);
+        if (!oldEntry || !newEntry) {
+            if (oldEntry)
+                freeEntry(mapdata, oldEntry);
+            if (newEntry)
+                freeEntry(mapdata, newEntry);
+            throwOutOfMemory(env);
+            return;
+        }
+    }
+    compactErase(t, oldSlot);
+    compactInsert(t, key, newHash, value);
+    if (oldEntry)
+        record_change(env, ctx, mapdata, oldEntry, newEntry);  // may throw an error
+}
+
+// Index operations on posting list index maps (POSTING_LISTS). The value is only copied when a new distinct value is stored.
+// Returns the value copied from Java, or NULL (after throwing) if no memory is available. Must be released by freeTempBuffer.
+static void *postingValueFromJava(JNIEnv *env, struct map *mapdata, jbyteArray data, jint offset, jint length) {
+    void *buffer = getTempBuffer(mapdata, length ? length : 1);
+    if (!buffer) {
+        throwOutOfMemory(env);
+        return NULL;
+    }
+    if (length)
+        (*env)->GetByteArrayRegion(env, data, offset, length, (jbyte *)buffer);
+    return buffer;
+}
+
+static void postingIndexCreate(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key, jint hash, const void *value, jint length) {
+    struct dataEntry *newEntry = NULL;
+    if (IS_TRANSACTIONAL(ctx, mapdata) && !(newEntry = indexLogEntry(mapdata, key, hash, value, length))) {
+        throwOutOfMemory(env);
+        return;
+    }
+    int result = postingInsert(mapdata->postings, key, hash, value, length);
+    if (result) {
+        if (newEntry)
+            freeEntry(mapdata, newEntry);
+        if (result < 0)
+            throwOutOfMemory(env);
+        return;     // else the key is stored for this value already
+    }
+    ++mapdata->count;
+    if (newEntry)
+        record_change(env, ctx, mapdata, NULL, newEntry);  // may throw an error
+}
+
+static void postingIndexDelete(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key, jint hash) {
+    struct postingNode *n = postingFindKey(mapdata->postings, key, hash);
+    if (!n) {
+        throwInconsistent(env, "no index entry found");
+        return;
+    }
+    struct dataEntry *oldEntry = NULL;
+    if (IS_TRANSACTIONAL(ctx, mapdata) && !(oldEntry = indexLogEntry(mapdata, key, hash, n->value, n->length))) {
+        throwOutOfMemory(env);
+        return;
+    }
+    postingRemove(mapdata->postings, n, key);
+    --mapdata->count;
+    if (oldEntry)
+        record_change(env, ctx, mapdata, oldEntry, NULL);  // may throw an error
+}
+
+static void postingIndexUpdate(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key, jint oldHash, jint newHash,
+  const void *value, jint length) {
+    struct postingNode *old = postingFindKey(mapdata->postings, key, oldHash);
+    if (!old) {
+        throwInconsistent(env, "old index entry not found");
+        return;
+    }
+    if (old->hash == newHash && old->length == length && (!length || !memcmp(old->value, value, length)))
+        return;     // same value, nothing to do
+    struct dataEntry *oldEntry = NULL;
+    struct dataEntry *newEntry = NULL;
+    if (IS_TRANSACTIONAL(ctx, mapdata)) {
+        oldEntry = indexLogEntry(mapdata, key, oldHash, old->value, old->length);
+        newEntry = indexLogEntry(mapdata, key, newHash, value, length);
+        if (!oldEntry || !newEntry) {
+            if (oldEntry)
+                freeEntry(mapdata, oldEntry);
+            if (newEntry)
+                freeEntry(mapdata, newEntry);
+            throwOutOfMemory(env);
+            return;
+        }
+    }
+    // insert first: the old node is not touched if no memory is available
+    int result = postingInsert(mapdata->postings, key, newHash, value, length);
+    if (result < 0) {
+        if (oldEntry) {
+            freeEntry(mapdata, oldEntry);
+            freeEntry(mapdata, newEntry);
+        }
+        throwOutOfMemory(env);
+        return;
+    }
+    postingRemove(mapdata->postings, old, key);
+    if (oldEntry)
+        record_change(env, ctx, mapdata, oldEntry, newEntry);  // may throw an error
+}
+
+// Index operations on hash chain index maps. The entry is allocated by the caller, from Java or from native memory. NULL means no memory.
+static struct dataEntry *create_index_entry_from_memory(struct map * const mapdata, jlong key, jint hash, const void *data, int length) {
+    struct dataEntry *e = allocEntry(mapdata, length);
+    if (!e)
+        return NULL;  // will throw OOM
+    e->nextSameHash = NULL;
+    e->nextInCommittedView = NULL;
+    e->uncompressedSize = length;
+    e->compressedSize = hash;
+    e->key = key;
+    if (length > 0)
+        memcpy(e->data, data, length);
+    return e;
+}
+
+static void insertIndexEntry(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, struct dataEntry *newEntry) {
+    if (!newEntry) {
+        throwOutOfMemory(env);
+        return;
+    }
+    if (setPutSubIndex(mapdata, newEntry)) {
+        freeEntry(mapdata, newEntry);
+        throwDuplicateKey(env);
+        return;
+    }
+    record_change(env, ctx, mapdata, 0, newEntry);  // may throw an error
+}
+
+static void replaceIndexEntry(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jint oldHash, struct dataEntry *newEntry) {
+    if (!newEntry) {
+        throwOutOfMemory(env);
+        return;
+    }
+    struct dataEntry *previousEntry = setPutSubIndexReplace(mapdata, oldHash, newEntry);
+    if (!previousEntry) {
+        freeEntry(mapdata, newEntry);
+        // could have 2 causes... check uniqueness and assume it's that one!
+        if (mapdata->modes & IS_UNIQUE_UNDEX)
+            throwDuplicateKey(env);
+        else
+            throwInconsistent(env, "old index entry not found");
+        return;
     }
+    record_change(env, ctx, mapdata, previousEntry, newEntry);  // may throw an error
 }
 
+static void removeIndexEntry(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key, jint hash) {
+    struct dataEntry **slot = findBucket(mapdata, hash);
 
-// find some existing entry or return null
-static struct dataEntry *findIndexEntry(struct dataEntry *e, int len, int newHash, const void *data) {
+    struct dataEntry *prev = NULL;
+    struct dataEntry *e = *slot;
     while (e) {
-        // check if this is a match (isSameIndex(e, newEntry)
-        if (e->compressedSize == newHash && len == e->uncompressedSize) {
-            if (len == 0 || !memcmp(e->data, data, len)) {
-                // match found with same index, problem!
-                return e;
+        // check if this is a match
+        if (e->key == key) {
+            // plausi check
+            if (e->compressedSize != hash) {
+                throwInconsistent(env, "hash code differs");
+                return;
+            }
+            if (!prev) {
+                // initial entry, update mapdata
+                *slot = e->nextSameHash;
+            } else {
+                prev->nextSameHash = e->nextSameHash;
             }
+            if (mapdata->sorted)
+                sortedRemove(mapdata->sorted, e);
+            record_change(env, ctx, mapdata, e, NULL); // may throw an error
+            --mapdata->count;
+            return;
         }
+        prev = e;
         e = e->nextSameHash;
     }
-    return NULL;
+    throwInconsistent(env, "no index entry found");
 }
 
-static struct dataEntry * setPutSubIndex(struct map * const mapdata, struct dataEntry * const newEntry) {
-    int slot = (newEntry->compressedSize & 0x7fffffff) % mapdata->hashTableSize;
-    struct dataEntry *existing = mapdata->keyHash[slot];
-    newEntry->nextSameHash = existing;  // insert it at the start
-    mapdata->keyHash[slot] = newEntry;
+// Index operations on values in native memory, for all organizations of index maps (used by the index rules of data maps)
+static void indexCreate(JNIEnv *env, struct map *index, struct tx_log_hdr *ctx, jlong key, jint hash, const char *value, int length) {
+    if (index->compact)
+        compactIndexCreate(env, index, ctx, key, hash, value, length);
+    else if (index->postings)
+        postingIndexCreate(env, index, ctx, key, hash, value, length);
+    else
+        insertIndexEntry(env, index, ctx, reserveEntry(index) ? NULL : create_index_entry_from_memory(index, key, hash, value, length));
+}
 
-    if (mapdata->modes & IS_UNIQUE_UNDEX) {
-//        fprintf(stderr, "try find existing: modes = %02x, hash size = %d, using slot %d\n", mapdata->modes, mapdata->hashTableSize, slot);
-        // check for existing index of same value
-        existing = findIndexEntry(existing, newEntry->uncompressedSize, newEntry->compressedSize, newEntry->data);
-        if (existing)
-            return existing;
+static void indexDelete(JNIEnv *env, struct map *index, struct tx_log_hdr *ctx, jlong key, jint hash) {
+    if (index->compact)
+        compactIndexDelete(env, index, ctx, key, hash);
+    else if (index->postings)
+        postingIndexDelete(env, index, ctx, key, hash);
+    else
+        removeIndexEntry(env, index, ctx, key, hash);
+}
+
+static void indexUpdate(JNIEnv *env, struct map *index, struct tx_log_hdr *ctx, jlong key, jint oldHash, jint newHash, const char *value, int length) {
+    if (index->compact)
+        compactIndexUpdate(env, index, ctx, key, oldHash, newHash, value, length);
+    else if (index->postings)
+        postingIndexUpdate(env, index, ctx, key, oldHash, newHash, value, length);
+    else
+        replaceIndexEntry(env, index, ctx, oldHash, reserveEntry(index) ? NULL : create_index_entry_from_memory(index, key, newHash, value, length));
+}
+
+// returns JNI_TRUE if the index is unique and holds the value for another key
+static jboolean indexConflicts(struct map *index, jlong key, jint hash, const char *value, int length) {
+    if (!(index->modes & IS_UNIQUE_UNDEX) || index->postings)
+        return JNI_FALSE;
+    if (index->compact) {
+        uint64_t v[COMPACT_MAX_WORDS];
+        if (length != index->compact->width)
+            return JNI_FALSE;   // reported by the update itself
+        compactLoadValue(index->compact, value, v);
+        int slot = compactFind(index->compact, hash, v);
+        return slot >= 0 && index->compact->keys[slot] != key;
     }
-    // this is a new entry
-#ifdef DEBUG
-    fprintf(stderr, "Inserting an index entry of key %ld in slot %d\n", (long)key, slot);
-#endif
-    ++mapdata->count;
-    return NULL;
+    struct dataEntry *e = findIndexEntry(*findBucket(index, hash), length, hash, value);
+    return e && e->key != key;
 }
 
-// return previous entry or NULL for error
-// old slot and new slot could be different or the same!
-static struct dataEntry * setPutSubIndexReplace(struct map *mapdata, int oldHash, struct dataEntry *newEntry) {
-    jlong key = newEntry->key;
-    int newSlot = (newEntry->compressedSize & 0x7fffffff) % mapdata->hashTableSize;
-    int oldSlot = (oldHash  & 0x7fffffff) % mapdata->hashTableSize;
-    struct dataEntry *e = mapdata->keyHash[newSlot];  // the new start of chain...
-    struct dataEntry *f = mapdata->keyHash[oldSlot];  // the old start of chain..., to find the previous entry for key
 
-    newEntry->nextSameHash = e;  // insert it at the start
-    mapdata->keyHash[newSlot] = newEntry;
+// Index rules of data maps. The index values are extracted from the rows natively, and hashed by valueHash,
+// which is what the Java side uses for byte [] index values.
 
-    if (mapdata->modes & IS_UNIQUE_UNDEX) {
-        // check for existing index of same value. By definition (shortcut in Java), this cannot be identical with the same key entry, we would have skipped this update!
-        // check for existing index of same value
-        struct dataEntry *existing = findIndexEntry(e, newEntry->uncompressedSize, newEntry->compressedSize, newEntry->data);
-        if (existing)
-            return NULL;
+// extracts the index value of a rule from an entry (NULL: none), using scratch buffer which for compressed entries.
+// Returns its length and sets *value, or -1 if the row has no value for this index, or FIELD_NO_MEMORY / FIELD_CORRUPTED
+static int extractIndexValue(const struct map *mapdata, const struct indexRule *r, const struct dataEntry *e, int which, const char **value) {
+    if (!e)
+        return -1;
+    if (r->kind == RULE_FIELD)
+        return extractField(mapdata, e, r->position, r->delimiter, r->nullIndicator, which, value);
+    if (r->position >= e->uncompressedSize)
+        return -1;      // as natGetRegion, a region which starts within the row is truncated at its end
+    int len = r->position + r->length <= e->uncompressedSize ? r->length : e->uncompressedSize - r->position;
+    if (!e->compressedSize) {
+        *value = e->data + r->position;
+        return len;
     }
+    char *buffer = getThreadScratch(which, r->position + len);
+    if (!buffer)
+        return FIELD_NO_MEMORY;
+    if (decompressEntry(mapdata, e, buffer, r->position + len))
+        return FIELD_CORRUPTED;
+    *value = buffer + r->position;
+    return len;
+}
 
-    // now find the old entry to remove!
-    struct dataEntry *prev = newSlot == oldSlot ? newEntry : NULL;
+// Updates the indexes attached to a data map for the change of the row of key from oldEntry to newEntry (either can be NULL),
+// within the same transaction. Unique indexes are checked first, such that a violation leaves the row and all indexes unchanged.
+// Returns 0 if OK, else -1 (and an exception has been thrown)
+static int maintainIndexes(JNIEnv *env, struct map *mapdata, struct tx_log_hdr *ctx, jlong key,
+  const struct dataEntry *oldEntry, const struct dataEntry *newEntry) {
+    const char *oldValue;
+    const char *newValue;
+    for (const struct indexRule *r = mapdata->indexRules; r; r = r->next) {
+        if (!(r->index->modes & IS_UNIQUE_UNDEX))
+            continue;
+        int newLen = extractIndexValue(mapdata, r, newEntry, 1, &newValue);
+        if (newLen < -1) {
+            throwFieldError(env, newLen);
+            return -1;
+        }
+        if (newLen >= 0 && indexConflicts(r->index, key, valueHash(newValue, newLen), newValue, newLen)) {
+            throwDuplicateKey(env);
+            return -1;
+        }
+    }
+    for (const struct indexRule *r = mapdata->indexRules; r; r = r->next) {
+        int oldLen = extractIndexValue(mapdata, r, oldEntry, 0, &oldValue);
+        int newLen = extractIndexValue(mapdata, r, newEntry, 1, &newValue);
+        if (oldLen < -1 || newLen < -1) {
+            throwFieldError(env, oldLen < -1 ? oldLen : newLen);
+            return -1;
+        }
+        int oldHash = oldLen >= 0 ? valueHash(oldValue, oldLen) : 0;
+        int newHash = newLen >= 0 ? valueHash(newValue, newLen) : 0;
+        if (oldLen < 0) {
+            if (newLen >= 0)
+                indexCreate(env, r->index, ctx, key, newHash, newValue, newLen);
+        } else if (newLen < 0) {
+            indexDelete(env, r->index, ctx, key, oldHash);
+        } else if (oldHash != newHash || oldLen != newLen || memcmp(oldValue, newValue, oldLen)) {
+            indexUpdate(env, r->index, ctx, key, oldHash, newHash, newValue, newLen);
+        }
+        if ((*env)->ExceptionCheck(env))
+            return -1;
+    }
+    return 0;
+}
 
-    while (f) {
-        if (f->key == key) {
-            // this one to replace
-            // last plausi...
-            if (f->compressedSize != oldHash)
-                return NULL;        // inconsistency!
-            // f is to be removed. set the ptr on prev
-            if (prev)
-                prev->nextSameHash = f->nextSameHash;
-            else
-                mapdata->keyHash[oldSlot] = f->nextSameHash;
-            return f;
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natAttachIndex
+ * Signature: (JJIIIBB)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natAttachIndex
+  (JNIEnv *env, jclass me, jlong cMap, jlong cIndex, jint kind, jint position, jint length, jbyte delimiter, jbyte nullIndicator) {
+    struct map *mapdata = (struct map *) cMap;
+    struct map *index = (struct map *) cIndex;
+    if ((mapdata->modes & IS_INDEX) || !(index->modes & IS_INDEX)) {
+        throwAny(env, "Indexes must be attached to a data map");
+        return;
+    }
+    if (mapdata->count) {
+        throwAny(env, "Indexes can only be attached to an empty map");
+        return;
+    }
+    if ((kind != RULE_FIELD && kind != RULE_REGION) || position < 0 || (kind == RULE_REGION && length <= 0)) {
+        throwAny(env, "Bad index rule");
+        return;
+    }
+    struct indexRule *r = malloc(sizeof(struct indexRule));
+    if (!r) {
+        throwOutOfMemory(env);
+        return;
+    }
+    r->index = index;
+    r->kind = kind;
+    r->position = position;
+    r->length = length;
+    r->delimiter = delimiter;
+    r->nullIndicator = nullIndicator;
+    // append, the indexes are maintained in order of attachment
+    struct indexRule **last = &mapdata->indexRules;
+    while (*last)
+        last = &(*last)->next;
+    r->next = NULL;
+    *last = r;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natDetachIndex
+ * Signature: (JJ)Z
+ */
+JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natDetachIndex
+  (JNIEnv *env, jclass me, jlong cMap, jlong cIndex) {
+    struct map *mapdata = (struct map *) cMap;
+    jboolean found = JNI_FALSE;
+    struct indexRule **prev = &mapdata->indexRules;
+    while (*prev) {
+        struct indexRule *r = *prev;
+        if (r->index == (struct map *) cIndex) {
+            *prev = r->next;
+            free(r);
+            found = JNI_TRUE;
+        } else {
+            prev = &r->next;
         }
-        prev = f;
-        f = f->nextSameHash;
     }
-    // problem! no old entry found
-    return NULL;
+    return found;
 }
 
 /*
@@ -1284,17 +5765,22 @@ static struct dataEntry * setPutSubIndexReplace(struct map *mapdata, int oldHash
 JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndex_natIndexCreate
   (JNIEnv *env, jclass me, jlong cMap, jlong ctx, jlong key, jint hash, jbyteArray data, jint offset, jint length) {
     struct map *mapdata = (struct map *) cMap;
-    struct dataEntry *newEntry = create_new_index_entry(env, key, hash, data, offset, length);
-    if (!newEntry) {
-        throwOutOfMemory(env);
+    if (mapdata->compact) {
+        char buffer[COMPACT_MAX_WIDTH];
+        compactBytesFromJava(env, mapdata->compact, data, offset, length, buffer);
+        compactIndexCreate(env, mapdata, (struct tx_log_hdr *)ctx, key, hash, buffer, length);
         return;
     }
-
-    if (setPutSubIndex(mapdata, newEntry)) {
-        throwDuplicateKey(env);
+    if (mapdata->postings) {
+        void *value = postingValueFromJava(env, mapdata, data, offset, length);
+        if (value) {
+            postingIndexCreate(env, mapdata, (struct tx_log_hdr *)ctx, key, hash, value, length);
+            freeTempBuffer(mapdata, value);
+        }
         return;
     }
-    record_change(env, (struct tx_log_hdr *)ctx, mapdata, 0, newEntry);  // may throw an error
+    insertIndexEntry(env, mapdata, (struct tx_log_hdr *)ctx,
+      reserveEntry(mapdata) ? NULL : create_new_index_entry(env, mapdata, key, hash, data, offset, length));
 }
 
 /*
@@ -1304,33 +5790,7 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndex_natInde
  */
 JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndex_natIndexDelete
   (JNIEnv *env, jclass me, jlong cMap, jlong ctx, jlong key, jint hash) {
-    struct map *mapdata = (struct map *) cMap;
-    int slot = (hash  & 0x7fffffff) % mapdata->hashTableSize;
-
-    struct dataEntry *prev = NULL;
-    struct dataEntry *e = mapdata->keyHash[slot];
-    while (e) {
-        // check if this is a match
-        if (e->key == key) {
-            // plausi check
-            if (e->compressedSize != hash) {
-                throwInconsistent(env, "hash code differs");
-                return;
-            }
-            if (!prev) {
-                // initial entry, update mapdata
-                mapdata->keyHash[slot] = e->nextSameHash;
-            } else {
-                prev->nextSameHash = e->nextSameHash;
-            }
-            record_change(env, (struct tx_log_hdr *)ctx, mapdata, e, NULL); // may throw an error
-            --mapdata->count;
-            return;
-        }
-        prev = e;
-        e = e->nextSameHash;
-    }
-    throwInconsistent(env, "no index entry found");
+    indexDelete(env, (struct map *) cMap, (struct tx_log_hdr *)ctx, key, hash);
 }
 
 /*
@@ -1341,54 +5801,37 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndex_natInde
 JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndex_natIndexUpdate
   (JNIEnv *env, jclass me, jlong cMap, jlong ctx, jlong key, jint oldHash, jint newHash, jbyteArray newData, jint offset, jint length) {
     struct map *mapdata = (struct map *) cMap;
-    struct dataEntry *newEntry = create_new_index_entry(env, key, newHash, newData, offset, length);
-    if (!newEntry) {
-        throwOutOfMemory(env);
+    if (mapdata->compact) {
+        char buffer[COMPACT_MAX_WIDTH];
+        compactBytesFromJava(env, mapdata->compact, newData, offset, length, buffer);
+        compactIndexUpdate(env, mapdata, (struct tx_log_hdr *)ctx, key, oldHash, newHash, buffer, length);
         return;
     }
-
-    struct dataEntry *previousEntry = setPutSubIndexReplace(mapdata, oldHash, newEntry);
-    if (!previousEntry) {
-        // could have 2 causes... check uniqueness and assume it's that one!
-        if (mapdata->modes & IS_UNIQUE_UNDEX)
-            throwDuplicateKey(env);
-        else
-            throwInconsistent(env, "old index entry not found");
+    if (mapdata->postings) {
+        void *value = postingValueFromJava(env, mapdata, newData, offset, length);
+        if (value) {
+            postingIndexUpdate(env, mapdata, (struct tx_log_hdr *)ctx, key, oldHash, newHash, value, length);
+            freeTempBuffer(mapdata, value);
+        }
         return;
     }
-    record_change(env, (struct tx_log_hdr *)ctx, mapdata, previousEntry, newEntry);  // may throw an error
+    replaceIndexEntry(env, mapdata, (struct tx_log_hdr *)ctx, oldHash,
+      reserveEntry(mapdata) ? NULL : create_new_index_entry(env, mapdata, key, newHash, newData, offset, length));
 }
 
 
 // index read
 
-
-static void *getTempBuffer(struct map *mapdata, int requiredSize) {
-    if (mapdata->sharedIndexLookupBufferSize >= requiredSize)
-        // current buffer is sufficient
-        return mapdata->sharedIndexLookupBuffer;
-    int newLen = ROUND_UP_SIZE(requiredSize);
-    // no buffer exists so far, must malloc!
-    void *buffer = malloc(newLen);
-    if (!buffer)
-        return buffer;      // out of memory!
-    if (mapdata->sharedIndexLookupBuffer) {
-        // there is a buffer already but we got a bigger one now. Free the old one and store the new.
-        free(mapdata->sharedIndexLookupBuffer);
-    } else  if (!(mapdata->modes & TRANSACTIONAL)) {
-        // no buffer exists, but we are running possibly in multithreading mode. No buffer sharing allowed!
-        return buffer;
-    }
-    // transactional mode, this is single threaded, no interrupt will mess up this one. Store the new buffer for reuse!
-    mapdata->sharedIndexLookupBuffer = buffer;
-    mapdata->sharedIndexLookupBufferSize = newLen;
-    return buffer;
+// returns the node of the value passed from Java, or NULL if there is none (or no memory is available, after throwing)
+static struct postingNode *findPostingNode(JNIEnv *env, struct map *mapdata, jint hash, jbyteArray data, jint offset, jint length) {
+    void *value = postingValueFromJava(env, mapdata, data, offset, length);
+    if (!value)
+        return NULL;
+    struct postingNode *n = postingFind(mapdata->postings, hash, value, length);
+    freeTempBuffer(mapdata, value);
+    return n;
 }
 
-static void inline freeTempBuffer(struct map *mapdata, void *buffer) {
-    if (!(mapdata->modes & TRANSACTIONAL))
-        free(buffer);
-}
 
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView
@@ -1398,8 +5841,19 @@ static void inline freeTempBuffer(struct map *mapdata, void *buffer) {
 JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_natIndexGetKey
   (JNIEnv *env, jclass me, jlong cMap, jint hash, jbyteArray data, jint offset, jint length) {
     struct map *mapdata = (struct map *) cMap;
-    int slot = (hash  & 0x7fffffff) % mapdata->hashTableSize;
-    struct dataEntry *e = mapdata->keyHash[slot];
+    if (mapdata->compact) {
+        uint64_t value[COMPACT_MAX_WORDS];
+        if (compactValueFromJava(env, mapdata->compact, data, offset, length, value))
+            return NO_ENTRY_PRESENT;
+        int slot = compactFind(mapdata->compact, hash, value);
+        return slot >= 0 ? mapdata->compact->keys[slot] : NO_ENTRY_PRESENT;
+    }
+    if (mapdata->postings) {
+        jlong key;
+        struct postingNode *n = findPostingNode(env, mapdata, hash, data, offset, length);
+        return n && postingCollect(&n->keys, NULL, 0, &key, 1) ? key : NO_ENTRY_PRESENT;
+    }
+    struct dataEntry *e = *findBucket(mapdata, hash);
     if (!e) {
         // no entry at all for this hash, don't worry copying byte arrays...
         return NO_ENTRY_PRESENT;
@@ -1426,10 +5880,10 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_na
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView
  * Method:    natInit
- * Signature: (Ljava/lang/Class;)V
+ * Signature: (Ljava/lang/Class;Ljava/lang/Class;Ljava/lang/Class;)V
  */
 JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_natInit
-  (JNIEnv *env, jclass myClass, jclass iteratorClass, jclass batchIteratorClass) {
+  (JNIEnv *env, jclass myClass, jclass iteratorClass, jclass batchIteratorClass, jclass rangeIteratorClass) {
 
     // Get the Field ID of the instance variables "number"
     javaIndexIteratorCurrentKeyFID = (*env)->GetFieldID(env, iteratorClass, "currentKey", "J");
@@ -1442,6 +5896,11 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_nat
         throwAny(env, "Batched iterator of invoking class must have a field int numValidEntries");
         return;
     }
+    javaIndexRangeIteratorCurrentSizeFID = (*env)->GetFieldID(env, rangeIteratorClass, "numValidEntries", "I");
+    if (!javaIndexRangeIteratorCurrentSizeFID) {
+        throwAny(env, "Range iterator of invoking class must have a field int numValidEntries");
+        return;
+    }
 }
 
 /*
@@ -1452,11 +5911,27 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_nat
 JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024PrimitiveLongKeyOffHeapViewIterator_natIterateStart
   (JNIEnv *env, jobject myClass, jlong cMap, jint hash, jbyteArray data, jint length) {
     struct map *mapdata = (struct map *) cMap;
-    int slot = (hash & 0x7fffffff) % mapdata->hashTableSize;
 #ifdef DEBUG
     fprintf(stderr, "iterate on map index %16p (has %d entries in %d slots)\n", mapdata, mapdata->count, mapdata->hashTableSize);
 #endif
-    struct dataEntry *e = mapdata->keyHash[slot];
+    if (mapdata->compact) {
+        // the position of compact index maps is the slot + 1
+        uint64_t value[COMPACT_MAX_WORDS];
+        int slot = compactValueFromJava(env, mapdata->compact, data, 0, length, value) ? -1 : compactFind(mapdata->compact, hash, value);
+        if (slot >= 0)
+            (*env)->SetLongField(env, myClass, javaIndexIteratorCurrentKeyFID, mapdata->compact->keys[slot]);
+        return (jlong)(slot + 1);
+    }
+    if (mapdata->postings) {
+        // the position of posting list index maps is the node, the iteration continues after the current key
+        jlong key;
+        struct postingNode *n = findPostingNode(env, mapdata, hash, data, 0, length);
+        if (!n || !postingCollect(&n->keys, NULL, 0, &key, 1))
+            return (jlong)0;
+        (*env)->SetLongField(env, myClass, javaIndexIteratorCurrentKeyFID, key);
+        return (jlong)n;
+    }
+    struct dataEntry *e = *findBucket(mapdata, hash);
     if (!e) {
         // no entry at all for this hash, don't worry copying byte arrays...
         return (jlong)0;        // not NO_ENTRY_PRESENT, different context here!
@@ -1485,9 +5960,24 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00
  * Signature: (JJ)J
  */
 JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024PrimitiveLongKeyOffHeapViewIterator_natIterate
-  (JNIEnv *env, jobject myClass, jlong nextEntryPtr) {
+  (JNIEnv *env, jobject myClass, jlong cMap, jlong nextEntryPtr) {
 
     // this method is never called with nextEntryPtr == null
+    struct map *mapdata = (struct map *) cMap;
+    if (mapdata->compact) {
+        int slot = compactFindNext(mapdata->compact, (int)nextEntryPtr - 1);
+        if (slot >= 0)
+            (*env)->SetLongField(env, myClass, javaIndexIteratorCurrentKeyFID, mapdata->compact->keys[slot]);
+        return (jlong)(slot + 1);
+    }
+    if (mapdata->postings) {
+        const struct postingNode *n = (const struct postingNode *)nextEntryPtr;
+        jlong key = (*env)->GetLongField(env, myClass, javaIndexIteratorCurrentKeyFID);
+        if (!postingCollect(&n->keys, &key, 0, &key, 1))
+            return (jlong)0;
+        (*env)->SetLongField(env, myClass, javaIndexIteratorCurrentKeyFID, key);
+        return nextEntryPtr;
+    }
     struct dataEntry *old = (struct dataEntry *)nextEntryPtr;
     int len = old->uncompressedSize;
     for (struct dataEntry *e = old->nextSameHash; e; e = e->nextSameHash) {
@@ -1540,6 +6030,44 @@ static struct dataEntry *findIndexEntries(
     return e;
 }
 
+// collects up to batchSize keys of a posting list, after the key *after (if not NULL).
+// Returns the node if the batch is full (the next batch continues after its last key), else 0
+static jlong findPostingEntries(JNIEnv *env, jobject myClass, const struct postingNode *n, const jlong *after,
+        jlongArray dest, jint batchSize, jint recordsToSkip) {
+    if (!n)
+        return (jlong)0;
+    jlong tmp[batchSize];
+    int found = postingCollect(&n->keys, after, recordsToSkip, tmp, batchSize);
+    if (found > 0) {
+        (*env)->SetIntField(env, myClass, javaIndexIteratorCurrentSizeFID, found);
+        (*env)->SetLongArrayRegion(env, dest, 0, found, tmp);
+    }
+    return found == batchSize ? (jlong)n : (jlong)0;
+}
+
+// collects the keys of up to batchSize entries of a compact index map, starting at slot, which holds the value to search for.
+// Returns the position (slot + 1) of the last key returned if the batch is full, else 0
+static jlong findCompactEntries(JNIEnv *env, jobject myClass, const struct compactIndex *t, int slot,
+        jlongArray dest, jint batchSize, jint recordsToSkip) {
+    int found = 0;
+    jlong tmp[batchSize];
+    while (slot >= 0) {
+        if (recordsToSkip > 0) {
+            --recordsToSkip;
+        } else {
+            tmp[found++] = t->keys[slot];
+            if (found == batchSize)
+                break;      // stay on this slot, the value is retrieved from here
+        }
+        slot = compactFindNext(t, slot);
+    }
+    if (found > 0) {
+        (*env)->SetIntField(env, myClass, javaIndexIteratorCurrentSizeFID, found);
+        (*env)->SetLongArrayRegion(env, dest, 0, found, tmp);
+    }
+    return (jlong)(slot + 1);
+}
+
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_BatchedPrimitiveLongKeyOffHeapViewIterator
  * Method:    natIterateStart
@@ -1548,8 +6076,15 @@ static struct dataEntry *findIndexEntries(
 JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024BatchedPrimitiveLongKeyOffHeapViewIterator_natIterateStart
   (JNIEnv *env, jobject myClass, jlong cMap, jint hash, jbyteArray data, jint length, jlongArray dest, jint batchSize, jint recordsToSkip) {
   struct map *mapdata = (struct map *) cMap;
-  int slot = (hash & 0x7fffffff) % mapdata->hashTableSize;
-  struct dataEntry *e = mapdata->keyHash[slot];
+  if (mapdata->compact) {
+      uint64_t value[COMPACT_MAX_WORDS];
+      if (compactValueFromJava(env, mapdata->compact, data, 0, length, value))
+          return (jlong)0;
+      return findCompactEntries(env, myClass, mapdata->compact, compactFind(mapdata->compact, hash, value), dest, batchSize, recordsToSkip);
+  }
+  if (mapdata->postings)
+      return findPostingEntries(env, myClass, findPostingNode(env, mapdata, hash, data, 0, length), NULL, dest, batchSize, recordsToSkip);
+  struct dataEntry *e = *findBucket(mapdata, hash);
   if (!e) {
       // no entry at all for this hash, don't worry copying byte arrays...
       return (jlong)0;        // not NO_ENTRY_PRESENT, different context here!
@@ -1573,11 +6108,20 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_BatchedPrimitiveLongKeyOffHeapViewIterator
  * Method:    natIterate
- * Signature: (J[JI)J
+ * Signature: (JJ[JI)J
  */
 JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024BatchedPrimitiveLongKeyOffHeapViewIterator_natIterate
-  (JNIEnv *env, jobject myClass, jlong nextEntryPtr, jlongArray dest, jint batchSize) {
+  (JNIEnv *env, jobject myClass, jlong cMap, jlong nextEntryPtr, jlongArray dest, jint batchSize) {
     // this method is never called with nextEntryPtr == null
+    struct map *mapdata = (struct map *) cMap;
+    if (mapdata->compact)
+        return findCompactEntries(env, myClass, mapdata->compact, compactFindNext(mapdata->compact, (int)nextEntryPtr - 1), dest, batchSize, 0);
+    if (mapdata->postings) {
+        // the previous batch was full, continue after its last key
+        jlong after;
+        (*env)->GetLongArrayRegion(env, dest, batchSize - 1, 1, &after);
+        return findPostingEntries(env, myClass, (const struct postingNode *)nextEntryPtr, &after, dest, batchSize, 0);
+    }
     int found = 0;
     jlong tmp[batchSize];
     struct dataEntry *e = (struct dataEntry *)nextEntryPtr;
@@ -1605,6 +6149,127 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00
 
 
 
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView
+ * Method:    natCombine
+ * Signature: (JI[BIJI[BIZ[JI)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_natCombine
+  (JNIEnv *env, jclass me, jlong cMapA, jint hashA, jbyteArray dataA, jint lengthA, jlong cMapB, jint hashB, jbyteArray dataB, jint lengthB,
+   jboolean isAnd, jlongArray dest, jint recordsToSkip) {
+    struct map *mapA = (struct map *) cMapA;
+    struct map *mapB = (struct map *) cMapB;
+    if (!mapA->postings || !mapB->postings) {
+        throwAny(env, "Index does not use posting lists");
+        return 0;
+    }
+    const int max = (*env)->GetArrayLength(env, dest);
+    struct postingNode *a = findPostingNode(env, mapA, hashA, dataA, 0, lengthA);
+    struct postingNode *b = findPostingNode(env, mapB, hashB, dataB, 0, lengthB);
+    if ((*env)->ExceptionCheck(env) || max <= 0 || (isAnd ? !a || !b : !a && !b))
+        return 0;
+    jlong *tmp = malloc(max * sizeof(jlong));
+    if (!tmp) {
+        throwOutOfMemory(env);
+        return 0;
+    }
+    int found = postingCombine(a ? &a->keys : NULL, b ? &b->keys : NULL, isAnd, recordsToSkip, tmp, max);
+    if (found > 0)
+        (*env)->SetLongArrayRegion(env, dest, 0, found, tmp);
+    free(tmp);
+    return found;
+}
+
+// Range iterator of ordered indexes. The upper bound is either a value (inclusive, NULL for none), or a prefix which all values must start with.
+
+static inline jboolean withinBound(const struct dataEntry *e, const void *to, int toLength, jboolean isPrefix) {
+    if (isPrefix)
+        return e->uncompressedSize >= toLength && (!toLength || !memcmp(e->data, to, toLength));
+    return !to || sortedCompareValues(e->data, e->uncompressedSize, to, toLength) <= 0;
+}
+
+// collects the keys of up to batchSize entries, starting at e, the current entry of the cursor, as long as they are within the bound.
+// Returns the entry following the batch, or NULL if there is none within the bound.
+static struct dataEntry *collectRange(JNIEnv *env, jobject myClass, struct sortedCursor *c, struct dataEntry *e,
+        const void *to, int toLength, jboolean isPrefix, jlongArray dest, jint batchSize, jint recordsToSkip) {
+    int found = 0;
+    jlong tmp[batchSize];
+    for (; e && found < batchSize; e = sortedNext(c)) {
+        if (!withinBound(e, to, toLength, isPrefix))
+            break;
+        if (recordsToSkip > 0)
+            --recordsToSkip;
+        else
+            tmp[found++] = e->key;
+    }
+    if (found > 0) {
+        (*env)->SetIntField(env, myClass, javaIndexRangeIteratorCurrentSizeFID, found);
+        (*env)->SetLongArrayRegion(env, dest, 0, found, tmp);
+    }
+    return e && withinBound(e, to, toLength, isPrefix) ? e : NULL;
+}
+
+// copies the bounds into one temporary buffer. Returns NULL (and throws) if no memory is available
+static char *copyBounds(JNIEnv *env, struct map *mapdata, jbyteArray from, int fromLength, jbyteArray to, int toLength) {
+    char *buffer = getTempBuffer(mapdata, fromLength + toLength > 0 ? fromLength + toLength : 1);
+    if (!buffer) {
+        throwOutOfMemory(env);
+        return NULL;
+    }
+    if (from && fromLength > 0)
+        (*env)->GetByteArrayRegion(env, from, 0, fromLength, (jbyte *)buffer);
+    if (to && toLength > 0)
+        (*env)->GetByteArrayRegion(env, to, 0, toLength, (jbyte *)buffer + fromLength);
+    return buffer;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_RangePrimitiveLongKeyOffHeapViewIterator
+ * Method:    natIterateStart
+ * Signature: (J[BI[BIZ[JII)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024RangePrimitiveLongKeyOffHeapViewIterator_natIterateStart
+  (JNIEnv *env, jobject myClass, jlong cMap, jbyteArray from, jint fromLength, jbyteArray to, jint toLength, jboolean isPrefix,
+   jlongArray dest, jint batchSize, jint recordsToSkip) {
+    struct map *mapdata = (struct map *) cMap;
+    if (!mapdata->sorted) {
+        throwAny(env, "Index is not ordered");
+        return (jlong)0;
+    }
+    char *bounds = copyBounds(env, mapdata, from, fromLength, to, toLength);
+    if (!bounds)
+        return (jlong)0;
+    // start before all entries of the lower bound value
+    struct sortKey k = { bounds, from ? fromLength : 0, 0, (jlong)0x8000000000000000LL };
+    struct sortedCursor c;
+    struct dataEntry *e = sortedSeek(mapdata->sorted, &k, &c);
+    e = collectRange(env, myClass, &c, e, to ? bounds + fromLength : NULL, toLength, isPrefix, dest, batchSize, recordsToSkip);
+    freeTempBuffer(mapdata, bounds);
+    return (jlong)e;
+}
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_RangePrimitiveLongKeyOffHeapViewIterator
+ * Method:    natIterate
+ * Signature: (JJ[BIZ[JI)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024RangePrimitiveLongKeyOffHeapViewIterator_natIterate
+  (JNIEnv *env, jobject myClass, jlong cMap, jlong nextEntryPtr, jbyteArray to, jint toLength, jboolean isPrefix, jlongArray dest, jint batchSize) {
+    // this method is never called with nextEntryPtr == null. The entry is looked up again, as the nodes could have changed meanwhile
+    struct map *mapdata = (struct map *) cMap;
+    char *bounds = copyBounds(env, mapdata, NULL, 0, to, toLength);
+    if (!bounds)
+        return (jlong)0;
+    struct sortKey k;
+    indexSortKey((struct dataEntry *)nextEntryPtr, &k);
+    struct sortedCursor c;
+    struct dataEntry *e = sortedSeek(mapdata->sorted, &k, &c);
+    e = collectRange(env, myClass, &c, e, to ? bounds : NULL, toLength, isPrefix, dest, batchSize, 0);
+    freeTempBuffer(mapdata, bounds);
+    return (jlong)e;
+}
+
 /*
  * Class:     de_jpaw_offHeap_AbstractOffHeapMap
  * Method:    natFullDump
@@ -1615,10 +6280,25 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natFullDump
     struct map *mapdata = (struct map *) cMap;
 
     printf("Map is at %16p, hash size %d, %d entries, modes=%02x\n", mapdata, mapdata->hashTableSize, mapdata->count, mapdata->modes);
-    for (int i = 0; i < mapdata->hashTableSize; ++i) {
-        if (mapdata->keyHash[i]) {
+    if (mapdata->compact) {
+        const struct compactIndex *t = mapdata->compact;
+        for (int i = 0; i < t->capacity; ++i)
+            if (t->ctrl[i] == COMPACT_USED)
+                printf("Slot %d:\n    key %08lx: len=%9d hash=%08x\n", i, t->keys[i], t->width, t->hashes[i]);
+    }
+    if (mapdata->postings) {
+        for (int i = 0; i < postingScanSlots(mapdata->postings); ++i) {
+            if (postingScanSlot(mapdata->postings, i)) {
+                printf("Slot %d:\n", i);
+                for (const struct postingNode *n = postingScanSlot(mapdata->postings, i); n; n = n->next)
+                    printf("    value len=%9d hash=%08x: %d keys in %d containers\n", n->length, n->hash, n->keys.count, n->keys.numContainers);
+            }
+        }
+    }
+    for (int i = 0; i < numberOfScanSlots(mapdata); ++i) {
+        if (scanSlot(mapdata, i)) {
             printf("Slot %d:\n", i);
-            for (struct dataEntry *e = mapdata->keyHash[i]; e; e = e->nextSameHash) {
+            for (struct dataEntry *e = scanSlot(mapdata, i); e; e = mapdata->isView ? e->nextInCommittedView : e->nextSameHash) {
                 printf("    key %08lx: len=%9d hash=%08x\n", e->key, e->uncompressedSize, e->compressedSize);
             }
         }
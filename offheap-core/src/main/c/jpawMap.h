@@ -39,6 +39,158 @@ JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSe
 JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natPut
   (JNIEnv *, jclass, jlong, jlong, jlong, jbyteArray, jint, jint, jboolean);
 
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natAttachIndex
+ * Signature: (JJIIIBB)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natAttachIndex
+  (JNIEnv *, jclass, jlong, jlong, jint, jint, jint, jbyte, jbyte);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natDetachIndex
+ * Signature: (JJ)Z
+ */
+JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natDetachIndex
+  (JNIEnv *, jclass, jlong, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natOpenSnapshot
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natOpenSnapshot
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natReclaimVersions
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natReclaimVersions
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natStartBackgroundDump
+ * Signature: (J[B)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natStartBackgroundDump
+  (JNIEnv *, jclass, jlong, jbyteArray);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natWriteMappedFile
+ * Signature: (J[BZ)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natWriteMappedFile
+  (JNIEnv *, jclass, jlong, jbyteArray, jboolean);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natMapFile
+ * Signature: (J[BI)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natMapFile
+  (JNIEnv *, jclass, jlong, jbyteArray, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natWriteSegmentedFile
+ * Signature: (J[BZI)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natWriteSegmentedFile
+  (JNIEnv *, jclass, jlong, jbyteArray, jboolean, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natReadSegmentedFile
+ * Signature: (J[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natReadSegmentedFile
+  (JNIEnv *, jclass, jlong, jbyteArray);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natEnableChangeTracking
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natEnableChangeTracking
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natWriteDeltaFile
+ * Signature: (J[BZ)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natWriteDeltaFile
+  (JNIEnv *, jclass, jlong, jbyteArray, jboolean);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natApplyDeltaFile
+ * Signature: (J[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natApplyDeltaFile
+  (JNIEnv *, jclass, jlong, jbyteArray);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natMergeCheckpoint
+ * Signature: ([B[[B[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natMergeCheckpoint
+  (JNIEnv *, jclass, jbyteArray, jobjectArray, jbyteArray);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natSetBatch
+ * Signature: (JJLjava/nio/ByteBuffer;III)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSetBatch
+  (JNIEnv *, jclass, jlong, jlong, jobject, jint, jint, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natDeleteBatch
+ * Signature: (JJLjava/nio/ByteBuffer;II)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natDeleteBatch
+  (JNIEnv *, jclass, jlong, jlong, jobject, jint, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natTrainDictionary
+ * Signature: (JI)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natTrainDictionary
+  (JNIEnv *, jclass, jlong, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natSetDictionary
+ * Signature: (J[B)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSetDictionary
+  (JNIEnv *, jclass, jlong, jbyteArray);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natGetDictionary
+ * Signature: (J)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natGetDictionary
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap
+ * Method:    natSetCacheSize
+ * Signature: (JJ)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMap_natSetCacheSize
+  (JNIEnv *, jclass, jlong, jlong);
+
 #ifdef __cplusplus
 }
 #endif
@@ -101,6 +253,86 @@ JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
 JNIEXPORT jobject JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetAsByteBuffer
   (JNIEnv *, jclass, jlong, jlong);
 
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natLease
+ * Signature: (JJ)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natLease
+  (JNIEnv *, jclass, jlong, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetCacheStats
+ * Signature: (J[J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetCacheStats
+  (JNIEnv *, jclass, jlong, jlongArray);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natSeek
+ * Signature: (JJI[J)Z
+ */
+JNIEXPORT jboolean JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natSeek
+  (JNIEnv *, jclass, jlong, jlong, jint, jlongArray);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetKeyRange
+ * Signature: (JJJ[JI)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetKeyRange
+  (JNIEnv *, jclass, jlong, jlong, jlong, jlongArray, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetBatch
+ * Signature: (J[JIILjava/nio/ByteBuffer;II)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetBatch
+  (JNIEnv *, jclass, jlong, jlongArray, jint, jint, jobject, jint, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natScan
+ * Signature: (JZ[B[JLjava/nio/ByteBuffer;III)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natScan
+  (JNIEnv *, jclass, jlong, jboolean, jbyteArray, jlongArray, jobject, jint, jint, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natAggregate
+ * Signature: (JZ[BIII)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natAggregate
+  (JNIEnv *, jclass, jlong, jboolean, jbyteArray, jint, jint, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natPinView
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natPinView
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natUnpinView
+ * Signature: (JJ)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natUnpinView
+  (JNIEnv *, jclass, jlong, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
+ * Method:    natGetScanSlots
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView_natGetScanSlots
+  (JNIEnv *, jclass, jlong);
+
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapMapView
  * Method:    natGetIntoPreallocated
@@ -215,10 +447,10 @@ extern "C" {
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView
  * Method:    natInit
- * Signature: (Ljava/lang/Class;Ljava/lang/Class;)V
+ * Signature: (Ljava/lang/Class;Ljava/lang/Class;Ljava/lang/Class;)V
  */
 JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_natInit
-  (JNIEnv *, jclass, jclass, jclass);
+  (JNIEnv *, jclass, jclass, jclass, jclass);
 
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView
@@ -228,6 +460,14 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_nat
 JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_natIndexGetKey
   (JNIEnv *, jclass, jlong, jint, jbyteArray, jint, jint);
 
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView
+ * Method:    natCombine
+ * Signature: (JI[BIJI[BIZ[JI)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_natCombine
+  (JNIEnv *, jclass, jlong, jint, jbyteArray, jint, jlong, jint, jbyteArray, jint, jboolean, jlongArray, jint);
+
 #ifdef __cplusplus
 }
 #endif
@@ -250,10 +490,10 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_BatchedPrimitiveLongKeyOffHeapViewIterator
  * Method:    natIterate
- * Signature: (J[JI)J
+ * Signature: (JJ[JI)J
  */
 JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024BatchedPrimitiveLongKeyOffHeapViewIterator_natIterate
-  (JNIEnv *, jobject, jlong, jlongArray, jint);
+  (JNIEnv *, jobject, jlong, jlong, jlongArray, jint);
 
 #ifdef __cplusplus
 }
@@ -277,10 +517,37 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00
 /*
  * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_PrimitiveLongKeyOffHeapViewIterator
  * Method:    natIterate
- * Signature: (J)J
+ * Signature: (JJ)J
  */
 JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024PrimitiveLongKeyOffHeapViewIterator_natIterate
-  (JNIEnv *, jobject, jlong);
+  (JNIEnv *, jobject, jlong, jlong);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+/* Header for class de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_RangePrimitiveLongKeyOffHeapViewIterator */
+
+#ifndef _Included_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_RangePrimitiveLongKeyOffHeapViewIterator
+#define _Included_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_RangePrimitiveLongKeyOffHeapViewIterator
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_RangePrimitiveLongKeyOffHeapViewIterator
+ * Method:    natIterateStart
+ * Signature: (J[BI[BIZ[JII)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024RangePrimitiveLongKeyOffHeapViewIterator_natIterateStart
+  (JNIEnv *, jobject, jlong, jbyteArray, jint, jbyteArray, jint, jboolean, jlongArray, jint, jint);
+
+/*
+ * Class:     de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_RangePrimitiveLongKeyOffHeapViewIterator
+ * Method:    natIterate
+ * Signature: (JJ[BIZ[JI)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00024RangePrimitiveLongKeyOffHeapViewIterator_natIterate
+  (JNIEnv *, jobject, jlong, jlong, jbyteArray, jint, jboolean, jlongArray, jint);
 
 #ifdef __cplusplus
 }
@@ -293,6 +560,111 @@ JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_PrimitiveLongKeyOffHeapIndexView_00
 #ifdef __cplusplus
 extern "C" {
 #endif
+#ifdef __cplusplus
+}
+#endif
+#endif
+/* Header for class de_jpaw_offHeap_OffHeapLease */
+
+#ifndef _Included_de_jpaw_offHeap_OffHeapLease
+#define _Included_de_jpaw_offHeap_OffHeapLease
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     de_jpaw_offHeap_OffHeapLease
+ * Method:    natGetBuffer
+ * Signature: (J)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_de_jpaw_offHeap_OffHeapLease_natGetBuffer
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapLease
+ * Method:    natRelease
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapLease_natRelease
+  (JNIEnv *, jclass, jlong);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+/* Header for class de_jpaw_offHeap_OffHeapSnapshot */
+
+#ifndef _Included_de_jpaw_offHeap_OffHeapSnapshot
+#define _Included_de_jpaw_offHeap_OffHeapSnapshot
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     de_jpaw_offHeap_OffHeapSnapshot
+ * Method:    natGet
+ * Signature: (JJ)[B
+ */
+JNIEXPORT jbyteArray JNICALL Java_de_jpaw_offHeap_OffHeapSnapshot_natGet
+  (JNIEnv *, jclass, jlong, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapSnapshot
+ * Method:    natLength
+ * Signature: (JJ)I
+ */
+JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_OffHeapSnapshot_natLength
+  (JNIEnv *, jclass, jlong, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapSnapshot
+ * Method:    natGetRef
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_de_jpaw_offHeap_OffHeapSnapshot_natGetRef
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapSnapshot
+ * Method:    natClose
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapSnapshot_natClose
+  (JNIEnv *, jclass, jlong);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+/* Header for class de_jpaw_offHeap_OffHeapDump */
+
+#ifndef _Included_de_jpaw_offHeap_OffHeapDump
+#define _Included_de_jpaw_offHeap_OffHeapDump
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     de_jpaw_offHeap_OffHeapDump
+ * Method:    natGetProgress
+ * Signature: (J[J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapDump_natGetProgress
+  (JNIEnv *, jclass, jlong, jlongArray);
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapDump
+ * Method:    natAwait
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapDump_natAwait
+  (JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     de_jpaw_offHeap_OffHeapDump
+ * Method:    natClose
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_OffHeapDump_natClose
+  (JNIEnv *, jclass, jlong);
+
 #ifdef __cplusplus
 }
 #endif
@@ -328,6 +700,14 @@ JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natFullDump
 JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natGetHistogram
   (JNIEnv *, jclass, jlong, jintArray);
 
+/*
+ * Class:     de_jpaw_offHeap_AbstractOffHeapMap
+ * Method:    natGetMemoryStats
+ * Signature: (J[J)V
+ */
+JNIEXPORT void JNICALL Java_de_jpaw_offHeap_AbstractOffHeapMap_natGetMemoryStats
+  (JNIEnv *, jclass, jlong, jlongArray);
+
 /*
  * Class:     de_jpaw_offHeap_AbstractOffHeapMap
  * Method:    natOpen
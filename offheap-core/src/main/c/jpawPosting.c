@@ -0,0 +1,545 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "jpawPosting.h"
+
+#define POSTING_MIN_SIZE        32
+#define POSTING_MAX_SIZE        0x40000000
+#define ARRAY_TO_BITMAP         POSTING_ARRAY_MAX           // an array container which would exceed this becomes a bitmap
+#define BITMAP_TO_ARRAY         (POSTING_ARRAY_MAX / 2)     // a bitmap container which drops below this becomes an array. Lower than the limit above, to avoid flapping
+
+static inline jlong highOf(jlong key) {
+    return key >> 16;
+}
+static inline int lowOf(jlong key) {
+    return (int)(key & 0xffff);
+}
+static inline jlong makeKey(jlong high, int low) {
+    return (jlong)(((uint64_t)high << 16) | (uint64_t)low);
+}
+
+
+// Containers
+
+// returns the index of the container for high, or -(insertion point) - 1
+static int findContainer(const struct postingList *p, jlong high) {
+    int lo = 0;
+    int hi = p->numContainers - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) >> 1;
+        jlong h = p->containers[mid].high;
+        if (h < high)
+            lo = mid + 1;
+        else if (h > high)
+            hi = mid - 1;
+        else
+            return mid;
+    }
+    return -lo - 1;
+}
+
+// index of the first entry >= low
+static int lowerBound(const uint16_t *lows, int n, int low) {
+    int lo = 0;
+    int hi = n;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (lows[mid] < low)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void freeContainer(struct postingContainer *c) {
+    free(c->lows);
+    free(c->bitmap);
+}
+
+static int toBitmap(struct postingContainer *c) {
+    uint64_t *bitmap = calloc(POSTING_BITMAP_WORDS, sizeof(uint64_t));
+    if (!bitmap)
+        return -1;
+    for (int i = 0; i < c->cardinality; ++i)
+        bitmap[c->lows[i] >> 6] |= 1uLL << (c->lows[i] & 63);
+    free(c->lows);
+    c->lows = NULL;
+    c->capacity = 0;
+    c->bitmap = bitmap;
+    return 0;
+}
+
+static void toArray(struct postingContainer *c) {
+    int capacity = POSTING_ARRAY_MAX / 2;
+    uint16_t *lows = malloc(capacity * sizeof(uint16_t));
+    if (!lows)
+        return;         // stay a bitmap
+    int n = 0;
+    for (int w = 0; w < POSTING_BITMAP_WORDS; ++w)
+        for (uint64_t bits = c->bitmap[w]; bits; bits &= bits - 1)
+            lows[n++] = (uint16_t)((w << 6) + __builtin_ctzll(bits));
+    free(c->bitmap);
+    c->bitmap = NULL;
+    c->lows = lows;
+    c->capacity = capacity;
+}
+
+// returns 0 if added, 1 if present already, -1 if no memory is available
+static int containerAdd(struct postingContainer *c, int low) {
+    if (c->bitmap) {
+        uint64_t bit = 1uLL << (low & 63);
+        if (c->bitmap[low >> 6] & bit)
+            return 1;
+        c->bitmap[low >> 6] |= bit;
+        ++c->cardinality;
+        return 0;
+    }
+    int i = lowerBound(c->lows, c->cardinality, low);
+    if (i < c->cardinality && c->lows[i] == low)
+        return 1;
+    if (c->cardinality >= ARRAY_TO_BITMAP) {
+        if (toBitmap(c))
+            return -1;
+        return containerAdd(c, low);
+    }
+    if (c->cardinality == c->capacity) {
+        int capacity = c->capacity ? c->capacity * 2 : 4;
+        uint16_t *lows = realloc(c->lows, capacity * sizeof(uint16_t));
+        if (!lows)
+            return -1;
+        c->lows = lows;
+        c->capacity = capacity;
+    }
+    memmove(c->lows + i + 1, c->lows + i, (c->cardinality - i) * sizeof(uint16_t));
+    c->lows[i] = (uint16_t)low;
+    ++c->cardinality;
+    return 0;
+}
+
+// returns 0 if removed, -1 if not present
+static int containerRemove(struct postingContainer *c, int low) {
+    if (c->bitmap) {
+        uint64_t bit = 1uLL << (low & 63);
+        if (!(c->bitmap[low >> 6] & bit))
+            return -1;
+        c->bitmap[low >> 6] &= ~bit;
+        if (--c->cardinality < BITMAP_TO_ARRAY)
+            toArray(c);
+        return 0;
+    }
+    int i = lowerBound(c->lows, c->cardinality, low);
+    if (i >= c->cardinality || c->lows[i] != low)
+        return -1;
+    --c->cardinality;
+    memmove(c->lows + i, c->lows + i + 1, (c->cardinality - i) * sizeof(uint16_t));
+    return 0;
+}
+
+
+// Posting lists
+
+static int listAdd(struct postingList *p, jlong key) {
+    int i = findContainer(p, highOf(key));
+    if (i < 0) {
+        i = -i - 1;
+        if (p->numContainers == p->capacity) {
+            int capacity = p->capacity ? p->capacity * 2 : 2;
+            struct postingContainer *containers = realloc(p->containers, capacity * sizeof(struct postingContainer));
+            if (!containers)
+                return -1;
+            p->containers = containers;
+            p->capacity = capacity;
+        }
+        memmove(p->containers + i + 1, p->containers + i, (p->numContainers - i) * sizeof(struct postingContainer));
+        memset(p->containers + i, 0, sizeof(struct postingContainer));
+        p->containers[i].high = highOf(key);
+        ++p->numContainers;
+    }
+    struct postingContainer *c = &p->containers[i];
+    int result = containerAdd(c, lowOf(key));
+    if (!result)
+        ++p->count;
+    else if (!c->cardinality) {
+        // the new container could not take the key
+        freeContainer(c);
+        --p->numContainers;
+        memmove(p->containers + i, p->containers + i + 1, (p->numContainers - i) * sizeof(struct postingContainer));
+    }
+    return result;
+}
+
+static int listRemove(struct postingList *p, jlong key) {
+    int i = findContainer(p, highOf(key));
+    if (i < 0)
+        return -1;
+    struct postingContainer *c = &p->containers[i];
+    if (containerRemove(c, lowOf(key)))
+        return -1;
+    --p->count;
+    if (!c->cardinality) {
+        freeContainer(c);
+        --p->numContainers;
+        memmove(p->containers + i, p->containers + i + 1, (p->numContainers - i) * sizeof(struct postingContainer));
+    }
+    return 0;
+}
+
+static int listContains(const struct postingList *p, jlong key) {
+    int i = findContainer(p, highOf(key));
+    if (i < 0)
+        return 0;
+    const struct postingContainer *c = &p->containers[i];
+    int low = lowOf(key);
+    if (c->bitmap)
+        return (c->bitmap[low >> 6] >> (low & 63)) & 1;
+    int j = lowerBound(c->lows, c->cardinality, low);
+    return j < c->cardinality && c->lows[j] == low;
+}
+
+static void listFree(struct postingList *p) {
+    for (int i = 0; i < p->numContainers; ++i)
+        freeContainer(&p->containers[i]);
+    free(p->containers);
+}
+
+
+// Output of collected keys, with skipping
+
+struct keySink {
+    jlong high;                     // of the current container
+    int toSkip;
+    int found;
+    int max;
+    int padding;
+    jlong *dest;
+};
+
+// returns 1 once the sink is full
+static inline int emitLow(struct keySink *s, int low) {
+    if (s->toSkip > 0) {
+        --s->toSkip;
+        return 0;
+    }
+    s->dest[s->found++] = makeKey(s->high, low);
+    return s->found == s->max;
+}
+
+static inline int emitWord(struct keySink *s, int w, uint64_t bits) {
+    if (!bits)
+        return 0;
+    int n = __builtin_popcountll(bits);
+    if (s->toSkip >= n) {
+        s->toSkip -= n;
+        return 0;
+    }
+    for (; bits; bits &= bits - 1)
+        if (emitLow(s, (w << 6) + __builtin_ctzll(bits)))
+            return 1;
+    return 0;
+}
+
+// emits the keys of the container >= fromLow
+static int emitContainer(struct keySink *s, const struct postingContainer *c, int fromLow) {
+    s->high = c->high;
+    if (!fromLow && s->toSkip >= c->cardinality) {
+        s->toSkip -= c->cardinality;
+        return 0;
+    }
+    if (c->bitmap) {
+        int w = fromLow >> 6;
+        if (emitWord(s, w, c->bitmap[w] & (~0uLL << (fromLow & 63))))
+            return 1;
+        while (++w < POSTING_BITMAP_WORDS)
+            if (emitWord(s, w, c->bitmap[w]))
+                return 1;
+        return 0;
+    }
+    int i = lowerBound(c->lows, c->cardinality, fromLow);
+    if (s->toSkip > 0) {
+        int n = c->cardinality - i < s->toSkip ? c->cardinality - i : s->toSkip;
+        i += n;
+        s->toSkip -= n;
+    }
+    for (; i < c->cardinality; ++i)
+        if (emitLow(s, c->lows[i]))
+            return 1;
+    return 0;
+}
+
+static int emitAnd(struct keySink *s, const struct postingContainer *a, const struct postingContainer *b) {
+    s->high = a->high;
+    if (a->bitmap && b->bitmap) {
+        for (int w = 0; w < POSTING_BITMAP_WORDS; ++w)
+            if (emitWord(s, w, a->bitmap[w] & b->bitmap[w]))
+                return 1;
+        return 0;
+    }
+    if (a->bitmap) {
+        const struct postingContainer *t = a;
+        a = b;
+        b = t;
+    }
+    // a is an array
+    if (b->bitmap) {
+        for (int i = 0; i < a->cardinality; ++i) {
+            int low = a->lows[i];
+            if (((b->bitmap[low >> 6] >> (low & 63)) & 1) && emitLow(s, low))
+                return 1;
+        }
+        return 0;
+    }
+    int i = 0;
+    int j = 0;
+    while (i < a->cardinality && j < b->cardinality) {
+        if (a->lows[i] < b->lows[j]) {
+            ++i;
+        } else if (a->lows[i] > b->lows[j]) {
+            ++j;
+        } else {
+            if (emitLow(s, a->lows[i]))
+                return 1;
+            ++i;
+            ++j;
+        }
+    }
+    return 0;
+}
+
+static int emitOr(struct keySink *s, const struct postingContainer *a, const struct postingContainer *b) {
+    s->high = a->high;
+    if (a->bitmap || b->bitmap) {
+        if (a->bitmap && b->bitmap) {
+            for (int w = 0; w < POSTING_BITMAP_WORDS; ++w)
+                if (emitWord(s, w, a->bitmap[w] | b->bitmap[w]))
+                    return 1;
+            return 0;
+        }
+        if (a->bitmap) {
+            const struct postingContainer *t = a;
+            a = b;
+            b = t;
+        }
+        // a is an array: merge it into a copy of the bitmap
+        uint64_t words[POSTING_BITMAP_WORDS];
+        memcpy(words, b->bitmap, sizeof(words));
+        for (int i = 0; i < a->cardinality; ++i)
+            words[a->lows[i] >> 6] |= 1uLL << (a->lows[i] & 63);
+        for (int w = 0; w < POSTING_BITMAP_WORDS; ++w)
+            if (emitWord(s, w, words[w]))
+                return 1;
+        return 0;
+    }
+    int i = 0;
+    int j = 0;
+    while (i < a->cardinality || j < b->cardinality) {
+        int low;
+        if (j >= b->cardinality || (i < a->cardinality && a->lows[i] < b->lows[j])) {
+            low = a->lows[i++];
+        } else if (i >= a->cardinality || a->lows[i] > b->lows[j]) {
+            low = b->lows[j++];
+        } else {
+            low = a->lows[i];
+            ++i;
+            ++j;
+        }
+        if (emitLow(s, low))
+            return 1;
+    }
+    return 0;
+}
+
+int postingCollect(const struct postingList *p, const jlong *after, int recordsToSkip, jlong *dest, int max) {
+    struct keySink s = { 0, recordsToSkip, 0, max, 0, dest };
+    if (max <= 0)
+        return 0;
+    int i = 0;
+    int fromLow = 0;
+    if (after) {
+        i = findContainer(p, highOf(*after));
+        if (i >= 0) {
+            fromLow = lowOf(*after) + 1;
+            if (fromLow > 0xffff) {
+                ++i;
+                fromLow = 0;
+            }
+        } else {
+            i = -i - 1;
+        }
+    }
+    for (; i < p->numContainers; ++i, fromLow = 0)
+        if (emitContainer(&s, &p->containers[i], fromLow))
+            break;
+    return s.found;
+}
+
+int postingCombine(const struct postingList *a, const struct postingList *b, int isAnd, int recordsToSkip, jlong *dest, int max) {
+    struct keySink s = { 0, recordsToSkip, 0, max, 0, dest };
+    static const struct postingList empty = { 0, 0, 0, 0, NULL };
+    if (max <= 0)
+        return 0;
+    if (!a)
+        a = &empty;
+    if (!b)
+        b = &empty;
+    int i = 0;
+    int j = 0;
+    while (i < a->numContainers || j < b->numContainers) {
+        const struct postingContainer *ca = i < a->numContainers ? &a->containers[i] : NULL;
+        const struct postingContainer *cb = j < b->numContainers ? &b->containers[j] : NULL;
+        int full;
+        if (ca && cb && ca->high == cb->high) {
+            full = isAnd ? emitAnd(&s, ca, cb) : emitOr(&s, ca, cb);
+            ++i;
+            ++j;
+        } else if (isAnd) {
+            if (!ca || !cb)
+                break;
+            if (ca->high < cb->high)
+                ++i;
+            else
+                ++j;
+            full = 0;
+        } else if (!cb || (ca && ca->high < cb->high)) {
+            full = emitContainer(&s, ca, 0);
+            ++i;
+        } else {
+            full = emitContainer(&s, cb, 0);
+            ++j;
+        }
+        if (full)
+            break;
+    }
+    return s.found;
+}
+
+
+// Value nodes
+
+static inline int bucketOf(const struct postingIndex *pi, int hash) {
+    return (int)(((uint32_t)hash * 0x9E3779B9u) >> pi->shift);
+}
+
+static int allocBuckets(struct postingIndex *pi, int size) {
+    struct postingNode **buckets = calloc(size, sizeof(struct postingNode *));
+    if (!buckets)
+        return -1;
+    pi->buckets = buckets;
+    pi->size = size;
+    pi->shift = 32 - __builtin_ctz(size);
+    return 0;
+}
+
+// doubles the number of buckets. Without memory, the chains just get longer
+static void grow(struct postingIndex *pi) {
+    struct postingIndex old = *pi;
+    if (pi->size >= POSTING_MAX_SIZE || allocBuckets(pi, pi->size * 2))
+        return;
+    for (int i = 0; i < old.size; ++i) {
+        struct postingNode *n = old.buckets[i];
+        while (n) {
+            struct postingNode *next = n->next;
+            int b = bucketOf(pi, n->hash);
+            n->next = pi->buckets[b];
+            pi->buckets[b] = n;
+            n = next;
+        }
+    }
+    free(old.buckets);
+}
+
+struct postingIndex *postingCreate(int minSize) {
+    struct postingIndex *pi = malloc(sizeof(struct postingIndex));
+    if (!pi)
+        return NULL;
+    int size = POSTING_MIN_SIZE;
+    while (size < minSize && size < POSTING_MAX_SIZE)
+        size <<= 1;
+    if (allocBuckets(pi, size)) {
+        free(pi);
+        return NULL;
+    }
+    pi->numValues = 0;
+    pi->count = 0;
+    return pi;
+}
+
+void postingClear(struct postingIndex *pi) {
+    for (int i = 0; i < pi->size; ++i) {
+        struct postingNode *n = pi->buckets[i];
+        while (n) {
+            struct postingNode *next = n->next;
+            listFree(&n->keys);
+            free(n);
+            n = next;
+        }
+        pi->buckets[i] = NULL;
+    }
+    pi->numValues = 0;
+    pi->count = 0;
+}
+
+void postingDestroy(struct postingIndex *pi) {
+    postingClear(pi);
+    free(pi->buckets);
+    free(pi);
+}
+
+struct postingNode *postingFind(const struct postingIndex *pi, int hash, const void *value, int length) {
+    for (struct postingNode *n = pi->buckets[bucketOf(pi, hash)]; n; n = n->next)
+        if (n->hash == hash && n->length == length && (!length || !memcmp(n->value, value, length)))
+            return n;
+    return NULL;
+}
+
+struct postingNode *postingFindKey(const struct postingIndex *pi, jlong key, int hash) {
+    for (struct postingNode *n = pi->buckets[bucketOf(pi, hash)]; n; n = n->next)
+        if (n->hash == hash && listContains(&n->keys, key))
+            return n;
+    return NULL;
+}
+
+int postingInsert(struct postingIndex *pi, jlong key, int hash, const void *value, int length) {
+    struct postingNode *n = postingFind(pi, hash, value, length);
+    if (!n) {
+        n = malloc(sizeof(struct postingNode) + length);
+        if (!n)
+            return -1;
+        memset(&n->keys, 0, sizeof(struct postingList));
+        n->hash = hash;
+        n->length = length;
+        if (length)
+            memcpy(n->value, value, length);
+        if (listAdd(&n->keys, key)) {
+            free(n);
+            return -1;
+        }
+        int b = bucketOf(pi, hash);
+        n->next = pi->buckets[b];
+        pi->buckets[b] = n;
+        ++pi->count;
+        if (++pi->numValues > pi->size)
+            grow(pi);
+        return 0;
+    }
+    int result = listAdd(&n->keys, key);
+    if (!result)
+        ++pi->count;
+    return result;
+}
+
+int postingRemove(struct postingIndex *pi, struct postingNode *node, jlong key) {
+    if (listRemove(&node->keys, key))
+        return -1;
+    --pi->count;
+    if (!node->keys.count) {
+        struct postingNode **prev = &pi->buckets[bucketOf(pi, node->hash)];
+        while (*prev != node)
+            prev = &(*prev)->next;
+        *prev = node->next;
+        listFree(&node->keys);
+        free(node);
+        --pi->numValues;
+    }
+    return 0;
+}
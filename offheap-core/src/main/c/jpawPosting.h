@@ -0,0 +1,78 @@
+#ifndef _Included_jpawPosting
+#define _Included_jpawPosting
+
+#include <stdint.h>
+#include <jni.h>
+
+// Posting list storage for non-unique index maps (POSTING_LISTS), used instead of an entry per indexed row.
+// There is one value node per distinct index value, in a hash table by the hash of the value, and every node holds the
+// primary keys of its rows as a sorted set, organized like a Roaring bitmap: the keys are grouped by their upper 48 bits into
+// containers, which store the lower 16 bits either as a sorted array (up to POSTING_ARRAY_MAX keys) or as a bitmap.
+// Paging skips whole containers by their cardinality, and intersections and unions work on containers, bitmaps word by word.
+
+#define POSTING_ARRAY_MAX       4096            // array containers hold up to this many keys, bigger ones are bitmaps
+#define POSTING_BITMAP_WORDS    1024            // 65536 bits
+
+struct postingContainer {
+    jlong high;                     // key >> 16, the containers are ordered by it
+    int cardinality;
+    int capacity;                   // array containers: allocated entries of lows. 0 for bitmap containers
+    uint16_t *lows;                 // array container: the sorted lower 16 bits of the keys, else NULL
+    uint64_t *bitmap;               // bitmap container: POSTING_BITMAP_WORDS words, else NULL
+};
+
+struct postingList {
+    int count;                      // keys
+    int numContainers;
+    int capacity;                   // allocated containers
+    int padding;
+    struct postingContainer *containers;
+};
+
+struct postingNode {
+    struct postingNode *next;       // same bucket
+    int hash;
+    int length;                     // of the serialized value
+    struct postingList keys;
+    char value[];
+};
+
+struct postingIndex {
+    int size;                       // buckets, a power of 2
+    int shift;                      // 32 - log2(size)
+    int numValues;                  // nodes
+    int count;                      // keys of all nodes
+    struct postingNode **buckets;
+};
+
+// returns NULL if no memory is available
+struct postingIndex *postingCreate(int minSize);
+void postingDestroy(struct postingIndex *pi);
+// removes all entries (but keeps the size)
+void postingClear(struct postingIndex *pi);
+
+// returns the node of the value, or NULL
+struct postingNode *postingFind(const struct postingIndex *pi, int hash, const void *value, int length);
+// returns the node of a value of the given hash which holds key, or NULL
+struct postingNode *postingFindKey(const struct postingIndex *pi, jlong key, int hash);
+// adds key to the value. Returns 0 if OK, 1 if the key was there already, -1 if no memory is available
+int postingInsert(struct postingIndex *pi, jlong key, int hash, const void *value, int length);
+// removes key from the node, and the node, if it becomes empty. Returns 0 if OK, -1 if the node did not hold the key
+int postingRemove(struct postingIndex *pi, struct postingNode *node, jlong key);
+
+// full scans: the nodes of a bucket are linked by next
+static inline int postingScanSlots(const struct postingIndex *pi) {
+    return pi->size;
+}
+static inline struct postingNode *postingScanSlot(const struct postingIndex *pi, int i) {
+    return pi->buckets[i];
+}
+
+// stores up to max keys of the list in ascending order into dest, starting after *after (or at the first key, if after is NULL),
+// after skipping recordsToSkip keys. Returns the number of keys stored.
+int postingCollect(const struct postingList *p, const jlong *after, int recordsToSkip, jlong *dest, int max);
+// stores up to max keys of the intersection (isAnd) or the union of a and b in ascending order into dest,
+// after skipping recordsToSkip keys. Either list can be NULL (empty). Returns the number of keys stored.
+int postingCombine(const struct postingList *a, const struct postingList *b, int isAnd, int recordsToSkip, jlong *dest, int max);
+
+#endif
@@ -0,0 +1,311 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "jpawProbe.h"
+
+// control byte values. Used slots store the lower 7 bits of the hash (0..127), i.e. the sign bit is set for free slots only.
+#define CTRL_EMPTY              ((signed char)-128)
+#define CTRL_DELETED            ((signed char)-2)
+
+#define PROBE_MIN_CAPACITY      PROBE_GROUP_SIZE
+#define PROBE_MAX_CAPACITY      0x40000000
+#define PROBE_MIGRATE_PER_STEP  256         // slots of the previous table migrated per modifying call
+
+// the load limit is 7/8 of the capacity, counting tombstones
+#define LOAD_LIMIT(capacity)    ((capacity) - ((capacity) >> 3))
+
+
+static inline uint64_t probeHash(jlong key) {
+    uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15uLL;
+    return h ^ (h >> 32);
+}
+
+#define H1(hash)        ((hash) >> 7)
+#define H2(hash)        ((signed char)((hash) & 0x7f))
+
+
+// group matching. Returns a bitmask with one bit per slot of the group.
+#ifdef __SSE2__
+static inline int matchTag(const signed char *group, signed char tag) {
+    __m128i ctrl = _mm_load_si128((const __m128i *)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+}
+static inline int matchEmpty(const signed char *group) {
+    return matchTag(group, CTRL_EMPTY);
+}
+static inline int matchFree(const signed char *group) {
+    // empty or deleted: these are the only control bytes with the sign bit set
+    return _mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+}
+#else
+static inline int matchTag(const signed char *group, signed char tag) {
+    int mask = 0;
+    for (int i = 0; i < PROBE_GROUP_SIZE; ++i)
+        if (group[i] == tag)
+            mask |= 1 << i;
+    return mask;
+}
+static inline int matchEmpty(const signed char *group) {
+    return matchTag(group, CTRL_EMPTY);
+}
+static inline int matchFree(const signed char *group) {
+    int mask = 0;
+    for (int i = 0; i < PROBE_GROUP_SIZE; ++i)
+        if (group[i] < 0)
+            mask |= 1 << i;
+    return mask;
+}
+#endif
+
+
+static int allocTable(struct probeTable *t, int capacity) {
+    // slots first: malloc returns 16 byte aligned memory, and the size of the slot array is a multiple of 16, so the control bytes are aligned as well
+    char *mem = malloc((size_t)capacity * (sizeof(struct probeSlot) + 1));
+    if (!mem)
+        return -1;
+    t->slots = (struct probeSlot *)mem;
+    t->ctrl = (signed char *)(mem + (size_t)capacity * sizeof(struct probeSlot));
+    memset(t->ctrl, CTRL_EMPTY, capacity);
+    t->capacity = capacity;
+    t->count = 0;
+    t->used = 0;
+    t->padding = 0;
+    return 0;
+}
+
+static void freeTable(struct probeTable *t) {
+    if (t->capacity)
+        free(t->slots);
+    memset(t, 0, sizeof(struct probeTable));
+}
+
+static int roundUpCapacity(int minCapacity) {
+    int capacity = PROBE_MIN_CAPACITY;
+    while (capacity < minCapacity && capacity < PROBE_MAX_CAPACITY)
+        capacity <<= 1;
+    return capacity;
+}
+
+// returns the slot index of key, or -1
+static int findInTable(const struct probeTable *t, jlong key, uint64_t hash) {
+    if (!t->count)
+        return -1;
+    const int groupMask = (t->capacity / PROBE_GROUP_SIZE) - 1;
+    const signed char tag = H2(hash);
+    int group = (int)H1(hash) & groupMask;
+    for (int step = 1; ; ++step) {
+        const signed char *ctrl = t->ctrl + group * PROBE_GROUP_SIZE;
+        int match = matchTag(ctrl, tag);
+        while (match) {
+            int i = group * PROBE_GROUP_SIZE + __builtin_ctz(match);
+            if (t->slots[i].key == key)
+                return i;
+            match &= match - 1;
+        }
+        if (matchEmpty(ctrl))
+            return -1;                          // an empty slot terminates the probe sequence
+        if (step > groupMask)
+            return -1;                          // all groups visited
+        group = (group + step) & groupMask;     // triangular probing visits every group once
+    }
+}
+
+// inserts a key known to be absent. There must be a free slot.
+static void insertNew(struct probeTable *t, jlong key, void *entry, uint64_t hash) {
+    const int groupMask = (t->capacity / PROBE_GROUP_SIZE) - 1;
+    int group = (int)H1(hash) & groupMask;
+    for (int step = 1; ; ++step) {
+        signed char *ctrl = t->ctrl + group * PROBE_GROUP_SIZE;
+        int free = matchFree(ctrl);
+        if (free) {
+            int i = group * PROBE_GROUP_SIZE + __builtin_ctz(free);
+            if (t->ctrl[i] == CTRL_EMPTY)
+                ++t->used;
+            t->ctrl[i] = H2(hash);
+            t->slots[i].key = key;
+            t->slots[i].entry = entry;
+            ++t->count;
+            return;
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+static void eraseSlot(struct probeTable *t, int i) {
+    // if the group still has an empty slot, no probe sequence ever continued past this group, and the slot can become empty again
+    const signed char *group = t->ctrl + (i & ~(PROBE_GROUP_SIZE - 1));
+    if (matchEmpty(group)) {
+        t->ctrl[i] = CTRL_EMPTY;
+        --t->used;
+    } else {
+        t->ctrl[i] = CTRL_DELETED;
+    }
+    --t->count;
+}
+
+static void migrateStep(struct probeMap *pm, int slotsToMigrate) {
+    struct probeTable *prev = &pm->previous;
+    int end = pm->migratePosition + slotsToMigrate;
+    if (end > prev->capacity)
+        end = prev->capacity;
+    for (int i = pm->migratePosition; i < end; ++i) {
+        if (prev->ctrl[i] >= 0) {
+            insertNew(&pm->current, prev->slots[i].key, prev->slots[i].entry, probeHash(prev->slots[i].key));
+            prev->ctrl[i] = CTRL_DELETED;   // keep the probe sequences of the remaining entries intact
+            --prev->count;
+        }
+    }
+    pm->migratePosition = end;
+    if (end >= prev->capacity) {
+        freeTable(prev);
+        pm->migratePosition = 0;
+    }
+}
+
+struct probeMap *probeCreate(int minCapacity) {
+    struct probeMap *pm = malloc(sizeof(struct probeMap));
+    if (!pm)
+        return NULL;
+    memset(pm, 0, sizeof(struct probeMap));
+    // the requested size is a number of entries. Allow for the load limit.
+    if (allocTable(&pm->current, roundUpCapacity(minCapacity + (minCapacity >> 3)))) {
+        free(pm);
+        return NULL;
+    }
+    return pm;
+}
+
+void probeDestroy(struct probeMap *pm) {
+    freeTable(&pm->current);
+    freeTable(&pm->previous);
+    free(pm);
+}
+
+void probeClear(struct probeMap *pm) {
+    freeTable(&pm->previous);
+    pm->migratePosition = 0;
+    memset(pm->current.ctrl, CTRL_EMPTY, pm->current.capacity);
+    pm->current.count = 0;
+    pm->current.used = 0;
+    pm->count = 0;
+}
+
+void probePresize(struct probeMap *pm, int numEntries) {
+    int capacity = roundUpCapacity(numEntries + (numEntries >> 3) + 1);
+    if (pm->count || capacity <= pm->current.capacity)
+        return;
+    struct probeTable t;
+    if (allocTable(&t, capacity))
+        return;     // continue with the current table
+    freeTable(&pm->current);
+    freeTable(&pm->previous);
+    pm->migratePosition = 0;
+    pm->current = t;
+}
+
+int probeReserve(struct probeMap *pm) {
+    if (pm->previous.capacity) {
+        migrateStep(pm, PROBE_MIGRATE_PER_STEP);
+        if (pm->current.used < LOAD_LIMIT(pm->current.capacity))
+            return 0;
+        // the new table filled up before the migration completed. Should not happen for regular growth, but finish it now.
+        migrateStep(pm, pm->previous.capacity);
+    }
+    struct probeTable *t = &pm->current;
+    if (t->used < LOAD_LIMIT(t->capacity))
+        return 0;
+    // start a migration: double the size, unless the load is caused mainly by tombstones
+    int newCapacity = t->count >= (t->capacity >> 1) - (t->capacity >> 4) && t->capacity < PROBE_MAX_CAPACITY ? t->capacity << 1 : t->capacity;
+    struct probeTable newTable;
+    if (allocTable(&newTable, newCapacity))
+        return t->used < t->capacity ? 0 : -1;      // no memory: keep going beyond the load limit, as long as empty slots exist
+    pm->previous = *t;
+    pm->current = newTable;
+    pm->migratePosition = 0;
+    migrateStep(pm, PROBE_MIGRATE_PER_STEP);
+    return 0;
+}
+
+void *probeGet(const struct probeMap *pm, jlong key) {
+    uint64_t hash = probeHash(key);
+    int i = findInTable(&pm->current, key, hash);
+    if (i >= 0)
+        return pm->current.slots[i].entry;
+    if (pm->previous.capacity) {
+        i = findInTable(&pm->previous, key, hash);
+        if (i >= 0)
+            return pm->previous.slots[i].entry;
+    }
+    return NULL;
+}
+
+void probePrefetch(const struct probeMap *pm, jlong key) {
+    const struct probeTable *t = &pm->current;
+    int i = ((int)H1(probeHash(key)) & ((t->capacity / PROBE_GROUP_SIZE) - 1)) * PROBE_GROUP_SIZE;
+    __builtin_prefetch(t->ctrl + i);
+    __builtin_prefetch(t->slots + i);
+}
+
+void *probeSet(struct probeMap *pm, jlong key, void *entry) {
+    uint64_t hash = probeHash(key);
+    int i = findInTable(&pm->current, key, hash);
+    if (i >= 0) {
+        void *old = pm->current.slots[i].entry;
+        pm->current.slots[i].entry = entry;
+        return old;
+    }
+    void *old = NULL;
+    if (pm->previous.capacity) {
+        i = findInTable(&pm->previous, key, hash);
+        if (i >= 0) {
+            // not yet migrated: move it over now
+            old = pm->previous.slots[i].entry;
+            eraseSlot(&pm->previous, i);
+            --pm->count;
+        }
+    }
+    insertNew(&pm->current, key, entry, hash);
+    ++pm->count;
+    return old;
+}
+
+void *probeRemove(struct probeMap *pm, jlong key) {
+    uint64_t hash = probeHash(key);
+    struct probeTable *t = &pm->current;
+    int i = findInTable(t, key, hash);
+    if (i < 0 && pm->previous.capacity) {
+        t = &pm->previous;
+        i = findInTable(t, key, hash);
+    }
+    if (i < 0)
+        return NULL;
+    void *old = t->slots[i].entry;
+    eraseSlot(t, i);
+    --pm->count;
+    return old;
+}
+
+int probeScanSlots(const struct probeMap *pm) {
+    return pm->current.capacity + pm->previous.capacity;
+}
+
+void *probeScanSlot(const struct probeMap *pm, int i) {
+    const struct probeTable *t = &pm->current;
+    if (i >= t->capacity) {
+        i -= t->capacity;
+        t = &pm->previous;
+    }
+    return t->ctrl[i] >= 0 ? t->slots[i].entry : NULL;
+}
+
+jlong probeScanKey(const struct probeMap *pm, int i) {
+    const struct probeTable *t = &pm->current;
+    if (i >= t->capacity) {
+        i -= t->capacity;
+        t = &pm->previous;
+    }
+    return t->slots[i].key;
+}
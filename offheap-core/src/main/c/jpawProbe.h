@@ -0,0 +1,61 @@
+#ifndef _Included_jpawProbe
+#define _Included_jpawProbe
+
+#include <jni.h>
+
+// Open addressing hash table engine, as an alternative to the hash chains of struct map.
+// Slots are organized in groups of 16. A separate control byte per slot holds 7 bits of the hash (or the empty / deleted marker),
+// a whole group is compared at once using SSE2. The slot array holds the key next to the payload pointer, so
+// a lookup touches the entry only once it has been found.
+// The table does not interpret the payload pointers, they are owned by the caller.
+
+#define PROBE_GROUP_SIZE        16
+
+struct probeSlot {
+    jlong key;
+    void *entry;
+};
+
+struct probeTable {
+    int capacity;                   // number of slots, a power of 2, at least PROBE_GROUP_SIZE. 0 if not allocated
+    int count;                      // slots in use
+    int used;                       // slots in use plus deleted slots (tombstones)
+    int padding;
+    signed char *ctrl;              // capacity control bytes, followed by capacity slots, in a single allocation
+    struct probeSlot *slots;
+};
+
+// A table growing incrementally: once the load limit has been reached, a new table is allocated, and with every following
+// modifying operation, a portion of the previous table is migrated. Lookups check both tables during that phase.
+struct probeMap {
+    struct probeTable current;
+    struct probeTable previous;     // table being migrated, capacity 0 if no migration is in progress
+    int migratePosition;            // slots of previous below this index have been migrated
+    int count;                      // total number of entries
+};
+
+// returns NULL if no memory is available
+struct probeMap *probeCreate(int minCapacity);
+void probeDestroy(struct probeMap *pm);
+// removes all entries (but keeps the size)
+void probeClear(struct probeMap *pm);
+// resizes an empty table to hold numEntries without migrations
+void probePresize(struct probeMap *pm, int numEntries);
+// returns 0 if there is space for at least one more entry (possibly after growing the table), else -1
+int probeReserve(struct probeMap *pm);
+
+void *probeGet(const struct probeMap *pm, jlong key);
+// issues prefetches for the first group probed for key, in preparation of a subsequent probeGet()
+void probePrefetch(const struct probeMap *pm, jlong key);
+// inserts or replaces the entry for key, returns the replaced entry or NULL. Requires a prior successful probeReserve().
+void *probeSet(struct probeMap *pm, jlong key, void *entry);
+// removes the entry for key and returns it, or NULL if no entry existed
+void *probeRemove(struct probeMap *pm, jlong key);
+
+// full scans: slot numbers run over the current table, followed by the one being migrated
+int probeScanSlots(const struct probeMap *pm);
+void *probeScanSlot(const struct probeMap *pm, int i);
+// the key of a slot for which probeScanSlot() returned an entry
+jlong probeScanKey(const struct probeMap *pm, int i);
+
+#endif
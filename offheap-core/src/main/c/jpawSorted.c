@@ -0,0 +1,351 @@
+#include <stdlib.h>
+#include <string.h>
+#include "jpawSorted.h"
+
+
+int sortedCompareValues(const void *a, int aLength, const void *b, int bLength) {
+    int n = aLength < bLength ? aLength : bLength;
+    int r = n ? memcmp(a, b, n) : 0;
+    if (r)
+        return r;
+    return aLength < bLength ? -1 : aLength > bLength ? 1 : 0;
+}
+
+static int compareKeys(const struct sortKey *a, const struct sortKey *b) {
+    int r = sortedCompareValues(a->data, a->length, b->data, b->length);
+    if (r)
+        return r;
+    return a->key < b->key ? -1 : a->key > b->key ? 1 : 0;
+}
+
+// the first 8 bytes of the value, big endian and zero padded, such that unsigned comparison matches memcmp (up to ties)
+static inline uint64_t prefixOf(const struct sortKey *k) {
+    const unsigned char *d = k->data;
+    uint64_t p = 0;
+    int i;
+    for (i = 0; i < 8; ++i)
+        p = (p << 8) | (i < k->length ? d[i] : 0);
+    return p;
+}
+
+static inline int compareSlot(const struct sortedTree *t, const struct sortKey *k, uint64_t kPrefix, uint64_t prefix, const void *entry) {
+    if (kPrefix != prefix)
+        return kPrefix < prefix ? -1 : 1;
+    struct sortKey e;
+    t->getKey(entry, &e);
+    return compareKeys(k, &e);
+}
+
+// number of slots < k
+static int lowerBound(const struct sortedTree *t, const uint64_t *prefixes, void * const *entries, int count, const struct sortKey *k, uint64_t kPrefix) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (compareSlot(t, k, kPrefix, prefixes[mid], entries[mid]) > 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// number of slots <= k
+static int upperBound(const struct sortedTree *t, const uint64_t *prefixes, void * const *entries, int count, const struct sortKey *k, uint64_t kPrefix) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (compareSlot(t, k, kPrefix, prefixes[mid], entries[mid]) >= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// frees a subtree, except the leaf keep
+static void freeNode(void *node, int height, const struct sortedLeaf *keep) {
+    if (height) {
+        struct sortedInner *inner = node;
+        int i;
+        for (i = 0; i <= inner->count; ++i)
+            freeNode(inner->children[i], height - 1, keep);
+    }
+    if (node != keep)
+        free(node);
+}
+
+
+struct sortedTree *sortedCreate(sortKeyGetter getKey) {
+    struct sortedTree *t = malloc(sizeof(struct sortedTree));
+    if (!t)
+        return NULL;
+    memset(t, 0, sizeof(struct sortedTree));
+    struct sortedLeaf *leaf = malloc(sizeof(struct sortedLeaf));
+    if (!leaf) {
+        free(t);
+        return NULL;
+    }
+    leaf->count = 0;
+    leaf->prev = NULL;
+    leaf->next = NULL;
+    t->root = leaf;
+    t->first = leaf;
+    t->getKey = getKey;
+    return t;
+}
+
+void sortedDestroy(struct sortedTree *t) {
+    freeNode(t->root, t->height, NULL);
+    int i;
+    for (i = 0; i < t->numSpareInner; ++i)
+        free(t->spareInner[i]);
+    free(t->spareLeaf);
+    free(t);
+}
+
+void sortedClear(struct sortedTree *t) {
+    // keep the first leaf as the (empty) root
+    struct sortedLeaf *root = t->first;
+    freeNode(t->root, t->height, root);
+    root->count = 0;
+    root->prev = NULL;
+    root->next = NULL;
+    t->root = root;
+    t->height = 0;
+    t->count = 0;
+}
+
+int sortedReserve(struct sortedTree *t) {
+    // an insert splits at most one leaf and one inner node per level, plus a new root
+    if (!t->spareLeaf) {
+        t->spareLeaf = malloc(sizeof(struct sortedLeaf));
+        if (!t->spareLeaf)
+            return -1;
+    }
+    while (t->numSpareInner <= t->height) {
+        if (t->height >= SORTED_MAX_HEIGHT)
+            return -1;
+        struct sortedInner *inner = malloc(sizeof(struct sortedInner));
+        if (!inner)
+            return -1;
+        t->spareInner[t->numSpareInner++] = inner;
+    }
+    return 0;
+}
+
+
+// inserts a separator and its right child at position pos of an inner node, splitting it if full.
+// Returns the new right sibling and sets the separator to move up, or returns NULL if the node had room.
+static struct sortedInner *insertInner(struct sortedTree *t, struct sortedInner *node, int pos, uint64_t prefix, void *separator, void *child,
+  jboolean append, uint64_t *upPrefix, void **upSeparator) {
+    if (node->count < SORTED_NODE_SIZE) {
+        memmove(node->prefixes + pos + 1, node->prefixes + pos, (node->count - pos) * sizeof(uint64_t));
+        memmove(node->separators + pos + 1, node->separators + pos, (node->count - pos) * sizeof(void *));
+        memmove(node->children + pos + 2, node->children + pos + 1, (node->count - pos) * sizeof(void *));
+        node->prefixes[pos] = prefix;
+        node->separators[pos] = separator;
+        node->children[pos + 1] = child;
+        ++node->count;
+        return NULL;
+    }
+    uint64_t prefixes[SORTED_NODE_SIZE + 1];
+    void *separators[SORTED_NODE_SIZE + 1];
+    void *children[SORTED_NODE_SIZE + 2];
+    memcpy(prefixes, node->prefixes, pos * sizeof(uint64_t));
+    memcpy(separators, node->separators, pos * sizeof(void *));
+    prefixes[pos] = prefix;
+    separators[pos] = separator;
+    memcpy(prefixes + pos + 1, node->prefixes + pos, (SORTED_NODE_SIZE - pos) * sizeof(uint64_t));
+    memcpy(separators + pos + 1, node->separators + pos, (SORTED_NODE_SIZE - pos) * sizeof(void *));
+    memcpy(children, node->children, (pos + 1) * sizeof(void *));
+    children[pos + 1] = child;
+    memcpy(children + pos + 2, node->children + pos + 1, (SORTED_NODE_SIZE - pos) * sizeof(void *));
+    // the separator at position mid moves up. Appends leave the left node full
+    int mid = append ? SORTED_NODE_SIZE : SORTED_NODE_SIZE / 2;
+    struct sortedInner *right = t->spareInner[--t->numSpareInner];
+    node->count = mid;
+    memcpy(node->prefixes, prefixes, mid * sizeof(uint64_t));
+    memcpy(node->separators, separators, mid * sizeof(void *));
+    memcpy(node->children, children, (mid + 1) * sizeof(void *));
+    right->count = SORTED_NODE_SIZE - mid;
+    memcpy(right->prefixes, prefixes + mid + 1, right->count * sizeof(uint64_t));
+    memcpy(right->separators, separators + mid + 1, right->count * sizeof(void *));
+    memcpy(right->children, children + mid + 1, (right->count + 1) * sizeof(void *));
+    *upPrefix = prefixes[mid];
+    *upSeparator = separators[mid];
+    return right;
+}
+
+void sortedInsert(struct sortedTree *t, void *entry) {
+    struct sortKey k;
+    t->getKey(entry, &k);
+    uint64_t kPrefix = prefixOf(&k);
+    struct sortedInner *path[SORTED_MAX_HEIGHT];
+    int pathPos[SORTED_MAX_HEIGHT];
+    jboolean rightmost = JNI_TRUE;
+    void *node = t->root;
+    int h;
+    for (h = 0; h < t->height; ++h) {
+        struct sortedInner *inner = node;
+        path[h] = inner;
+        pathPos[h] = upperBound(t, inner->prefixes, inner->separators, inner->count, &k, kPrefix);
+        rightmost = rightmost && pathPos[h] == inner->count;
+        node = inner->children[pathPos[h]];
+    }
+    struct sortedLeaf *leaf = node;
+    int pos = lowerBound(t, leaf->prefixes, leaf->entries, leaf->count, &k, kPrefix);
+    ++t->count;
+    if (leaf->count < SORTED_NODE_SIZE) {
+        memmove(leaf->prefixes + pos + 1, leaf->prefixes + pos, (leaf->count - pos) * sizeof(uint64_t));
+        memmove(leaf->entries + pos + 1, leaf->entries + pos, (leaf->count - pos) * sizeof(void *));
+        leaf->prefixes[pos] = kPrefix;
+        leaf->entries[pos] = entry;
+        ++leaf->count;
+        return;
+    }
+
+    // split the leaf. Appends to the last leaf move the new entry only
+    jboolean append = rightmost && pos == SORTED_NODE_SIZE;
+    struct sortedLeaf *right = t->spareLeaf;
+    t->spareLeaf = NULL;
+    int mid = append ? SORTED_NODE_SIZE : SORTED_NODE_SIZE / 2;
+    right->count = SORTED_NODE_SIZE - mid;
+    memcpy(right->prefixes, leaf->prefixes + mid, right->count * sizeof(uint64_t));
+    memcpy(right->entries, leaf->entries + mid, right->count * sizeof(void *));
+    leaf->count = mid;
+    struct sortedLeaf *target = pos <= mid && !append ? leaf : right;
+    int targetPos = target == leaf ? pos : pos - mid;
+    memmove(target->prefixes + targetPos + 1, target->prefixes + targetPos, (target->count - targetPos) * sizeof(uint64_t));
+    memmove(target->entries + targetPos + 1, target->entries + targetPos, (target->count - targetPos) * sizeof(void *));
+    target->prefixes[targetPos] = kPrefix;
+    target->entries[targetPos] = entry;
+    ++target->count;
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next)
+        leaf->next->prev = right;
+    leaf->next = right;
+
+    // insert the separator into the parents
+    uint64_t upPrefix = right->prefixes[0];
+    void *upSeparator = right->entries[0];
+    void *newChild = right;
+    for (h = t->height - 1; h >= 0; --h) {
+        struct sortedInner *sibling = insertInner(t, path[h], pathPos[h], upPrefix, upSeparator, newChild, append, &upPrefix, &upSeparator);
+        if (!sibling)
+            return;
+        newChild = sibling;
+    }
+    // new root
+    struct sortedInner *root = t->spareInner[--t->numSpareInner];
+    root->count = 1;
+    root->prefixes[0] = upPrefix;
+    root->separators[0] = upSeparator;
+    root->children[0] = t->root;
+    root->children[1] = newChild;
+    t->root = root;
+    ++t->height;
+}
+
+int sortedRemove(struct sortedTree *t, void *entry) {
+    struct sortKey k;
+    t->getKey(entry, &k);
+    uint64_t kPrefix = prefixOf(&k);
+    struct sortedInner *path[SORTED_MAX_HEIGHT];
+    int pathPos[SORTED_MAX_HEIGHT];
+    void *node = t->root;
+    int h;
+    for (h = 0; h < t->height; ++h) {
+        struct sortedInner *inner = node;
+        path[h] = inner;
+        pathPos[h] = upperBound(t, inner->prefixes, inner->separators, inner->count, &k, kPrefix);
+        node = inner->children[pathPos[h]];
+    }
+    struct sortedLeaf *leaf = node;
+    int pos = lowerBound(t, leaf->prefixes, leaf->entries, leaf->count, &k, kPrefix);
+    if (pos >= leaf->count || leaf->entries[pos] != entry)
+        return -1;
+    --leaf->count;
+    memmove(leaf->prefixes + pos, leaf->prefixes + pos + 1, (leaf->count - pos) * sizeof(uint64_t));
+    memmove(leaf->entries + pos, leaf->entries + pos + 1, (leaf->count - pos) * sizeof(void *));
+    --t->count;
+
+    if (!pos && t->height) {
+        // the smallest entry of a leaf can be the separator of some subtree: replace it by the successor.
+        // If the subtree becomes empty, the separator is removed below.
+        const struct sortedLeaf *s = leaf->count ? leaf : leaf->next;
+        for (h = t->height - 1; h >= 0; --h) {
+            struct sortedInner *inner = path[h];
+            if (pathPos[h] && inner->separators[pathPos[h] - 1] == entry) {
+                inner->separators[pathPos[h] - 1] = s ? s->entries[0] : NULL;
+                inner->prefixes[pathPos[h] - 1] = s ? s->prefixes[0] : 0;
+                break;
+            }
+        }
+    }
+    if (leaf->count || !t->height)
+        return 0;
+
+    // remove the empty leaf, and inner nodes which lose their last child
+    if (leaf->prev)
+        leaf->prev->next = leaf->next;
+    else
+        t->first = leaf->next;
+    if (leaf->next)
+        leaf->next->prev = leaf->prev;
+    free(leaf);
+    for (h = t->height - 1; h >= 0; --h) {
+        struct sortedInner *inner = path[h];
+        int i = pathPos[h];
+        if (inner->count) {
+            // child i goes away, together with the separator to its left (or right, for the first child)
+            int s = i ? i - 1 : 0;
+            memmove(inner->prefixes + s, inner->prefixes + s + 1, (inner->count - s - 1) * sizeof(uint64_t));
+            memmove(inner->separators + s, inner->separators + s + 1, (inner->count - s - 1) * sizeof(void *));
+            memmove(inner->children + i, inner->children + i + 1, (inner->count - i) * sizeof(void *));
+            --inner->count;
+            break;
+        }
+        free(inner);        // that was the only child
+    }
+    // shrink the tree while the root has a single child
+    while (t->height && !((struct sortedInner *)t->root)->count) {
+        struct sortedInner *root = t->root;
+        t->root = root->children[0];
+        --t->height;
+        free(root);
+    }
+    return 0;
+}
+
+
+void *sortedSeek(const struct sortedTree *t, const struct sortKey *k, struct sortedCursor *c) {
+    uint64_t kPrefix = prefixOf(k);
+    const void *node = t->root;
+    int h;
+    for (h = t->height; h > 0; --h) {
+        const struct sortedInner *inner = node;
+        node = inner->children[upperBound(t, inner->prefixes, inner->separators, inner->count, k, kPrefix)];
+    }
+    const struct sortedLeaf *leaf = node;
+    c->leaf = leaf;
+    c->pos = lowerBound(t, leaf->prefixes, leaf->entries, leaf->count, k, kPrefix);
+    if (c->pos < leaf->count)
+        return leaf->entries[c->pos];
+    // all entries of this leaf are smaller. Leaves other than the root are never empty
+    c->leaf = leaf->next;
+    c->pos = 0;
+    return c->leaf ? c->leaf->entries[0] : NULL;
+}
+
+void *sortedNext(struct sortedCursor *c) {
+    if (!c->leaf)
+        return NULL;
+    if (++c->pos >= c->leaf->count) {
+        c->leaf = c->leaf->next;
+        c->pos = 0;
+        if (!c->leaf)
+            return NULL;
+    }
+    return c->leaf->entries[c->pos];
+}
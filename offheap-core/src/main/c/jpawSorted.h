@@ -0,0 +1,82 @@
+#ifndef _Included_jpawSorted
+#define _Included_jpawSorted
+
+#include <stdint.h>
+#include <jni.h>
+
+// Ordered set of index entries (B+tree), sorted by their serialized index value (memcmp order, shorter values first on a
+// common prefix), and by the primary key for equal values. Used by ordered index maps next to their hash chains, for range
+// and prefix scans. The tree does not know the layout of an entry, it obtains value and key by a callback.
+// The separators of inner nodes are entries of the tree (the smallest one of the subtree to their right), and are replaced
+// when that entry is removed. Every slot caches the first 8 bytes of the value, such that most comparisons do not touch the entry.
+// Nodes are not merged when they become underfull, only empty leaves (and empty inner nodes) are removed.
+
+#define SORTED_NODE_SIZE        32
+#define SORTED_MAX_HEIGHT       16      // inner levels
+
+struct sortKey {
+    const void *data;
+    int length;
+    int padding;
+    jlong key;                          // primary key, orders entries of equal value
+};
+
+typedef void (*sortKeyGetter)(const void *entry, struct sortKey *k);
+
+struct sortedLeaf {
+    int count;
+    int padding;
+    struct sortedLeaf *prev;            // leaves in value order
+    struct sortedLeaf *next;
+    uint64_t prefixes[SORTED_NODE_SIZE];
+    void *entries[SORTED_NODE_SIZE];
+};
+
+struct sortedInner {
+    int count;                          // number of separators. children[i + 1] holds the entries >= separators[i]
+    int padding;
+    uint64_t prefixes[SORTED_NODE_SIZE];
+    void *separators[SORTED_NODE_SIZE];
+    void *children[SORTED_NODE_SIZE + 1];
+};
+
+struct sortedTree {
+    void *root;                         // a leaf if height is 0, else an inner node
+    int height;
+    int count;
+    sortKeyGetter getKey;
+    struct sortedLeaf *first;
+    // nodes allocated by sortedReserve(), such that an insert cannot fail
+    int numSpareInner;
+    int padding;
+    struct sortedLeaf *spareLeaf;
+    struct sortedInner *spareInner[SORTED_MAX_HEIGHT + 1];
+};
+
+// position of an entry, valid until the next modification of the tree
+struct sortedCursor {
+    const struct sortedLeaf *leaf;
+    int pos;
+};
+
+// returns NULL if no memory is available
+struct sortedTree *sortedCreate(sortKeyGetter getKey);
+void sortedDestroy(struct sortedTree *t);
+void sortedClear(struct sortedTree *t);
+// returns 0 if there is space for at least one more entry (possibly after allocating nodes), else -1
+int sortedReserve(struct sortedTree *t);
+
+// adds an entry, which must not be in the tree yet. Requires a prior successful sortedReserve()
+void sortedInsert(struct sortedTree *t, void *entry);
+// removes the entry (by identity). Returns 0 if OK, -1 if it was not found
+int sortedRemove(struct sortedTree *t, void *entry);
+
+// positions the cursor at the first entry >= k, and returns that entry, or NULL if no such entry exists
+void *sortedSeek(const struct sortedTree *t, const struct sortKey *k, struct sortedCursor *c);
+// advances the cursor and returns the next entry, or NULL at the end
+void *sortedNext(struct sortedCursor *c);
+
+// memcmp ordering of values, shorter first on a common prefix
+int sortedCompareValues(const void *a, int aLength, const void *b, int bLength);
+
+#endif
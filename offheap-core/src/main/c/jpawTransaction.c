@@ -14,6 +14,19 @@ struct tx_delayed_update {
 };
 
 
+// adds the committed view of a change to u. Returns JNI_FALSE (after throwing, and discarding u) if the commit cannot be applied
+static jboolean addViewOfChange(JNIEnv *env, struct viewUpdate *u, const struct tx_log_entry *ep) {
+    int rc = viewUpdateAdd(u, ep);
+    if (!rc)
+        return JNI_TRUE;
+    viewUpdateDiscard(u);
+    if (rc == VIEW_UPDATE_NO_MEMORY)
+        throwOutOfMemory(env);
+    else
+        throwAny(env, "A committed view of the transaction is pinned by this thread (a parallel scan is open)");
+    return JNI_FALSE;
+}
+
 // transactions
 
 struct tx_log_entry *getTxLogEntry(JNIEnv *env, struct tx_log_hdr *ctx) {
@@ -183,9 +196,17 @@ JNIEXPORT int JNICALL Java_de_jpaw_offHeap_OffHeapTransaction_natUpdateViews
     int numberOfChanges = upd->numberOfChanges;
     int i;
     struct tx_log_entry *ep = upd->transactions;
+    struct viewUpdate u;
+    viewUpdateInit(&u);
+    for (i = 0; i < numberOfChanges; ++i) {
+        if (!addViewOfChange(env, &u, &upd->transactions[i]))
+            return 0;
+    }
+    beginViewUpdate(&u);
     for (i = 0; i < numberOfChanges; ++i) {
-        commitToView(ep++, hdr->currentTransactionRef);
+        commitToView(ep++, upd->currentTransactionRef);
     }
+    endViewUpdate(&u);
 
     hdr->lastCommittedRefOnViews = upd->currentTransactionRef;
     free(upd);
@@ -218,6 +239,13 @@ JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_OffHeapTransaction_natCommit
 
         struct tx_log_list *chunk = NULL;
         int i;
+        struct viewUpdate u;
+        viewUpdateInit(&u);
+        for (i = 0; i < currentEntries; ++i) {
+            if (!addViewOfChange(env, &u, &(hdr->chunks[i >> 8]->entries[i & 0xff])))
+                return 0;       // nothing has been applied, the transaction stays open
+        }
+        beginViewUpdate(&u);
         for (i = 0; i < currentEntries; ++i) {
             if (!(i & 0xff)) {
                 // need a new chunk
@@ -225,6 +253,7 @@ JNIEXPORT jint JNICALL Java_de_jpaw_offHeap_OffHeapTransaction_natCommit
             }
             commitToView(&(chunk->entries[i & 0xff]), hdr->currentTransactionRef);
         }
+        endViewUpdate(&u);
     }
     hdr->number_of_changes = 0;
     hdr->lastCommittedRef = hdr->currentTransactionRef;
@@ -0,0 +1,388 @@
+#include <stdlib.h>
+#include <string.h>
+#include "jpawTree.h"
+
+#define TREE_MIN_DIRECTORY      64
+
+
+// number of keys < key
+static inline int lowerBound(const jlong *keys, int count, jlong key) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// number of keys <= key
+static inline int upperBound(const jlong *keys, int count, jlong key) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (keys[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static struct treeLeaf *findLeaf(const struct orderedTree *t, jlong key) {
+    void *node = t->root;
+    int h;
+    for (h = t->height; h > 0; --h) {
+        const struct treeInner *inner = node;
+        node = inner->children[upperBound(inner->keys, inner->count, key)];
+    }
+    return node;
+}
+
+static void freeInner(void *node, int height) {
+    if (!height)
+        return;
+    struct treeInner *inner = node;
+    if (height > 1) {
+        int i;
+        for (i = 0; i <= inner->count; ++i)
+            freeInner(inner->children[i], height - 1);
+    }
+    free(inner);
+}
+
+
+// leaf directory
+static int addToDirectory(struct orderedTree *t, struct treeLeaf *leaf) {
+    leaf->index = t->numFreePositions ? t->freePositions[--t->numFreePositions] : t->numLeaves++;
+    t->leaves[leaf->index] = leaf;
+    return leaf->index;
+}
+
+static void removeFromDirectory(struct orderedTree *t, struct treeLeaf *leaf) {
+    t->leaves[leaf->index] = NULL;
+    t->freePositions[t->numFreePositions++] = leaf->index;
+}
+
+static int growDirectory(struct orderedTree *t) {
+    int newCapacity = t->leavesCapacity ? 2 * t->leavesCapacity : TREE_MIN_DIRECTORY;
+    struct treeLeaf **leaves = realloc(t->leaves, newCapacity * sizeof(struct treeLeaf *));
+    if (!leaves)
+        return -1;
+    t->leaves = leaves;
+    int *freePositions = realloc(t->freePositions, newCapacity * sizeof(int));
+    if (!freePositions)
+        return -1;
+    t->freePositions = freePositions;
+    t->leavesCapacity = newCapacity;
+    return 0;
+}
+
+
+struct orderedTree *treeCreate(void) {
+    struct orderedTree *t = malloc(sizeof(struct orderedTree));
+    if (!t)
+        return NULL;
+    memset(t, 0, sizeof(struct orderedTree));
+    struct treeLeaf *leaf = malloc(sizeof(struct treeLeaf));
+    if (!leaf || growDirectory(t)) {
+        free(leaf);
+        free(t->leaves);
+        free(t->freePositions);
+        free(t);
+        return NULL;
+    }
+    leaf->count = 0;
+    leaf->prev = NULL;
+    leaf->next = NULL;
+    addToDirectory(t, leaf);
+    t->root = leaf;
+    t->first = leaf;
+    t->last = leaf;
+    return t;
+}
+
+void treeDestroy(struct orderedTree *t) {
+    freeInner(t->root, t->height);
+    int i;
+    for (i = 0; i < t->numLeaves; ++i)
+        free(t->leaves[i]);
+    for (i = 0; i < t->numSpareInner; ++i)
+        free(t->spareInner[i]);
+    free(t->spareLeaf);
+    free(t->leaves);
+    free(t->freePositions);
+    free(t);
+}
+
+void treeClear(struct orderedTree *t) {
+    // keep the first leaf as the (empty) root
+    struct treeLeaf *root = t->first;
+    freeInner(t->root, t->height);
+    int i;
+    for (i = 0; i < t->numLeaves; ++i)
+        if (t->leaves[i] != root)
+            free(t->leaves[i]);
+    t->numLeaves = 0;
+    t->numFreePositions = 0;
+    root->count = 0;
+    root->prev = NULL;
+    root->next = NULL;
+    addToDirectory(t, root);
+    t->root = root;
+    t->height = 0;
+    t->count = 0;
+    t->first = root;
+    t->last = root;
+}
+
+int treeReserve(struct orderedTree *t) {
+    // an insert splits at most one leaf and one inner node per level, plus a new root
+    if (!t->spareLeaf) {
+        t->spareLeaf = malloc(sizeof(struct treeLeaf));
+        if (!t->spareLeaf)
+            return -1;
+    }
+    while (t->numSpareInner <= t->height) {
+        if (t->height >= TREE_MAX_HEIGHT)
+            return -1;
+        struct treeInner *inner = malloc(sizeof(struct treeInner));
+        if (!inner)
+            return -1;
+        t->spareInner[t->numSpareInner++] = inner;
+    }
+    if (!t->numFreePositions && t->numLeaves >= t->leavesCapacity && growDirectory(t))
+        return -1;
+    return 0;
+}
+
+void *treeGet(const struct orderedTree *t, jlong key) {
+    const struct treeLeaf *leaf = findLeaf(t, key);
+    int pos = lowerBound(leaf->keys, leaf->count, key);
+    return pos < leaf->count && leaf->keys[pos] == key ? leaf->entries[pos] : NULL;
+}
+
+
+// inserts key and right child at position pos (key index) of an inner node, splitting it if full.
+// Returns the new right sibling and sets *upKey, or returns NULL if the node had room.
+static struct treeInner *insertInner(struct orderedTree *t, struct treeInner *node, int pos, jlong key, void *child, jboolean append, jlong *upKey) {
+    if (node->count < TREE_INNER_SIZE) {
+        memmove(node->keys + pos + 1, node->keys + pos, (node->count - pos) * sizeof(jlong));
+        memmove(node->children + pos + 2, node->children + pos + 1, (node->count - pos) * sizeof(void *));
+        node->keys[pos] = key;
+        node->children[pos + 1] = child;
+        ++node->count;
+        return NULL;
+    }
+    jlong keys[TREE_INNER_SIZE + 1];
+    void *children[TREE_INNER_SIZE + 2];
+    memcpy(keys, node->keys, pos * sizeof(jlong));
+    keys[pos] = key;
+    memcpy(keys + pos + 1, node->keys + pos, (TREE_INNER_SIZE - pos) * sizeof(jlong));
+    memcpy(children, node->children, (pos + 1) * sizeof(void *));
+    children[pos + 1] = child;
+    memcpy(children + pos + 2, node->children + pos + 1, (TREE_INNER_SIZE - pos) * sizeof(void *));
+    // the key at position mid moves up. Appends leave the left node full
+    int mid = append ? TREE_INNER_SIZE : TREE_INNER_SIZE / 2;
+    struct treeInner *right = t->spareInner[--t->numSpareInner];
+    node->count = mid;
+    memcpy(node->keys, keys, mid * sizeof(jlong));
+    memcpy(node->children, children, (mid + 1) * sizeof(void *));
+    right->count = TREE_INNER_SIZE - mid;
+    memcpy(right->keys, keys + mid + 1, right->count * sizeof(jlong));
+    memcpy(right->children, children + mid + 1, (right->count + 1) * sizeof(void *));
+    *upKey = keys[mid];
+    return right;
+}
+
+void *treeSet(struct orderedTree *t, jlong key, void *entry) {
+    struct treeInner *path[TREE_MAX_HEIGHT];
+    int pathPos[TREE_MAX_HEIGHT];
+    jboolean rightmost = JNI_TRUE;
+    void *node = t->root;
+    int h;
+    for (h = 0; h < t->height; ++h) {
+        struct treeInner *inner = node;
+        path[h] = inner;
+        pathPos[h] = upperBound(inner->keys, inner->count, key);
+        rightmost = rightmost && pathPos[h] == inner->count;
+        node = inner->children[pathPos[h]];
+    }
+    struct treeLeaf *leaf = node;
+    int pos = lowerBound(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && leaf->keys[pos] == key) {
+        void *old = leaf->entries[pos];
+        leaf->entries[pos] = entry;
+        return old;
+    }
+    ++t->count;
+    if (leaf->count < TREE_LEAF_SIZE) {
+        memmove(leaf->keys + pos + 1, leaf->keys + pos, (leaf->count - pos) * sizeof(jlong));
+        memmove(leaf->entries + pos + 1, leaf->entries + pos, (leaf->count - pos) * sizeof(void *));
+        leaf->keys[pos] = key;
+        leaf->entries[pos] = entry;
+        ++leaf->count;
+        return NULL;
+    }
+
+    // split the leaf. Appends to the last leaf move the new key only
+    jboolean append = rightmost && pos == TREE_LEAF_SIZE;
+    struct treeLeaf *right = t->spareLeaf;
+    t->spareLeaf = NULL;
+    int mid = append ? TREE_LEAF_SIZE : TREE_LEAF_SIZE / 2;
+    right->count = TREE_LEAF_SIZE - mid;
+    memcpy(right->keys, leaf->keys + mid, right->count * sizeof(jlong));
+    memcpy(right->entries, leaf->entries + mid, right->count * sizeof(void *));
+    leaf->count = mid;
+    struct treeLeaf *target = pos <= mid && !append ? leaf : right;
+    int targetPos = target == leaf ? pos : pos - mid;
+    memmove(target->keys + targetPos + 1, target->keys + targetPos, (target->count - targetPos) * sizeof(jlong));
+    memmove(target->entries + targetPos + 1, target->entries + targetPos, (target->count - targetPos) * sizeof(void *));
+    target->keys[targetPos] = key;
+    target->entries[targetPos] = entry;
+    ++target->count;
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next)
+        leaf->next->prev = right;
+    else
+        t->last = right;
+    leaf->next = right;
+    addToDirectory(t, right);
+
+    // insert the separator into the parents
+    jlong upKey = right->keys[0];
+    void *newChild = right;
+    for (h = t->height - 1; h >= 0; --h) {
+        struct treeInner *sibling = insertInner(t, path[h], pathPos[h], upKey, newChild, append, &upKey);
+        if (!sibling)
+            return NULL;
+        newChild = sibling;
+    }
+    // new root
+    struct treeInner *root = t->spareInner[--t->numSpareInner];
+    root->count = 1;
+    root->keys[0] = upKey;
+    root->children[0] = t->root;
+    root->children[1] = newChild;
+    t->root = root;
+    ++t->height;
+    return NULL;
+}
+
+void *treeRemove(struct orderedTree *t, jlong key) {
+    struct treeInner *path[TREE_MAX_HEIGHT];
+    int pathPos[TREE_MAX_HEIGHT];
+    void *node = t->root;
+    int h;
+    for (h = 0; h < t->height; ++h) {
+        struct treeInner *inner = node;
+        path[h] = inner;
+        pathPos[h] = upperBound(inner->keys, inner->count, key);
+        node = inner->children[pathPos[h]];
+    }
+    struct treeLeaf *leaf = node;
+    int pos = lowerBound(leaf->keys, leaf->count, key);
+    if (pos >= leaf->count || leaf->keys[pos] != key)
+        return NULL;
+    void *old = leaf->entries[pos];
+    --leaf->count;
+    memmove(leaf->keys + pos, leaf->keys + pos + 1, (leaf->count - pos) * sizeof(jlong));
+    memmove(leaf->entries + pos, leaf->entries + pos + 1, (leaf->count - pos) * sizeof(void *));
+    --t->count;
+    if (leaf->count || !t->height)
+        return old;
+
+    // remove the empty leaf, and inner nodes which lose their last child
+    if (leaf->prev)
+        leaf->prev->next = leaf->next;
+    else
+        t->first = leaf->next;
+    if (leaf->next)
+        leaf->next->prev = leaf->prev;
+    else
+        t->last = leaf->prev;
+    removeFromDirectory(t, leaf);
+    free(leaf);
+    for (h = t->height - 1; h >= 0; --h) {
+        struct treeInner *inner = path[h];
+        int i = pathPos[h];
+        if (inner->count) {
+            // child i goes away, together with the separator to its left (or right, for the first child)
+            int k = i ? i - 1 : 0;
+            memmove(inner->keys + k, inner->keys + k + 1, (inner->count - k - 1) * sizeof(jlong));
+            memmove(inner->children + i, inner->children + i + 1, (inner->count - i) * sizeof(void *));
+            --inner->count;
+            break;
+        }
+        free(inner);        // that was the only child
+    }
+    // shrink the tree while the root has a single child
+    while (t->height && !((struct treeInner *)t->root)->count) {
+        struct treeInner *root = t->root;
+        t->root = root->children[0];
+        --t->height;
+        free(root);
+    }
+    return old;
+}
+
+
+void *treeFloor(const struct orderedTree *t, jlong key) {
+    const struct treeLeaf *leaf = findLeaf(t, key);
+    int pos = upperBound(leaf->keys, leaf->count, key);
+    if (pos)
+        return leaf->entries[pos - 1];
+    // all keys of this leaf are bigger. Leaves other than the root are never empty
+    return leaf->prev ? leaf->prev->entries[leaf->prev->count - 1] : NULL;
+}
+
+void *treeCeiling(const struct orderedTree *t, jlong key) {
+    const struct treeLeaf *leaf = findLeaf(t, key);
+    int pos = lowerBound(leaf->keys, leaf->count, key);
+    if (pos < leaf->count)
+        return leaf->entries[pos];
+    return leaf->next ? leaf->next->entries[0] : NULL;
+}
+
+void *treeHigher(const struct orderedTree *t, jlong key) {
+    const struct treeLeaf *leaf = findLeaf(t, key);
+    int pos = upperBound(leaf->keys, leaf->count, key);
+    if (pos < leaf->count)
+        return leaf->entries[pos];
+    return leaf->next ? leaf->next->entries[0] : NULL;
+}
+
+int treeRange(const struct orderedTree *t, jlong fromKey, jlong toKey, jlong *keys, void **entries, int maxCount) {
+    if (fromKey > toKey)
+        return 0;
+    const struct treeLeaf *leaf = findLeaf(t, fromKey);
+    int pos = lowerBound(leaf->keys, leaf->count, fromKey);
+    int n = 0;
+    while (leaf && n < maxCount) {
+        for (; pos < leaf->count && n < maxCount; ++pos, ++n) {
+            if (leaf->keys[pos] > toKey)
+                return n;
+            keys[n] = leaf->keys[pos];
+            if (entries)
+                entries[n] = leaf->entries[pos];
+        }
+        leaf = leaf->next;
+        pos = 0;
+    }
+    return n;
+}
+
+
+int treeScanSlots(const struct orderedTree *t) {
+    return t->numLeaves * TREE_LEAF_SIZE;
+}
+
+void *treeScanSlot(const struct orderedTree *t, int i) {
+    const struct treeLeaf *leaf = t->leaves[i / TREE_LEAF_SIZE];
+    if (!leaf || i % TREE_LEAF_SIZE >= leaf->count)
+        return NULL;
+    return leaf->entries[i % TREE_LEAF_SIZE];
+}
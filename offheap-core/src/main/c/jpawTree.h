@@ -0,0 +1,76 @@
+#ifndef _Included_jpawTree
+#define _Included_jpawTree
+
+#include <jni.h>
+
+// Ordered key engine (B+tree), as an alternative to the hash chains of struct map, for range scans and ordered iteration.
+// Keys are stored in the nodes, the leaves hold the payload pointers next to the keys, and are linked in key order.
+// Nodes are not merged when they become underfull, only empty leaves (and empty inner nodes) are removed.
+// When keys are inserted in ascending order (time ordered ids), full nodes are split such that the left one stays full.
+// The tree does not interpret the payload pointers, they are owned by the caller.
+
+#define TREE_LEAF_SIZE          32
+#define TREE_INNER_SIZE         32      // keys per inner node, which has one more child
+#define TREE_MAX_HEIGHT         16      // inner levels, enough for more than 2^31 entries
+
+struct treeLeaf {
+    int count;
+    int index;                          // position in the leaf directory
+    struct treeLeaf *prev;              // leaves in key order
+    struct treeLeaf *next;
+    jlong keys[TREE_LEAF_SIZE];
+    void *entries[TREE_LEAF_SIZE];
+};
+
+struct treeInner {
+    int count;                          // number of keys. children[i + 1] holds the keys >= keys[i]
+    int padding;
+    jlong keys[TREE_INNER_SIZE];
+    void *children[TREE_INNER_SIZE + 1];
+};
+
+struct orderedTree {
+    void *root;                         // a leaf if height is 0, else an inner node
+    int height;                         // number of inner levels
+    int count;                          // total number of entries
+    struct treeLeaf *first;
+    struct treeLeaf *last;
+    // leaf directory for full scans: the scan slots of leaf i are i * TREE_LEAF_SIZE ... (i + 1) * TREE_LEAF_SIZE - 1.
+    // Positions of removed leaves are NULL and are reused.
+    struct treeLeaf **leaves;
+    int numLeaves;
+    int leavesCapacity;
+    int *freePositions;
+    int numFreePositions;
+    int numSpareInner;
+    // nodes allocated by treeReserve(), such that an insert cannot fail
+    struct treeLeaf *spareLeaf;
+    struct treeInner *spareInner[TREE_MAX_HEIGHT + 1];
+};
+
+// returns NULL if no memory is available
+struct orderedTree *treeCreate(void);
+void treeDestroy(struct orderedTree *t);
+// removes all entries
+void treeClear(struct orderedTree *t);
+// returns 0 if there is space for at least one more entry (possibly after allocating nodes), else -1
+int treeReserve(struct orderedTree *t);
+
+void *treeGet(const struct orderedTree *t, jlong key);
+// inserts or replaces the entry for key, returns the replaced entry or NULL. Requires a prior successful treeReserve().
+void *treeSet(struct orderedTree *t, jlong key, void *entry);
+// removes the entry for key and returns it, or NULL if no entry existed
+void *treeRemove(struct orderedTree *t, jlong key);
+
+// neighbours: the entry of the biggest key <= key, of the smallest key >= key, of the smallest key > key. NULL if none exists
+void *treeFloor(const struct orderedTree *t, jlong key);
+void *treeCeiling(const struct orderedTree *t, jlong key);
+void *treeHigher(const struct orderedTree *t, jlong key);
+// copies up to maxCount keys (and entries, if entries is not NULL) within [fromKey, toKey] in ascending order. Returns the number copied
+int treeRange(const struct orderedTree *t, jlong fromKey, jlong toKey, jlong *keys, void **entries, int maxCount);
+
+// full scans, in the order of the leaf directory (not in key order)
+int treeScanSlots(const struct orderedTree *t);
+void *treeScanSlot(const struct orderedTree *t, int i);
+
+#endif
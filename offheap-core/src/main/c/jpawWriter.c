@@ -0,0 +1,177 @@
+#define _GNU_SOURCE             // O_DIRECT
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "jpawWriter.h"
+
+// writes len bytes at offset completely. Returns 0 or the error
+static int writeFully(struct dumpWriter *w, const char *data, int len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(w->fd, data, len, offset);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EINVAL && __atomic_load_n(&w->direct, __ATOMIC_RELAXED)) {
+            // the file system accepted O_DIRECT at open, but not for this write: continue buffered
+            __atomic_store_n(&w->direct, JNI_FALSE, __ATOMIC_RELAXED);
+            fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) & ~O_DIRECT);
+            continue;
+        }
+        if (n < 0)
+            return errno;
+        if (n == 0)
+            return WRITER_SHORT_WRITE;
+        data += n;
+        offset += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// I/O thread: writes queued buffers, lowest file offset first
+static void *writerThread(void *arg) {
+    struct dumpWriter *w = arg;
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < w->numBuffers; ++i)
+            if (w->state[i] == WRITER_BUFFER_QUEUED && (next < 0 || w->offset[i] < w->offset[next]))
+                next = i;
+        if (next < 0) {
+            if (w->stopping)
+                break;
+            pthread_cond_wait(&w->cond, &w->lock);
+            continue;
+        }
+        w->state[next] = WRITER_BUFFER_WRITING;
+        int skip = w->error != 0;           // no further writes after a failure
+        pthread_mutex_unlock(&w->lock);
+        int rc = skip ? 0 : writeFully(w, w->buffers[next], w->length[next], w->offset[next]);
+        pthread_mutex_lock(&w->lock);
+        if (rc && !w->error)
+            w->error = rc;
+        w->state[next] = WRITER_BUFFER_FREE;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+static void freeBuffers(struct dumpWriter *w) {
+    for (int i = 0; i < w->numBuffers; ++i)
+        free(w->buffers[i]);
+}
+
+int writerOpen(struct dumpWriter *w, const char *filename, int numBuffers) {
+    memset(w, 0, sizeof(struct dumpWriter));
+    w->numBuffers = numBuffers < 2 ? 2 : numBuffers > WRITER_MAX_BUFFERS ? WRITER_MAX_BUFFERS : numBuffers;
+    for (int i = 0; i < w->numBuffers; ++i) {
+        if (posix_memalign((void **)&w->buffers[i], WRITER_ALIGNMENT, WRITER_BUFFER_SIZE)) {
+            w->buffers[i] = NULL;
+            freeBuffers(w);
+            return ENOMEM;
+        }
+    }
+    w->direct = JNI_TRUE;
+    w->fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC | O_DIRECT, 0644);
+    if (w->fd < 0 && errno == EINVAL) {
+        w->direct = JNI_FALSE;          // not supported by the file system (tmpfs for example)
+        w->fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    }
+    if (w->fd < 0) {
+        int rc = errno;
+        freeBuffers(w);
+        return rc;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->cond, NULL);
+    for (int i = 0; i < w->numBuffers - 1; ++i) {
+        if (pthread_create(&w->threads[i], NULL, writerThread, w))
+            break;
+        ++w->numThreads;
+    }
+    if (!w->numThreads) {
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+        close(w->fd);
+        freeBuffers(w);
+        return EAGAIN;
+    }
+    w->state[0] = WRITER_BUFFER_FILLING;
+    return 0;
+}
+
+// queues the current buffer and waits for a free one
+static void writerSubmit(struct dumpWriter *w) {
+    pthread_mutex_lock(&w->lock);
+    w->length[w->current] = w->fill;
+    w->offset[w->current] = w->position;
+    w->state[w->current] = WRITER_BUFFER_QUEUED;
+    pthread_cond_broadcast(&w->cond);
+    w->position += w->fill;
+    w->fill = 0;
+    for (;;) {
+        for (int i = 0; i < w->numBuffers; ++i) {
+            if (w->state[i] == WRITER_BUFFER_FREE) {
+                w->state[i] = WRITER_BUFFER_FILLING;
+                w->current = i;
+                pthread_mutex_unlock(&w->lock);
+                return;
+            }
+        }
+        pthread_cond_wait(&w->cond, &w->lock);
+    }
+}
+
+void writerPut(struct dumpWriter *w, const void *src, int len) {
+    const char *p = src;
+    int padding = -len & 7;
+    while (len > 0) {
+        int portion = WRITER_BUFFER_SIZE - w->fill;
+        if (portion > len)
+            portion = len;
+        memcpy(w->buffers[w->current] + w->fill, p, portion);
+        w->fill += portion;
+        p += portion;
+        len -= portion;
+        if (w->fill == WRITER_BUFFER_SIZE)
+            writerSubmit(w);
+    }
+    // the buffer size is a multiple of 8, therefore the padding always fits
+    memset(w->buffers[w->current] + w->fill, 0xee, padding);
+    w->fill += padding;
+}
+
+int writerClose(struct dumpWriter *w, const void *header, int headerSize) {
+    pthread_mutex_lock(&w->lock);
+    w->stopping = JNI_TRUE;
+    pthread_cond_broadcast(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+    for (int i = 0; i < w->numThreads; ++i)
+        pthread_join(w->threads[i], NULL);
+    // the I/O threads have written all queued buffers. Write the tail: the aligned part directly, the rest buffered
+    int rc = w->error;
+    if (!rc && w->fill) {
+        int aligned = w->direct ? w->fill & ~(WRITER_ALIGNMENT - 1) : w->fill;
+        rc = writeFully(w, w->buffers[w->current], aligned, w->position);
+        if (!rc && aligned < w->fill) {
+            w->direct = JNI_FALSE;
+            fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) & ~O_DIRECT);
+            rc = writeFully(w, w->buffers[w->current] + aligned, w->fill - aligned, w->position + aligned);
+        }
+    }
+    if (!rc && header) {
+        if (w->direct) {
+            w->direct = JNI_FALSE;
+            fcntl(w->fd, F_SETFL, fcntl(w->fd, F_GETFL) & ~O_DIRECT);
+        }
+        rc = writeFully(w, header, headerSize, 0);
+    }
+    if (close(w->fd) && !rc)
+        rc = errno;
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->cond);
+    freeBuffers(w);
+    return rc;
+}
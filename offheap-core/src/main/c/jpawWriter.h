@@ -0,0 +1,60 @@
+#ifndef _Included_jpawWriter
+#define _Included_jpawWriter
+
+#include <sys/types.h>
+#include <pthread.h>
+#include <jni.h>
+
+// Asynchronous sequential writer of dump files. The data is copied into aligned staging buffers, and every full buffer is written
+// by a pool of I/O threads (pwrite at its file offset), while the caller fills the next one. The caller only waits if all buffers
+// are in flight. The file is opened with O_DIRECT if the file system supports it, to avoid the page cache copy; the tail of the
+// file, which is not a multiple of the alignment, is written without O_DIRECT when the writer is closed.
+// Failures of the I/O threads are kept and reported by writerClose(), later data is discarded meanwhile.
+// A writer is used by one thread (the I/O threads are internal).
+
+#define WRITER_BUFFER_SIZE      (2 * 1024 * 1024)   // a multiple of WRITER_ALIGNMENT, about one SSD write latency at full speed
+#define WRITER_ALIGNMENT        4096                // of the buffers and of their file offsets, as required by O_DIRECT
+#define WRITER_MAX_BUFFERS      4                   // quad buffering: up to 3 writes in flight while the fourth buffer is filled
+#define WRITER_SHORT_WRITE      -1                  // error code of writes which did not complete, without errno
+
+#define WRITER_BUFFER_FREE      0
+#define WRITER_BUFFER_FILLING   1
+#define WRITER_BUFFER_QUEUED    2
+#define WRITER_BUFFER_WRITING   3
+
+struct dumpWriter {
+    int fd;
+    jboolean direct;                        // the file has been opened with O_DIRECT
+    int numBuffers;
+    int numThreads;                         // I/O threads, numBuffers - 1
+    char *buffers[WRITER_MAX_BUFFERS];
+    int state[WRITER_MAX_BUFFERS];          // WRITER_BUFFER_*
+    int length[WRITER_MAX_BUFFERS];         // bytes to write of queued buffers
+    off_t offset[WRITER_MAX_BUFFERS];       // file offset of queued buffers
+    int current;                            // the buffer being filled
+    int fill;                               // bytes used in the current buffer
+    off_t position;                         // file offset of the current buffer
+    int error;                              // the first failure: errno, or WRITER_SHORT_WRITE. 0 if OK
+    jboolean stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;                    // signalled by every change of a buffer state, and by stopping
+    pthread_t threads[WRITER_MAX_BUFFERS];
+};
+
+// creates (or truncates) the file and starts the I/O threads. numBuffers is 2 (double buffering) to WRITER_MAX_BUFFERS.
+// Returns 0 if OK, else an errno value
+int writerOpen(struct dumpWriter *w, const char *filename, int numBuffers);
+
+// appends len bytes, padded by 0xee to a multiple of 8 bytes (all entries in the dump files are 8-byte aligned)
+void writerPut(struct dumpWriter *w, const void *src, int len);
+
+// number of bytes appended so far, including the padding
+static inline off_t writerPosition(const struct dumpWriter *w) {
+    return w->position + w->fill;
+}
+
+// writes the remaining data, optionally rewrites the start of the file with header (if not NULL), stops the I/O threads,
+// and closes the file. Returns 0 if all data has been written completely, else the error (errno or WRITER_SHORT_WRITE)
+int writerClose(struct dumpWriter *w, const void *header, int headerSize);
+
+#endif
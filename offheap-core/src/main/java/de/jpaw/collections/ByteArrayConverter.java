@@ -93,7 +93,7 @@ public interface ByteArrayConverter<V> {
         @Override
         public byte[] valueTypeToByteArray(UUID arg) {
             return arg == null ? null
-                : ByteBuffer.allocate(8)
+                : ByteBuffer.allocate(16)
                     .putLong(arg.getMostSignificantBits())
                     .putLong(arg.getLeastSignificantBits())
                     .array();
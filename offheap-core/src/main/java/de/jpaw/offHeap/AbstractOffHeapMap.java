@@ -7,6 +7,13 @@ import de.jpaw.collections.OffHeapBaseMap;
 
 /** Base class for data and index maps. The generic type T represents either the data or the index type. */
 public class AbstractOffHeapMap<T> implements OffHeapBaseMap {
+    /** Indexes into the array returned by getMemoryStats(). */
+    public static final int MEMSTAT_BYTES_USED = 0;         // bytes in use by entries
+    public static final int MEMSTAT_BYTES_WASTED = 1;       // bytes allocated from the system, but not in use by entries (free lists, partially used slab)
+    public static final int MEMSTAT_SLABS = 2;              // number of slabs allocated for small entries
+    public static final int MEMSTAT_LARGE_BLOCKS = 3;       // number of entries which are allocated individually, due to their size
+    public static final int MEMSTAT_BYTES_RESERVED = 4;     // total bytes allocated from the system for entries
+    public static final int MEMSTAT_NUM_STATS = 5;
 
     /** Only used by native code, to store the off heap address of the structure. */
     public final ByteArrayConverter<T> converter;  // this is usually the superclass itself
@@ -34,6 +41,9 @@ public class AbstractOffHeapMap<T> implements OffHeapBaseMap {
      * Chains of bigger length are not counted. The method returns the longest chain length. */
     private static native int natGetHistogram(long cMap, int [] chainsOfLength);
 
+    /** Fills the statistics of the memory used for the entries, see the MEMSTAT_* constants. */
+    private static native void natGetMemoryStats(long cMap, long [] stats);
+
     /** Allocates and initializes a new data structure for the given maximum number of elements.
      * Returns the resulting off heap location.
      */
@@ -82,6 +92,15 @@ public class AbstractOffHeapMap<T> implements OffHeapBaseMap {
         }
     }
 
+    /** Returns statistics of the memory used for the entries, indexed by the MEMSTAT_* constants.
+     * A map and its committed view share the same storage, therefore both report the same figures.
+     * The size of the hash table itself is not included. */
+    public long [] getMemoryStats() {
+        long [] stats = new long [MEMSTAT_NUM_STATS];
+        natGetMemoryStats(cStruct, stats);
+        return stats;
+    }
+
     /** Prints the histogram of the hash distribution. */
     public void printHistogram(int len, PrintStream out) {
         if (out == null)
@@ -0,0 +1,99 @@
+package de.jpaw.offHeap;
+
+import java.nio.ByteBuffer;
+import java.util.HashMap;
+import java.util.Map;
+
+/** Result of PrimitiveLongKeyOffHeapMapView.aggregate(): per group (distinct value of the group field), the number of matching rows,
+ * and the number, sum, minimum and maximum of the numeric values of the value field. Rows without the group field form the null group,
+ * which is the only group if no group field has been specified. Groups are in no particular order. */
+public class Aggregates {
+    /** Field number to specify no grouping or no value field. */
+    public static final int NO_FIELD = -1;
+
+    private final byte [][] groups;
+    private final long [] counts;
+    private final long [] valueCounts;
+    private final long [] sums;
+    private final long [] mins;
+    private final long [] maxs;
+    private Map<ByteBuffer, Integer> positions = null;
+
+    /** Parses the result of natAggregate. */
+    Aggregates(byte [] data) {
+        ByteBuffer buffer = ByteBuffer.wrap(data);
+        int n = buffer.getInt();
+        groups = new byte [n][];
+        counts = new long [n];
+        valueCounts = new long [n];
+        sums = new long [n];
+        mins = new long [n];
+        maxs = new long [n];
+        for (int i = 0; i < n; ++i) {
+            int length = buffer.getInt();
+            if (length >= 0) {
+                groups[i] = new byte [length];
+                buffer.get(groups[i]);
+            }
+            counts[i] = buffer.getLong();
+            valueCounts[i] = buffer.getLong();
+            sums[i] = buffer.getLong();
+            mins[i] = buffer.getLong();
+            maxs[i] = buffer.getLong();
+        }
+    }
+
+    /** Returns the number of groups. */
+    public int size() {
+        return groups.length;
+    }
+
+    /** Returns the value of the group field of group i, or null for the null group. */
+    public byte [] getGroup(int i) {
+        return groups[i];
+    }
+
+    /** Returns the index of a group, or -1 if no row has this group value. */
+    public int indexOf(byte [] group) {
+        if (positions == null) {
+            positions = new HashMap<ByteBuffer, Integer>(2 * groups.length);
+            for (int i = 0; i < groups.length; ++i)
+                positions.put(groups[i] == null ? null : ByteBuffer.wrap(groups[i]), i);
+        }
+        Integer i = positions.get(group == null ? null : ByteBuffer.wrap(group));
+        return i == null ? -1 : i;
+    }
+
+    /** Returns the number of matching rows of group i. */
+    public long getCount(int i) {
+        return counts[i];
+    }
+
+    /** Returns the number of matching rows of group i which have a numeric value field. */
+    public long getValueCount(int i) {
+        return valueCounts[i];
+    }
+
+    /** Returns the sum of the numeric values of group i (modulo 2^64). */
+    public long getSum(int i) {
+        return sums[i];
+    }
+
+    /** Returns the minimum of the numeric values of group i, 0 if there are none. */
+    public long getMin(int i) {
+        return mins[i];
+    }
+
+    /** Returns the maximum of the numeric values of group i, 0 if there are none. */
+    public long getMax(int i) {
+        return maxs[i];
+    }
+
+    /** Returns the number of matching rows of all groups. */
+    public long getTotalCount() {
+        long total = 0L;
+        for (long count : counts)
+            total += count;
+        return total;
+    }
+}
@@ -0,0 +1,32 @@
+package de.jpaw.offHeap;
+
+import de.jpaw.collections.ByteArrayConverter;
+
+/** Index on raw byte values, as used for the indexes maintained by a data map (see PrimitiveLongKeyOffHeapMap.attachFieldIndex). */
+public class IndexBytes extends PrimitiveLongKeyOffHeapIndex<byte []> {
+
+    protected IndexBytes(ByteArrayConverter<byte []> converter, int size, Shard forShard, int modes, boolean withCommittedView, String name) {
+        super(converter, size, forShard, modes, withCommittedView, name);
+    }
+
+    public static class Builder extends PrimitiveLongKeyOffHeapIndex.Builder<byte [], IndexBytes> {
+
+        public Builder() {
+            super(ByteArrayConverter.BYTE_CONVERTER);
+        }
+        @Override
+        public IndexBytes build() {
+            return new IndexBytes(converter, hashSize, shard, mode, withCommittedView, name);
+        }
+    }
+
+    // convenience constructor
+    public static IndexBytes forHashSize(int hashSize) {
+        return new Builder().setHashSize(hashSize).build();
+    }
+    // convenience constructor
+    public static IndexBytes uniqueForHashSize(int hashSize) {
+        return new Builder().setHashSize(hashSize).setUnique(true).build();
+    }
+
+}
@@ -12,6 +12,7 @@ public class IndexLong extends PrimitiveLongKeyOffHeapIndex<Long> {
 
         public Builder() {
             super(ByteArrayConverter.LONG_CONVERTER);
+            setFixedWidth(8);
         }
         @Override
         public IndexLong build() {
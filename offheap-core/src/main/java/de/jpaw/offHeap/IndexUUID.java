@@ -14,6 +14,7 @@ public class IndexUUID extends PrimitiveLongKeyOffHeapIndex<UUID> {
 
         public Builder() {
             super(ByteArrayConverter.UUID_CONVERTER);
+            setFixedWidth(16);
         }
         @Override
         public IndexUUID build() {
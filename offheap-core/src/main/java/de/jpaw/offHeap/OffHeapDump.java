@@ -0,0 +1,65 @@
+package de.jpaw.offHeap;
+
+/** A dump of the committed view of a map which is written to disk by a native thread, see PrimitiveLongKeyOffHeapMap.startBackgroundDump().
+ * The progress can be queried from any thread. close() waits for the dump to complete. */
+public final class OffHeapDump implements AutoCloseable {
+
+    static {
+        OffHeapInit.init();
+    }
+
+    /** Fills the number of records written, the total number of records, and the state (0 = running, 1 = done, -1 = failed). */
+    private static native void natGetProgress(long cDump, long [] progress);
+
+    /** Waits until the dump is complete. Throws if it failed. */
+    private static native void natAwait(long cDump);
+
+    /** Waits until the dump is complete, and releases it. */
+    private static native void natClose(long cDump);
+
+    private long cDump;
+    private final long [] progress = new long [3];
+
+    /** Constructor, invoked by the map only. */
+    protected OffHeapDump(long cDump) {
+        this.cDump = cDump;
+    }
+
+    private long dump() {
+        if (cDump == 0L)
+            throw new IllegalStateException("Dump has been closed");
+        return cDump;
+    }
+
+    /** Returns the number of records written so far (updated every 1024 records). */
+    public synchronized long getRecordsWritten() {
+        natGetProgress(dump(), progress);
+        return progress[0];
+    }
+
+    /** Returns the number of records the dump consists of. */
+    public synchronized long getTotalRecords() {
+        natGetProgress(dump(), progress);
+        return progress[1];
+    }
+
+    /** Returns true once the file has been written completely, or the dump failed. */
+    public synchronized boolean isDone() {
+        natGetProgress(dump(), progress);
+        return progress[2] != 0L;
+    }
+
+    /** Waits until the dump is complete. Throws if it failed, for example for lack of disk space. */
+    public void await() {
+        natAwait(dump());
+    }
+
+    /** Waits until the dump is complete, and releases it. Multiple invocations are harmless. */
+    @Override
+    public void close() {
+        if (cDump != 0L) {
+            natClose(cDump);
+            cDump = 0L;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+package de.jpaw.offHeap;
+
+import java.nio.ByteBuffer;
+
+/** A lease provides read access to the value of a map entry, without copying it to the Java heap.
+ * Uncompressed values are accessed in place, compressed values are decompressed into a buffer owned by the lease.
+ * As long as the lease has not been closed, the entry is not freed, even if it is updated or removed in the meantime
+ * (the buffer continues to show the value as of the time the lease was obtained).
+ * The buffer must not be used after close(). All leases of a map must be closed before the map is closed.
+ *
+ * Leases may be obtained and closed by other threads than the one modifying the map. An instance itself is not thread-safe. */
+public final class OffHeapLease implements AutoCloseable {
+
+    static {
+        OffHeapInit.init();
+    }
+
+    /** Returns a DirectByteBuffer for the leased data. */
+    private static native ByteBuffer natGetBuffer(long cLease);
+
+    /** Releases the lease. Frees of entries which have been deferred because of it are performed by the next modifying operation. */
+    private static native void natRelease(long cLease);
+
+    private long cLease;
+    private final ByteBuffer buffer;
+
+    /** Constructor, invoked by the map view only. */
+    protected OffHeapLease(long cLease) {
+        this.cLease = cLease;
+        this.buffer = natGetBuffer(cLease).asReadOnlyBuffer();
+    }
+
+    /** Returns the value as a read only direct buffer, with position 0 and limit at the length of the value. */
+    public ByteBuffer getBuffer() {
+        if (cLease == 0L)
+            throw new IllegalStateException("Lease has been closed");
+        return buffer;
+    }
+
+    /** Releases the lease. Multiple invocations are harmless. */
+    @Override
+    public void close() {
+        if (cLease != 0L) {
+            natRelease(cLease);
+            cLease = 0L;
+        }
+    }
+}
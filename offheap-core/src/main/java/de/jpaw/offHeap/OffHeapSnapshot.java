@@ -0,0 +1,72 @@
+package de.jpaw.offHeap;
+
+import de.jpaw.collections.ByteArrayConverter;
+
+/** A snapshot provides reads of the committed view of a map as of the time it was opened, while later commits go by.
+ * The values which are replaced or removed by these commits are kept in per-key versions, tagged with the transaction reference
+ * of the commit, until no open snapshot needs them any more. They are freed by the thread which modifies the map, with the next commit
+ * after the snapshot has been closed (or by reclaimVersions()). Long-lived snapshots therefore hold memory for every change.
+ * All snapshots of a map must be closed before the map is closed.
+ *
+ * Snapshots may be used by other threads than the one modifying the map, also concurrently. */
+public final class OffHeapSnapshot<V> implements AutoCloseable {
+
+    static {
+        OffHeapInit.init();
+    }
+
+    /** Returns the value of key as of the snapshot, or null. */
+    private static native byte [] natGet(long cSnapshot, long key);
+
+    /** Returns the (uncompressed) length of the value of key as of the snapshot, or -1. */
+    private static native int natLength(long cSnapshot, long key);
+
+    /** Returns the transaction reference pinned by the snapshot. */
+    private static native long natGetRef(long cSnapshot);
+
+    /** Closes the snapshot. */
+    private static native void natClose(long cSnapshot);
+
+    private final ByteArrayConverter<V> converter;
+    private long cSnapshot;
+
+    /** Constructor, invoked by the map only. */
+    protected OffHeapSnapshot(ByteArrayConverter<V> converter, long cSnapshot) {
+        this.converter = converter;
+        this.cSnapshot = cSnapshot;
+    }
+
+    private long snapshot() {
+        if (cSnapshot == 0L)
+            throw new IllegalStateException("Snapshot has been closed");
+        return cSnapshot;
+    }
+
+    /** Returns the value of key as of the snapshot, or null if the key did not exist. */
+    public V get(long key) {
+        return converter.byteArrayToValueType(natGet(snapshot(), key));
+    }
+
+    /** Returns the length of the value of key as of the snapshot, or -1 if the key did not exist. */
+    public int length(long key) {
+        return natLength(snapshot(), key);
+    }
+
+    public boolean containsKey(long key) {
+        return natLength(snapshot(), key) >= 0;
+    }
+
+    /** Returns the lastCommittedRef of the committed view at the time the snapshot was opened. */
+    public long getCommittedRef() {
+        return natGetRef(snapshot());
+    }
+
+    /** Closes the snapshot. Multiple invocations are harmless. */
+    @Override
+    public void close() {
+        if (cSnapshot != 0L) {
+            natClose(cSnapshot);
+            cSnapshot = 0L;
+        }
+    }
+}
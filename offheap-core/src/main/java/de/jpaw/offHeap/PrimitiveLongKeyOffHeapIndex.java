@@ -28,7 +28,7 @@ public class PrimitiveLongKeyOffHeapIndex<I> extends PrimitiveLongKeyOffHeapInde
     public abstract static class Builder<I, T extends PrimitiveLongKeyOffHeapIndex<I>> {
         protected final ByteArrayConverter<I> converter;
         protected int hashSize = 4096;
-        protected int mode = 0xa1;
+        protected int mode = 0x100000a1;
         protected Shard shard = Shard.TRANSACTIONLESS_DEFAULT_SHARD;
         protected boolean withCommittedView = false;
         protected String name = null;
@@ -51,6 +51,34 @@ public class PrimitiveLongKeyOffHeapIndex<I> extends PrimitiveLongKeyOffHeapInde
                 this.mode &= ~0x10;
             return this;
         }
+        /** Stores index values of a fixed serialized length of up to 16 bytes inline in a flat table, instead of an entry per value.
+         * Width 0 is for int sized values, which are passed by the direct methods. Ordered indexes ignore this setting. */
+        public Builder<I, T> setFixedWidth(int width) {
+            if (width < 0 || width > 16)
+                throw new IllegalArgumentException("fixed width must be between 0 and 16, got " + width);
+            this.mode = (this.mode & ~0x1f00) | 0x40 | (width << 8);
+            return this;
+        }
+        /** Non-unique indexes keep one node per distinct value, with the keys as sorted posting list (the default).
+         * Paging through the keys of a value and combining two values does not depend on the number of other entries.
+         * Takes precedence over a fixed width, ordered indexes ignore this setting. */
+        public Builder<I, T> setPostingLists(boolean postingLists) {
+            if (postingLists)
+                this.mode |= 0x10000000;
+            else
+                this.mode &= ~0x10000000;
+            return this;
+        }
+        /** Uses an entry per value, also for fixed width values. */
+        public Builder<I, T> setVariableWidth() {
+            this.mode &= ~0x1f40;
+            return this;
+        }
+        /** Keeps the entries in order of the serialized index value as well, for range and prefix iterators. */
+        public Builder<I, T> setOrdered() {
+            this.mode |= 0x08000000;
+            return this;
+        }
         public Builder<I, T> setAutonomous() {
             this.mode &= ~0x81;
             return this;
@@ -100,7 +128,7 @@ public class PrimitiveLongKeyOffHeapIndex<I> extends PrimitiveLongKeyOffHeapInde
                 natIndexDelete(cStruct, myShard.getTxCStruct(), key, oldHash);
             } else {
                 int newHash = indexHash(newIndex);
-                if (oldHash != newHash || oldIndex.equals(newIndex)) {
+                if (oldHash != newHash || !oldIndex.equals(newIndex)) {
                     // only invoke the native method if old and new key are different
                     byte [] indexData = converter.getBuffer(newIndex);
                     natIndexUpdate(cStruct, myShard.getTxCStruct(), key, oldHash, newHash, indexData, 0, converter.getLength());
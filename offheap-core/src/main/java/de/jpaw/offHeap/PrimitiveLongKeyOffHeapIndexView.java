@@ -1,5 +1,6 @@
 package de.jpaw.offHeap;
 
+import java.util.Arrays;
 import java.util.Iterator;
 import java.util.NoSuchElementException;
 
@@ -12,7 +13,8 @@ public class PrimitiveLongKeyOffHeapIndexView<I> extends AbstractOffHeapMap<I> {
     static {
         OffHeapInit.init();
         natInit(PrimitiveLongKeyOffHeapIndexView.PrimitiveLongKeyOffHeapViewIterator.class,
-                PrimitiveLongKeyOffHeapIndexView.BatchedPrimitiveLongKeyOffHeapViewIterator.class);
+                PrimitiveLongKeyOffHeapIndexView.BatchedPrimitiveLongKeyOffHeapViewIterator.class,
+                PrimitiveLongKeyOffHeapIndexView.RangePrimitiveLongKeyOffHeapViewIterator.class);
     }
 
     // class can only be instantiated from a parent
@@ -29,11 +31,14 @@ public class PrimitiveLongKeyOffHeapIndexView<I> extends AbstractOffHeapMap<I> {
 //    }
 
     protected int indexHash(I index) {
-        return converter == null ? (Integer)index : index.hashCode();
+        if (converter == null)
+            return (Integer)index;
+        // byte [] values use the content hash, as computed natively for indexes maintained by a data map
+        return index instanceof byte [] ? Arrays.hashCode((byte [])index) : index.hashCode();
     }
 
     /** Register globals (especially the Iterator class). */
-    private static native void natInit(Class<?> iterator, Class<?> batchedIterator);
+    private static native void natInit(Class<?> iterator, Class<?> batchedIterator, Class<?> rangeIterator);
 
     /** Read an entry and return its key, or null if it does not exist. */
     private static native long natIndexGetKey(long cMap, int indexHash, byte [] indexData, int offset, int length);
@@ -55,6 +60,24 @@ public class PrimitiveLongKeyOffHeapIndexView<I> extends AbstractOffHeapMap<I> {
         return natIndexGetKey(cStruct, index, null, 0, 0);
     }
 
+    private static native int natCombine(long cMapA, int hashA, byte [] dataA, int lengthA, long cMapB, int hashB, byte [] dataB, int lengthB,
+            boolean isAnd, long [] dest, int recordsToSkip);
+
+    /** Stores the keys of the rows which have index value a in index ia and (isAnd) or (else) value b in index ib into dest,
+     * in ascending order, after skipping recordsToSkip keys. Both indexes must use posting lists.
+     * Returns the number of keys stored, at most dest.length. */
+    public static <A, B> int combine(PrimitiveLongKeyOffHeapIndexView<A> ia, A a, PrimitiveLongKeyOffHeapIndexView<B> ib, B b,
+            boolean isAnd, long [] dest, int recordsToSkip) {
+        // copy the first value: both indexes can share a converter, which reuses its buffer
+        byte [] dataA = ia.converter == null ? null : ia.converter.getBuffer(a);
+        int lengthA = ia.converter == null ? 0 : ia.converter.getLength();
+        if (dataA != null)
+            dataA = Arrays.copyOf(dataA, lengthA);
+        byte [] dataB = ib.converter == null ? null : ib.converter.getBuffer(b);
+        int lengthB = ib.converter == null ? 0 : ib.converter.getLength();
+        return natCombine(ia.cStruct, ia.indexHash(a), dataA, lengthA, ib.cStruct, ib.indexHash(b), dataB, lengthB, isAnd, dest, recordsToSkip);
+    }
+
     private class IndexIterable implements Iterable<Long> {
         final I index;
         final int batchSize;
@@ -88,12 +111,41 @@ public class PrimitiveLongKeyOffHeapIndexView<I> extends AbstractOffHeapMap<I> {
         return new BatchedPrimitiveLongKeyOffHeapViewIterator(index, batchSize, recordsToSkip);
     }
 
+    /** Returns the keys of all entries with an index value within from and to (both inclusive, null for no bound),
+     * in order of the serialized index value (unsigned bytewise), and by key for equal values. Ordered indexes only. */
+    public RangePrimitiveLongKeyOffHeapViewIterator rangeIterator(I from, I to, int batchSize, int recordsToSkip) {
+        byte [] fromData = null;
+        int fromLength = 0;
+        if (from != null) {
+            fromData = converter.getBuffer(from);
+            fromLength = converter.getLength();
+        }
+        byte [] toData = null;
+        int toLength = 0;
+        if (to != null) {
+            toData = converter.getBuffer(to);
+            toLength = converter.getLength();
+        }
+        return new RangePrimitiveLongKeyOffHeapViewIterator(fromData, fromLength, toData, toLength, false, batchSize, recordsToSkip);
+    }
+
+    /** Returns the keys of all entries with a serialized index value which starts with the given bytes, in index value order. Ordered indexes only. */
+    public RangePrimitiveLongKeyOffHeapViewIterator prefixIterator(byte [] prefix, int length, int batchSize, int recordsToSkip) {
+        return new RangePrimitiveLongKeyOffHeapViewIterator(prefix, length, prefix, length, true, batchSize, recordsToSkip);
+    }
+
+    /** Returns the keys of all entries with a serialized index value which starts with the serialized form of prefix (for String indexes: which start with prefix). */
+    public RangePrimitiveLongKeyOffHeapViewIterator prefixIterator(I prefix, int batchSize) {
+        byte [] data = converter.getBuffer(prefix);
+        return prefixIterator(data, converter.getLength(), batchSize, 0);
+    }
+
     public class PrimitiveLongKeyOffHeapViewIterator implements PrimitiveLongIterator {
         private long nextEntryPtr = 0L;     // we are "at End" if this field has value 0
         private long currentKey = 0L;       // updated from JNI
 
         private native long natIterateStart(long cStructOfMap, int hash, byte [] data, int length);
-        private native long natIterate(long previousEntryPtr);
+        private native long natIterate(long cStructOfMap, long previousEntryPtr);
 
         /** Constructor, protected because it can only be created by the Map itself. */
         private PrimitiveLongKeyOffHeapViewIterator(I index) {
@@ -110,7 +162,7 @@ public class PrimitiveLongKeyOffHeapIndexView<I> extends AbstractOffHeapMap<I> {
             if (nextEntryPtr == 0L)
                 throw new NoSuchElementException();
             long thisKey = currentKey;                  // currentKey will be modified during the JNI call
-            nextEntryPtr = natIterate(nextEntryPtr);    // peek to the one after this (to allow removing the returned one)
+            nextEntryPtr = natIterate(cStruct, nextEntryPtr);    // peek to the one after this (to allow removing the returned one)
             return thisKey;
         }
 
@@ -146,7 +198,7 @@ public class PrimitiveLongKeyOffHeapIndexView<I> extends AbstractOffHeapMap<I> {
         private final int batchSize;
 
         private native long natIterateStart(long cStructOfMap, int hash, byte [] data, int length, long [] entries, int batchSize, int recordsToSkip);
-        private native long natIterate(long previousEntryPtr, long [] entries, int batchSize);
+        private native long natIterate(long cStructOfMap, long previousEntryPtr, long [] entries, int batchSize);
 
         /** Constructor, protected because it can only be created by the Map itself. */
         private BatchedPrimitiveLongKeyOffHeapViewIterator(I index, int batchSize, int recordsToSkip) {
@@ -169,7 +221,72 @@ public class PrimitiveLongKeyOffHeapIndexView<I> extends AbstractOffHeapMap<I> {
                 return;  // no need to try
             numValidEntries = 0;
             nextEntryToReturn = 0;
-            nextEntryPtr = natIterate(nextEntryPtr, nextEntries, batchSize);    // peek to the one after this (to allow removing the returned one)
+            nextEntryPtr = natIterate(cStruct, nextEntryPtr, nextEntries, batchSize);    // peek to the one after this (to allow removing the returned one)
+        }
+
+        @Override
+        public long nextAsPrimitiveLong() {
+            if (nextEntryToReturn >= numValidEntries)
+                throw new NoSuchElementException();
+            long key =  nextEntries[nextEntryToReturn];
+            if (++nextEntryToReturn == numValidEntries)
+                getMore();
+            return key;
+        }
+
+        @Override
+        public boolean hasNext() {
+            return nextEntryToReturn < numValidEntries;
+        }
+
+        @Override
+        public Long next() {
+            return Long.valueOf(nextAsPrimitiveLong());
+        }
+
+        @Override
+        public void remove() {
+            // not supported because with an index, maybe also unknown indexes need removal
+            throw new UnsupportedOperationException();
+        }
+    }
+
+    /** Batched iterator over a range of values of an ordered index. Works like BatchedPrimitiveLongKeyOffHeapViewIterator,
+     * the upper bound is passed again for every batch. */
+    public class RangePrimitiveLongKeyOffHeapViewIterator implements PrimitiveLongIterator {
+        private long nextEntryPtr = 0L;     // we are "at End" if this field has value 0
+        private int numValidEntries = 0;    // how may entries in nextEntries are valid? (filled via JNI)
+        private int nextEntryToReturn = 0;  // index of the next entry to return
+        private final long [] nextEntries;
+        private final int batchSize;
+        private final byte [] to;
+        private final int toLength;
+        private final boolean isPrefix;
+
+        private native long natIterateStart(long cStructOfMap, byte [] from, int fromLength, byte [] to, int toLength, boolean isPrefix,
+                long [] entries, int batchSize, int recordsToSkip);
+        private native long natIterate(long cStructOfMap, long nextEntryPtr, byte [] to, int toLength, boolean isPrefix, long [] entries, int batchSize);
+
+        /** Constructor, protected because it can only be created by the Map itself. */
+        private RangePrimitiveLongKeyOffHeapViewIterator(byte [] from, int fromLength, byte [] to, int toLength, boolean isPrefix,
+                int batchSize, int recordsToSkip) {
+            if (batchSize < 1) {
+                throw new IllegalArgumentException("batch size must be at least 1, got " + batchSize);
+            }
+            nextEntries = new long [batchSize];
+            this.batchSize = batchSize;
+            this.to = to;
+            this.toLength = toLength;
+            this.isPrefix = isPrefix;
+            nextEntryPtr = natIterateStart(cStruct, from, fromLength, to, toLength, isPrefix, nextEntries, batchSize, recordsToSkip);
+        }
+
+        private void getMore() {
+            if (nextEntryPtr == 0)
+                return;  // no need to try
+            numValidEntries = 0;
+            nextEntryToReturn = 0;
+            nextEntryPtr = natIterate(cStruct, nextEntryPtr, to, toLength, isPrefix, nextEntries, batchSize);
         }
 
         @Override
@@ -1,5 +1,6 @@
 package de.jpaw.offHeap;
 
+import java.nio.ByteBuffer;
 import java.nio.charset.Charset;
 
 import de.jpaw.collections.ByteArrayConverter;
@@ -33,6 +34,84 @@ implements PrimitiveLongKeyMap<V>, DatabaseIO {
      * data may not be null (use get(key) for that purpose). */
     private static native byte [] natPut(long cMap, long ctx, long key, byte [] data, int offset, int length, boolean doCompress);
 
+    /** Applies the records of a direct buffer (see setBatch) between position and limit. Returns the number of replaced or removed entries. */
+    private static native int natSetBatch(long cMap, long ctx, ByteBuffer src, int position, int limit, int maxUncompressedSize);
+
+    /** Removes the entries for the keys of a direct buffer between position and limit. Returns the number of removed entries. */
+    private static native int natDeleteBatch(long cMap, long ctx, ByteBuffer src, int position, int limit);
+
+    /** Builds a compression dictionary of at most maxSize bytes from a sample of the entries. */
+    private static native byte [] natTrainDictionary(long cMap, int maxSize);
+
+    /** Installs a compression dictionary, or removes it if dictionary is null. */
+    private static native void natSetDictionary(long cMap, byte [] dictionary);
+
+    /** Returns the compression dictionary, or null if none is used. */
+    private static native byte [] natGetDictionary(long cMap);
+
+    /** Replaces the cache of decompressed values by one of the given capacity in bytes, 0 disables it. */
+    private static native void natSetCacheSize(long cMap, long capacity);
+
+    /** Registers an index to be maintained by all row changes of the map, see attachFieldIndex() and attachRegionIndex(). */
+    private static native void natAttachIndex(long cMap, long cIndex, int kind, int position, int length, byte delimiter, byte nullIndicator);
+
+    /** Stops maintaining an index. Returns false if it was not attached. */
+    private static native boolean natDetachIndex(long cMap, long cIndex);
+
+    /** Opens a snapshot of the committed view at its current lastCommittedRef. Returns the native snapshot. */
+    private static native long natOpenSnapshot(long cMap);
+
+    /** Frees the versions no open snapshot needs any more. Returns the number of versions freed. */
+    private static native int natReclaimVersions(long cMap);
+
+    /** Starts writing the committed view to a disk file in a native thread. Returns the native dump. */
+    private static native long natStartBackgroundDump(long cMap, byte [] pathname);
+
+    /** Dumps the map (or its committed view) to a disk file in the mapped format. */
+    private static native void natWriteMappedFile(long cMap, byte [] pathname, boolean fromCommittedView);
+
+    /** Loads a file in the mapped format by mapping it into memory. The map must be empty. */
+    private static native void natMapFile(long cMap, byte [] pathname, int prewarm);
+
+    /** Dumps the map (or its committed view) to a manifest and a number of segment files, written in parallel. */
+    private static native void natWriteSegmentedFile(long cMap, byte [] pathname, boolean fromCommittedView, int numberOfSegments);
+
+    /** Loads a segmented dump, reading and verifying the segments in parallel. The map must be empty. */
+    private static native void natReadSegmentedFile(long cMap, byte [] pathname);
+
+    /** Starts recording the keys changed by commits, for writeDeltaFile(). */
+    private static native void natEnableChangeTracking(long cMap);
+
+    /** Writes the entries (or tombstones) of the keys changed since the previous delta, returns the number of records. */
+    private static native int natWriteDeltaFile(long cMap, byte [] pathname, boolean fromCommittedView);
+
+    /** Applies a delta file to the map and its committed view. */
+    private static native void natApplyDeltaFile(long cMap, byte [] pathname);
+
+    /** Folds a chain of deltas into a base dump, writing a new base dump. */
+    private static native void natMergeCheckpoint(byte [] basePathname, byte [][] deltaPathnames, byte [] targetPathname);
+
+    /** Prewarm options of mapFile(), which can be combined. */
+    public static final int MAPPED_PREWARM_NONE = 0;        // the pages are read on first access
+    public static final int MAPPED_PREWARM_POPULATE = 0x01; // read the whole file during the call
+    public static final int MAPPED_PREWARM_WILLNEED = 0x02; // let the kernel read the file ahead asynchronously
+
+    /** Kinds of index rules. */
+    private static final int INDEX_RULE_FIELD = 0;
+    private static final int INDEX_RULE_REGION = 1;
+
+    /** Flags of batch records. */
+    public static final int BATCH_FLAG_COMPRESS = 0x01;     // compress the data, independent of the compression threshold
+    public static final int BATCH_FLAG_DELETE = 0x02;       // remove the entry for the key. The length must be 0.
+    public static final int BATCH_RECORD_HEADER_SIZE = 16;
+
+    /** Compression codecs, see Builder.setCompression(). */
+    public static final int CODEC_LZ4 = 0;                  // level is the acceleration (default 1)
+    public static final int CODEC_LZ4HC = 1;                // level 1..12 (default 9)
+    public static final int CODEC_ZSTD = 2;                 // level 1..22 (default 3), only if the native library has been built with zstd
+    public static final int MAX_DICTIONARY_SIZE = 65536;
+    public static final int MIN_TRAINED_DICTIONARY_SIZE = 32;   // smaller sizes passed to trainDictionary() are raised to this one
+
 
 
     // external callers should use the builder pattern here, the number of optional parameters is growing...
@@ -63,7 +142,31 @@ implements PrimitiveLongKeyMap<V>, DatabaseIO {
             return this;
         }
         public Builder<V, T> setAutonomous() {
-            this.mode = 0;
+            this.mode &= ~0x81;     // keep the table organization and the compression settings
+            return this;
+        }
+        /** Use an open addressing table with SIMD probing instead of hash chains. The hash size is the initial capacity. */
+        public Builder<V, T> setOpenAddressing() {
+            this.mode |= 0x08;
+            return this;
+        }
+        /** Use a B+tree instead of hash chains, which provides ordered iteration, range scans and floor / ceiling lookups. */
+        public Builder<V, T> setOrdered() {
+            this.mode |= 0x08000000;
+            return this;
+        }
+        /** Selects the codec for compressed entries (one of the CODEC_* constants), and its level (0 = default of the codec). */
+        public Builder<V, T> setCompression(int codec, int level) {
+            if (codec < CODEC_LZ4 || codec > CODEC_ZSTD || level < 0 || level > 255)
+                throw new IllegalArgumentException("Bad codec or level");
+            this.mode = (this.mode & ~0xfff00) | (codec << 8) | (level << 12);
+            return this;
+        }
+        /** Entries which do not shrink by at least the given percentage when compressed are stored uncompressed. */
+        public Builder<V, T> setMinCompressionSavings(int percent) {
+            if (percent < 0 || percent > 99)
+                throw new IllegalArgumentException("percent must be between 0 and 99");
+            this.mode = (this.mode & ~(0x7f << 20)) | (percent << 20);
             return this;
         }
         public Builder<V, T> addCommittedView() {
@@ -83,6 +186,88 @@ implements PrimitiveLongKeyMap<V>, DatabaseIO {
         natWriteToFile(cStruct, pathname.getBytes(filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding), false);
     }
 
+    /** Dumps the committed view to a disk file, in the format of writeToFile(), in a background thread, while commits continue.
+     * The file contains the state of the last commit applied to the view before this call. The entries replaced or removed by
+     * later commits are kept until they have been written. Requires a committed view. All dumps must be closed before the map. */
+    public OffHeapDump startBackgroundDump(String pathname, Charset filenameEncoding) {
+        return new OffHeapDump(natStartBackgroundDump(cStruct,
+          pathname.getBytes(filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding)));
+    }
+
+    /** Dumps the map, or its committed view, to a disk file in the mapped format, which mapFile() loads without reading or copying the entries.
+     * The file depends on the native build (layout of the entries), and is therefore not meant for the exchange between different versions. */
+    public void writeMappedFile(String pathname, Charset filenameEncoding, boolean fromCommittedView) {
+        natWriteMappedFile(cStruct, pathname.getBytes(filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding), fromCommittedView);
+    }
+
+    /** Loads a file written by writeMappedFile() by mapping it into memory: the entries are used in place and only read on first access,
+     * the load time only depends on the number of entries (for maps with open addressing or ordered keys; hash chains write a link into
+     * every entry). Changed entries are allocated off-heap as usual. The map must be empty, and its compression codec must match the file.
+     * The mapping is released when the map is closed. */
+    public void mapFile(String pathname, Charset filenameEncoding, int prewarm) {
+        natMapFile(cStruct, pathname.getBytes(filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding), prewarm);
+    }
+
+    /** Maximum number of segments of writeSegmentedFile(). */
+    public static final int MAX_SEGMENTS = 64;
+
+    /** Dumps the map, or its committed view, to the manifest file pathname, and numberOfSegments segment files (pathname.0, pathname.1, ...),
+     * each holding the entries of a range of slots. The segments are written by a thread each, and checked by a CRC32C checksum and their
+     * record count, which are stored in the manifest, together with the last committed transaction reference. The manifest is written last.
+     * A committed view stays pinned while it is written, delaying the application of commits. */
+    public void writeSegmentedFile(String pathname, Charset filenameEncoding, boolean fromCommittedView, int numberOfSegments) {
+        natWriteSegmentedFile(cStruct, pathname.getBytes(filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding),
+          fromCommittedView, numberOfSegments);
+    }
+
+    /** Loads a dump written by writeSegmentedFile(), by one thread per segment. All segments are verified before the map is changed,
+     * a missing or corrupted segment is reported by an exception, and the map stays empty. The map must be empty, and its compression
+     * codec must match the file. */
+    public void readSegmentedFile(String pathname, Charset filenameEncoding) {
+        natReadSegmentedFile(cStruct, pathname.getBytes(filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding));
+    }
+
+    /** Starts (or restarts) recording the keys changed by commits, for delta checkpoints. The next delta contains the changes after
+     * the current last committed transaction reference, therefore a full dump is written right after this call, usually.
+     * Non-transactional changes are recorded immediately. A non-transactional clear() requires a new full dump and a call of this method.
+     * Transactional maps require a committed view. */
+    public void enableChangeTracking() {
+        natEnableChangeTracking(cStruct);
+    }
+
+    /** Writes the entries of the keys changed since the previous delta (or enableChangeTracking()) to a delta file, or tombstones for
+     * the removed keys, and returns the number of records written. The delta covers the commits up to the last committed transaction
+     * reference of the map (or of its committed view, which stays pinned while it is written). If writing fails, the changes are kept
+     * for the next delta. Transactional maps are written from the committed view only (fromCommittedView must be true), as the map
+     * itself contains the uncommitted changes. */
+    public int writeDeltaFile(String pathname, Charset filenameEncoding, boolean fromCommittedView) {
+        return natWriteDeltaFile(cStruct, pathname.getBytes(filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding),
+          fromCommittedView);
+    }
+
+    /** Applies a delta file to the map and its committed view. The delta must follow the state of the map (no changes missing in between),
+     * and must not be older. It is verified completely before the map is changed. Its codec must match the map, and no snapshots may be open. */
+    public void applyDeltaFile(String pathname, Charset filenameEncoding) {
+        natApplyDeltaFile(cStruct, pathname.getBytes(filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding));
+    }
+
+    /** Restores a checkpoint: loads the full dump basePathname into the (empty) map, and applies the chain of delta files in order. */
+    public void restoreCheckpoint(String basePathname, String [] deltaPathnames, Charset filenameEncoding) {
+        readFromFile(basePathname, filenameEncoding);
+        for (String delta : deltaPathnames)
+            applyDeltaFile(delta, filenameEncoding);
+    }
+
+    /** Merges a full dump and a chain of delta files into a new full dump, without a map. The base is streamed, the deltas are held
+     * in memory. The deltas must have been written with the codec of the base. */
+    public static void mergeCheckpoint(String basePathname, String [] deltaPathnames, String targetPathname, Charset filenameEncoding) {
+        Charset cs = filenameEncoding == null ? DEFAULT_FILENAME_ENCODING : filenameEncoding;
+        byte [][] deltas = new byte [deltaPathnames.length][];
+        for (int i = 0; i < deltas.length; ++i)
+            deltas[i] = deltaPathnames[i].getBytes(cs);
+        natMergeCheckpoint(basePathname.getBytes(cs), deltas, targetPathname.getBytes(cs));
+    }
+
     /** Read a database from disk. The database should be empty before. */
     @Override
     public void readFromFile(String pathname, Charset filenameEncoding) {
@@ -157,6 +342,98 @@ implements PrimitiveLongKeyMap<V>, DatabaseIO {
     }
 
 
+    /** Stores or removes multiple entries with a single JNI call. The buffer must be a direct ByteBuffer in big endian byte order
+     * (the default), and contains records of key (long), length (int), flags (int, see BATCH_FLAG_*), followed by length bytes of data.
+     * The records between the position and the limit of the buffer are applied in sequence, within the current transaction.
+     * Data is compressed if requested by the flags, or if it is bigger than the threshold of the map.
+     * Returns the number of records which replaced or removed an existing entry. The position of the buffer is not changed. */
+    public int setBatch(ByteBuffer src) {
+        return natSetBatch(cStruct, myShard.getTxCStruct(), src, src.position(), src.limit(), maxUncompressedSize);
+    }
+
+    /** Appends a record for setBatch() to a buffer. data == null creates a delete record. */
+    public static void addBatchRecord(ByteBuffer dst, long key, byte [] data, int flags) {
+        dst.putLong(key);
+        if (data == null) {
+            dst.putInt(0);
+            dst.putInt(flags | BATCH_FLAG_DELETE);
+        } else {
+            dst.putInt(data.length);
+            dst.putInt(flags);
+            dst.put(data);
+        }
+    }
+
+    /** Removes the entries for multiple keys with a single JNI call. The buffer must be a direct ByteBuffer in big endian byte order
+     * (the default), and contains the keys as longs between its position and limit.
+     * Returns the number of entries removed. The position of the buffer is not changed. */
+    public int deleteBatch(ByteBuffer src) {
+        return natDeleteBatch(cStruct, myShard.getTxCStruct(), src, src.position(), src.limit());
+    }
+
+    /** Builds a compression dictionary of at most maxSize bytes (MIN_TRAINED_DICTIONARY_SIZE up to MAX_DICTIONARY_SIZE) from a sample
+     * of the current entries. Small records with repeated field names or values compress much better with a dictionary. */
+    public byte [] trainDictionary(int maxSize) {
+        return natTrainDictionary(cStruct, maxSize);
+    }
+
+    /** Sets the compression dictionary used for all entries compressed afterwards, null removes it. The dictionary is stored in dumps as well.
+     * It can only be replaced while the map does not contain compressed entries, i.e. the map should be loaded uncompressed,
+     * then the dictionary is trained and set, and then the entries are written again. */
+    public void setDictionary(byte [] dictionary) {
+        natSetDictionary(cStruct, dictionary);
+    }
+
+    /** Returns a copy of the compression dictionary, or null if none is used. */
+    public byte [] getDictionary() {
+        return natGetDictionary(cStruct);
+    }
+
+    /** Enables a cache of decompressed values of the given capacity in bytes, for read heavy maps with compressed entries.
+     * The cache is shared with the committed view. Entries are dropped from the cache when they are replaced or removed.
+     * A capacity of 0 disables the cache. The size should be set while no other thread reads the map. */
+    public void setCacheSize(long capacity) {
+        if (capacity < 0)
+            throw new IllegalArgumentException("cache capacity may not be < 0");
+        natSetCacheSize(cStruct, capacity);
+    }
+
+    /** Attaches an index which is maintained natively by set, put, delete and the batch operations of this map, within the same transaction.
+     * The index value is field fieldNo of the row, as returned by getField() for the same delimiter and null indicator.
+     * Rows without that field (or with a null field) have no index entry. If the index is unique, a row change which would
+     * create a duplicate throws and leaves the row and all indexes unchanged. The map must be empty. */
+    public void attachFieldIndex(PrimitiveLongKeyOffHeapIndex<byte []> index, int fieldNo, byte delimiter, byte nullIndicator) {
+        if (fieldNo < 0)
+            throw new IllegalArgumentException("field number may not be < 0");
+        natAttachIndex(cStruct, index.cStruct, INDEX_RULE_FIELD, fieldNo, 0, delimiter, nullIndicator);
+    }
+
+    /** Attaches an index as attachFieldIndex() does, using up to length bytes from offset of each row as index value
+     * (truncated for shorter rows, rows ending before offset have no index entry). */
+    public void attachRegionIndex(PrimitiveLongKeyOffHeapIndex<byte []> index, int offset, int length) {
+        if (offset < 0 || length <= 0)
+            throw new IllegalArgumentException("bad index region");
+        natAttachIndex(cStruct, index.cStruct, INDEX_RULE_REGION, offset, length, (byte)0, (byte)0);
+    }
+
+    /** Stops maintaining an attached index. Returns false if the index was not attached to this map. */
+    public boolean detachIndex(PrimitiveLongKeyOffHeapIndex<?> index) {
+        return natDetachIndex(cStruct, index.cStruct);
+    }
+
+    /** Opens a snapshot of the committed view: reads through the snapshot return the values as of the last commit applied to the view,
+     * however many commits follow. The values replaced or removed by these commits are kept until the snapshot has been closed.
+     * Snapshots may be opened, read and closed by other threads than the one modifying the map. Requires a committed view. */
+    public OffHeapSnapshot<V> openSnapshot() {
+        return new OffHeapSnapshot<V>(converter, natOpenSnapshot(cStruct));
+    }
+
+    /** Frees the values kept for snapshots which have been closed meanwhile. This is also done by the next commit,
+     * and must be called by the thread modifying the map. Returns the number of versions freed. */
+    public int reclaimVersions() {
+        return natReclaimVersions(cStruct);
+    }
+
     @Override
     public V remove(long key) {
         return converter.byteArrayToValueType(natRemove(cStruct, myShard.getTxCStruct(), key));
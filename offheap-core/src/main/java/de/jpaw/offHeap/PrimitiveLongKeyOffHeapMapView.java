@@ -15,6 +15,24 @@ import de.jpaw.collections.PrimitiveLongKeyMapView;
  *
  *  This implementation is not thread-safe. */
 public class PrimitiveLongKeyOffHeapMapView<V> extends AbstractOffHeapMap<V> implements PrimitiveLongKeyMapView<V> {
+    /** Indexes into the statistics of the cache of decompressed values, see getCacheStats(). */
+    public static final int CACHESTAT_HITS = 0;
+    public static final int CACHESTAT_MISSES = 1;
+    public static final int CACHESTAT_ENTRIES = 2;          // number of cached values
+    public static final int CACHESTAT_BYTES_USED = 3;       // bytes of cached values
+    public static final int CACHESTAT_CAPACITY = 4;         // 0 if no cache is used
+    public static final int CACHESTAT_NUM_STATS = 5;
+
+    /** Modes of natSeek. */
+    private static final int SEEK_FLOOR = 0;
+    private static final int SEEK_CEILING = 1;
+    private static final int SEEK_HIGHER = 2;
+    private static final int SEEK_LOWER = 3;
+    private static final int RANGE_CHUNK_SIZE = 256;
+
+    /** Scans of all entries, as used by the chunked iteration. */
+    private static final ScanSpec ALL_KEYS = new ScanSpec((byte)0);
+    private static final ScanSpec ALL_ENTRIES = new ScanSpec((byte)0).project(ScanSpec.PROJECT_ROW);
 
     static {
         OffHeapInit.init();
@@ -45,6 +63,40 @@ public class PrimitiveLongKeyOffHeapMapView<V> extends AbstractOffHeapMap<V> imp
     /** Read an entry and return it as a DirectByteBuffer which is created from JNI. This avoids a buffer copy. */
     private static native ByteBuffer natGetAsByteBuffer(long cMap, long key);
 
+    /** Acquire a lease on an entry. Returns the native lease, or 0 if no entry is present for the specified key. */
+    private static native long natLease(long cMap, long key);
+
+    /** Fills the statistics of the cache of decompressed values, see the CACHESTAT_* constants. */
+    private static native void natGetCacheStats(long cMap, long [] stats);
+
+    /** Ordered maps only: finds a neighbouring key (see the SEEK_* constants) and stores it in result[0]. Returns false if none exists. */
+    private static native boolean natSeek(long cMap, long key, int mode, long [] result);
+
+    /** Ordered maps only: copies the keys within [fromKey, toKey] into keys, in ascending order, up to maxCount. Returns the number of keys. */
+    private static native int natGetKeyRange(long cMap, long fromKey, long toKey, long [] keys, int maxCount);
+
+    /** Read the entries for count keys, starting at keys[fromIndex], into the direct buffer target, between position and limit.
+     * Returns the number of keys processed in the upper 32 bits and the new position in the lower 32 bits. */
+    private static native long natGetBatch(long cMap, long [] keys, int fromIndex, int count, ByteBuffer target, int position, int limit);
+
+    /** Scans the map for the rows matching spec (see ScanSpec), starting at the cursor, and writes up to maxRows of them into the
+     * direct buffer target, between position and limit. The chains of the committed view are followed if isView is set.
+     * Returns the number of rows written in the upper 32 bits and the new position in the lower 32 bits. */
+    private static native long natScan(long cMap, boolean isView, byte [] spec, long [] cursor, ByteBuffer target, int position, int limit,
+      int maxRows);
+
+    /** Aggregates the rows matching spec, optionally grouped by groupField, using up to numThreads threads. See Aggregates for the result. */
+    private static native byte [] natAggregate(long cMap, boolean isView, byte [] spec, int groupField, int valueField, int numThreads);
+
+    /** Pin a committed view: commits to it wait until its pins have been released. Returns the pin (0 if cMap is not a view). */
+    private static native long natPinView(long cMap);
+
+    /** Release a pin obtained by natPinView. */
+    private static native void natUnpinView(long cMap, long pin);
+
+    /** Returns the number of slots a scan of the map iterates over. */
+    private static native int natGetScanSlots(long cMap);
+
     /** Copy an entry into a preallocated byte area, at a certain offset. */
     private static native int natGetIntoPreallocated(long cMap, long key, byte [] target, int offset);
 
@@ -78,11 +130,63 @@ public class PrimitiveLongKeyOffHeapMapView<V> extends AbstractOffHeapMap<V> imp
         return converter.byteArrayToValueType(natGet(cStruct, key));
     }
 
-    /** returns the data as a DirectByteBuffer. */
+    /** returns the data as a DirectByteBuffer.
+     * The buffer of an uncompressed entry becomes invalid once the entry is updated or removed, the buffer of a compressed one is never freed.
+     * lease() avoids both problems. */
     public ByteBuffer getAsByteBuffer(long key) {
         return natGetAsByteBuffer(cStruct, key);
     }
 
+    /** Returns a lease for the data stored for key, or null if no entry is present. The lease must be closed after use,
+     * preferably by try-with-resources. Until then, the buffer remains valid, even if the entry is modified or removed. */
+    public OffHeapLease lease(long key) {
+        long cLease = natLease(cStruct, key);
+        return cLease == 0L ? null : new OffHeapLease(cLease);
+    }
+
+    /** Reads the entries for multiple keys with a single JNI call. For every key, starting at keys[fromIndex],
+     * the (uncompressed) length is written as an int in big endian byte order, followed by the data.
+     * The length is -1 for keys which do not exist.
+     * Writing starts at the current position of the buffer, which must be a direct ByteBuffer, and the position is advanced.
+     * Returns the number of keys processed, which is less than count if the buffer was not big enough. */
+    public int getBatch(long [] keys, int fromIndex, int count, ByteBuffer target) {
+        if (fromIndex < 0 || count < 0 || fromIndex + count > keys.length)
+            throw new IndexOutOfBoundsException();
+        long result = natGetBatch(cStruct, keys, fromIndex, count, target, target.position(), target.limit());
+        target.position((int)result);
+        return (int)(result >>> 32);
+    }
+
+    public int getBatch(long [] keys, ByteBuffer target) {
+        return getBatch(keys, 0, keys.length, target);
+    }
+
+    /** Scans the map natively and writes the rows matching all predicates of spec into target, which must be a direct ByteBuffer.
+     * Per row, the key (long) is written, then for every projection of spec the length (int, -1 for a null field) followed by the bytes,
+     * all in big endian byte order. Writing starts at the current position of the buffer, and the position is advanced.
+     * Only complete rows are written. The next call continues at the cursor, until cursor.isAtEnd().
+     * Ordered maps are scanned in key order, others in slot order. As for iterators, rows changed between calls
+     * may be skipped or returned twice. Returns the number of rows written. */
+    public int scan(ScanSpec spec, ScanSpec.Cursor cursor, ByteBuffer target) {
+        if (cursor.isAtEnd())
+            return 0;
+        long result = natScan(cStruct, isView, spec.toBytes(), cursor.state, target, target.position(), target.limit(), Integer.MAX_VALUE);
+        target.position((int)result);
+        return (int)(result >>> 32);
+    }
+
+    /** Aggregates the rows matching the predicates of filter (its projections are ignored) natively: counts them, and sums up the
+     * numeric (decimal) values of field valueField, grouped by the value of field groupField. Either field can be Aggregates.NO_FIELD.
+     * Big maps are processed by up to numThreads threads, each scanning a range of slots. The map must not be modified meanwhile,
+     * a committed view is pinned for the duration of the call (see ParallelScan). */
+    public Aggregates aggregate(ScanSpec filter, int groupField, int valueField, int numThreads) {
+        return new Aggregates(natAggregate(cStruct, isView, filter.toBytes(), groupField, valueField, numThreads));
+    }
+
+    public Aggregates aggregate(ScanSpec filter, int groupField, int valueField) {
+        return aggregate(filter, groupField, valueField, 1);
+    }
+
     /** Returns the length of a stored entry, or -1 if no entry is stored. */
     public int length(long key) {
         return natLength(cStruct, key);
@@ -93,6 +197,14 @@ public class PrimitiveLongKeyOffHeapMapView<V> extends AbstractOffHeapMap<V> imp
         return natCompressedLength(cStruct, key);
     }
 
+    /** Returns the statistics of the cache of decompressed values, indexed by the CACHESTAT_* constants.
+     * A map and its committed view share the same cache. */
+    public long [] getCacheStats() {
+        long [] stats = new long [CACHESTAT_NUM_STATS];
+        natGetCacheStats(cStruct, stats);
+        return stats;
+    }
+
     /** Stores an entry in the map and returns the previous entry, or null if there was no prior entry for this key.
      * Deleting an entry can be done by passing null as the data pointer. */
     @Override
@@ -138,6 +250,183 @@ public class PrimitiveLongKeyOffHeapMapView<V> extends AbstractOffHeapMap<V> imp
     }
 
 
+    private Long seek(long key, int mode) {
+        long [] result = new long [1];
+        return natSeek(cStruct, key, mode, result) ? Long.valueOf(result[0]) : null;
+    }
+
+    /** Ordered maps only: returns the greatest key less than or equal to key, or null if there is no such key. */
+    public Long floorKey(long key) {
+        return seek(key, SEEK_FLOOR);
+    }
+
+    /** Ordered maps only: returns the least key greater than or equal to key, or null if there is no such key. */
+    public Long ceilingKey(long key) {
+        return seek(key, SEEK_CEILING);
+    }
+
+    /** Ordered maps only: returns the least key strictly greater than key, or null if there is no such key. */
+    public Long higherKey(long key) {
+        return seek(key, SEEK_HIGHER);
+    }
+
+    /** Ordered maps only: returns the greatest key strictly less than key, or null if there is no such key. */
+    public Long lowerKey(long key) {
+        return seek(key, SEEK_LOWER);
+    }
+
+    /** Ordered maps only: copies the keys between fromKey and toKey (both inclusive) into keys, in ascending order.
+     * Returns the number of keys copied, at most keys.length. */
+    public int getKeys(long fromKey, long toKey, long [] keys) {
+        return natGetKeyRange(cStruct, fromKey, toKey, keys, keys.length);
+    }
+
+    /** Ordered maps only: iterates the entries with keys between fromKey and toKey (both inclusive), in ascending order.
+     * The keys are fetched in chunks, the values on demand. */
+    public Iterator<PrimitiveLongKeyMapView.Entry<V>> getRange(long fromKey, long toKey) {
+        return new RangeIterator(fromKey, toKey);
+    }
+
+    /** Returns an iterator over all entries which transfers them in chunks, see EntryChunkIterator. */
+    public EntryChunkIterator chunkIterator(ByteBuffer buffer, int maxRecords, boolean withValues) {
+        return new EntryChunkIterator(buffer, maxRecords, withValues, new ScanSpec.Cursor());
+    }
+
+    /** Pins this committed view and splits it into up to numPartitions partitions, see ParallelScan. */
+    public ParallelScan parallelScan(int numPartitions) {
+        return new ParallelScan(numPartitions);
+    }
+
+    /** A scan of a committed view by several threads. While it is open, the view is pinned: commits which change it block
+     * before they are applied to it (the transactions' own maps are updated), therefore all partitions see the
+     * view at the same, consistent point, and no entry is freed during the scan. Pins are taken by aggregate() as well.
+     * Commits to other maps are not affected.
+     * The slots of the view are split into partitions of about the same size, which can be scanned concurrently, each by
+     * its own thread, via scan() with the partition's cursor, or by a chunk iterator. Ordered maps are scanned in slot
+     * order then, not in key order.
+     * The scan must be closed. A commit to the view by the thread which opened the scan is rejected by an exception before,
+     * as it would wait forever, and can be repeated once the scan has been closed. */
+    public class ParallelScan implements AutoCloseable {
+        private final int numSlots;
+        private final int numPartitions;
+        private final long pin;
+        private boolean closed = false;
+
+        private ParallelScan(int numPartitions) {
+            if (numPartitions <= 0)
+                throw new IllegalArgumentException();
+            pin = natPinView(cStruct);
+            numSlots = natGetScanSlots(cStruct);
+            this.numPartitions = numSlots < numPartitions ? Math.max(numSlots, 1) : numPartitions;
+        }
+
+        public int getNumberOfPartitions() {
+            return numPartitions;
+        }
+
+        /** Returns a new cursor which covers the slots of partition i. */
+        public ScanSpec.Cursor getPartition(int i) {
+            if (closed || i < 0 || i >= numPartitions)
+                throw new IllegalArgumentException();
+            return new ScanSpec.Cursor((long)numSlots * i / numPartitions, (long)numSlots * (i + 1) / numPartitions);
+        }
+
+        /** Returns a chunk iterator over the entries of partition i. */
+        public EntryChunkIterator chunkIterator(int i, ByteBuffer buffer, int maxRecords, boolean withValues) {
+            return new EntryChunkIterator(buffer, maxRecords, withValues, getPartition(i));
+        }
+
+        /** Releases the pin, which allows pending commits to proceed. */
+        @Override
+        public void close() {
+            if (!closed) {
+                closed = true;
+                natUnpinView(cStruct, pin);
+            }
+        }
+    }
+
+    /** Iterates all entries in chunks, with a single JNI call per chunk: nextChunk() fills a direct ByteBuffer with up to maxRecords
+     * records, which consist of the key (long), and, if values are requested, the (uncompressed) length (int) and the data,
+     * all in big endian byte order. Compressed entries are decompressed straight into the buffer.
+     * As for the entry iterator, entries changed meanwhile may be skipped or returned twice. */
+    public class EntryChunkIterator {
+        private final ScanSpec.Cursor cursor;
+        private final ByteBuffer buffer;
+        private final int maxRecords;
+        private final ScanSpec spec;
+
+        private EntryChunkIterator(ByteBuffer buffer, int maxRecords, boolean withValues, ScanSpec.Cursor cursor) {
+            if (!buffer.isDirect() || maxRecords <= 0)
+                throw new IllegalArgumentException();
+            this.cursor = cursor;
+            this.buffer = buffer;
+            this.maxRecords = maxRecords;
+            this.spec = withValues ? ALL_ENTRIES : ALL_KEYS;
+        }
+
+        /** Returns false once all entries have been returned. */
+        public boolean hasNext() {
+            return !cursor.isAtEnd();
+        }
+
+        /** Fills the buffer with the next chunk, starting at offset 0, and flips it.
+         * Returns the number of records, which is 0 once all entries have been returned.
+         * Throws if the buffer is too small for the next entry. */
+        public int nextChunk() {
+            buffer.clear();
+            int n = 0;
+            if (!cursor.isAtEnd()) {
+                long result = natScan(cStruct, isView, spec.toBytes(), cursor.state, buffer, 0, buffer.limit(), maxRecords);
+                buffer.position((int)result);
+                n = (int)(result >>> 32);
+            }
+            buffer.flip();
+            return n;
+        }
+    }
+
+    private class RangeIterator implements Iterator<PrimitiveLongKeyMapView.Entry<V>> {
+        private final long [] keys = new long [RANGE_CHUNK_SIZE];
+        private final long toKey;
+        private int numKeys;
+        private int position = 0;
+        private PrimitiveLongKeyOffHeapMapEntry currentEntry = null;
+
+        private RangeIterator(long fromKey, long toKey) {
+            this.toKey = toKey;
+            numKeys = natGetKeyRange(cStruct, fromKey, toKey, keys, RANGE_CHUNK_SIZE);
+        }
+
+        @Override
+        public boolean hasNext() {
+            if (position < numKeys)
+                return true;
+            // a full chunk may be followed by more keys
+            if (numKeys < RANGE_CHUNK_SIZE || keys[numKeys - 1] == toKey)
+                return false;
+            numKeys = natGetKeyRange(cStruct, keys[numKeys - 1] + 1, toKey, keys, RANGE_CHUNK_SIZE);
+            position = 0;
+            return numKeys > 0;
+        }
+
+        @Override
+        public PrimitiveLongKeyOffHeapMapEntry next() {
+            if (!hasNext())
+                throw new NoSuchElementException();
+            currentEntry = new PrimitiveLongKeyOffHeapMapEntry(keys[position++]);
+            return currentEntry;
+        }
+
+        @Override
+        public void remove() {
+            if (currentEntry == null)
+                throw new NoSuchElementException();
+            delete(currentEntry.getKey());
+        }
+    }
+
+
     // protected proxy for access from index class
     protected PrimitiveLongKeyOffHeapMapEntry createEntry(long key) {
         return new PrimitiveLongKeyOffHeapMapEntry(key);
@@ -0,0 +1,156 @@
+package de.jpaw.offHeap;
+
+import java.nio.ByteBuffer;
+import java.util.ArrayList;
+import java.util.List;
+
+/** Predicates and projection of a native scan, see PrimitiveLongKeyOffHeapMapView.scan().
+ * A row matches if all predicates hold. Fields are numbered and delimited as for getField(), null fields never match.
+ * Byte ranges compare unsigned bytes lexicographically, both bounds are inclusive. */
+public class ScanSpec {
+    /** Projection of the whole row. */
+    public static final int PROJECT_ROW = -1;
+
+    /** Kinds of predicates, as evaluated by the native code. */
+    private static final int FIELD_EQUALS = 0;
+    private static final int FIELD_PREFIX = 1;
+    private static final int FIELD_RANGE = 2;
+    private static final int REGION_RANGE = 3;
+    private static final int MAX_TERMS = 64;
+
+    private static class Predicate {
+        private final int kind;
+        private final int position;
+        private final byte [] a;
+        private final byte [] b;
+
+        private Predicate(int kind, int position, byte [] a, byte [] b) {
+            this.kind = kind;
+            this.position = position;
+            this.a = a;
+            this.b = b;
+        }
+    }
+
+    /** The position of a scan. A new cursor starts at the beginning of the map. */
+    public static class Cursor {
+        final long [] state = new long [3];     // updated from JNI: slot or key, position within the slot, end slot
+        private final long fromSlot;
+
+        public Cursor() {
+            this(0L, Long.MAX_VALUE);
+        }
+
+        /** Creates a cursor which scans the slots from fromSlot (inclusive) to toSlot (exclusive) only, also for ordered maps.
+         * Used for the partitions of a parallel scan. */
+        Cursor(long fromSlot, long toSlot) {
+            this.fromSlot = fromSlot;
+            state[2] = toSlot;
+            reset();
+        }
+
+        /** Returns true once all rows have been scanned. */
+        public boolean isAtEnd() {
+            return state[0] < 0L;
+        }
+
+        /** Restarts the scan at the beginning of the map (or partition). */
+        public void reset() {
+            state[0] = fromSlot;
+            state[1] = 0L;
+        }
+    }
+
+    private final byte delimiter;
+    private final byte nullIndicator;
+    private final List<Predicate> predicates = new ArrayList<Predicate>();
+    private final List<Integer> projections = new ArrayList<Integer>();
+    private byte [] serialized = null;
+
+    public ScanSpec(byte delimiter, byte nullIndicator) {
+        this.delimiter = delimiter;
+        this.nullIndicator = nullIndicator;
+    }
+    public ScanSpec(byte delimiter) {
+        this(delimiter, delimiter);
+    }
+
+    private ScanSpec add(int kind, int position, byte [] a, byte [] b) {
+        if (position < 0 || a == null)
+            throw new IllegalArgumentException();
+        if (predicates.size() >= MAX_TERMS)
+            throw new IllegalArgumentException("too many predicates");
+        predicates.add(new Predicate(kind, position, a, b));
+        serialized = null;
+        return this;
+    }
+
+    /** Field fieldNo must be equal to value. */
+    public ScanSpec fieldEquals(int fieldNo, byte [] value) {
+        return add(FIELD_EQUALS, fieldNo, value, null);
+    }
+
+    /** Field fieldNo must start with prefix. */
+    public ScanSpec fieldPrefix(int fieldNo, byte [] prefix) {
+        return add(FIELD_PREFIX, fieldNo, prefix, null);
+    }
+
+    /** Field fieldNo must be within from and to. to == null means no upper bound. */
+    public ScanSpec fieldRange(int fieldNo, byte [] from, byte [] to) {
+        return add(FIELD_RANGE, fieldNo, from, to);
+    }
+
+    /** The from.length bytes at offset must be within from and to, which must have the same length. to == null means no upper bound.
+     * Rows ending before do not match. */
+    public ScanSpec regionRange(int offset, byte [] from, byte [] to) {
+        if (from == null || from.length == 0 || (to != null && to.length != from.length))
+            throw new IllegalArgumentException("bad region bounds");
+        return add(REGION_RANGE, offset, from, to);
+    }
+
+    /** Adds field fieldNo (or the whole row for PROJECT_ROW) to the output of every matching row. */
+    public ScanSpec project(int fieldNo) {
+        if (fieldNo < PROJECT_ROW)
+            throw new IllegalArgumentException();
+        if (projections.size() >= MAX_TERMS)
+            throw new IllegalArgumentException("too many projections");
+        projections.add(fieldNo);
+        serialized = null;
+        return this;
+    }
+
+    /** Returns the number of fields written per row, after the key. */
+    public int getNumberOfProjections() {
+        return projections.size();
+    }
+
+    /** Returns the specification in the format parsed by the native code. */
+    byte [] toBytes() {
+        if (serialized == null) {
+            int size = 16 + 4 * projections.size();
+            for (Predicate p : predicates)
+                size += 16 + p.a.length + (p.b == null ? 0 : p.b.length);
+            ByteBuffer buffer = ByteBuffer.allocate(size);
+            buffer.putInt(delimiter);
+            buffer.putInt(nullIndicator);
+            buffer.putInt(predicates.size());
+            for (Predicate p : predicates) {
+                buffer.putInt(p.kind);
+                buffer.putInt(p.position);
+                buffer.putInt(p.a.length);
+                buffer.put(p.a);
+                if (p.b == null) {
+                    buffer.putInt(-1);
+                } else {
+                    buffer.putInt(p.b.length);
+                    buffer.put(p.b);
+                }
+            }
+            buffer.putInt(projections.size());
+            for (Integer fieldNo : projections)
+                buffer.putInt(fieldNo);
+            serialized = buffer.array();
+        }
+        return serialized;
+    }
+}
@@ -0,0 +1,45 @@
+package de.jpaw.offHeap;
+
+import java.nio.charset.StandardCharsets;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class AggregateTest {
+    static public final int NUM = 100000;
+
+    private static byte [] bytes(String s) {
+        return s.getBytes(StandardCharsets.UTF_8);
+    }
+
+    // sum of field 2 grouped by field 1, for the rows with field 0 = "open"
+    public void runGroupByTest() {
+        LongToStringOffHeapMap map = new LongToStringOffHeapMap.Builder().setHashSize(NUM).setAutonomous().build();
+        for (int i = 0; i < NUM; ++i)
+            map.set(i, (i % 2 == 0 ? "open" : "closed") + ";region" + (i % 4) + ";" + (i % 100));
+
+        ScanSpec open = new ScanSpec((byte)';').fieldEquals(0, bytes("open"));
+        for (int threads = 1; threads <= 4; threads *= 4) {
+            Aggregates result = map.aggregate(open, 1, 2, threads);
+            Assert.assertEquals(result.size(), 2);          // only even regions have open rows
+            Assert.assertEquals(result.getTotalCount(), NUM / 2);
+            int i = result.indexOf(bytes("region2"));
+            Assert.assertTrue(i >= 0);
+            Assert.assertEquals(result.getCount(i), NUM / 4);
+            Assert.assertEquals(result.getValueCount(i), NUM / 4);
+            Assert.assertEquals(result.getMin(i), 2L);
+            Assert.assertEquals(result.getMax(i), 98L);
+            Assert.assertEquals(result.getSum(i), (NUM / 100) * 25L * (2L + 98L) / 2L);
+            Assert.assertEquals(result.indexOf(bytes("region1")), -1);
+        }
+
+        // no grouping: a single null group
+        Aggregates all = map.aggregate(new ScanSpec((byte)';'), Aggregates.NO_FIELD, 2);
+        Assert.assertEquals(all.size(), 1);
+        Assert.assertNull(all.getGroup(0));
+        Assert.assertEquals(all.getCount(0), NUM);
+        Assert.assertEquals(all.getSum(0), (NUM / 100) * 4950L);
+        map.close();
+    }
+}
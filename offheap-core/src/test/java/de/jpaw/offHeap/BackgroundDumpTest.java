@@ -0,0 +1,56 @@
+package de.jpaw.offHeap;
+
+import java.io.File;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class BackgroundDumpTest {
+    private static final int NUM = 50000;
+
+    // the dump contains the state at its start, although the map is changed and committed while it is written
+    public void runBackgroundDumpTest() throws Exception {
+        OffHeapTransaction tx = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard shard = new Shard();
+        shard.setOwningTransaction(tx);
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setHashSize(NUM)
+            .setShard(shard)
+            .addCommittedView()
+            .build();
+        for (int i = 0; i < NUM; ++i)
+            myMap.set(i, "initial value " + i);
+        tx.commit();
+
+        File tmp = new File(System.getProperty("java.io.tmpdir"), "backgroundDumpTest.db");
+        try (OffHeapDump dump = myMap.startBackgroundDump(tmp.getPath(), null)) {
+            Assert.assertEquals(dump.getTotalRecords(), NUM);
+            for (int round = 0; round < 10; ++round) {
+                for (int i = round; i < NUM; i += 100)
+                    myMap.set(i, "changed in round " + round);
+                myMap.remove(NUM - 1 - round);
+                myMap.set(NUM + round, "inserted");
+                tx.commit();
+            }
+            dump.await();
+            Assert.assertTrue(dump.isDone());
+            Assert.assertEquals(dump.getRecordsWritten(), NUM);
+        }
+
+        LongToStringOffHeapMap myMap2 = new LongToStringOffHeapMap.Builder()
+            .setAutonomous()
+            .setHashSize(NUM)
+            .build();
+        myMap2.readFromFile(tmp.getPath(), null);
+        Assert.assertEquals(myMap2.size(), NUM);
+        for (int i = 0; i < NUM; ++i)
+            Assert.assertEquals(myMap2.get(i), "initial value " + i);
+        Assert.assertNull(myMap2.get(NUM));
+        tmp.delete();
+
+        myMap2.close();
+        tx.close();
+        myMap.close();
+    }
+}
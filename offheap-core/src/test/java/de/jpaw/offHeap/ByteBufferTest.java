@@ -36,4 +36,88 @@ public class ByteBufferTest {
         Assert.assertEquals(result.position(), 0);
         myMap.close();
     }
+
+    @Test
+    public void runGetBatchTest() {
+        LongToByteArrayOffHeapMap myMap = LongToByteArrayOffHeapMap.forHashSize(1000);
+        long [] keys = new long [1000];
+        for (int i = 0; i < 1000; ++i) {
+            keys[i] = i;
+            if ((i & 1) == 0)
+                myMap.set(i, ("value " + i).getBytes(defCS));
+        }
+        ByteBuffer target = ByteBuffer.allocateDirect(8000);
+        int done = myMap.getBatch(keys, target);
+        Assert.assertTrue(done > 0 && done < 1000);         // buffer too small for all
+
+        target.flip();
+        for (int i = 0; i < done; ++i) {
+            int len = target.getInt();
+            if ((i & 1) != 0) {
+                Assert.assertEquals(len, -1);
+            } else {
+                byte [] data = new byte [len];
+                target.get(data);
+                Assert.assertEquals(new String(data, defCS), "value " + i);
+            }
+        }
+        Assert.assertEquals(target.remaining(), 0);
+
+        target.clear();
+        Assert.assertEquals(myMap.getBatch(keys, done, 1000 - done, target), 1000 - done);
+        myMap.close();
+    }
+
+    @Test
+    public void runSetBatchTest() {
+        LongToByteArrayOffHeapMap myMap = LongToByteArrayOffHeapMap.forHashSize(1000);
+        ByteBuffer src = ByteBuffer.allocateDirect(100000);
+        for (int i = 0; i < 1000; ++i)
+            LongToByteArrayOffHeapMap.addBatchRecord(src, i, ("value " + i).getBytes(defCS), (i & 1) != 0 ? LongToByteArrayOffHeapMap.BATCH_FLAG_COMPRESS : 0);
+        src.flip();
+        Assert.assertEquals(myMap.setBatch(src), 0);
+        Assert.assertEquals(myMap.size(), 1000);
+        Assert.assertEquals(new String(myMap.get(999L), defCS), "value 999");
+
+        src.clear();
+        LongToByteArrayOffHeapMap.addBatchRecord(src, 5L, null, 0);                 // delete
+        LongToByteArrayOffHeapMap.addBatchRecord(src, 6L, TEXT.getBytes(defCS), 0);  // replace
+        LongToByteArrayOffHeapMap.addBatchRecord(src, 2000L, null, 0);              // delete of a missing key
+        src.flip();
+        Assert.assertEquals(myMap.setBatch(src), 2);
+        Assert.assertNull(myMap.get(5L));
+        Assert.assertEquals(new String(myMap.get(6L), defCS), TEXT);
+
+        src.clear();
+        for (long i = 0; i < 2000; i += 2)
+            src.putLong(i);
+        src.flip();
+        Assert.assertEquals(myMap.deleteBatch(src), 500);
+        Assert.assertEquals(myMap.size(), 499);
+        myMap.close();
+    }
+
+    @Test
+    public void runLeaseTest() {
+        LongToByteArrayOffHeapMap myMap = LongToByteArrayOffHeapMap.forHashSize(1000);
+        myMap.set(KEY, TEXT.getBytes(defCS));
+        myMap.setMaxUncompressedSize(100);
+        myMap.set(KEY + 1, TEXT.getBytes(defCS));      // compressed
+        Assert.assertTrue(myMap.compressedLength(KEY + 1) > 0);
+        Assert.assertNull(myMap.lease(KEY + 2));
+
+        try (OffHeapLease lease = myMap.lease(KEY); OffHeapLease lease2 = myMap.lease(KEY + 1)) {
+            // the leased data remains valid after the entries have been replaced or removed
+            for (int i = 0; i < 1000; ++i)
+                myMap.set(KEY, ("other value " + i).getBytes(defCS));
+            myMap.delete(KEY + 1);
+            for (ByteBuffer buffer : new ByteBuffer [] { lease.getBuffer(), lease2.getBuffer() }) {
+                Assert.assertEquals(buffer.remaining(), TEXT.length());
+                byte [] data = new byte [buffer.remaining()];
+                buffer.get(data);
+                Assert.assertEquals(new String(data, defCS), TEXT);
+            }
+        }
+        myMap.close();
+    }
 }
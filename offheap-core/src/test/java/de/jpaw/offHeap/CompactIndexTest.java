@@ -0,0 +1,89 @@
+package de.jpaw.offHeap;
+
+import java.util.UUID;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import de.jpaw.collections.DuplicateIndexException;
+import de.jpaw.collections.PrimitiveLongIterator;
+
+@Test
+public class CompactIndexTest {
+    static public final int NUM = 100000;
+
+    private int count(PrimitiveLongIterator it) {
+        int cnt = 0;
+        while (it.hasNext()) {
+            it.nextAsPrimitiveLong();
+            ++cnt;
+        }
+        return cnt;
+    }
+
+    // long indexes are compact by default, and store equal values of non-unique indexes in the same table, if they do not use posting lists
+    public void runLongIndexTest() {
+        IndexLong myIndex = new IndexLong.Builder().setPostingLists(false).setAutonomous().build();
+        for (int i = 1; i <= NUM; ++i)
+            myIndex.create(i, Long.valueOf(i % 1000));
+        Assert.assertEquals(myIndex.size(), NUM);
+        Assert.assertEquals(count(myIndex.iterator(Long.valueOf(17L))), NUM / 1000);
+        Assert.assertEquals(count(myIndex.iterator(Long.valueOf(17L), 16, 3)), NUM / 1000 - 3);
+        Assert.assertEquals(myIndex.getUniqueKeyByIndex(Long.valueOf(5000L)), 0L);
+
+        for (int i = 1; i <= NUM; i += 2)
+            myIndex.update(i, Long.valueOf(i % 1000), Long.valueOf(i + 1000000L));
+        Assert.assertEquals(myIndex.getUniqueKeyByIndex(Long.valueOf(1000077L)), 77L);
+        Assert.assertEquals(count(myIndex.iterator(Long.valueOf(18L))), NUM / 1000);
+        Assert.assertEquals(count(myIndex.iterator(Long.valueOf(17L))), 0);
+        for (int i = 2; i <= NUM; i += 2)
+            myIndex.delete(i, Long.valueOf(i % 1000));
+        Assert.assertEquals(myIndex.size(), NUM / 2);
+        myIndex.close();
+    }
+
+    @Test(expectedExceptions = DuplicateIndexException.class)
+    public void runUniqueUUIDTest() {
+        IndexUUID myIndex = new IndexUUID.Builder().setUnique(true).setAutonomous().build();
+        try {
+            UUID u = UUID.randomUUID();
+            myIndex.create(1L, u);
+            Assert.assertEquals(myIndex.getUniqueKeyByIndex(u), 1L);
+            myIndex.create(2L, new UUID(u.getMostSignificantBits(), u.getLeastSignificantBits()));
+        } finally {
+            Assert.assertEquals(myIndex.size(), 1);
+            myIndex.close();
+        }
+    }
+
+    // the committed view gets the changes at commit, rollbacks restore the previous values
+    public void runTransactionTest() {
+        OffHeapTransaction tx1 = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard s1 = new Shard();
+        s1.setOwningTransaction(tx1);
+        IndexLong myIndex = new IndexLong.Builder().setUnique(true).setShard(s1).addCommittedView().build();
+        PrimitiveLongKeyOffHeapIndexView<Long> myView = myIndex.getView();
+
+        for (int i = 1; i <= 1000; ++i)
+            myIndex.create(i, Long.valueOf(-i));
+        Assert.assertEquals(myView.size(), 0);
+        tx1.commit();
+        Assert.assertEquals(myView.size(), 1000);
+        Assert.assertEquals(myView.getUniqueKeyByIndex(Long.valueOf(-10L)), 10L);
+
+        myIndex.update(10L, Long.valueOf(-10L), Long.valueOf(10L));
+        myIndex.delete(11L, Long.valueOf(-11L));
+        Assert.assertEquals(myIndex.getUniqueKeyByIndex(Long.valueOf(10L)), 10L);
+        tx1.rollback();
+        Assert.assertEquals(myIndex.getUniqueKeyByIndex(Long.valueOf(10L)), 0L);
+        Assert.assertEquals(myIndex.getUniqueKeyByIndex(Long.valueOf(-11L)), 11L);
+
+        myIndex.update(10L, Long.valueOf(-10L), Long.valueOf(10L));
+        tx1.commit();
+        Assert.assertEquals(myView.getUniqueKeyByIndex(Long.valueOf(10L)), 10L);
+        Assert.assertEquals(myView.getUniqueKeyByIndex(Long.valueOf(-10L)), 0L);
+
+        tx1.close();
+        myIndex.close();
+    }
+}
@@ -0,0 +1,142 @@
+package de.jpaw.offHeap;
+
+import java.io.File;
+import java.util.Arrays;
+import java.util.Random;
+
+import org.testng.annotations.Test;
+
+@Test
+public class CompressionTest {
+    static public final int NUM_ENTRIES = 10000;
+
+    private static String value(int i) {
+        StringBuilder sb = new StringBuilder();
+        for (int j = 0; j < 20; ++j)
+            sb.append("field ").append(j).append(" of entry ").append(i).append(';');
+        return sb.toString();
+    }
+
+    // entries which do not shrink are stored uncompressed
+    public void runRawFallbackTest() {
+        LongToByteArrayOffHeapMap myMap = new LongToByteArrayOffHeapMap.Builder().setAutonomous().build();
+        myMap.setMaxUncompressedSize(0);
+        byte [] random = new byte [1000];
+        new Random(42).nextBytes(random);
+        myMap.set(1L, random);
+        assert(myMap.compressedLength(1L) == 0);
+        myMap.set(2L, value(2).getBytes());
+        assert(myMap.compressedLength(2L) > 0);
+        myMap.close();
+
+        LongToByteArrayOffHeapMap myMap2 = new LongToByteArrayOffHeapMap.Builder().setAutonomous().setMinCompressionSavings(99).build();
+        myMap2.setMaxUncompressedSize(0);
+        myMap2.set(2L, value(2).getBytes());
+        assert(myMap2.compressedLength(2L) == 0);
+        myMap2.close();
+    }
+
+    // a dump written with LZ4HC can be read into a map using LZ4 with acceleration
+    public void runCodecDumpTest() {
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setAutonomous()
+            .setCompression(PrimitiveLongKeyOffHeapMap.CODEC_LZ4HC, 12)
+            .build();
+        myMap.setMaxUncompressedSize(0);
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.set(i, value(i));
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            assert(value(i).equals(myMap.get(i)));
+
+        File tmp = new File(System.getProperty("java.io.tmpdir"), "compressionTest.db");
+        myMap.writeToFile(tmp.getPath(), null);
+        LongToStringOffHeapMap myMap2 = new LongToStringOffHeapMap.Builder()
+            .setAutonomous()
+            .setCompression(PrimitiveLongKeyOffHeapMap.CODEC_LZ4, 8)
+            .build();
+        myMap2.readFromFile(tmp.getPath(), null);
+        assert(myMap2.size() == NUM_ENTRIES);
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            assert(value(i).equals(myMap2.get(i)));
+        assert(myMap2.getField(17, 3, (byte)';').equals("field 3 of entry 17"));
+        tmp.delete();
+
+        myMap2.close();
+        myMap.close();
+    }
+
+    private static String record(int i) {
+        return "{\"customerId\":" + i + ",\"status\":\"" + (i % 3 == 0 ? "ACTIVE" : "SUSPENDED") + "\",\"currency\":\"EUR\",\"segment\":\"RETAIL\"}";
+    }
+
+    // small records compress better with a trained dictionary, which is kept in the dump
+    public void runDictionaryTest() {
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder().setAutonomous().build();
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.set(i, record(i));
+        byte [] dictionary = myMap.trainDictionary(4096);
+        assert(dictionary.length > 0);
+        myMap.setDictionary(dictionary);
+        myMap.setMaxUncompressedSize(0);
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.set(i, record(i));
+        assert(myMap.compressedLength(5) > 0);
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            assert(record(i).equals(myMap.get(i)));
+        try {
+            myMap.setDictionary(null);
+            assert(false);
+        } catch (RuntimeException e) {
+            // expected: compressed entries exist
+        }
+
+        File tmp = new File(System.getProperty("java.io.tmpdir"), "dictionaryTest.db");
+        myMap.writeToFile(tmp.getPath(), null);
+        LongToStringOffHeapMap myMap2 = new LongToStringOffHeapMap.Builder().setAutonomous().build();
+        myMap2.readFromFile(tmp.getPath(), null);
+        assert(Arrays.equals(dictionary, myMap2.getDictionary()));
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            assert(record(i).equals(myMap2.get(i)));
+        tmp.delete();
+
+        myMap2.close();
+        myMap.close();
+    }
+
+    // a maxSize below one training segment is raised to it
+    public void runSmallDictionaryTest() {
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder().setAutonomous().build();
+        for (int i = 0; i < 100; ++i)
+            myMap.set(i, record(i));
+        byte [] dictionary = myMap.trainDictionary(16);
+        assert(dictionary.length > 0 && dictionary.length <= PrimitiveLongKeyOffHeapMap.MIN_TRAINED_DICTIONARY_SIZE);
+        myMap.setDictionary(dictionary);
+        myMap.setMaxUncompressedSize(0);
+        for (int i = 0; i < 100; ++i)
+            myMap.set(i, record(i));
+        for (int i = 0; i < 100; ++i)
+            assert(record(i).equals(myMap.get(i)));
+        myMap.close();
+    }
+
+    // repeated reads of compressed entries are served from the cache, replaced entries are not
+    public void runCacheTest() {
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder().setAutonomous().build();
+        myMap.setMaxUncompressedSize(0);
+        myMap.setCacheSize(1024 * 1024);
+        for (int i = 0; i < 100; ++i)
+            myMap.set(i, value(i));
+        for (int k = 0; k < 3; ++k)
+            for (int i = 0; i < 100; ++i)
+                assert(value(i).equals(myMap.get(i)));
+        long [] stats = myMap.getCacheStats();
+        assert(stats[PrimitiveLongKeyOffHeapMapView.CACHESTAT_MISSES] == 100);
+        assert(stats[PrimitiveLongKeyOffHeapMapView.CACHESTAT_HITS] == 200);
+        myMap.set(5, value(6));
+        assert(value(6).equals(myMap.get(5)));
+        myMap.delete(7);
+        myMap.set(7, value(8));
+        assert(value(8).equals(myMap.get(7)));
+        myMap.close();
+    }
+}
@@ -0,0 +1,146 @@
+package de.jpaw.offHeap;
+
+import java.io.File;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class DeltaCheckpointTest {
+    private static final int NUM = 10000;
+
+    // a transactional map with a committed view, from which its deltas are written
+    private LongToStringOffHeapMap buildTransactionalMap(OffHeapTransaction tx, boolean openAddressing) {
+        Shard shard = new Shard();
+        shard.setOwningTransaction(tx);
+        LongToStringOffHeapMap.Builder builder = new LongToStringOffHeapMap.Builder().setShard(shard).addCommittedView();
+        if (openAddressing)
+            builder.setOpenAddressing();
+        LongToStringOffHeapMap myMap = builder.build();
+        for (int i = 0; i < NUM; ++i)
+            myMap.set(i, "value " + i);
+        tx.commit();
+        return myMap;
+    }
+
+    // the deltas of maps without transactions are ordered by their change sequence, the others by the commit references
+    private void runDeltaCheckpoints(boolean openAddressing, boolean transactional) throws Exception {
+        String base = DumpTestSupport.tmpFile("deltaCheckpointTest.db").getPath();
+        String [] deltas = { base + ".d1", base + ".d2" };
+        String merged = base + ".merged";
+
+        OffHeapTransaction tx = transactional ? new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL) : null;
+        LongToStringOffHeapMap myMap = transactional
+            ? buildTransactionalMap(tx, openAddressing) : DumpTestSupport.buildFilledMap(openAddressing, NUM);
+        myMap.enableChangeTracking();
+        myMap.writeToFile(base, null);
+
+        for (int i = 0; i < 100; ++i) {
+            myMap.set(i, "changed " + i);
+            myMap.delete(100 + i);
+            myMap.set(NUM + i, "new " + i);
+        }
+        if (tx != null)
+            tx.commit();
+        Assert.assertEquals(myMap.writeDeltaFile(deltas[0], null, transactional), 300);
+        myMap.set(0, "changed again");
+        myMap.delete(NUM);
+        if (tx != null)
+            tx.commit();
+        Assert.assertEquals(myMap.writeDeltaFile(deltas[1], null, transactional), 2);
+
+        // base followed by the deltas
+        LongToStringOffHeapMap myMap2 = DumpTestSupport.buildMap(openAddressing);
+        myMap2.restoreCheckpoint(base, deltas, null);
+        DumpTestSupport.assertSameContents(myMap, myMap2, NUM + 100);
+
+        // a delta which does not follow the state of the map is rejected
+        LongToStringOffHeapMap myMap3 = DumpTestSupport.buildMap(openAddressing);
+        myMap3.readFromFile(base, null);
+        try {
+            myMap3.applyDeltaFile(deltas[1], null);
+            Assert.fail("missing delta not detected");
+        } catch (RuntimeException e) {
+            Assert.assertEquals(myMap3.size(), NUM);
+        }
+
+        try {
+            PrimitiveLongKeyOffHeapMap.mergeCheckpoint(base, new String [] { deltas[1] }, merged, null);
+            Assert.fail("missing delta not detected by the merge");
+        } catch (RuntimeException e) {
+        }
+
+        // the merged checkpoint restores the same contents
+        PrimitiveLongKeyOffHeapMap.mergeCheckpoint(base, deltas, merged, null);
+        LongToStringOffHeapMap myMap4 = DumpTestSupport.buildMap(openAddressing);
+        myMap4.readFromFile(merged, null);
+        DumpTestSupport.assertSameContents(myMap, myMap4, NUM + 100);
+
+        myMap4.close();
+        myMap3.close();
+        myMap2.close();
+        if (tx != null)
+            tx.close();
+        myMap.close();
+        new File(base).delete();
+        new File(merged).delete();
+        for (String delta : deltas)
+            new File(delta).delete();
+    }
+
+    public void runDeltaHashTest() throws Exception {
+        runDeltaCheckpoints(false, false);
+    }
+
+    public void runDeltaOpenAddressingTest() throws Exception {
+        runDeltaCheckpoints(true, false);
+    }
+
+    public void runDeltaTransactionalHashTest() throws Exception {
+        runDeltaCheckpoints(false, true);
+    }
+
+    public void runDeltaTransactionalOpenAddressingTest() throws Exception {
+        runDeltaCheckpoints(true, true);
+    }
+
+    // the deltas of transactional maps contain the committed changes only, they are written from the committed view
+    public void runDeltaTransactionalTest() throws Exception {
+        String base = DumpTestSupport.tmpFile("deltaTransactionalTest.db").getPath();
+        String delta = base + ".d1";
+        OffHeapTransaction tx = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard shard = new Shard();
+        shard.setOwningTransaction(tx);
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setShard(shard)
+            .addCommittedView()
+            .build();
+        for (int i = 0; i < 100; ++i)
+            myMap.set(i, "value " + i);
+        tx.commit();
+        myMap.enableChangeTracking();
+        myMap.writeToFile(base, null);
+
+        myMap.set(1L, "committed");
+        tx.commit();
+        myMap.set(2L, "pending");
+        try {
+            myMap.writeDeltaFile(delta, null, false);
+            Assert.fail("delta of a transactional map written from the map");
+        } catch (RuntimeException e) {
+        }
+        Assert.assertEquals(myMap.writeDeltaFile(delta, null, true), 1);
+
+        LongToStringOffHeapMap myMap2 = DumpTestSupport.buildMap(false);
+        myMap2.restoreCheckpoint(base, new String [] { delta }, null);
+        Assert.assertEquals(myMap2.get(1L), "committed");
+        Assert.assertEquals(myMap2.get(2L), "value 2");
+
+        myMap2.close();
+        tx.rollback();
+        tx.close();
+        myMap.close();
+        new File(base).delete();
+        new File(delta).delete();
+    }
+}
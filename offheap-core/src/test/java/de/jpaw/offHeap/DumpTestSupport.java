@@ -0,0 +1,38 @@
+package de.jpaw.offHeap;
+
+import java.io.File;
+
+import org.testng.Assert;
+
+/** Maps and files shared by the tests of the dump formats, which run for hash chains as well as for open addressing. */
+final class DumpTestSupport {
+    private DumpTestSupport() {
+    }
+
+    static LongToStringOffHeapMap buildMap(boolean openAddressing) {
+        LongToStringOffHeapMap.Builder builder = new LongToStringOffHeapMap.Builder().setAutonomous();
+        if (openAddressing)
+            builder.setOpenAddressing();
+        return builder.build();
+    }
+
+    /** Fills keys 0 to num - 1, with every second value long enough to be stored compressed. */
+    static LongToStringOffHeapMap buildFilledMap(boolean openAddressing, int num) {
+        LongToStringOffHeapMap myMap = buildMap(openAddressing);
+        myMap.setMaxUncompressedSize(64);
+        for (int i = 0; i < num; ++i)
+            myMap.set(i, i % 2 == 0 ? "short " + i : "a longer value which will be compressed, for entry number " + i);
+        return myMap;
+    }
+
+    static File tmpFile(String name) {
+        return new File(System.getProperty("java.io.tmpdir"), name);
+    }
+
+    /** Compares the keys 0 to upTo - 1, present or not, and the sizes. */
+    static void assertSameContents(LongToStringOffHeapMap expected, LongToStringOffHeapMap actual, int upTo) {
+        Assert.assertEquals(actual.size(), expected.size());
+        for (int i = 0; i < upTo; ++i)
+            Assert.assertEquals(actual.get(i), expected.get(i));
+    }
+}
@@ -0,0 +1,32 @@
+package de.jpaw.offHeap;
+
+import java.io.File;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class DumpWriteErrorTest {
+    private static final int NUM = 10000;
+
+    public void runWriteErrorTest() {
+        if (!new File("/dev/full").exists())
+            return;     // Linux only
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder().setAutonomous().build();
+        for (int i = 0; i < NUM; ++i)
+            myMap.set(i, "value number " + i + " of the map, long enough to fill several buffers of the dump");
+        try {
+            myMap.writeToFile("/dev/full", null);
+            Assert.fail("write error not reported");
+        } catch (RuntimeException e) {
+            Assert.assertTrue(e.getMessage().startsWith("Cannot write the file"));
+        }
+        try {
+            myMap.writeToFile("/nonexistent/directory/dump.db", null);
+            Assert.fail("open error not reported");
+        } catch (RuntimeException e) {
+            Assert.assertTrue(e.getMessage().startsWith("Cannot open file"));
+        }
+        myMap.close();
+    }
+}
@@ -0,0 +1,70 @@
+package de.jpaw.offHeap;
+
+import java.nio.charset.StandardCharsets;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import de.jpaw.collections.DuplicateIndexException;
+import de.jpaw.collections.PrimitiveLongIterator;
+
+@Test
+public class IndexRuleTest {
+    static public final int NUM = 10000;
+
+    private static byte [] bytes(String s) {
+        return s.getBytes(StandardCharsets.UTF_8);
+    }
+
+    // field 1 is a unique id, the first 2 bytes of the row a non-unique code
+    public void runMaintainedIndexTest() {
+        LongToStringOffHeapMap rows = new LongToStringOffHeapMap.Builder().setHashSize(NUM).setAutonomous().build();
+        IndexBytes ids = new IndexBytes.Builder().setHashSize(NUM).setUnique(true).setAutonomous().build();
+        IndexBytes codes = new IndexBytes.Builder().setHashSize(100).setAutonomous().build();
+        rows.attachFieldIndex(ids, 1, (byte)';', (byte)0);
+        rows.attachRegionIndex(codes, 0, 2);
+
+        for (int i = 1; i <= NUM; ++i)
+            rows.set(i, "c" + (i % 5) + ";id" + i + ";payload");
+        Assert.assertEquals(ids.size(), NUM);
+        Assert.assertEquals(ids.getUniqueKeyByIndex(bytes("id17")), 17L);
+
+        int cnt = 0;
+        for (PrimitiveLongIterator it = codes.iterator(bytes("c2")); it.hasNext(); it.nextAsPrimitiveLong())
+            ++cnt;
+        Assert.assertEquals(cnt, NUM / 5);
+
+        rows.set(17L, "c2;id17b");
+        Assert.assertEquals(ids.getUniqueKeyByIndex(bytes("id17")), 0L);
+        Assert.assertEquals(ids.getUniqueKeyByIndex(bytes("id17b")), 17L);
+
+        rows.delete(18L);
+        Assert.assertEquals(ids.getUniqueKeyByIndex(bytes("id18")), 0L);
+        Assert.assertEquals(ids.size(), NUM - 1);
+
+        rows.clear();
+        Assert.assertEquals(ids.size(), 0);
+        Assert.assertEquals(codes.size(), 0);
+        rows.close();
+        ids.close();
+        codes.close();
+    }
+
+    // a duplicate leaves the row and the other indexes unchanged
+    @Test(expectedExceptions = DuplicateIndexException.class)
+    public void runDuplicateTest() {
+        LongToStringOffHeapMap rows = new LongToStringOffHeapMap.Builder().setHashSize(100).setAutonomous().build();
+        IndexBytes codes = new IndexBytes.Builder().setHashSize(100).setAutonomous().build();
+        IndexBytes ids = new IndexBytes.Builder().setHashSize(100).setUnique(true).setAutonomous().build();
+        rows.attachRegionIndex(codes, 0, 2);
+        rows.attachFieldIndex(ids, 1, (byte)';', (byte)0);
+        rows.set(1L, "c1;one");
+        try {
+            rows.set(2L, "c2;one");
+        } finally {
+            Assert.assertEquals(rows.size(), 1);
+            Assert.assertEquals(codes.size(), 1);
+            Assert.assertEquals(ids.getUniqueKeyByIndex(bytes("one")), 1L);
+        }
+    }
+}
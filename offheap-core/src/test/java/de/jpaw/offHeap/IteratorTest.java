@@ -1,7 +1,10 @@
 package de.jpaw.offHeap;
 
+import java.nio.ByteBuffer;
+import java.util.Arrays;
 import java.util.Iterator;
 
+import org.testng.Assert;
 import org.testng.annotations.Test;
 
 import de.jpaw.collections.PrimitiveLongKeyMap;
@@ -68,4 +71,37 @@ public class IteratorTest {
         myMap.clear();
     }
 
+    // chunks of at most 3 records, with compressed entries
+    public void runChunkIteratorTest() {
+        int i;
+        LongToByteArrayOffHeapMap myMap = LongToByteArrayOffHeapMap.forHashSize(8);
+        myMap.setMaxUncompressedSize(4);
+        for (i = 0; i < 4; ++i)
+            myMap.set(keys[i], data[i]);
+
+        ByteBuffer buffer = ByteBuffer.allocateDirect(100);
+        PrimitiveLongKeyOffHeapMapView<byte[]>.EntryChunkIterator chunks = myMap.chunkIterator(buffer, 3, true);
+        int total = 0;
+        while (chunks.hasNext()) {
+            int n = chunks.nextChunk();
+            Assert.assertTrue(n <= 3);
+            for (int j = 0; j < n; ++j) {
+                long key = buffer.getLong();
+                byte [] value = new byte [buffer.getInt()];
+                buffer.get(value);
+                Assert.assertTrue(Arrays.equals(value, myMap.get(key)));
+            }
+            Assert.assertEquals(buffer.remaining(), 0);
+            total += n;
+        }
+        Assert.assertEquals(total, 4);
+        Assert.assertEquals(chunks.nextChunk(), 0);
+
+        // keys only, in a single chunk
+        ByteBuffer keysOnly = ByteBuffer.allocateDirect(100);
+        Assert.assertEquals(myMap.chunkIterator(keysOnly, 100, false).nextChunk(), 4);
+        Assert.assertEquals(keysOnly.remaining(), 4 * 8);
+        myMap.close();
+    }
+
 }
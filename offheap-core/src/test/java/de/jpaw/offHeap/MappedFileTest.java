@@ -0,0 +1,71 @@
+package de.jpaw.offHeap;
+
+import java.io.File;
+import java.io.RandomAccessFile;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class MappedFileTest {
+    private static final int NUM = 20000;
+
+    private void runMappedFile(boolean openAddressing, int prewarm) {
+        LongToStringOffHeapMap myMap = DumpTestSupport.buildFilledMap(openAddressing, NUM);
+        File tmp = DumpTestSupport.tmpFile("mappedFileTest.db");
+        myMap.writeMappedFile(tmp.getPath(), null, false);
+        LongToStringOffHeapMap myMap2 = DumpTestSupport.buildMap(openAddressing);
+        myMap2.mapFile(tmp.getPath(), null, prewarm);
+        DumpTestSupport.assertSameContents(myMap, myMap2, NUM);
+
+        // entries of the file are replaced and removed as usual
+        myMap2.set(1L, "changed");
+        myMap2.remove(2L);
+        Assert.assertEquals(myMap2.get(1L), "changed");
+        Assert.assertNull(myMap2.get(2L));
+        Assert.assertEquals(myMap2.size(), NUM - 1);
+
+        myMap2.close();
+        tmp.delete();
+        myMap.close();
+    }
+
+    public void runMappedHashTest() {
+        runMappedFile(false, PrimitiveLongKeyOffHeapMap.MAPPED_PREWARM_NONE);
+    }
+
+    public void runMappedOpenAddressingTest() {
+        runMappedFile(true, PrimitiveLongKeyOffHeapMap.MAPPED_PREWARM_WILLNEED);
+    }
+
+    // a payload size in the key table which exceeds the entries area is rejected before the map refers to the mapping,
+    // and the dictionary of the file is not kept
+    public void runCorruptedKeyTableTest() throws Exception {
+        LongToStringOffHeapMap myMap = DumpTestSupport.buildMap(true);
+        myMap.setDictionary("a longer value which will be compressed, for entry number ".getBytes());
+        myMap.setMaxUncompressedSize(64);
+        for (int i = 0; i < 100; ++i)
+            myMap.set(i, "a longer value which will be compressed, for entry number " + i);
+        File tmp = DumpTestSupport.tmpFile("mappedFileTest.db");
+        myMap.writeMappedFile(tmp.getPath(), null, false);
+        RandomAccessFile raf = new RandomAccessFile(tmp, "rw");
+        raf.seek(raf.length() - 8);         // payload size of the last key, in native byte order
+        raf.write(new byte [] { 0, 0, 0, 0x7f });
+        raf.close();
+
+        LongToStringOffHeapMap myMap2 = DumpTestSupport.buildMap(true);
+        try {
+            myMap2.mapFile(tmp.getPath(), null, PrimitiveLongKeyOffHeapMap.MAPPED_PREWARM_NONE);
+            Assert.fail("corrupted key table not detected");
+        } catch (RuntimeException e) {
+            Assert.assertEquals(myMap2.size(), 0);
+            Assert.assertNull(myMap2.getDictionary());
+        }
+        myMap2.set(1L, "still usable");
+        Assert.assertEquals(myMap2.get(1L), "still usable");
+
+        myMap2.close();
+        tmp.delete();
+        myMap.close();
+    }
+}
@@ -0,0 +1,42 @@
+package de.jpaw.offHeap;
+
+import java.nio.charset.Charset;
+import java.nio.charset.StandardCharsets;
+
+import org.testng.annotations.Test;
+
+@Test
+public class MemoryStatsTest {
+    static public Charset defCS = StandardCharsets.UTF_8;
+    static public final int NUM_ENTRIES = 100000;
+
+    // deleted entries are reused, clear() returns all slabs
+    public void runStatsTest() {
+        LongToByteArrayOffHeapMap myMap = LongToByteArrayOffHeapMap.forHashSize(1000);
+        long [] stats = myMap.getMemoryStats();
+        assert(stats[AbstractOffHeapMap.MEMSTAT_BYTES_USED] == 0);
+        assert(stats[AbstractOffHeapMap.MEMSTAT_SLABS] == 0);
+
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.set(i, ("value " + i).getBytes(defCS));
+        myMap.set(NUM_ENTRIES, new byte [100000]);
+        stats = myMap.getMemoryStats();
+        assert(stats[AbstractOffHeapMap.MEMSTAT_BYTES_USED] >= NUM_ENTRIES * 32);
+        assert(stats[AbstractOffHeapMap.MEMSTAT_LARGE_BLOCKS] == 1);
+        assert(stats[AbstractOffHeapMap.MEMSTAT_BYTES_RESERVED]
+            == stats[AbstractOffHeapMap.MEMSTAT_BYTES_USED] + stats[AbstractOffHeapMap.MEMSTAT_BYTES_WASTED]);
+        long slabs = stats[AbstractOffHeapMap.MEMSTAT_SLABS];
+
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.delete(i);
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.set(i, ("value " + i).getBytes(defCS));
+        assert(myMap.getMemoryStats()[AbstractOffHeapMap.MEMSTAT_SLABS] == slabs);
+
+        myMap.clear();
+        stats = myMap.getMemoryStats();
+        assert(stats[AbstractOffHeapMap.MEMSTAT_BYTES_USED] == 0);
+        assert(stats[AbstractOffHeapMap.MEMSTAT_BYTES_RESERVED] == 0);
+        myMap.close();
+    }
+}
@@ -155,6 +155,29 @@ public class OffHeapMapTest {
         myMap.close();
     }
 
+    // partial reads decompress a prefix of compressed entries only
+    public void partialReadsCompressed() {
+        LongToByteArrayOffHeapMap myMap = LongToByteArrayOffHeapMap.forHashSize(20);
+        StringBuilder sb = new StringBuilder();
+        for (int i = 0; i < 1000; ++i)
+            sb.append("field").append(i).append(';');
+        byte [] data = sb.toString().getBytes(defCS);
+        myMap.setMaxUncompressedSize(0);
+        myMap.set(KEY, data);
+        assert(myMap.compressedLength(KEY) > 0);
+
+        assert(new String(myMap.getField(KEY, 3, (byte)';'), defCS).equals("field3"));
+        assert(new String(myMap.getField(KEY, 999, (byte)';'), defCS).equals("field999"));
+        assert(myMap.getField(KEY, 1001, (byte)';') == null);
+        assert(new String(myMap.getRegion(KEY, 7, 6), defCS).equals("field1"));
+        assert(myMap.getRegion(KEY, data.length + 1, 6).length == 0);
+
+        byte [] buffer = "xxxxxxxxxx".getBytes(defCS);
+        assert(myMap.getIntoBuffer(KEY, buffer, 4) == 6);
+        assert(Arrays.equals(buffer, "xxxxfield0".getBytes(defCS)));
+        myMap.close();
+    }
+
     public void getRegionTest() {
         LongToByteArrayOffHeapMap myMap = LongToByteArrayOffHeapMap.forHashSize(20);
         byte [] data = "John likes to play foo bar with his dog".getBytes(defCS);
@@ -0,0 +1,80 @@
+package de.jpaw.offHeap;
+
+import java.io.File;
+
+import org.testng.annotations.Test;
+
+@Test
+public class OpenAddressingTest {
+    static public final int NUM_ENTRIES = 100000;
+
+    // the open addressing table must grow from a tiny initial capacity, and support deletes in between
+    public void runGrowAndDeleteTest() {
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setHashSize(32)
+            .setOpenAddressing()
+            .build();
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.set(i, "value " + i);
+        assert(myMap.size() == NUM_ENTRIES);
+        for (int i = 0; i < NUM_ENTRIES; i += 2)
+            assert(myMap.delete(i));
+        assert(myMap.size() == NUM_ENTRIES / 2);
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            assert(i % 2 == 0 ? myMap.get(i) == null : ("value " + i).equals(myMap.get(i)));
+
+        int count = 0;
+        for (@SuppressWarnings("unused") Object e : myMap)
+            ++count;
+        assert(count == NUM_ENTRIES / 2);
+        myMap.verifyMaxChainLength(1);
+        myMap.close();
+    }
+
+    // transactions and the committed view work the same way as with hash chains
+    public void runViewAndDumpTest() {
+        OffHeapTransaction tx1 = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard s1 = new Shard();
+        s1.setOwningTransaction(tx1);
+
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setHashSize(32)
+            .setShard(s1)
+            .addCommittedView()
+            .setOpenAddressing()
+            .build();
+        PrimitiveLongKeyOffHeapMapView<String> myView = myMap.getView();
+
+        for (int i = 0; i < 5000; ++i)
+            myMap.set(i, "v" + i);
+        tx1.commit();
+        for (int i = 5000; i < 20000; ++i)
+            myMap.set(i, "v" + i);
+        for (int i = 0; i < 1000; ++i)
+            myMap.delete(i);
+        tx1.rollback();
+        assert(myMap.size() == 5000);
+        assert(myView.size() == 5000);
+
+        for (int i = 5000; i < 20000; ++i)
+            myMap.set(i, "v" + i);
+        tx1.commit();
+        assert(myView.size() == 20000);
+
+        File tmp = new File(System.getProperty("java.io.tmpdir"), "openAddressingTest.db");
+        myMap.writeToFile(tmp.getPath(), null);
+        LongToStringOffHeapMap myMap2 = new LongToStringOffHeapMap.Builder()
+            .setAutonomous()
+            .setOpenAddressing()
+            .build();
+        myMap2.readFromFile(tmp.getPath(), null);
+        assert(myMap2.size() == 20000);
+        for (int i = 0; i < 20000; ++i)
+            assert(("v" + i).equals(myMap2.get(i)));
+        tmp.delete();
+
+        myMap2.close();
+        tx1.close();
+        myMap.close();
+    }
+}
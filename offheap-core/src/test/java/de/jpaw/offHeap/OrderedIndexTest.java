@@ -0,0 +1,84 @@
+package de.jpaw.offHeap;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import de.jpaw.collections.PrimitiveLongIterator;
+
+@Test
+public class OrderedIndexTest {
+    static public final int NUM = 5000;
+
+    private int count(PrimitiveLongIterator it) {
+        int cnt = 0;
+        while (it.hasNext()) {
+            it.nextAsPrimitiveLong();
+            ++cnt;
+        }
+        return cnt;
+    }
+
+    // range and prefix scans return the keys in order of the index value
+    public void runRangeTest() {
+        IndexString myIndex = new IndexString.Builder().setOrdered().setAutonomous().build();
+        for (int i = 0; i < NUM; ++i)
+            myIndex.create(i, String.format("IND%04d", (i * 7) % 1000));   // every value 5 times
+
+        PrimitiveLongIterator it = myIndex.rangeIterator("IND0100", "IND0199", 16, 0);
+        long previous = -1L;
+        int cnt = 0;
+        while (it.hasNext()) {
+            long key = it.nextAsPrimitiveLong();
+            int value = (int)((key * 7) % 1000);
+            Assert.assertEquals(value, 100 + cnt / 5);
+            if (cnt % 5 != 0)
+                assert(key > previous);             // equal values are ordered by key
+            previous = key;
+            ++cnt;
+        }
+        Assert.assertEquals(cnt, 500);
+
+        Assert.assertEquals(count(myIndex.prefixIterator("IND09", 7)), 500);
+        Assert.assertEquals(count(myIndex.rangeIterator(null, "IND0009", 3, 0)), 50);
+        Assert.assertEquals(count(myIndex.rangeIterator("IND0995", null, 3, 2)), 23);
+        Assert.assertEquals(count(myIndex.rangeIterator("J", null, 3, 0)), 0);
+
+        // updates move the entry
+        myIndex.update(0L, "IND0000", "IND5000");
+        Assert.assertEquals(count(myIndex.prefixIterator("IND5", 10)), 1);
+        Assert.assertEquals(count(myIndex.prefixIterator("IND0000", 10)), 4);
+        myIndex.close();
+    }
+
+    // the committed view sees the ordered entries of the last commit, and rollbacks restore the previous order
+    public void runTransactionTest() {
+        OffHeapTransaction tx1 = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard s1 = new Shard();
+        s1.setOwningTransaction(tx1);
+        IndexString myIndex = new IndexString.Builder().setOrdered().setShard(s1).addCommittedView().build();
+        PrimitiveLongKeyOffHeapIndexView<String> myView = myIndex.getView();
+
+        for (int i = 0; i < 100; ++i)
+            myIndex.create(i, "A" + i);
+        Assert.assertEquals(count(myIndex.prefixIterator("A", 8)), 100);
+        Assert.assertEquals(count(myView.prefixIterator("A", 8)), 0);
+        tx1.commit();
+        Assert.assertEquals(count(myView.prefixIterator("A", 8)), 100);
+
+        for (int i = 0; i < 50; ++i)
+            myIndex.update(i, "A" + i, "B" + i);
+        Assert.assertEquals(count(myIndex.prefixIterator("B", 8)), 50);
+        tx1.rollback();
+        Assert.assertEquals(count(myIndex.prefixIterator("B", 8)), 0);
+        Assert.assertEquals(count(myIndex.prefixIterator("A", 8)), 100);
+
+        for (int i = 0; i < 50; ++i)
+            myIndex.delete(i, "A" + i);
+        tx1.commit();
+        Assert.assertEquals(count(myView.prefixIterator("A", 8)), 50);
+        Assert.assertEquals(count(myView.rangeIterator("A5", "A6", 8, 0)), 10);     // A50 ... A59
+
+        tx1.close();
+        myIndex.close();
+    }
+}
@@ -0,0 +1,75 @@
+package de.jpaw.offHeap;
+
+import java.util.Iterator;
+
+import org.testng.annotations.Test;
+
+import de.jpaw.collections.PrimitiveLongKeyMapView;
+
+@Test
+public class OrderedMapTest {
+    static public final int NUM_ENTRIES = 100000;
+
+    // iteration returns the keys in ascending order, also after deletes
+    public void runOrderedIterationTest() {
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setAutonomous()
+            .setOrdered()
+            .build();
+        for (int i = NUM_ENTRIES - 1; i >= 0; --i)
+            myMap.set(i * 3L, "value " + i);
+        for (int i = 0; i < NUM_ENTRIES; i += 2)
+            assert(myMap.delete(i * 3L));
+        assert(myMap.size() == NUM_ENTRIES / 2);
+
+        long previous = -1L;
+        int count = 0;
+        for (PrimitiveLongKeyMapView.Entry<String> e : myMap) {
+            assert(e.getKey() > previous);
+            previous = e.getKey();
+            ++count;
+        }
+        assert(count == NUM_ENTRIES / 2);
+        myMap.close();
+    }
+
+    // range scans and neighbour lookups, on time ordered keys
+    public void runRangeTest() {
+        OffHeapTransaction tx1 = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard s1 = new Shard();
+        s1.setOwningTransaction(tx1);
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setShard(s1)
+            .addCommittedView()
+            .setOrdered()
+            .build();
+        PrimitiveLongKeyOffHeapMapView<String> myView = myMap.getView();
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.set(1000L + 10 * i, "v" + i);
+        tx1.commit();
+
+        assert(myView.floorKey(1015L) == 1010L);
+        assert(myView.ceilingKey(1015L) == 1020L);
+        assert(myView.higherKey(1020L) == 1030L);
+        assert(myView.lowerKey(1020L) == 1010L);
+        assert(myView.lowerKey(1000L) == null);
+        assert(myView.ceilingKey(Long.MAX_VALUE) == null);
+
+        long [] keys = new long [10];
+        assert(myView.getKeys(1000L, 1045L, keys) == 5);
+        assert(keys[4] == 1040L);
+
+        int count = 0;
+        Iterator<PrimitiveLongKeyMapView.Entry<String>> it = myView.getRange(2000L, 9999L);
+        while (it.hasNext()) {
+            PrimitiveLongKeyMapView.Entry<String> e = it.next();
+            assert(e.getKey() == 2000L + 10 * count);
+            assert(("v" + (100 + count)).equals(e.getValue()));
+            ++count;
+        }
+        assert(count == 800);
+
+        tx1.close();
+        myMap.close();
+    }
+}
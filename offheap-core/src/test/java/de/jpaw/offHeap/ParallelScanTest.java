@@ -0,0 +1,113 @@
+package de.jpaw.offHeap;
+
+import java.nio.ByteBuffer;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicIntegerArray;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class ParallelScanTest {
+    private static final int NUM = 20000;
+    private static final int PARTITIONS = 4;
+
+    // scans a committed view by several threads, while a commit waits for the scan to finish
+    public void runParallelScanTest() throws Exception {
+        final OffHeapTransaction tx = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard shard = new Shard();
+        shard.setOwningTransaction(tx);
+        final LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setHashSize(4000)
+            .setShard(shard)
+            .addCommittedView()
+            .build();
+        PrimitiveLongKeyOffHeapMapView<String> myView = myMap.getView();
+        for (int i = 0; i < NUM; ++i)
+            myMap.set(i, "row " + i);
+        tx.commit();
+
+        final AtomicIntegerArray seen = new AtomicIntegerArray(NUM + 1);
+        final AtomicBoolean committed = new AtomicBoolean(false);
+        Thread writer;
+        try (final PrimitiveLongKeyOffHeapMapView<String>.ParallelScan scan = myView.parallelScan(PARTITIONS)) {
+            Assert.assertEquals(scan.getNumberOfPartitions(), PARTITIONS);
+
+            // the commit of a concurrent writer is delayed until the scan is closed
+            writer = new Thread(new Runnable() {
+                @Override
+                public void run() {
+                    myMap.set(NUM, "new row");
+                    myMap.remove(0L);
+                    tx.commit();
+                    committed.set(true);
+                }
+            });
+            writer.start();
+
+            Thread [] scanners = new Thread [PARTITIONS];
+            for (int p = 0; p < PARTITIONS; ++p) {
+                final int partition = p;
+                scanners[p] = new Thread(new Runnable() {
+                    @Override
+                    public void run() {
+                        ByteBuffer buffer = ByteBuffer.allocateDirect(1000);
+                        PrimitiveLongKeyOffHeapMapView<String>.EntryChunkIterator chunks = scan.chunkIterator(partition, buffer, 50, false);
+                        while (chunks.hasNext()) {
+                            int n = chunks.nextChunk();
+                            for (int j = 0; j < n; ++j)
+                                seen.incrementAndGet((int)buffer.getLong());
+                        }
+                    }
+                });
+                scanners[p].start();
+            }
+            for (Thread t : scanners)
+                t.join();
+            Assert.assertFalse(committed.get());
+        }
+        writer.join();
+        Assert.assertTrue(committed.get());
+
+        // every row of the view before the commit has been returned exactly once
+        for (int i = 0; i < NUM; ++i)
+            Assert.assertEquals(seen.get(i), 1);
+        Assert.assertEquals(seen.get(NUM), 0);
+        Assert.assertEquals(myView.get(NUM), "new row");
+        Assert.assertNull(myView.get(0L));
+
+        tx.close();
+        myMap.close();
+    }
+
+    // pins are kept per view: a scan of one map does not delay commits to another, and a commit of the scanning thread is rejected
+    public void runPinPerViewTest() throws Exception {
+        OffHeapTransaction tx = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard shard = new Shard();
+        shard.setOwningTransaction(tx);
+        LongToStringOffHeapMap scanned = new LongToStringOffHeapMap.Builder().setShard(shard).addCommittedView().build();
+        LongToStringOffHeapMap other = new LongToStringOffHeapMap.Builder().setShard(shard).addCommittedView().build();
+        scanned.set(1L, "scanned");
+        tx.commit();
+
+        try (PrimitiveLongKeyOffHeapMapView<String>.ParallelScan scan = scanned.getView().parallelScan(2)) {
+            other.set(2L, "other");
+            tx.commit();
+            Assert.assertEquals(other.getView().get(2L), "other");
+
+            scanned.set(3L, "pending");
+            try {
+                tx.commit();
+                Assert.fail("commit to the pinned view not rejected");
+            } catch (RuntimeException e) {
+                Assert.assertNull(scanned.getView().get(3L));
+            }
+        }
+        tx.commit();
+        Assert.assertEquals(scanned.getView().get(3L), "pending");
+
+        tx.close();
+        other.close();
+        scanned.close();
+    }
+}
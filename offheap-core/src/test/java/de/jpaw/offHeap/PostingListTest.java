@@ -0,0 +1,63 @@
+package de.jpaw.offHeap;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+import de.jpaw.collections.PrimitiveLongIterator;
+
+@Test
+public class PostingListTest {
+    static public final int NUM = 100000;
+
+    private int count(PrimitiveLongIterator it) {
+        int cnt = 0;
+        long last = Long.MIN_VALUE;
+        while (it.hasNext()) {
+            long key = it.nextAsPrimitiveLong();
+            Assert.assertTrue(key > last);      // posting lists return the keys in ascending order
+            last = key;
+            ++cnt;
+        }
+        return cnt;
+    }
+
+    // a low cardinality value: paging does not walk the other entries
+    public void runPagingTest() {
+        IndexLong status = new IndexLong.Builder().setAutonomous().build();
+        for (int i = 1; i <= NUM; ++i)
+            status.create(i, Long.valueOf(i % 4));
+        Assert.assertEquals(status.size(), NUM);
+        Assert.assertEquals(count(status.iterator(Long.valueOf(1L))), NUM / 4);
+        Assert.assertEquals(count(status.iterator(Long.valueOf(1L), 100, NUM / 4 - 10)), 10);
+        Assert.assertEquals(count(status.iterator(Long.valueOf(5L), 100, 0)), 0);
+
+        for (int i = 1; i <= NUM; i += 4)
+            status.update(i, Long.valueOf(1L), Long.valueOf(2L));
+        Assert.assertEquals(count(status.iterator(Long.valueOf(1L))), 0);
+        Assert.assertEquals(count(status.iterator(Long.valueOf(2L), 1000, 0)), NUM / 2);
+        for (int i = 2; i <= NUM; i += 4)
+            status.delete(i, Long.valueOf(2L));
+        Assert.assertEquals(status.size(), NUM - NUM / 4);
+        status.close();
+    }
+
+    // intersections and unions of two indexes
+    public void runCombineTest() {
+        IndexLong status = new IndexLong.Builder().setAutonomous().build();
+        IndexLong tenant = new IndexLong.Builder().setAutonomous().build();
+        for (int i = 1; i <= NUM; ++i) {
+            status.create(i, Long.valueOf(i % 2));
+            tenant.create(i, Long.valueOf(i % 3));
+        }
+        long [] keys = new long [NUM];
+        int n = PrimitiveLongKeyOffHeapIndexView.combine(status, Long.valueOf(0L), tenant, Long.valueOf(0L), true, keys, 0);
+        Assert.assertEquals(n, NUM / 6);
+        Assert.assertEquals(keys[0], 6L);
+        n = PrimitiveLongKeyOffHeapIndexView.combine(status, Long.valueOf(0L), tenant, Long.valueOf(0L), false, keys, 10);
+        Assert.assertEquals(n, NUM / 2 + NUM / 3 - NUM / 6 - 10);
+        n = PrimitiveLongKeyOffHeapIndexView.combine(status, Long.valueOf(7L), tenant, Long.valueOf(0L), true, keys, 0);
+        Assert.assertEquals(n, 0);
+        status.close();
+        tenant.close();
+    }
+}
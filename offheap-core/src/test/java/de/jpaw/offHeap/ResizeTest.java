@@ -0,0 +1,68 @@
+package de.jpaw.offHeap;
+
+import java.nio.charset.Charset;
+import java.nio.charset.StandardCharsets;
+
+import org.testng.annotations.Test;
+
+@Test
+public class ResizeTest {
+    static public Charset defCS = StandardCharsets.UTF_8;
+    static public final int NUM_ENTRIES = 100000;
+
+    // a map created with a tiny hash size must grow on the fly, and keep short chains
+    public void runGrowTest() {
+        LongToByteArrayOffHeapMap myMap = LongToByteArrayOffHeapMap.forHashSize(32);
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            myMap.set(i, ("value " + i).getBytes(defCS));
+        assert(myMap.size() == NUM_ENTRIES);
+        myMap.verifyMaxChainLength(8);
+        for (int i = 0; i < NUM_ENTRIES; ++i)
+            assert(("value " + i).equals(new String(myMap.get(i), defCS)));
+
+        int count = 0;
+        for (@SuppressWarnings("unused") Object e : myMap)
+            ++count;
+        assert(count == NUM_ENTRIES);
+        myMap.close();
+    }
+
+    // the committed view is resized independently, within commit, and must stay consistent with rollbacks
+    public void runGrowWithViewTest() {
+        OffHeapTransaction tx1 = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard s1 = new Shard();
+        s1.setOwningTransaction(tx1);
+
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setHashSize(32)
+            .setShard(s1)
+            .addCommittedView()
+            .build();
+        PrimitiveLongKeyOffHeapMapView<String> myView = myMap.getView();
+
+        for (int i = 0; i < 5000; ++i)
+            myMap.set(i, "v" + i);
+        tx1.commit();
+        assert(myView.size() == 5000);
+
+        for (int i = 5000; i < 20000; ++i)
+            myMap.set(i, "v" + i);
+        for (int i = 0; i < 1000; ++i)
+            myMap.delete(i);
+        tx1.rollback();
+        assert(myMap.size() == 5000);
+        for (int i = 0; i < 20000; ++i)
+            assert(myMap.containsKey(i) == (i < 5000));
+
+        for (int i = 5000; i < 20000; ++i)
+            myMap.set(i, "v" + i);
+        tx1.commit();
+        assert(myView.size() == 20000);
+        myView.verifyMaxChainLength(8);
+        for (int i = 0; i < 20000; ++i)
+            assert(("v" + i).equals(myView.get(i)));
+
+        tx1.close();
+        myMap.close();
+    }
+}
@@ -0,0 +1,54 @@
+package de.jpaw.offHeap;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class ScanTest {
+    static public final int NUM = 10000;
+
+    private static byte [] bytes(String s) {
+        return s.getBytes(StandardCharsets.UTF_8);
+    }
+
+    // scans with a small buffer, such that multiple calls are required
+    public void runScanTest() {
+        LongToStringOffHeapMap map = new LongToStringOffHeapMap.Builder().setHashSize(NUM).setAutonomous().build();
+        for (int i = 0; i < NUM; ++i)
+            map.set(i, "name" + i + ";city" + (i % 10) + ";" + String.format("%05d", i));
+
+        ScanSpec spec = new ScanSpec((byte)';')
+            .fieldEquals(1, bytes("city3"))
+            .fieldRange(2, bytes("01000"), bytes("01999"))
+            .project(0);
+        ScanSpec.Cursor cursor = new ScanSpec.Cursor();
+        ByteBuffer buffer = ByteBuffer.allocateDirect(200);
+        int rows = 0;
+        while (!cursor.isAtEnd()) {
+            buffer.clear();
+            int n = map.scan(spec, cursor, buffer);
+            buffer.flip();
+            for (int i = 0; i < n; ++i) {
+                long key = buffer.getLong();
+                byte [] name = new byte [buffer.getInt()];
+                buffer.get(name);
+                Assert.assertEquals(key % 10, 3L);
+                Assert.assertEquals(new String(name, StandardCharsets.UTF_8), "name" + key);
+            }
+            Assert.assertEquals(buffer.remaining(), 0);
+            rows += n;
+        }
+        Assert.assertEquals(rows, 100);
+
+        // prefix, without projection: only the keys
+        cursor.reset();
+        buffer = ByteBuffer.allocateDirect(NUM * 8);
+        Assert.assertEquals(map.scan(new ScanSpec((byte)';').fieldPrefix(0, bytes("name99")), cursor, buffer), 11);
+        Assert.assertTrue(cursor.isAtEnd());
+        Assert.assertEquals(buffer.position(), 11 * 8);
+        map.close();
+    }
+}
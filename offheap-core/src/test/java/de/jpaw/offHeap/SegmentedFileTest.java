@@ -0,0 +1,53 @@
+package de.jpaw.offHeap;
+
+import java.io.File;
+import java.io.RandomAccessFile;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class SegmentedFileTest {
+    private static final int NUM = 20000;
+    private static final int SEGMENTS = 4;
+
+    private void runSegmentedFile(boolean openAddressing) throws Exception {
+        LongToStringOffHeapMap myMap = DumpTestSupport.buildFilledMap(openAddressing, NUM);
+        File tmp = DumpTestSupport.tmpFile("segmentedFileTest.db");
+        myMap.writeSegmentedFile(tmp.getPath(), null, false, SEGMENTS);
+        LongToStringOffHeapMap myMap2 = DumpTestSupport.buildMap(openAddressing);
+        myMap2.readSegmentedFile(tmp.getPath(), null);
+        DumpTestSupport.assertSameContents(myMap, myMap2, NUM);
+
+        // a damaged segment is detected before the map is changed
+        File segment = new File(tmp.getPath() + ".2");
+        try (RandomAccessFile raf = new RandomAccessFile(segment, "rw")) {
+            raf.seek(100);
+            int b = raf.read();
+            raf.seek(100);
+            raf.write(b ^ 0x55);
+        }
+        LongToStringOffHeapMap myMap3 = DumpTestSupport.buildMap(openAddressing);
+        try {
+            myMap3.readSegmentedFile(tmp.getPath(), null);
+            Assert.fail("corrupted segment not detected");
+        } catch (RuntimeException e) {
+            Assert.assertEquals(myMap3.size(), 0);
+        }
+
+        myMap3.close();
+        myMap2.close();
+        tmp.delete();
+        for (int i = 0; i < SEGMENTS; ++i)
+            new File(tmp.getPath() + "." + i).delete();
+        myMap.close();
+    }
+
+    public void runSegmentedHashTest() throws Exception {
+        runSegmentedFile(false);
+    }
+
+    public void runSegmentedOpenAddressingTest() throws Exception {
+        runSegmentedFile(true);
+    }
+}
@@ -0,0 +1,86 @@
+package de.jpaw.offHeap;
+
+import org.testng.Assert;
+import org.testng.annotations.Test;
+
+@Test
+public class SnapshotTest {
+
+    // a snapshot keeps returning the values of the commit it was opened at, while further commits are applied to the view
+    public void runSnapshotTest() throws Exception {
+        OffHeapTransaction tx = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard shard = new Shard();
+        shard.setOwningTransaction(tx);
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setHashSize(1000)
+            .setShard(shard)
+            .addCommittedView()
+            .build();
+        PrimitiveLongKeyOffHeapMapView<String> myView = myMap.getView();
+
+        myMap.set(1L, "one");
+        myMap.set(2L, "two");
+        tx.commit();
+
+        OffHeapSnapshot<String> first = myMap.openSnapshot();
+        myMap.set(1L, "uno");
+        myMap.remove(2L);
+        myMap.set(3L, "tres");
+        tx.commit();
+
+        OffHeapSnapshot<String> second = myMap.openSnapshot();
+        Assert.assertTrue(second.getCommittedRef() > first.getCommittedRef());
+        for (int i = 0; i < 100; ++i) {
+            myMap.set(1L, "eins " + i);
+            tx.commit();
+        }
+
+        Assert.assertEquals(first.get(1L), "one");
+        Assert.assertEquals(first.get(2L), "two");
+        Assert.assertNull(first.get(3L));
+        Assert.assertEquals(first.length(2L), 3);
+        Assert.assertEquals(second.get(1L), "uno");
+        Assert.assertFalse(second.containsKey(2L));
+        Assert.assertEquals(second.get(3L), "tres");
+        Assert.assertEquals(myView.get(1L), "eins 99");
+
+        // the versions only needed by the first snapshot are freed after it has been closed
+        Assert.assertEquals(myMap.reclaimVersions(), 0);
+        first.close();
+        Assert.assertEquals(myMap.reclaimVersions(), 3);
+        Assert.assertEquals(second.get(1L), "uno");
+        second.close();
+        Assert.assertEquals(myMap.reclaimVersions(), 100);
+
+        tx.close();
+        myMap.close();
+    }
+
+    // keys not changed since the snapshot are read from the view, along its own chains, while uncommitted inserts have grown the map.
+    // The keys are multiples of 4096, which share a slot in the small array of the view, but not in the grown one of the map.
+    public void runSnapshotAfterDirtyResizeTest() throws Exception {
+        OffHeapTransaction tx = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard shard = new Shard();
+        shard.setOwningTransaction(tx);
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setHashSize(64)
+            .setShard(shard)
+            .addCommittedView()
+            .build();
+        for (long i = 0; i < 200; ++i)
+            myMap.set(i << 12, "committed " + i);
+        tx.commit();
+
+        OffHeapSnapshot<String> snapshot = myMap.openSnapshot();
+        for (long i = 1000000; i < 1050000; ++i)
+            myMap.set(i, "dirty " + i);
+        for (long i = 0; i < 200; ++i)
+            Assert.assertEquals(snapshot.get(i << 12), "committed " + i);
+        Assert.assertNull(snapshot.get(1000000L));
+
+        snapshot.close();
+        tx.rollback();
+        tx.close();
+        myMap.close();
+    }
+}
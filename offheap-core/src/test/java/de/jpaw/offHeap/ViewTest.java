@@ -1,5 +1,10 @@
 package de.jpaw.offHeap;
 
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+import java.util.HashSet;
+import java.util.Set;
+
 import org.testng.annotations.Test;
 
 import de.jpaw.collections.PrimitiveLongKeyMapView;
@@ -109,4 +114,54 @@ public class ViewTest {
         myMap.close();
     }
 
+    // The committed keys stay readable through the view while uncommitted inserts have grown the bucket array of the map.
+    // The keys are multiples of 4096, which share a slot in the small array of the view, but not in the grown one of the map.
+    public void runViewAfterDirtyResizeTest() throws Exception {
+        OffHeapTransaction tx1 = new OffHeapTransaction(OffHeapTransaction.TRANSACTIONAL);
+        Shard s1 = new Shard();
+        s1.setOwningTransaction(tx1);
+
+        LongToStringOffHeapMap myMap = new LongToStringOffHeapMap.Builder()
+            .setHashSize(64)
+            .setShard(s1)
+            .addCommittedView()
+            .build();
+        PrimitiveLongKeyOffHeapMapView<String> myView = myMap.getView();
+
+        for (long i = 0; i < 200; ++i)
+            myMap.set(i << 12, "committed " + i);
+        tx1.commit();
+        for (long i = 1000000; i < 1050000; ++i)
+            myMap.set(i, "dirty " + i);
+
+        assert(myView.size() == 200);
+        for (long i = 0; i < 200; ++i)
+            assert(("committed " + i).equals(myView.get(i << 12)));
+        assert(myView.get(1000000L) == null);
+
+        // the iteration follows the chains of the view as well: every committed key once, no uncommitted one
+        Set<Long> seen = new HashSet<Long>();
+        for (PrimitiveLongKeyMapView.Entry<String> e : myView) {
+            assert(seen.add(e.getKey()));
+            assert(e.getKey() % 4096 == 0 && ("committed " + (e.getKey() >> 12)).equals(e.getValue()));
+        }
+        assert(seen.size() == 200);
+
+        long [] keys = new long [200];
+        for (int i = 0; i < 200; ++i)
+            keys[i] = (long)i << 12;
+        ByteBuffer target = ByteBuffer.allocateDirect(10000);
+        assert(myView.getBatch(keys, target) == 200);
+        target.flip();
+        for (int i = 0; i < 200; ++i) {
+            byte [] data = new byte [target.getInt()];
+            target.get(data);
+            assert(("committed " + i).equals(new String(data, StandardCharsets.UTF_8)));
+        }
+
+        tx1.commit();
+        assert(myView.size() == 50200);
+        tx1.close();
+        myMap.close();
+    }
 }